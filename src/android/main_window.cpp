@@ -1244,6 +1244,7 @@ std::vector<glaxnimate::model::VisualNode*> MainWindow::cleaned_selection() cons
 std::vector<glaxnimate::io::mime::MimeSerializer *> MainWindow::supported_mimes() const
 {
     return {
+        io::IoRegistry::instance().serializer_from_slug("glaxnimate-binary"),
         io::IoRegistry::instance().serializer_from_slug("glaxnimate")
     };
 }
@@ -25,17 +25,21 @@ glaxnimate::command::SetKeyframe::SetKeyframe(
 
 void glaxnimate::command::SetKeyframe::undo()
 {
+    if ( !unspill() )
+        return;
     if ( had_before )
         prop->set_keyframe(time, before);
     else
         prop->remove_keyframe_at_time(time);
 
     if ( insert_index > 0 )
-        prop->keyframe(insert_index-1)->set_transition(trans_before);
+        prop->set_keyframe_transition(insert_index-1, trans_before);
 }
 
 void glaxnimate::command::SetKeyframe::redo()
 {
+    if ( !unspill() )
+        return;
     if ( !calculated )
     {
         auto mid = prop->mid_transition(time);
@@ -66,8 +70,8 @@ void glaxnimate::command::SetKeyframe::redo()
 
     if ( insert_index > 0 )
     {
-        prop->keyframe(insert_index-1)->set_transition(left);
-        prop->keyframe(insert_index)->set_transition(right);
+        prop->set_keyframe_transition(insert_index-1, left);
+        prop->set_keyframe_transition(insert_index, right);
     }
 
 }
@@ -76,10 +80,29 @@ bool glaxnimate::command::SetKeyframe::merge_with(const SetKeyframe& other)
 {
     if ( other.prop != prop )
         return false;
+    if ( !unspill() )
+        return false;
     after = other.after;
     return true;
 }
 
+qint64 glaxnimate::command::SetKeyframe::spillable_size() const
+{
+    return variant_size(before) + variant_size(after);
+}
+
+void glaxnimate::command::SetKeyframe::spill(QDataStream& stream)
+{
+    spill_variant(stream, before);
+    spill_variant(stream, after);
+}
+
+void glaxnimate::command::SetKeyframe::restore(QDataStream& stream)
+{
+    restore_variant(stream, before);
+    restore_variant(stream, after);
+}
+
 glaxnimate::command::RemoveKeyframeTime::RemoveKeyframeTime(
     model::AnimatableBase* prop,
     model::FrameTime time
@@ -101,13 +124,13 @@ void glaxnimate::command::RemoveKeyframeTime::undo()
 {
     prop->set_keyframe(time, before);
     if ( index > 0 )
-        prop->keyframe(index-1)->set_transition(prev_transition_before);
+        prop->set_keyframe_transition(index-1, prev_transition_before);
 }
 
 void glaxnimate::command::RemoveKeyframeTime::redo()
 {
     if ( index > 0 )
-        prop->keyframe(index-1)->set_transition(prev_transition_after);
+        prop->set_keyframe_transition(index-1, prev_transition_after);
     prop->remove_keyframe(index);
 }
 
@@ -132,14 +155,14 @@ void glaxnimate::command::RemoveKeyframeIndex::undo()
 {
     prop->set_keyframe(time, before, nullptr, true);
     if ( index > 0 )
-        prop->keyframe(index-1)->set_transition(prev_transition_before);
+        prop->set_keyframe_transition(index-1, prev_transition_before);
 
 }
 
 void glaxnimate::command::RemoveKeyframeIndex::redo()
 {
     if ( index > 0 )
-        prop->keyframe(index-1)->set_transition(prev_transition_after);
+        prop->set_keyframe_transition(index-1, prev_transition_after);
     prop->remove_keyframe(index);
 }
 
@@ -205,6 +228,8 @@ void glaxnimate::command::SetMultipleAnimated::push_property_not_animated(model:
 
 void glaxnimate::command::SetMultipleAnimated::undo()
 {
+    if ( !unspill() )
+        return;
     for ( int i = 0; i < int(props.size()); i++ )
     {
         auto prop = props[i];
@@ -242,6 +267,8 @@ void glaxnimate::command::SetMultipleAnimated::undo()
 
 void glaxnimate::command::SetMultipleAnimated::redo()
 {
+    if ( !unspill() )
+        return;
     for ( int i = 0; i < int(props.size()); i++ )
     {
         auto prop = props[i];
@@ -276,10 +303,38 @@ bool glaxnimate::command::SetMultipleAnimated::merge_with(const SetMultipleAnima
         if ( props_not_animated[i] != other.props_not_animated[i] )
             return false;
 
+    if ( !unspill() )
+        return false;
     after = other.after;
     return true;
 }
 
+qint64 glaxnimate::command::SetMultipleAnimated::spillable_size() const
+{
+    qint64 size = 0;
+    for ( const auto& value : before )
+        size += variant_size(value);
+    for ( const auto& value : after )
+        size += variant_size(value);
+    return size;
+}
+
+void glaxnimate::command::SetMultipleAnimated::spill(QDataStream& stream)
+{
+    for ( auto& value : before )
+        spill_variant(stream, value);
+    for ( auto& value : after )
+        spill_variant(stream, value);
+}
+
+void glaxnimate::command::SetMultipleAnimated::restore(QDataStream& stream)
+{
+    for ( auto& value : before )
+        restore_variant(stream, value);
+    for ( auto& value : after )
+        restore_variant(stream, value);
+}
+
 QString glaxnimate::command::SetMultipleAnimated::auto_name(model::AnimatableBase* prop)
 {
     bool key_before = prop->has_keyframe(prop->time());
@@ -338,12 +393,12 @@ glaxnimate::command::SetKeyframeTransition::SetKeyframeTransition(
 
 void glaxnimate::command::SetKeyframeTransition::undo()
 {
-    keyframe()->set_transition(undo_value);
+    prop->set_keyframe_transition(keyframe_index, undo_value);
 }
 
 void glaxnimate::command::SetKeyframeTransition::redo()
 {
-    keyframe()->set_transition(redo_value);
+    prop->set_keyframe_transition(keyframe_index, redo_value);
 }
 
 glaxnimate::model::KeyframeBase* glaxnimate::command::SetKeyframeTransition::keyframe() const
@@ -406,13 +461,59 @@ void glaxnimate::command::RemoveAllKeyframes::undo()
 {
     for ( const auto& kf : keyframes )
     {
-        prop->set_keyframe(kf.time, kf.value, nullptr, true)->set_transition(kf.transition);
+        model::AnimatableBase::SetKeyframeInfo info;
+        if ( prop->set_keyframe(kf.time, kf.value, &info, true) )
+            prop->set_keyframe_transition(info.index, kf.transition);
     }
     prop->set_time(prop->time());
     prop->set_value(before);
 }
 
 
+glaxnimate::command::ReplaceKeyframes::ReplaceKeyframes(model::AnimatableBase* prop, std::vector<Keyframe> keyframes)
+    : QUndoCommand(QObject::tr("Update %1 keyframes").arg(prop->name())),
+      prop(prop),
+      after(std::move(keyframes)),
+      value_before(prop->value())
+{
+    int count = prop->keyframe_count();
+    before.reserve(count);
+    for ( int i = 0; i < count; i++ )
+    {
+        auto kf = prop->keyframe(i);
+        before.push_back({
+            kf->time(),
+            kf->value(),
+            kf->transition()
+        });
+    }
+}
+
+void glaxnimate::command::ReplaceKeyframes::apply(const std::vector<Keyframe>& keyframes)
+{
+    prop->clear_keyframes();
+    for ( const auto& kf : keyframes )
+    {
+        model::AnimatableBase::SetKeyframeInfo info;
+        if ( prop->set_keyframe(kf.time, kf.value, &info, true) )
+            prop->set_keyframe_transition(info.index, kf.transition);
+    }
+    prop->set_time(prop->time());
+}
+
+void glaxnimate::command::ReplaceKeyframes::redo()
+{
+    apply(after);
+}
+
+void glaxnimate::command::ReplaceKeyframes::undo()
+{
+    apply(before);
+    if ( before.empty() )
+        prop->set_value(value_before);
+}
+
+
 glaxnimate::command::SetPositionBezier::SetPositionBezier(
     model::detail::AnimatedPropertyPosition* prop,
     math::bezier::Bezier after,
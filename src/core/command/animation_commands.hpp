@@ -9,13 +9,14 @@
 #include "base.hpp"
 
 #include "command/base.hpp"
+#include "command/spill_store.hpp"
 #include "model/animation/animatable.hpp"
 #include "model/document.hpp"
 #include "model/object.hpp"
 
 namespace glaxnimate::command {
 
-class SetKeyframe : public MergeableCommand<Id::SetKeyframe, SetKeyframe>
+class SetKeyframe : public MergeableCommand<Id::SetKeyframe, SetKeyframe>, public SpillableCommand
 {
 public:
     SetKeyframe(
@@ -32,6 +33,12 @@ public:
 
     bool merge_with(const SetKeyframe& other);
 
+    qint64 spillable_size() const override;
+
+protected:
+    void spill(QDataStream& stream) override;
+    void restore(QDataStream& stream) override;
+
 private:
     model::AnimatableBase* prop;
     model::FrameTime time;
@@ -113,12 +120,43 @@ private:
     QVariant after;
 };
 
+/**
+ * \brief Replaces all the keyframes of a property in a single step
+ */
+class ReplaceKeyframes : public QUndoCommand
+{
+public:
+    struct Keyframe
+    {
+        model::FrameTime time;
+        QVariant value;
+        model::KeyframeTransition transition = {};
+    };
+
+    /**
+     * \pre \p keyframes is sorted by time
+     */
+    ReplaceKeyframes(model::AnimatableBase* prop, std::vector<Keyframe> keyframes);
+
+    void undo() override;
+
+    void redo() override;
+
+private:
+    void apply(const std::vector<Keyframe>& keyframes);
+
+    model::AnimatableBase* prop;
+    std::vector<Keyframe> before;
+    std::vector<Keyframe> after;
+    QVariant value_before;
+};
+
 
 /**
  * \brief Command that sets multiple animated properties at once,
  * setting keyframes based on the document record_to_keyframe
  */
-class SetMultipleAnimated : public MergeableCommand<Id::SetMultipleAnimated, SetMultipleAnimated>
+class SetMultipleAnimated : public MergeableCommand<Id::SetMultipleAnimated, SetMultipleAnimated>, public SpillableCommand
 {
 public:
     SetMultipleAnimated(model::AnimatableBase* prop, QVariant after, bool commit);
@@ -160,6 +198,12 @@ public:
 
     bool empty() const;
 
+    qint64 spillable_size() const override;
+
+protected:
+    void spill(QDataStream& stream) override;
+    void restore(QDataStream& stream) override;
+
 private:
     static QString auto_name(model::AnimatableBase* prop);
 
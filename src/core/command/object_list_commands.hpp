@@ -53,6 +53,46 @@ private:
 };
 
 
+/**
+ * \brief Adds several consecutive objects, notifying the change as a single span
+ */
+template<class ItemT, class PropT = model::ObjectListProperty<ItemT>>
+class AddObjects : public QUndoCommand
+{
+public:
+    AddObjects(
+        PropT* object_parent,
+        std::vector<std::unique_ptr<ItemT>> objects,
+        int position = -1,
+        QUndoCommand* parent = nullptr,
+        const QString& name = {}
+    )
+        : QUndoCommand(name.isEmpty() ? QObject::tr("Create %1 Objects").arg(objects.size()) : name, parent),
+          object_parent(object_parent),
+          objects(std::move(objects)),
+          position(position == -1 ? object_parent->size() : position),
+          count(this->objects.size())
+    {}
+
+    void undo() override
+    {
+        objects = object_parent->remove_range(position, count);
+    }
+
+    void redo() override
+    {
+        object_parent->insert_range(std::move(objects), position);
+        objects.clear();
+    }
+
+private:
+    PropT* object_parent;
+    std::vector<std::unique_ptr<ItemT>> objects;
+    int position;
+    int count;
+};
+
+
 template<class ItemT, class PropT = model::ObjectListProperty<ItemT>>
 class RemoveObject : public QUndoCommand
 {
@@ -9,11 +9,12 @@
 #include <QVector>
 
 #include "command/base.hpp"
+#include "command/spill_store.hpp"
 #include "model/property/property.hpp"
 
 namespace glaxnimate::command {
 
-class SetPropertyValue : public MergeableCommand<Id::SetPropertyValue, SetPropertyValue>
+class SetPropertyValue : public MergeableCommand<Id::SetPropertyValue, SetPropertyValue>, public SpillableCommand
 {
 public:
     SetPropertyValue(model::BaseProperty* prop, const QVariant& value, bool commit = true)
@@ -29,11 +30,15 @@ public:
 
     void undo() override
     {
+        if ( !unspill() )
+            return;
         prop->set_value(before);
     }
 
     void redo() override
     {
+        if ( !unspill() )
+            return;
         prop->set_value(after);
     }
 
@@ -42,10 +47,30 @@ public:
     {
         if ( other.prop != prop )
             return false;
+        if ( !unspill() )
+            return false;
         after = other.after;
         return true;
     }
 
+    qint64 spillable_size() const override
+    {
+        return variant_size(before) + variant_size(after);
+    }
+
+protected:
+    void spill(QDataStream& stream) override
+    {
+        spill_variant(stream, before);
+        spill_variant(stream, after);
+    }
+
+    void restore(QDataStream& stream) override
+    {
+        restore_variant(stream, before);
+        restore_variant(stream, after);
+    }
+
 private:
     model::BaseProperty* prop;
     QVariant before;
@@ -53,7 +78,7 @@ private:
 };
 
 
-class SetMultipleProperties : public MergeableCommand<Id::SetMultipleProperties, SetMultipleProperties>
+class SetMultipleProperties : public MergeableCommand<Id::SetMultipleProperties, SetMultipleProperties>, public SpillableCommand
 {
 public:
     template<class... Args>
@@ -86,12 +111,16 @@ public:
 
     void undo() override
     {
+        if ( !unspill() )
+            return;
         for ( int i = 0; i < props.size(); i++ )
             props[i]->set_value(before[i]);
     }
 
     void redo() override
     {
+        if ( !unspill() )
+            return;
         for ( int i = 0; i < props.size(); i++ )
             props[i]->set_value(after[i]);
     }
@@ -106,10 +135,39 @@ public:
             if ( props[i] != other.props[i] )
                 return false;
 
+        if ( !unspill() )
+            return false;
         after = other.after;
         return true;
     }
 
+    qint64 spillable_size() const override
+    {
+        qint64 size = 0;
+        for ( const auto& value : before )
+            size += variant_size(value);
+        for ( const auto& value : after )
+            size += variant_size(value);
+        return size;
+    }
+
+protected:
+    void spill(QDataStream& stream) override
+    {
+        for ( auto& value : before )
+            spill_variant(stream, value);
+        for ( auto& value : after )
+            spill_variant(stream, value);
+    }
+
+    void restore(QDataStream& stream) override
+    {
+        for ( auto& value : before )
+            restore_variant(stream, value);
+        for ( auto& value : after )
+            restore_variant(stream, value);
+    }
+
 private:
     QVector<model::BaseProperty*> props;
     QVariantList before;
@@ -15,6 +15,7 @@ namespace glaxnimate::model { class Group; }
 namespace glaxnimate::command {
 
 using AddShape = AddObject<model::ShapeElement, model::ShapeListProperty>;
+using AddShapes = AddObjects<model::ShapeElement, model::ShapeListProperty>;
 using RemoveShape = RemoveObject<model::ShapeElement, model::ShapeListProperty>;
 using MoveShape = MoveObject<model::ShapeElement, model::ShapeListProperty>;
 
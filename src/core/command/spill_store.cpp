@@ -0,0 +1,380 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "spill_store.hpp"
+
+#include <algorithm>
+#include <map>
+#include <unordered_set>
+
+#include <QTemporaryFile>
+#include <QDir>
+
+#include "math/bezier/meta.hpp"
+#include "app/log/log.hpp"
+
+using namespace glaxnimate;
+
+namespace {
+
+enum class SpilledType : quint8
+{
+    InMemory,
+    Bezier,
+    ByteArray,
+    String,
+};
+
+struct Candidate
+{
+    int distance;
+    command::SpillableCommand* command;
+    qint64 size;
+};
+
+void collect_candidates(const QUndoCommand* command, int distance, std::vector<Candidate>& candidates, qint64& total)
+{
+    if ( auto spillable = dynamic_cast<const command::SpillableCommand*>(command) )
+    {
+        if ( !spillable->spilled() )
+        {
+            qint64 size = spillable->spillable_size();
+            if ( size > 0 )
+            {
+                total += size;
+                candidates.push_back({distance, const_cast<command::SpillableCommand*>(spillable), size});
+            }
+        }
+    }
+
+    for ( int i = 0; i < command->childCount(); i++ )
+        collect_candidates(command->child(i), distance, candidates, total);
+}
+
+} // namespace
+
+class command::SpillStore::Private
+{
+public:
+    bool open()
+    {
+        if ( file.isOpen() )
+            return true;
+
+        file.setFileTemplate(QDir::temp().filePath("glaxnimate-undo-XXXXXX"));
+        if ( !file.open() )
+        {
+            app::log::Log("Undo").stream(app::log::Warning) << "Could not open temporary file" << file.errorString();
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * \brief Finds where to write \p size bytes, reusing the first free range large enough
+     */
+    qint64 allocate(qint64 size)
+    {
+        for ( auto it = free_ranges.begin(); it != free_ranges.end(); ++it )
+        {
+            if ( it->second < size )
+                continue;
+
+            qint64 offset = it->first;
+            qint64 left = it->second - size;
+            free_ranges.erase(it);
+            if ( left > 0 )
+                free_ranges[offset + size] = left;
+            return offset;
+        }
+
+        return file.size();
+    }
+
+    /**
+     * \brief Marks a range as free, merging it with adjacent free ranges
+     */
+    void release(qint64 offset, qint64 size)
+    {
+        if ( spilled.empty() )
+        {
+            free_ranges.clear();
+            if ( file.isOpen() )
+                file.resize(0);
+            return;
+        }
+
+        auto next = free_ranges.lower_bound(offset);
+        if ( next != free_ranges.end() && offset + size == next->first )
+        {
+            size += next->second;
+            next = free_ranges.erase(next);
+        }
+
+        if ( next != free_ranges.begin() )
+        {
+            auto prev = std::prev(next);
+            if ( prev->first + prev->second == offset )
+            {
+                offset = prev->first;
+                size += prev->second;
+                free_ranges.erase(prev);
+            }
+        }
+
+        // Free space at the end of the file can be dropped
+        if ( offset + size >= file.size() )
+            file.resize(offset);
+        else
+            free_ranges[offset] = size;
+    }
+
+    QUndoStack* stack;
+    qint64 budget = 0;
+    QTemporaryFile file;
+    std::unordered_set<SpillableCommand*> spilled;
+    /// Unused ranges in the file, offset -> size
+    std::map<qint64, qint64> free_ranges;
+    QMetaObject::Connection connection;
+    std::function<void (const QString&)> error_handler;
+};
+
+command::SpillStore::SpillStore(QUndoStack* stack)
+    : d(std::make_unique<Private>())
+{
+    d->stack = stack;
+    d->connection = QObject::connect(stack, &QUndoStack::indexChanged, stack, [this]{ enforce(); });
+}
+
+command::SpillStore::~SpillStore()
+{
+    QObject::disconnect(d->connection);
+    for ( auto command : d->spilled )
+        command->store = nullptr;
+}
+
+void command::SpillStore::set_budget(qint64 bytes)
+{
+    d->budget = bytes;
+    enforce();
+}
+
+qint64 command::SpillStore::budget() const
+{
+    return d->budget;
+}
+
+qint64 command::SpillStore::memory_usage() const
+{
+    qint64 total = 0;
+    for ( int i = 0; i < d->stack->count(); i++ )
+        total += memory_usage(d->stack->command(i));
+    return total;
+}
+
+qint64 command::SpillStore::memory_usage(const QUndoCommand* command)
+{
+    qint64 total = 0;
+    if ( auto spillable = dynamic_cast<const SpillableCommand*>(command) )
+    {
+        if ( !spillable->spilled() )
+            total += spillable->spillable_size();
+    }
+
+    for ( int i = 0; i < command->childCount(); i++ )
+        total += memory_usage(command->child(i));
+    return total;
+}
+
+qint64 command::SpillStore::spilled_size(const QUndoCommand* command)
+{
+    qint64 total = 0;
+    if ( auto spillable = dynamic_cast<const SpillableCommand*>(command) )
+        total += spillable->spilled_size();
+
+    for ( int i = 0; i < command->childCount(); i++ )
+        total += spilled_size(command->child(i));
+    return total;
+}
+
+void command::SpillStore::enforce()
+{
+    if ( d->budget <= 0 )
+        return;
+
+    std::vector<Candidate> candidates;
+    qint64 total = 0;
+    int index = d->stack->index();
+    for ( int i = 0; i < d->stack->count(); i++ )
+    {
+        // 0 for the commands that would be undone or redone next
+        int distance = i < index ? index - 1 - i : i - index;
+        collect_candidates(d->stack->command(i), distance, candidates, total);
+    }
+
+    if ( total <= d->budget || !d->open() )
+        return;
+
+    std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b){
+        return a.distance > b.distance;
+    });
+
+    for ( const auto& candidate : candidates )
+    {
+        if ( total <= d->budget || candidate.distance == 0 )
+            break;
+
+        QByteArray data;
+        {
+            QDataStream stream(&data, QIODevice::WriteOnly);
+            candidate.command->spill(stream);
+        }
+        QByteArray compressed = qCompress(data);
+
+        qint64 offset = d->allocate(compressed.size());
+        if ( !d->file.seek(offset) || d->file.write(compressed) != compressed.size() || !d->file.flush() )
+        {
+            app::log::Log("Undo").stream(app::log::Warning) << "Could not write undo data" << d->file.errorString();
+            QDataStream stream(data);
+            candidate.command->restore(stream);
+            if ( offset < d->file.size() )
+                d->release(offset, compressed.size());
+            return;
+        }
+
+        candidate.command->store = this;
+        candidate.command->offset = offset;
+        candidate.command->size = compressed.size();
+        d->spilled.insert(candidate.command);
+        total -= candidate.size;
+    }
+}
+
+void command::SpillStore::set_error_handler(std::function<void (const QString&)> handler)
+{
+    d->error_handler = std::move(handler);
+}
+
+QString command::SpillStore::file_name() const
+{
+    return d->file.isOpen() ? d->file.fileName() : QString();
+}
+
+bool command::SpillStore::restore(SpillableCommand* command)
+{
+    QByteArray data;
+    if ( d->file.seek(command->offset) )
+        data = qUncompress(d->file.read(command->size));
+
+    // Spilled commands always have data
+    if ( data.isEmpty() )
+    {
+        app::log::Log("Undo").stream(app::log::Error) << "Could not read undo data" << d->file.errorString();
+        if ( d->error_handler )
+            d->error_handler(QObject::tr("Could not read the undo history from disk, the history has been cleared"));
+        // The stack index has moved past a skipped action so the history no longer
+        // matches the document, the stack is busy calling this command so it's cleared later
+        QMetaObject::invokeMethod(d->stack, [stack=d->stack]{ stack->clear(); }, Qt::QueuedConnection);
+        return false;
+    }
+
+    command->store = nullptr;
+    d->spilled.erase(command);
+    d->release(command->offset, command->size);
+
+    QDataStream stream(data);
+    command->restore(stream);
+    command->size = 0;
+    return true;
+}
+
+void command::SpillStore::forget(SpillableCommand* command)
+{
+    d->spilled.erase(command);
+    d->release(command->offset, command->size);
+}
+
+
+command::SpillableCommand::~SpillableCommand()
+{
+    if ( store )
+        store->forget(this);
+}
+
+bool command::SpillableCommand::spilled() const
+{
+    return store;
+}
+
+qint64 command::SpillableCommand::spilled_size() const
+{
+    return store ? size : 0;
+}
+
+bool command::SpillableCommand::unspill()
+{
+    return !store || store->restore(this);
+}
+
+qint64 command::SpillableCommand::variant_size(const QVariant& value)
+{
+    if ( value.userType() == qMetaTypeId<math::bezier::Bezier>() )
+        return static_cast<const math::bezier::Bezier*>(value.constData())->size() * qint64(sizeof(math::bezier::Point));
+    if ( value.userType() == QMetaType::QByteArray )
+        return static_cast<const QByteArray*>(value.constData())->size();
+    if ( value.userType() == QMetaType::QString )
+        return static_cast<const QString*>(value.constData())->size() * qint64(sizeof(QChar));
+    return 0;
+}
+
+void command::SpillableCommand::spill_variant(QDataStream& stream, QVariant& value)
+{
+    if ( value.userType() == qMetaTypeId<math::bezier::Bezier>() )
+        stream << quint8(SpilledType::Bezier) << *static_cast<const math::bezier::Bezier*>(value.constData());
+    else if ( value.userType() == QMetaType::QByteArray )
+        stream << quint8(SpilledType::ByteArray) << value.toByteArray();
+    else if ( value.userType() == QMetaType::QString )
+        stream << quint8(SpilledType::String) << value.toString();
+    else
+    {
+        stream << quint8(SpilledType::InMemory);
+        return;
+    }
+
+    value = QVariant();
+}
+
+void command::SpillableCommand::restore_variant(QDataStream& stream, QVariant& value)
+{
+    quint8 type = 0;
+    stream >> type;
+    switch ( SpilledType(type) )
+    {
+        case SpilledType::InMemory:
+            break;
+        case SpilledType::Bezier:
+        {
+            math::bezier::Bezier bezier;
+            stream >> bezier;
+            value = QVariant::fromValue(bezier);
+            break;
+        }
+        case SpilledType::ByteArray:
+        {
+            QByteArray bytes;
+            stream >> bytes;
+            value = bytes;
+            break;
+        }
+        case SpilledType::String:
+        {
+            QString string;
+            stream >> string;
+            value = string;
+            break;
+        }
+    }
+}
@@ -0,0 +1,148 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+
+#include <QUndoStack>
+#include <QDataStream>
+#include <QVariant>
+
+namespace glaxnimate::command {
+
+class SpillStore;
+
+/**
+ * \brief Base for commands whose data can be moved to disk while it isn't needed
+ *
+ * Derived classes call unspill() before accessing their data
+ * (eg: in undo(), redo() and when merging) and skip the action if it fails,
+ * the store then clears the undo stack as it no longer matches the document
+ */
+class SpillableCommand
+{
+public:
+    virtual ~SpillableCommand();
+
+    /**
+     * \brief Approximate size in bytes of the data that would be moved by spilling
+     */
+    virtual qint64 spillable_size() const = 0;
+
+    /**
+     * \brief Whether the data is currently on disk
+     */
+    bool spilled() const;
+
+    /**
+     * \brief Compressed size of the spilled data
+     */
+    qint64 spilled_size() const;
+
+protected:
+    /**
+     * \brief Reads the data back from disk if needed
+     * \return \b false if the data couldn't be read, in which case it stays spilled
+     */
+    bool unspill();
+
+    /**
+     * \brief Writes the spillable data and releases it from memory
+     */
+    virtual void spill(QDataStream& stream) = 0;
+
+    /**
+     * \brief Reads back the data written by spill()
+     */
+    virtual void restore(QDataStream& stream) = 0;
+
+    /**
+     * \brief Size of a value as counted by spillable_size(), 0 if it can't be spilled
+     */
+    static qint64 variant_size(const QVariant& value);
+
+    /**
+     * \brief Writes \p value to \p stream and clears it if it can be spilled
+     */
+    static void spill_variant(QDataStream& stream, QVariant& value);
+
+    /**
+     * \brief Reads a value written by spill_variant()
+     */
+    static void restore_variant(QDataStream& stream, QVariant& value);
+
+private:
+    SpillStore* store = nullptr;
+    qint64 offset = 0;
+    qint64 size = 0;
+    friend SpillStore;
+};
+
+/**
+ * \brief Keeps the memory used by an undo stack within a budget
+ *
+ * When the stack changes and the spillable commands use more memory than the budget,
+ * their data is compressed and written to a temporary file, starting from
+ * the commands furthest away from the current undo index.
+ * Commands reload their data automatically when undone or redone,
+ * the space they used in the file is reused by later spills.
+ */
+class SpillStore
+{
+public:
+    explicit SpillStore(QUndoStack* stack);
+    ~SpillStore();
+
+    /**
+     * \brief Maximum number of bytes to keep in memory, 0 for no limit
+     */
+    void set_budget(qint64 bytes);
+    qint64 budget() const;
+
+    /**
+     * \brief Spillable data kept in memory by the whole stack
+     */
+    qint64 memory_usage() const;
+
+    /**
+     * \brief Spillable data kept in memory by \p command and its children
+     */
+    static qint64 memory_usage(const QUndoCommand* command);
+
+    /**
+     * \brief Data moved to disk from \p command and its children
+     */
+    static qint64 spilled_size(const QUndoCommand* command);
+
+    /**
+     * \brief Spills commands until the memory usage is within budget
+     */
+    void enforce();
+
+    /**
+     * \brief Called with a user-facing message when spilled data can't be read back
+     *
+     * When that happens the undo stack is cleared once control returns to the event loop.
+     */
+    void set_error_handler(std::function<void (const QString&)> handler);
+
+    /**
+     * \brief Name of the temporary file, empty if nothing has been spilled
+     */
+    QString file_name() const;
+
+private:
+    bool restore(SpillableCommand* command);
+    void forget(SpillableCommand* command);
+
+    class Private;
+    std::unique_ptr<Private> d;
+    friend SpillableCommand;
+};
+
+} // namespace glaxnimate::command
@@ -5,6 +5,7 @@
  */
 #include "base.hpp"
 #include "model/assets/assets.hpp"
+#include "utils/profiler.hpp"
 
 QString glaxnimate::io::ImportExport::name_filter() const
 {
@@ -57,7 +58,12 @@ bool glaxnimate::io::ImportExport::open(QIODevice& file, const QString& filename
         if ( !file.open(QIODevice::ReadOnly) )
             return false;
 
-    bool ok = on_open(file, filename, document, setting_values);
+    cancel_requested = false;
+    bool ok;
+    {
+        utils::profiler::Scope scope("open", slug());
+        ok = on_open(file, filename, document, setting_values) && !cancel_requested;
+    }
     emit completed(ok);
     return ok;
 }
@@ -69,7 +75,11 @@ bool glaxnimate::io::ImportExport::save(QIODevice& file, const QString& filename
         if ( !file.open(QIODevice::WriteOnly) )
             return false;
 
-    bool ok = on_save(file, filename, comp, setting_values);
+    bool ok;
+    {
+        utils::profiler::Scope scope("save", slug());
+        ok = on_save(file, filename, comp, setting_values);
+    }
     emit completed(ok);
     return ok;
 }
@@ -6,6 +6,8 @@
 
 #pragma once
 
+#include <atomic>
+
 #include <QFileInfo>
 #include <QObject>
 #include <QBuffer>
@@ -114,6 +116,25 @@ public:
         emit this->message(message, app::log::Error);
     }
 
+    /**
+     * \brief Asks an open() running in another thread to stop
+     *
+     * Formats check cancelled() where it's convenient to stop loading,
+     * open() fails once cancelled.
+     */
+    void cancel()
+    {
+        cancel_requested = true;
+    }
+
+    /**
+     * \brief Whether cancel() has been called since the current open() started
+     */
+    bool cancelled() const
+    {
+        return cancel_requested;
+    }
+
 protected:
     virtual bool auto_open() const { return true; }
 
@@ -145,6 +166,9 @@ signals:
     void progress_max_changed(int max);
     void progress(int value);
     void completed(bool success);
+
+private:
+    std::atomic<bool> cancel_requested = false;
 };
 
 } // namespace glaxnimate::io
@@ -0,0 +1,589 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "frame_server.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#include <QDataStream>
+#include <QFile>
+#include <QFutureWatcher>
+#include <QImage>
+#include <QLocalSocket>
+#include <QSharedMemory>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include "app/log/log.hpp"
+#include "io/io_registry.hpp"
+#include "model/document.hpp"
+#include "model/assets/assets.hpp"
+#include "model/render_program.hpp"
+
+class glaxnimate::io::FrameServer::Private
+{
+public:
+    enum class SlotState
+    {
+        /// Doesn't contain a frame
+        Free,
+        /// Contains a frame the host has released
+        Cached,
+        /// Being written by a worker thread
+        Rendering,
+        /// Announced to the host and not released yet
+        Host,
+    };
+
+    struct Slot
+    {
+        SlotState state = SlotState::Free;
+        model::FrameTime frame = -1;
+        /// Requests for the frame that are waiting for the render to finish
+        int requested = 0;
+        /// Number of `ready` messages not yet released
+        int pins = 0;
+        /// Held by the host while the document has been replaced
+        bool stale = false;
+        quint64 last_used = 0;
+        std::unique_ptr<QFutureWatcher<void>> watcher;
+    };
+
+    Private(FrameServer* parent) : parent(parent) {}
+
+    ~Private()
+    {
+        wait_renders();
+    }
+
+    model::Composition* comp() const
+    {
+        if ( !document || composition >= document->assets()->compositions->values.size() )
+            return nullptr;
+        return document->assets()->compositions->values[composition];
+    }
+
+    /**
+     * \brief Discards the rendered frames after the document or composition changed
+     */
+    void reset_frames()
+    {
+        wait_renders();
+        program.reset();
+
+        for ( auto& slot : slots )
+        {
+            // Slots held by the host stay valid until released
+            if ( slot.state != SlotState::Host )
+                slot.state = SlotState::Free;
+            else
+                slot.stale = true;
+            slot.requested = 0;
+        }
+
+        if ( auto comp = this->comp() )
+            program = std::make_shared<model::RenderProgram>(comp);
+    }
+
+    void wait_renders()
+    {
+        for ( auto& slot : slots )
+        {
+            if ( slot.watcher )
+                slot.watcher->waitForFinished();
+        }
+    }
+
+    uchar* slot_data(int index)
+    {
+        return static_cast<uchar*>(memory->data()) + header_size + index * slot_stride;
+    }
+
+    int find_slot(model::FrameTime frame) const
+    {
+        for ( int i = 0; i < int(slots.size()); i++ )
+        {
+            if ( slots[i].state != SlotState::Free && !slots[i].stale && slots[i].frame == frame )
+                return i;
+        }
+        return -1;
+    }
+
+    bool in_prefetch_window(model::FrameTime frame) const
+    {
+        return frame >= playhead && frame <= playhead + prefetch;
+    }
+
+    /**
+     * \brief Finds a slot that can be rendered into
+     *
+     * Prefers free slots then the least recently used cached frame,
+     * prefetching doesn't evict frames it would render again.
+     */
+    int evict_slot(bool for_request) const
+    {
+        int best = -1;
+        for ( int i = 0; i < int(slots.size()); i++ )
+        {
+            const Slot& slot = slots[i];
+            if ( slot.state == SlotState::Free )
+                return i;
+
+            if ( slot.state != SlotState::Cached )
+                continue;
+
+            if ( !for_request && in_prefetch_window(slot.frame) )
+                continue;
+
+            if ( best == -1 || slot.last_used < slots[best].last_used )
+                best = i;
+        }
+        return best;
+    }
+
+    void start_render(int index, model::FrameTime frame)
+    {
+        Slot& slot = slots[index];
+        slot.state = SlotState::Rendering;
+        slot.frame = frame;
+        slot.last_used = ++use_counter;
+
+        if ( program->outdated() )
+            program->compile();
+
+        auto data = slot_data(index);
+        QSize size = frame_size;
+        int bytes_per_line = this->bytes_per_line;
+        std::shared_ptr<model::RenderProgram> program = this->program;
+        slot.watcher->setFuture(QtConcurrent::run([data, size, bytes_per_line, program, frame]{
+            QImage image(data + slot_header_size, size.width(), size.height(), bytes_per_line, format);
+            program->render_into(image, frame);
+        }));
+    }
+
+    void on_rendered(int index)
+    {
+        Slot& slot = slots[index];
+        // Stale notification for a render that has been discarded
+        if ( slot.state != SlotState::Rendering || !slot.watcher->isFinished() )
+            return;
+
+        if ( slot.requested )
+        {
+            slot.state = SlotState::Host;
+            slot.pins += slot.requested;
+            for ( ; slot.requested > 0; slot.requested-- )
+                send_ready(index);
+        }
+        else
+        {
+            slot.state = SlotState::Cached;
+        }
+
+        prefetch_frames();
+    }
+
+    void request_frame(model::FrameTime frame)
+    {
+        if ( !memory || !program )
+        {
+            send(QString("error not configured"));
+            return;
+        }
+
+        playhead = frame;
+
+        int index = find_slot(frame);
+        if ( index != -1 )
+        {
+            Slot& slot = slots[index];
+            slot.last_used = ++use_counter;
+            if ( slot.state == SlotState::Rendering )
+            {
+                slot.requested++;
+            }
+            else
+            {
+                slot.state = SlotState::Host;
+                slot.pins++;
+                send_ready(index);
+            }
+        }
+        else
+        {
+            index = evict_slot(true);
+            if ( index == -1 )
+            {
+                send(QString("error busy %1").arg(frame));
+                return;
+            }
+            slots[index].requested = 1;
+            start_render(index, frame);
+        }
+
+        prefetch_frames();
+    }
+
+    void prefetch_frames()
+    {
+        auto comp = this->comp();
+        if ( !comp || !memory )
+            return;
+
+        model::FrameTime last = comp->animation->last_frame.get();
+        int max_jobs = QThreadPool::globalInstance()->maxThreadCount();
+
+        for ( int i = 1; i <= prefetch && rendering() < max_jobs; i++ )
+        {
+            model::FrameTime frame = playhead + i;
+            if ( frame >= last )
+                break;
+
+            if ( find_slot(frame) != -1 )
+                continue;
+
+            int index = evict_slot(false);
+            if ( index == -1 )
+                break;
+
+            start_render(index, frame);
+        }
+    }
+
+    int rendering() const
+    {
+        return std::count_if(slots.begin(), slots.end(), [](const Slot& slot){
+            return slot.state == SlotState::Rendering;
+        });
+    }
+
+    void release(int index)
+    {
+        if ( index < 0 || index >= int(slots.size()) || slots[index].state != SlotState::Host )
+        {
+            send(QString("error invalid slot %1").arg(index));
+            return;
+        }
+
+        Slot& slot = slots[index];
+        slot.pins--;
+        if ( slot.pins <= 0 )
+        {
+            slot.pins = 0;
+            slot.state = slot.stale ? SlotState::Free : SlotState::Cached;
+            slot.stale = false;
+            prefetch_frames();
+        }
+    }
+
+    void send_ready(int index)
+    {
+        send(QString("ready %1 %2").arg(slots[index].frame).arg(index));
+    }
+
+    void send_document()
+    {
+        if ( auto comp = this->comp() )
+        {
+            send(QString("document %1 %2 %3 %4 %5")
+                .arg(comp->width.get())
+                .arg(comp->height.get())
+                .arg(comp->animation->first_frame.get())
+                .arg(comp->animation->last_frame.get())
+                .arg(comp->fps.get())
+            );
+        }
+    }
+
+    void send(const QString& message)
+    {
+        if ( !stream || !socket || !socket->isOpen() )
+            return;
+
+        *stream << message;
+        socket->flush();
+    }
+
+    void read()
+    {
+        while ( stream )
+        {
+            stream->startTransaction();
+            QString message;
+            *stream >> message;
+            if ( !stream->commitTransaction() )
+                break;
+
+            handle(message);
+        }
+    }
+
+    void handle(const QString& message)
+    {
+        QString command = message.section(' ', 0, 0);
+        QString arg = message.section(' ', 1);
+
+        if ( command == "hello" )
+        {
+            send(QString("version %1 frame-server").arg(protocol_version));
+            send_document();
+        }
+        else if ( command == "open" )
+        {
+            if ( parent->open(arg) )
+                send_document();
+            else
+                send(QString("error could not open %1").arg(arg));
+        }
+        else if ( command == "composition" )
+        {
+            if ( parent->set_composition(arg.toInt()) )
+                send_document();
+            else
+                send(QString("error no composition %1").arg(arg));
+        }
+        else if ( command == "configure" )
+        {
+            QStringList args = arg.split(' ',
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+                Qt::SkipEmptyParts
+#else
+                QString::SkipEmptyParts
+#endif
+            );
+            int slots = args.size() > 2 ? args[2].toInt() : default_slots;
+            QSize size(args.value(0).toInt(), args.value(1).toInt());
+            if ( !parent->configure(size, slots) )
+                send(QString("error could not configure %1").arg(arg));
+        }
+        else if ( command == "prefetch" )
+        {
+            parent->set_prefetch(arg.toInt());
+            prefetch_frames();
+        }
+        else if ( command == "frame" )
+        {
+            request_frame(arg.toDouble());
+        }
+        else if ( command == "release" )
+        {
+            release(arg.toInt());
+        }
+        else if ( command == "bye" )
+        {
+            socket->disconnectFromServer();
+        }
+        else
+        {
+            app::log::Log("frame-server").stream(app::log::Info) << "Host sent unknown command:" << message;
+            send(QString("error unknown command %1").arg(command));
+        }
+    }
+
+    void on_error(QLocalSocket::LocalSocketError error)
+    {
+        // No disconnected signal will follow a failed connection attempt
+        if ( !connected )
+        {
+            app::log::Log("frame-server").stream(app::log::Error) << "Could not connect to" << name << ":" << socket->errorString();
+            emit parent->finished(false);
+            return;
+        }
+
+        switch ( error )
+        {
+            case QLocalSocket::PeerClosedError:
+                app::log::Log("frame-server").stream(app::log::Info) << "Host closed the connection:" << socket->serverName();
+                break;
+            default:
+                app::log::Log("frame-server").stream(app::log::Warning) << "IPC error:" << socket->errorString();
+        }
+    }
+
+    static constexpr QImage::Format format = QImage::Format_ARGB32_Premultiplied;
+
+    FrameServer* parent;
+    std::unique_ptr<model::Document> document;
+    std::shared_ptr<model::RenderProgram> program;
+
+    QString name;
+    std::unique_ptr<QLocalSocket> socket;
+    std::unique_ptr<QDataStream> stream;
+    std::unique_ptr<QSharedMemory> memory;
+
+    std::vector<Slot> slots;
+    QSize frame_size;
+    int bytes_per_line = 0;
+    int slot_stride = 0;
+    int default_slots = 8;
+    int prefetch = 4;
+    model::FrameTime playhead = 0;
+    quint64 use_counter = 0;
+    int composition = 0;
+    bool connected = false;
+};
+
+glaxnimate::io::FrameServer::FrameServer(QObject* parent)
+    : QObject(parent), d(std::make_unique<Private>(this))
+{
+}
+
+glaxnimate::io::FrameServer::~FrameServer() = default;
+
+void glaxnimate::io::FrameServer::set_document(std::unique_ptr<model::Document> document)
+{
+    d->wait_renders();
+    d->document = std::move(document);
+    d->composition = 0;
+    d->reset_frames();
+}
+
+bool glaxnimate::io::FrameServer::set_composition(int index)
+{
+    if ( !d->document || index < 0 || index >= d->document->assets()->compositions->values.size() )
+        return false;
+
+    d->composition = index;
+    d->reset_frames();
+    return true;
+}
+
+bool glaxnimate::io::FrameServer::open(const QString& filename)
+{
+    auto importer = IoRegistry::instance().from_filename(filename, ImportExport::Import);
+    if ( !importer || !importer->can_open() )
+    {
+        app::log::Log("frame-server").stream(app::log::Warning) << "Unknown importer for" << filename;
+        return false;
+    }
+
+    QFile file(filename);
+    if ( !file.open(QIODevice::ReadOnly) )
+    {
+        app::log::Log("frame-server").stream(app::log::Warning) << "Could not open" << filename;
+        return false;
+    }
+
+    QVariantMap settings;
+    if ( auto group = importer->open_settings() )
+    {
+        for ( const auto& setting : *group )
+            settings[setting.slug] = setting.default_value;
+    }
+
+    auto document = std::make_unique<model::Document>(filename);
+    if ( !importer->open(file, filename, document.get(), settings) )
+        return false;
+
+    set_document(std::move(document));
+    return d->comp();
+}
+
+glaxnimate::model::Document * glaxnimate::io::FrameServer::document() const
+{
+    return d->document.get();
+}
+
+void glaxnimate::io::FrameServer::set_default_slots(int slots)
+{
+    d->default_slots = qMax(1, slots);
+}
+
+void glaxnimate::io::FrameServer::set_prefetch(int frames)
+{
+    d->prefetch = qMax(0, frames);
+}
+
+int glaxnimate::io::FrameServer::prefetch() const
+{
+    return d->prefetch;
+}
+
+bool glaxnimate::io::FrameServer::configure(const QSize& size, int slots)
+{
+    if ( size.isEmpty() || slots < 1 )
+        return false;
+
+    d->wait_renders();
+    d->slots.clear();
+    d->memory.reset();
+
+    d->frame_size = size;
+    d->bytes_per_line = size.width() * 4;
+    // Keep each slot cache line aligned
+    d->slot_stride = (slot_header_size + d->bytes_per_line * size.height() + 63) & ~63;
+
+    d->memory = std::make_unique<QSharedMemory>(d->name + "-frames");
+    qint64 total = header_size + qint64(d->slot_stride) * slots;
+    if ( total > std::numeric_limits<int>::max() )
+        return false;
+
+    if ( !d->memory->create(total) )
+    {
+        // Leftover segment from a previous run, on Unix it needs to be attached
+        // and detached to be destroyed
+        if ( d->memory->error() == QSharedMemory::AlreadyExists && d->memory->attach() )
+            d->memory->detach();
+
+        if ( !d->memory->create(total) )
+        {
+            app::log::Log("frame-server").stream(app::log::Warning) << "Could not create shared memory:" << d->memory->errorString();
+            d->memory.reset();
+            return false;
+        }
+    }
+
+    qint32* header = static_cast<qint32*>(d->memory->data());
+    header[0] = magic;
+    header[1] = protocol_version;
+    header[2] = slots;
+    header[3] = d->slot_stride;
+    header[4] = size.width();
+    header[5] = size.height();
+
+    d->slots.resize(slots);
+    for ( int i = 0; i < slots; i++ )
+    {
+        qint32* slot_header = reinterpret_cast<qint32*>(d->slot_data(i));
+        slot_header[0] = size.width();
+        slot_header[1] = size.height();
+        slot_header[2] = Private::format;
+        slot_header[3] = d->bytes_per_line;
+
+        auto& watcher = d->slots[i].watcher;
+        watcher = std::make_unique<QFutureWatcher<void>>();
+        connect(watcher.get(), &QFutureWatcher<void>::finished, this, [this, i]{ d->on_rendered(i); });
+    }
+
+    d->send(QString("memory %1 %2 %3 %4").arg(memory_key()).arg(slots).arg(d->slot_stride).arg(header_size));
+    d->prefetch_frames();
+    return true;
+}
+
+QString glaxnimate::io::FrameServer::memory_key() const
+{
+    return d->memory ? d->memory->key() : QString();
+}
+
+void glaxnimate::io::FrameServer::connect_to_host(const QString& name)
+{
+    d->name = name;
+    d->connected = false;
+    d->socket = std::make_unique<QLocalSocket>();
+    d->stream = std::make_unique<QDataStream>(d->socket.get());
+    auto on_error = [this](QLocalSocket::LocalSocketError error){ d->on_error(error); };
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+    d->stream->setVersion(QDataStream::Qt_5_15);
+    connect(d->socket.get(), &QLocalSocket::errorOccurred, this, on_error);
+#else
+    connect(d->socket.get(), QOverload<QLocalSocket::LocalSocketError>::of(&QLocalSocket::error), this, on_error);
+#endif
+    connect(d->socket.get(), &QLocalSocket::connected, this, [this]{ d->connected = true; });
+    connect(d->socket.get(), &QLocalSocket::readyRead, this, [this]{ d->read(); });
+    connect(d->socket.get(), &QLocalSocket::disconnected, this, [this]{ emit finished(true); });
+    d->socket->connectToServer(name);
+}
@@ -0,0 +1,126 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <memory>
+
+#include <QObject>
+#include <QSize>
+
+namespace glaxnimate::model {
+class Document;
+} // namespace glaxnimate::model
+
+namespace glaxnimate::io {
+
+/**
+ * \brief Headless server that renders frames for a host application
+ *
+ * Connects to a local socket opened by the host (like the GUI --ipc mode)
+ * and renders the requested frames into a ring of slots in shared memory,
+ * the socket is only used for (QDataStream encoded) text messages.
+ *
+ * Messages from the host:
+ *  - `hello`: replies with `version 1 frame-server`
+ *  - `open FILE`: loads a document
+ *  - `composition INDEX`: selects the composition to render
+ *  - `configure WIDTH HEIGHT [SLOTS]`: (re)creates the shared memory
+ *  - `prefetch FRAMES`: number of frames to render ahead of the last request
+ *  - `frame TIME`: requests a frame, replies with `ready TIME SLOT` when available
+ *  - `release SLOT`: the host is done reading a slot announced by `ready`
+ *  - `bye`: disconnects
+ *
+ * Frames are rendered from the first composition of the document,
+ * until the host selects another one with `composition`.
+ * Opening a document goes back to its first composition.
+ *
+ * The server replies to `open`, `composition` and `hello` with `document WIDTH HEIGHT FIRST LAST FPS`,
+ * to `configure` with `memory KEY SLOTS SLOT_STRIDE HEADER_SIZE`,
+ * and with `error MESSAGE` when a request fails.
+ *
+ * The shared memory starts with HEADER_SIZE bytes containing the qint32 values
+ * magic, version, slots, slot stride, width and height.
+ * Slot N starts at HEADER_SIZE + N * SLOT_STRIDE with the qint32 values
+ * width, height, QImage::Format and bytes per line (same as the --ipc background image),
+ * followed by the pixels.
+ *
+ * A slot belongs to the host from the `ready` message until it's released,
+ * the server never writes to it in the meantime so no locking is needed.
+ * Released slots keep their frame and are reused if it's requested again.
+ */
+class FrameServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int protocol_version = 1;
+    static constexpr qint32 magic = 0x464c4758; // "XGLF" little endian
+    static constexpr int header_size = 32;
+    static constexpr int slot_header_size = 16;
+
+    explicit FrameServer(QObject* parent = nullptr);
+    ~FrameServer();
+
+    /**
+     * \brief Replaces the document being rendered
+     */
+    void set_document(std::unique_ptr<model::Document> document);
+
+    /**
+     * \brief Loads a document from file, returns whether it was successful
+     */
+    bool open(const QString& filename);
+
+    model::Document* document() const;
+
+    /**
+     * \brief Renders the composition at \p index in the document
+     * \return Whether such composition exists
+     */
+    bool set_composition(int index);
+
+    /**
+     * \brief Number of slots used when the host doesn't specify it
+     */
+    void set_default_slots(int slots);
+
+    /**
+     * \brief Number of frames rendered ahead of the last frame requested by the host
+     */
+    void set_prefetch(int frames);
+    int prefetch() const;
+
+    /**
+     * \brief Creates the shared memory for frames of the given size
+     *
+     * Waits for pending renders and invalidates all the slots
+     */
+    bool configure(const QSize& size, int slots);
+
+    /**
+     * \brief Key for the shared memory, empty if not configured
+     */
+    QString memory_key() const;
+
+    /**
+     * \brief Connects to the local socket called \p name
+     */
+    void connect_to_host(const QString& name);
+
+signals:
+    /**
+     * \brief Emitted when the host closes the connection
+     * \param success \b false if the connection to the host couldn't be established
+     */
+    void finished(bool success);
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace glaxnimate::io
@@ -37,6 +37,11 @@ QJsonObject io::glaxnimate::GlaxnimateFormat::format_metadata()
 }
 
 QJsonDocument io::glaxnimate::GlaxnimateFormat::to_json ( model::Document* document )
+{
+    return to_json(document, to_json(document->assets()));
+}
+
+QJsonDocument io::glaxnimate::GlaxnimateFormat::to_json ( model::Document* document, const QJsonObject& assets )
 {
     QJsonObject doc_obj;
     doc_obj["format"] = format_metadata();
@@ -49,7 +54,7 @@ QJsonDocument io::glaxnimate::GlaxnimateFormat::to_json ( model::Document* docum
         keywords.push_back(kw);
     info["keywords"] = keywords;
     doc_obj["info"] = info;
-    doc_obj["assets"] = to_json(document->assets());
+    doc_obj["assets"] = assets;
     return QJsonDocument(doc_obj);
 }
 
@@ -30,6 +30,10 @@ public:
     bool can_open() const override { return true; }
 
     static QJsonDocument to_json(model::Document* document);
+    /**
+     * \brief Document JSON using a pre-computed value for its assets
+     */
+    static QJsonDocument to_json(model::Document* document, const QJsonObject& assets);
     static QJsonObject to_json(model::Object* object);
     static QJsonValue to_json(model::BaseProperty* property);
     static QJsonValue to_json(const QVariant& value);
@@ -0,0 +1,607 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "glaxnimate_journal.hpp"
+
+#include <algorithm>
+
+#include <QFile>
+#include <QSaveFile>
+#include <QPointer>
+#include <QThread>
+#include <QTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+
+#include "glaxnimate_format.hpp"
+#include "model/document.hpp"
+#include "model/assets/assets.hpp"
+#include "model/assets/composition.hpp"
+#include "model/shapes/group.hpp"
+#include "model/property/sub_object_property.hpp"
+
+using namespace glaxnimate;
+
+class io::glaxnimate::AutosaveJournal::Private
+{
+public:
+    enum class ChunkType
+    {
+        None,           ///< Not part of a chunk
+        Node,           ///< Shape or asset without children
+        Container,      ///< Composition or group properties and shape order
+        Structure,      ///< Asset lists, needs a snapshot
+    };
+
+    struct Chunk
+    {
+        ChunkType type = ChunkType::None;
+        model::DocumentNode* node = nullptr;
+        /// Outermost node found, the chunk is detached if it isn't in the document
+        model::DocumentNode* root = nullptr;
+        bool attached = false;
+    };
+
+    using DirtySet = QHash<model::DocumentNode*, QPointer<model::DocumentNode>>;
+
+    Private(model::Document* document, const QString& filename)
+        : document(document),
+          assets(document->assets()),
+          filename(filename)
+    {}
+
+    static QString key(model::DocumentNode* node)
+    {
+        return GlaxnimateFormat::to_json(QVariant::fromValue(node->uuid.get())).toString();
+    }
+
+    /**
+     * \brief Shapes of a container chunk, nullptr for other nodes
+     */
+    static model::ShapeListProperty* child_shapes(model::DocumentNode* node)
+    {
+        if ( auto comp = qobject_cast<model::Composition*>(node) )
+            return &comp->shapes;
+        if ( auto group = qobject_cast<model::Group*>(node) )
+            return &group->shapes;
+        return nullptr;
+    }
+
+    /**
+     * \brief Finds the chunk containing \p object
+     */
+    Chunk resolve(model::Object* object) const
+    {
+        Chunk chunk;
+
+        for ( model::Object* current = object; current; )
+        {
+            auto node = qobject_cast<model::DocumentNode*>(current);
+            if ( !node )
+            {
+                auto property = current->owner_property();
+                current = property ? property->object() : nullptr;
+                continue;
+            }
+
+            chunk.root = node;
+
+            // Composition::docnode_parent() is the same for removed compositions
+            if ( auto comp = qobject_cast<model::Composition*>(node) )
+            {
+                if ( chunk.type == ChunkType::None )
+                {
+                    chunk.type = ChunkType::Container;
+                    chunk.node = comp;
+                }
+                chunk.attached = assets->compositions->values.index_of(comp) != -1;
+                return chunk;
+            }
+
+            auto parent = node->docnode_parent();
+            if ( node == assets || parent == assets )
+            {
+                if ( chunk.type == ChunkType::None )
+                    chunk.type = ChunkType::Structure;
+                chunk.attached = true;
+                return chunk;
+            }
+
+            if ( chunk.type == ChunkType::None && parent &&
+                ( child_shapes(parent) || parent->docnode_parent() == assets ) )
+            {
+                chunk.type = child_shapes(node) ? ChunkType::Container : ChunkType::Node;
+                chunk.node = node;
+            }
+
+            current = parent;
+        }
+
+        // Removed from the document
+        return chunk;
+    }
+
+    /**
+     * \brief Drops \p node and its children from the cache so they are written again if added back
+     */
+    void forget(model::DocumentNode* node)
+    {
+        cache.remove(key(node));
+        known.remove(key(node));
+        for ( int i = 0, count = node->docnode_child_count(); i < count; i++ )
+            forget(node->docnode_child(i));
+    }
+
+    void on_object_edited(model::Object* object)
+    {
+        auto chunk = resolve(object);
+        if ( chunk.type == ChunkType::Structure )
+        {
+            needs_snapshot = true;
+        }
+        else if ( !chunk.attached )
+        {
+            // Needs to be written again if it's added back
+            if ( chunk.root )
+                forget(chunk.root);
+        }
+        else if ( chunk.node )
+        {
+            cache.remove(key(chunk.node));
+            dirty.insert(chunk.node, chunk.node);
+        }
+    }
+
+    /**
+     * \brief JSON for the chunk, containers reference their shapes by uuid
+     */
+    QJsonObject chunk_json(model::DocumentNode* node)
+    {
+        QString uuid = key(node);
+        known.insert(uuid);
+        auto it = cache.find(uuid);
+        if ( it == cache.end() )
+            it = cache.insert(uuid, container_json(node));
+        return *it;
+    }
+
+    QJsonObject container_json(model::DocumentNode* node)
+    {
+        auto list = child_shapes(node);
+        if ( !list )
+            return GlaxnimateFormat::to_json(node);
+
+        QJsonObject obj;
+        obj["__type__"] = node->type_name();
+        for ( model::BaseProperty* prop : node->properties() )
+        {
+            if ( prop != list )
+            {
+                obj[prop->name()] = GlaxnimateFormat::to_json(prop);
+                continue;
+            }
+
+            QJsonArray shapes;
+            for ( const auto& shape : *list )
+                shapes.push_back(key(shape.get()));
+            obj[prop->name()] = shapes;
+        }
+        return obj;
+    }
+
+    /**
+     * \brief Same as GlaxnimateFormat::to_json(node) but using cached chunks
+     */
+    QJsonObject full_json(model::DocumentNode* node)
+    {
+        QJsonObject obj = chunk_json(node);
+        if ( auto list = child_shapes(node) )
+        {
+            QJsonArray shapes;
+            for ( const auto& shape : *list )
+                shapes.push_back(full_json(shape.get()));
+            obj[list->name()] = shapes;
+        }
+        return obj;
+    }
+
+    /**
+     * \brief Same as GlaxnimateFormat::to_json(assets) but using cached chunks
+     */
+    QJsonObject assets_json()
+    {
+        QJsonObject obj;
+        obj["__type__"] = assets->type_name();
+        for ( model::BaseProperty* prop : assets->properties() )
+        {
+            auto list = prop->traits().type == model::PropertyTraits::Object ? prop->value().value<model::Object*>() : nullptr;
+            if ( !list )
+            {
+                obj[prop->name()] = GlaxnimateFormat::to_json(prop);
+                continue;
+            }
+
+            QJsonObject list_obj;
+            list_obj["__type__"] = list->type_name();
+            for ( model::BaseProperty* list_prop : list->properties() )
+            {
+                if ( !(list_prop->traits().flags & model::PropertyTraits::List) || list_prop->traits().type != model::PropertyTraits::Object )
+                {
+                    list_obj[list_prop->name()] = GlaxnimateFormat::to_json(list_prop);
+                    continue;
+                }
+
+                QJsonArray values;
+                for ( const QVariant& value : list_prop->value().toList() )
+                {
+                    auto item = value.value<model::Object*>();
+                    if ( auto node = qobject_cast<model::DocumentNode*>(item) )
+                        values.push_back(full_json(node));
+                    else
+                        values.push_back(GlaxnimateFormat::to_json(value, list_prop->traits()));
+                }
+                list_obj[list_prop->name()] = values;
+            }
+            obj[prop->name()] = list_obj;
+        }
+        return obj;
+    }
+
+    void reset_journal()
+    {
+        journal.close();
+        journal.setFileName(journal_filename(filename));
+        journal.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    }
+
+    void write_record(const QString& type, const QString& uuid, const QJsonObject& data)
+    {
+        QJsonObject record;
+        record["seq"] = ++sequence;
+        record["type"] = type;
+        record["uuid"] = uuid;
+        record["data"] = data;
+        QByteArray line = QJsonDocument(record).toJson(QJsonDocument::Compact) + '\n';
+        journal.write(line);
+        lines.emplace_back(sequence, line);
+        records_since_snapshot++;
+    }
+
+    void write_chunk(model::DocumentNode* node)
+    {
+        dirty.remove(node);
+
+        auto list = child_shapes(node);
+        if ( !list )
+        {
+            write_record("node", key(node), chunk_json(node));
+            return;
+        }
+
+        // Shapes added since they were last written
+        for ( const auto& shape : *list )
+            if ( !known.contains(key(shape.get())) )
+                write_chunk(shape.get());
+
+        write_record("container", key(node), chunk_json(node));
+    }
+
+    void flush()
+    {
+        flush_timer.stop();
+
+        if ( dirty.empty() && !needs_snapshot )
+            return;
+
+        if ( !has_snapshot )
+        {
+            dirty.clear();
+            write_snapshot();
+            return;
+        }
+
+        // write_chunk() removes the new shapes it writes from the set
+        while ( !dirty.empty() )
+        {
+            auto it = dirty.begin();
+            QPointer<model::DocumentNode> node = it.value();
+            dirty.erase(it);
+            if ( !node )
+                continue;
+
+            auto chunk = resolve(node);
+            if ( chunk.node == node && chunk.attached )
+                write_chunk(node);
+        }
+
+        journal.flush();
+
+        if ( needs_snapshot )
+            write_snapshot();
+    }
+
+    void write_snapshot()
+    {
+        if ( writing )
+        {
+            pending_snapshot = true;
+            return;
+        }
+
+        // Entries from a previous session don't apply to the new snapshot
+        if ( !has_snapshot )
+            reset_journal();
+
+        // Shapes that aren't in the snapshot must be written again if they are added back
+        known.clear();
+        QJsonDocument json = GlaxnimateFormat::to_json(document, assets_json());
+        QJsonObject obj = json.object();
+        obj["journal_sequence"] = sequence;
+        json.setObject(obj);
+
+        has_snapshot = true;
+        writing = true;
+        needs_snapshot = false;
+        pending_snapshot = false;
+        records_since_snapshot = 0;
+        writing_sequence = sequence;
+
+        watcher.setFuture(QtConcurrent::run([filename=filename, json]{
+            QSaveFile file(filename);
+            if ( !file.open(QIODevice::WriteOnly) )
+                return false;
+            file.write(json.toJson(QJsonDocument::Indented));
+            return file.commit();
+        }));
+    }
+
+    void on_snapshot_written()
+    {
+        if ( !writing )
+            return;
+
+        writing = false;
+        if ( watcher.result() )
+        {
+            // Only keep entries newer than the snapshot
+            lines.erase(
+                std::remove_if(lines.begin(), lines.end(), [this](const auto& line){ return line.first <= writing_sequence; }),
+                lines.end()
+            );
+            reset_journal();
+            for ( const auto& line : lines )
+                journal.write(line.second);
+            journal.flush();
+        }
+
+        if ( pending_snapshot )
+            write_snapshot();
+    }
+
+    model::Document* document;
+    model::Assets* assets;
+    QString filename;
+    QFile journal;
+    bool enabled = true;
+    bool has_snapshot = false;
+    bool needs_snapshot = true;
+    bool pending_snapshot = false;
+    bool writing = false;
+    int sequence = 0;
+    int writing_sequence = 0;
+    int records_since_snapshot = 0;
+    DirtySet dirty;
+    QTimer flush_timer;
+    /// Chunk JSON by uuid
+    QHash<QString, QJsonObject> cache;
+    /// Chunks that have been written to the snapshot or the journal
+    QSet<QString> known;
+    /// Journal lines not covered by a snapshot on disk
+    std::vector<std::pair<int, QByteArray>> lines;
+    QFutureWatcher<bool> watcher;
+};
+
+io::glaxnimate::AutosaveJournal::AutosaveJournal(model::Document* document, const QString& filename)
+    : d(std::make_unique<Private>(document, filename))
+{
+    // Direct so edits from other threads can be discarded before the objects change again
+    connect(document, &model::Document::object_edited, this, [this](model::Object* object){
+        if ( d->enabled && QThread::currentThread() == thread() )
+            d->on_object_edited(object);
+    }, Qt::DirectConnection);
+    connect(&d->watcher, &QFutureWatcher<bool>::finished, this, [this]{ d->on_snapshot_written(); });
+    d->flush_timer.setSingleShot(true);
+    d->flush_timer.setInterval(1000);
+    connect(&d->flush_timer, &QTimer::timeout, this, &AutosaveJournal::flush);
+}
+
+io::glaxnimate::AutosaveJournal::~AutosaveJournal()
+{
+    wait();
+}
+
+const QString& io::glaxnimate::AutosaveJournal::filename() const
+{
+    return d->filename;
+}
+
+void io::glaxnimate::AutosaveJournal::flush()
+{
+    if ( d->enabled )
+        d->flush();
+}
+
+void io::glaxnimate::AutosaveJournal::schedule_flush()
+{
+    // Not restarted so a steady stream of edits is still flushed
+    if ( d->enabled && !d->flush_timer.isActive() )
+        d->flush_timer.start();
+}
+
+void io::glaxnimate::AutosaveJournal::set_flush_delay(int msec)
+{
+    d->flush_timer.setInterval(msec);
+}
+
+int io::glaxnimate::AutosaveJournal::flush_delay() const
+{
+    return d->flush_timer.interval();
+}
+
+void io::glaxnimate::AutosaveJournal::snapshot()
+{
+    if ( !d->enabled )
+        return;
+
+    d->flush();
+    if ( d->records_since_snapshot || !d->has_snapshot )
+        d->write_snapshot();
+}
+
+void io::glaxnimate::AutosaveJournal::wait()
+{
+    // Doesn't wait for the finished signal so the journal is compacted right away
+    while ( d->writing )
+    {
+        d->watcher.waitForFinished();
+        d->on_snapshot_written();
+    }
+}
+
+void io::glaxnimate::AutosaveJournal::remove_files()
+{
+    d->enabled = false;
+    d->flush_timer.stop();
+    wait();
+    d->journal.close();
+    remove_files(d->filename);
+}
+
+QString io::glaxnimate::AutosaveJournal::journal_filename(const QString& filename)
+{
+    return filename + ".journal";
+}
+
+void io::glaxnimate::AutosaveJournal::remove_files(const QString& filename)
+{
+    QFile::remove(filename);
+    QFile::remove(journal_filename(filename));
+}
+
+QByteArray io::glaxnimate::AutosaveJournal::recover(const QString& filename)
+{
+    QFile snapshot(filename);
+    if ( !snapshot.open(QIODevice::ReadOnly) )
+        return {};
+
+    QByteArray journal_data;
+    QFile journal(journal_filename(filename));
+    if ( journal.open(QIODevice::ReadOnly) )
+        journal_data = journal.readAll();
+
+    return recover(snapshot.readAll(), journal_data);
+}
+
+namespace {
+
+/**
+ * \brief Adds \p item and its shapes to \p chunks, with the shapes replaced by their uuids
+ */
+void split_chunks(const QJsonObject& item, QHash<QString, QJsonObject>& chunks)
+{
+    QJsonObject chunk = item;
+    if ( item["shapes"].isArray() )
+    {
+        QJsonArray shapes;
+        for ( const auto& shape : item["shapes"].toArray() )
+        {
+            split_chunks(shape.toObject(), chunks);
+            shapes.push_back(shape.toObject()["uuid"]);
+        }
+        chunk["shapes"] = shapes;
+    }
+    chunks[item["uuid"].toString()] = chunk;
+}
+
+/**
+ * \brief Inverse of split_chunks(), shapes missing from \p chunks are skipped
+ */
+QJsonObject join_chunks(const QJsonObject& chunk, const QHash<QString, QJsonObject>& chunks, QSet<QString>& visited)
+{
+    if ( !chunk["shapes"].isArray() )
+        return chunk;
+
+    QJsonObject item = chunk;
+    QJsonArray shapes;
+    for ( const auto& shape_uuid : chunk["shapes"].toArray() )
+    {
+        QString uuid = shape_uuid.toString();
+        auto shape = chunks.find(uuid);
+        // Guards against cycles from a corrupted journal
+        if ( shape == chunks.end() || visited.contains(uuid) )
+            continue;
+        visited.insert(uuid);
+        shapes.push_back(join_chunks(*shape, chunks, visited));
+    }
+    item["shapes"] = shapes;
+    return item;
+}
+
+} // namespace
+
+QByteArray io::glaxnimate::AutosaveJournal::recover(const QByteArray& snapshot, const QByteArray& journal)
+{
+    QJsonParseError error;
+    QJsonDocument json = QJsonDocument::fromJson(snapshot, &error);
+    if ( error.error != QJsonParseError::NoError || !json.isObject() )
+        return {};
+
+    QJsonObject top = json.object();
+    int snapshot_sequence = top["journal_sequence"].toInt();
+    QJsonObject assets = top["assets"].toObject();
+
+    QHash<QString, QJsonObject> chunks;
+    for ( const QString& list_name : assets.keys() )
+    {
+        for ( const auto& value : assets[list_name].toObject()["values"].toArray() )
+            split_chunks(value.toObject(), chunks);
+    }
+
+    for ( const QByteArray& line : journal.split('\n') )
+    {
+        // The last line might be truncated if the application crashed while writing it
+        QJsonObject record = QJsonDocument::fromJson(line).object();
+        if ( record.isEmpty() || record["seq"].toInt() <= snapshot_sequence )
+            continue;
+
+        QString type = record["type"].toString();
+        if ( type == "node" || type == "container" )
+            chunks[record["uuid"].toString()] = record["data"].toObject();
+    }
+
+    QSet<QString> visited;
+    for ( const QString& list_name : assets.keys() )
+    {
+        QJsonObject list = assets[list_name].toObject();
+        if ( !list.contains("values") )
+            continue;
+
+        QJsonArray values;
+        for ( const auto& value : list["values"].toArray() )
+        {
+            QString uuid = value.toObject()["uuid"].toString();
+            values.push_back(join_chunks(chunks.value(uuid, value.toObject()), chunks, visited));
+        }
+        list["values"] = values;
+        assets[list_name] = list;
+    }
+
+    top["assets"] = assets;
+    top.remove("journal_sequence");
+    return QJsonDocument(top).toJson(QJsonDocument::Compact);
+}
@@ -0,0 +1,106 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <memory>
+
+#include <QObject>
+#include <QByteArray>
+
+namespace glaxnimate::model {
+class Document;
+} // namespace glaxnimate::model
+
+namespace glaxnimate::io::glaxnimate {
+
+/**
+ * \brief Incremental autosave for a document
+ *
+ * Keeps a full snapshot in the glaxnimate format plus an append-only journal
+ * (snapshot filename + ".journal") with one JSON line per changed chunk.
+ *
+ * Every shape and non-composition asset is a chunk, compositions and groups
+ * only contain their own properties and reference their shapes by uuid.
+ * Edits are tracked through model::Document::object_edited and appended to the journal
+ * by flush(), which only serializes the chunks that changed since the last flush.
+ * schedule_flush() coalesces the edits made within flush_delay() into a single flush.
+ *
+ * Snapshots are assembled from cached chunk JSON and written to disk in a
+ * background thread, after which the journal entries they cover are dropped.
+ * Changes that can't be expressed as chunks (eg: adding assets) schedule a snapshot.
+ */
+class AutosaveJournal : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * \param document  Document to track, must outlive the journal
+     * \param filename  Name of the snapshot file
+     */
+    AutosaveJournal(model::Document* document, const QString& filename);
+    ~AutosaveJournal();
+
+    const QString& filename() const;
+
+    /**
+     * \brief Appends the chunks changed since the last call to the journal
+     *
+     * The first flush writes the initial snapshot instead
+     */
+    void flush();
+
+    /**
+     * \brief Calls flush() after flush_delay() milliseconds, unless it's already scheduled
+     */
+    void schedule_flush();
+
+    void set_flush_delay(int msec);
+    int flush_delay() const;
+
+    /**
+     * \brief Flushes pending changes and writes a new snapshot if the journal isn't empty
+     */
+    void snapshot();
+
+    /**
+     * \brief Blocks until the background snapshot (if any) has been written
+     */
+    void wait();
+
+    /**
+     * \brief Stops tracking changes and removes the files
+     */
+    void remove_files();
+
+    /**
+     * \brief Name of the journal file for the given snapshot
+     */
+    static QString journal_filename(const QString& filename);
+
+    /**
+     * \brief Removes the snapshot and journal files
+     */
+    static void remove_files(const QString& filename);
+
+    /**
+     * \brief Applies the journal to the snapshot
+     * \return The recovered document in the glaxnimate format or an empty array on failure
+     */
+    static QByteArray recover(const QByteArray& snapshot, const QByteArray& journal);
+
+    /**
+     * \brief Reads the snapshot and journal for \p filename and recovers the document
+     */
+    static QByteArray recover(const QString& filename);
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace glaxnimate::io::glaxnimate
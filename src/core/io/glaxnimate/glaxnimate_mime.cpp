@@ -7,16 +7,28 @@
 #include "glaxnimate_mime.hpp"
 
 #include <set>
+#include <cmath>
+#include <cstring>
+
+#include <QCoreApplication>
+#include <QCborValue>
+#include <QCborArray>
+#include <QCborStreamWriter>
+#include <QDataStream>
+#include <QJsonObject>
 
 #include "import_state.hpp"
 #include "model/shapes/shape.hpp"
 #include "model/assets/assets.hpp"
 #include "model/visitor.hpp"
+#include "model/property/reference_property.hpp"
+#include "model/property/sub_object_property.hpp"
 #include "app/log/log.hpp"
 
 using namespace glaxnimate;
 
 io::Autoreg<io::glaxnimate::GlaxnimateMime> io::glaxnimate::GlaxnimateMime::autoreg;
+io::Autoreg<io::glaxnimate::GlaxnimateBinaryMime> io::glaxnimate::GlaxnimateBinaryMime::autoreg;
 
 namespace {
 
@@ -41,14 +53,281 @@ public:
                 referenced[ptr->uuid.get().toString()] = ptr;
 
                 on_visit(ptr);
+                ordered.push_back(ptr);
             }
         }
     }
 
     std::set<model::DocumentNode*> skip;
     std::map<QString, model::DocumentNode*> referenced;
+    /// Referenced nodes, each after the nodes it depends on
+    std::vector<model::DocumentNode*> ordered;
+};
+
+/**
+ * \brief Objects from the last copy, kept to paste them without decoding
+ */
+struct ClipboardSnapshot
+{
+    QUuid id;
+    std::vector<model::DocumentNode*> assets;
+    io::mime::DeserializedData data;
 };
 
+/*
+ * Shared with the lazy clipboard payload, which is produced from the snapshot
+ * when another application requests it
+ */
+std::shared_ptr<ClipboardSnapshot>& clipboard_snapshot();
+
+void clear_clipboard_snapshot()
+{
+    clipboard_snapshot().reset();
+}
+
+std::shared_ptr<ClipboardSnapshot>& clipboard_snapshot()
+{
+    static std::shared_ptr<ClipboardSnapshot> snapshot;
+    // The document must be destroyed while the application is still around
+    static bool cleanup = (qAddPostRoutine(&clear_clipboard_snapshot), true);
+    Q_UNUSED(cleanup);
+    return snapshot;
+}
+
+using PendingReferences = std::vector<std::pair<model::ReferencePropertyBase*, QUuid>>;
+
+void collect_references(model::Object* object, PendingReferences& references)
+{
+    for ( auto property : object->properties() )
+    {
+        if ( property->traits().type == model::PropertyTraits::ObjectReference )
+        {
+            auto reference = static_cast<model::ReferencePropertyBase*>(property);
+            if ( auto target = reference->get_ref() )
+                references.emplace_back(reference, target->uuid.get());
+        }
+        else if ( property->traits().type == model::PropertyTraits::Object )
+        {
+            if ( property->traits().flags & model::PropertyTraits::List )
+            {
+                for ( const auto& child : property->value().toList() )
+                    collect_references(child.value<model::Object*>(), references);
+            }
+            else
+            {
+                collect_references(static_cast<model::SubObjectPropertyBase*>(property)->sub_object(), references);
+            }
+        }
+    }
+}
+
+/**
+ * \brief Whether \p assets can be added to the pasted document by clone_nodes()
+ */
+bool can_clone(const std::vector<model::DocumentNode*>& objects, const std::vector<model::DocumentNode*>& assets)
+{
+    for ( auto object : objects )
+        if ( !object->is_instance<model::ShapeElement>() )
+            return false;
+
+    for ( auto asset : assets )
+    {
+        if (
+            !asset->is_instance<model::NamedColor>() &&
+            !asset->is_instance<model::Bitmap>() &&
+            !asset->is_instance<model::Gradient>() &&
+            !asset->is_instance<model::GradientColors>()
+        )
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * \brief Clones shapes and the assets they reference into a new document
+ *
+ * References between the cloned nodes are resolved by uuid,
+ * the result matches what GlaxnimateMime::deserialize_json() would produce
+ */
+io::mime::DeserializedData clone_nodes(const std::vector<model::DocumentNode*>& shapes, const std::vector<model::DocumentNode*>& assets)
+{
+    io::mime::DeserializedData output;
+    output.initialize_data();
+    model::Document* document = output.document.get();
+    PendingReferences references;
+
+    auto clone = [document, &references](model::DocumentNode* node) {
+        auto object = node->clone();
+        collect_references(object.get(), references);
+        object->transfer(document);
+        return object.release();
+    };
+
+    for ( auto asset : assets )
+    {
+        auto obj = clone(asset);
+        if ( auto color = qobject_cast<model::NamedColor*>(obj) )
+            document->assets()->colors->values.emplace(color);
+        else if ( auto bitmap = qobject_cast<model::Bitmap*>(obj) )
+            document->assets()->images->values.emplace(bitmap);
+        else if ( auto gradient = qobject_cast<model::Gradient*>(obj) )
+            document->assets()->gradients->values.emplace(gradient);
+        else if ( auto gradient_colors = qobject_cast<model::GradientColors*>(obj) )
+            document->assets()->gradient_colors->values.emplace(gradient_colors);
+        else
+            delete obj;
+    }
+
+    std::vector<std::unique_ptr<model::ShapeElement>> cloned;
+    cloned.reserve(shapes.size());
+    for ( auto shape : shapes )
+        cloned.emplace_back(static_cast<model::ShapeElement*>(clone(shape)));
+    output.main->shapes.insert_range(std::move(cloned));
+
+    for ( const auto& reference : references )
+    {
+        auto target = reference.first->get_ref();
+        if ( !target || target->document() != document )
+            reference.first->set_ref(document->find_by_uuid(reference.second));
+    }
+
+    return output;
+}
+
+const char binary_magic[] = "GLXB";
+const quint16 binary_version = 1;
+
+QByteArray binary_header(const QUuid& snapshot)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.writeRawData(binary_magic, 4);
+    stream << binary_version << qint64(QCoreApplication::applicationPid()) << snapshot;
+    return data;
+}
+
+void write_cbor(QCborStreamWriter& writer, double value)
+{
+    if ( value == std::floor(value) && std::abs(value) < 1e15 )
+        writer.append(qint64(value));
+    // Floats are stored in the smallest size that doesn't lose precision
+    else if ( double(qfloat16(value)) == value )
+        writer.append(qfloat16(value));
+    else if ( double(float(value)) == value )
+        writer.append(float(value));
+    else
+        writer.append(value);
+}
+
+void write_cbor(QCborStreamWriter& writer, const QJsonValue& value)
+{
+    switch ( value.type() )
+    {
+        case QJsonValue::Bool:
+            writer.append(value.toBool());
+            break;
+        case QJsonValue::Double:
+            write_cbor(writer, value.toDouble());
+            break;
+        case QJsonValue::String:
+            writer.append(value.toString());
+            break;
+        case QJsonValue::Array:
+        {
+            QJsonArray array = value.toArray();
+            writer.startArray(array.size());
+            for ( const auto& item : array )
+                write_cbor(writer, item);
+            writer.endArray();
+            break;
+        }
+        case QJsonValue::Object:
+        {
+            QJsonObject object = value.toObject();
+            writer.startMap(object.size());
+            for ( auto it = object.constBegin(); it != object.constEnd(); ++it )
+            {
+                writer.append(it.key());
+                write_cbor(writer, it.value());
+            }
+            writer.endMap();
+            break;
+        }
+        default:
+            writer.append(nullptr);
+            break;
+    }
+}
+
+/**
+ * \brief Writes the same layout as GlaxnimateFormat::to_json(object)
+ *
+ * Only the values of leaf properties go through JSON
+ */
+void write_cbor(QCborStreamWriter& writer, model::Object* object)
+{
+    if ( !object )
+    {
+        writer.append(nullptr);
+        return;
+    }
+
+    // Indefinite length as to_json() skips undefined values
+    writer.startMap();
+    writer.append(QLatin1String("__type__"));
+    writer.append(object->type_name());
+
+    for ( model::BaseProperty* prop : object->properties() )
+    {
+        if ( prop->traits().type == model::PropertyTraits::Object )
+        {
+            writer.append(prop->name());
+            if ( prop->traits().flags & model::PropertyTraits::List )
+            {
+                QVariantList values = prop->value().toList();
+                writer.startArray(values.size());
+                for ( const auto& value : values )
+                    write_cbor(writer, value.value<model::Object*>());
+                writer.endArray();
+            }
+            else
+            {
+                write_cbor(writer, prop->value().value<model::Object*>());
+            }
+            continue;
+        }
+
+        QJsonValue value = io::glaxnimate::GlaxnimateFormat::to_json(prop);
+        if ( value.isUndefined() )
+            continue;
+        writer.append(prop->name());
+        write_cbor(writer, value);
+    }
+
+    writer.endMap();
+}
+
+/**
+ * \brief CBOR equivalent of GlaxnimateMime::serialize_json()
+ */
+QByteArray binary_payload(const std::vector<model::DocumentNode*>& objects)
+{
+    GetDeps deps(objects);
+    for ( auto object : objects )
+        deps.visit(object);
+
+    QByteArray data;
+    QCborStreamWriter writer(&data);
+    writer.startArray(deps.referenced.size() + objects.size());
+    for ( auto it = deps.referenced.rbegin(); it != deps.referenced.rend(); ++it )
+        write_cbor(writer, it->second);
+    for ( auto object : objects )
+        write_cbor(writer, object);
+    writer.endArray();
+    return data;
+}
+
 } // namespace
 
 QStringList io::glaxnimate::GlaxnimateMime::mime_types() const
@@ -95,8 +374,11 @@ io::mime::DeserializedData io::glaxnimate::GlaxnimateMime::deserialize(const QBy
         return {};
     }
 
-    QJsonArray input_objects = jdoc.array();
+    return deserialize_json(jdoc.array());
+}
 
+io::mime::DeserializedData io::glaxnimate::GlaxnimateMime::deserialize_json(const QJsonArray& input_objects)
+{
     io::mime::DeserializedData output;
     output.initialize_data();
     detail::ImportState state(nullptr, output.document.get());
@@ -150,3 +432,126 @@ io::mime::DeserializedData io::glaxnimate::GlaxnimateMime::deserialize(const QBy
     state.resolve();
     return output;
 }
+
+QStringList io::glaxnimate::GlaxnimateBinaryMime::mime_types() const
+{
+    return {"application/x-glaxnimate-binary"};
+}
+
+QByteArray io::glaxnimate::GlaxnimateBinaryMime::serialize(const std::vector<model::DocumentNode*>& objects) const
+{
+    return binary_header({}) + binary_payload(objects);
+}
+
+void io::glaxnimate::GlaxnimateBinaryMime::to_mime_data(QMimeData& out, const std::vector<model::DocumentNode*>& objects) const
+{
+    auto& snapshot = clipboard_snapshot();
+    snapshot.reset();
+
+    GetDeps deps(objects);
+    for ( auto object : objects )
+        deps.visit(object);
+
+    if ( can_clone(objects, deps.ordered) )
+    {
+        snapshot = std::make_shared<ClipboardSnapshot>();
+        snapshot->data = clone_nodes(objects, deps.ordered);
+        for ( auto list : snapshot->data.document->assets()->docnode_children() )
+            for ( auto asset : list->docnode_children() )
+                if ( !asset->is_instance<model::Composition>() )
+                    snapshot->assets.push_back(asset);
+        snapshot->id = QUuid::createUuid();
+
+        // Pasting in this process only needs the header
+        if ( auto lazy = qobject_cast<io::mime::MimeData*>(&out) )
+        {
+            QByteArray header = binary_header(snapshot->id);
+            for ( const QString& mime : mime_types() )
+            {
+                lazy->set_lazy_data(mime, header, [snapshot]{
+                    std::vector<model::DocumentNode*> shapes;
+                    for ( const auto& shape : snapshot->data.main->shapes )
+                        shapes.push_back(shape.get());
+                    return binary_payload(shapes);
+                });
+            }
+            return;
+        }
+    }
+
+    QByteArray data = binary_header(snapshot ? snapshot->id : QUuid()) + binary_payload(objects);
+    for ( const QString& mime : mime_types() )
+        out.setData(mime, data);
+}
+
+io::mime::DeserializedData io::glaxnimate::GlaxnimateBinaryMime::from_mime_data(const QMimeData& data) const
+{
+    // Payload not produced yet, it can only come from the snapshot
+    if ( auto lazy = qobject_cast<const io::mime::MimeData*>(&data) )
+    {
+        for ( const QString& mime : mime_types() )
+        {
+            io::mime::DeserializedData pasted;
+            if ( read_header(lazy->lazy_header(mime), pasted) != -1 && pasted.document )
+                return pasted;
+        }
+    }
+
+    return MimeSerializer::from_mime_data(data);
+}
+
+int io::glaxnimate::GlaxnimateBinaryMime::read_header(const QByteArray& data, io::mime::DeserializedData& snapshot_data) const
+{
+    QDataStream stream(data);
+    char magic[4];
+    quint16 version = 0;
+    qint64 pid = 0;
+    QUuid snapshot_id;
+    if ( stream.readRawData(magic, 4) != 4 || std::memcmp(magic, binary_magic, 4) != 0 )
+        return -1;
+
+    stream >> version >> pid >> snapshot_id;
+    if ( stream.status() != QDataStream::Ok || version > binary_version )
+        return -1;
+
+    auto& snapshot = clipboard_snapshot();
+    if ( snapshot && pid == QCoreApplication::applicationPid() && !snapshot_id.isNull() && snapshot_id == snapshot->id )
+    {
+        std::vector<model::DocumentNode*> shapes;
+        for ( const auto& shape : snapshot->data.main->shapes )
+            shapes.push_back(shape.get());
+        snapshot_data = clone_nodes(shapes, snapshot->assets);
+    }
+
+    return stream.device()->pos();
+}
+
+io::mime::DeserializedData io::glaxnimate::GlaxnimateBinaryMime::deserialize(const QByteArray& data) const
+{
+    io::mime::DeserializedData pasted;
+    int payload = read_header(data, pasted);
+    if ( payload == -1 )
+    {
+        message(GlaxnimateFormat::tr("Invalid binary clipboard data"));
+        return {};
+    }
+
+    if ( pasted.document )
+        return pasted;
+
+    QCborParserError error;
+    QCborValue cbor = QCborValue::fromCbor(data.mid(payload), &error);
+    if ( error.error != QCborError::NoError )
+    {
+        message(GlaxnimateFormat::tr("Could not parse binary clipboard data: %1").arg(error.errorString()));
+        return {};
+    }
+
+    if ( !cbor.isArray() )
+    {
+        message(GlaxnimateFormat::tr("No object found"));
+        return {};
+    }
+
+    return GlaxnimateMime::deserialize_json(cbor.toArray().toJsonArray());
+}
@@ -7,7 +7,9 @@
 #pragma once
 
 #include <QJsonDocument>
+#include <QJsonArray>
 #include <QByteArray>
+#include <QUuid>
 #include "io/mime/mime_serializer.hpp"
 #include "glaxnimate_format.hpp"
 
@@ -25,10 +27,44 @@ public:
     bool can_deserialize() const override { return true; }
 
     static QJsonDocument serialize_json(const std::vector<model::DocumentNode*>& objects);
+    static io::mime::DeserializedData deserialize_json(const QJsonArray& objects);
 
 private:
     static Autoreg<GlaxnimateMime> autoreg;
 };
 
+/**
+ * \brief Binary clipboard format for copying between glaxnimate instances
+ *
+ * The payload is the same object layout used by GlaxnimateMime encoded as CBOR,
+ * preceded by a header identifying the process that copied it.
+ *
+ * When pasting in the same process, the objects are cloned from a snapshot
+ * taken on copy, without decoding the payload.
+ * If the clipboard data is an io::mime::MimeData, the payload is only encoded
+ * when another application requests it.
+ */
+class GlaxnimateBinaryMime : public io::mime::MimeSerializer
+{
+public:
+    QString slug() const override { return "glaxnimate-binary"; }
+    QString name() const override { return GlaxnimateFormat::tr("Glaxnimate Animation (Binary)"); }
+    QStringList mime_types() const override;
+    QByteArray serialize(const std::vector<model::DocumentNode*>& objects) const override;
+    io::mime::DeserializedData deserialize(const QByteArray& data) const override;
+    bool can_deserialize() const override { return true; }
+    void to_mime_data(QMimeData& out, const std::vector<model::DocumentNode*>& objects) const override;
+    io::mime::DeserializedData from_mime_data(const QMimeData& data) const override;
+
+private:
+    /**
+     * \brief Reads the header and clones the snapshot into \p snapshot_data if it matches
+     * \return Offset of the payload or -1 if the header isn't valid
+     */
+    int read_header(const QByteArray& data, io::mime::DeserializedData& snapshot_data) const;
+
+    static Autoreg<GlaxnimateBinaryMime> autoreg;
+};
+
 
 } // namespace glaxnimate::io::glaxnimate
@@ -6,6 +6,8 @@
 
 #pragma once
 
+#include <algorithm>
+
 #include <QUuid>
 #include <QJsonArray>
 
@@ -177,6 +179,11 @@ public:
         }
 
         load_metadata(top_level);
+        if ( fmt )
+        {
+            objects_total = count_objects(assets);
+            emit fmt->progress_max_changed(objects_total);
+        }
         load_object(document->assets(), assets);
         resolve();
     }
@@ -188,6 +195,28 @@ private:
             emit fmt->warning(msg);
     }
 
+    /**
+     * \brief Number of objects in \p value, used to report progress
+     */
+    static int count_objects(const QJsonValue& value)
+    {
+        int count = 0;
+        if ( value.isObject() )
+        {
+            QJsonObject object = value.toObject();
+            if ( object.contains("__type__") )
+                count++;
+            for ( const auto& child : object )
+                count += count_objects(child);
+        }
+        else if ( value.isArray() )
+        {
+            for ( const auto& child : value.toArray() )
+                count += count_objects(child);
+        }
+        return count;
+    }
+
     QJsonObject fixed_asset_list(const QString& type, const QJsonValue& values)
     {
         QJsonObject fixed;
@@ -311,6 +340,17 @@ private:
 
     void do_load_object ( model::Object* target, QJsonObject object, const UnresolvedPath& path )
     {
+        // Progress is only reported when loading a whole document
+        if ( objects_total )
+        {
+            if ( fmt->cancelled() )
+                return;
+
+            objects_loaded++;
+            if ( objects_loaded % 64 == 0 )
+                emit fmt->progress(std::min(objects_loaded, objects_total));
+        }
+
         QString type = object["__type__"].toString();
 
         if ( type != target->type_name() )
@@ -622,6 +662,8 @@ private:
     std::vector<model::Object*> unwanted;
     std::vector<std::unique_ptr<model::Object>> temporaries;
     int document_version;
+    int objects_total = 0;
+    int objects_loaded = 0;
 };
 
 } // namespace glaxnimate::io::glaxnimate::detail
@@ -6,6 +6,8 @@
 
 #pragma once
 
+#include <algorithm>
+#include <unordered_map>
 
 #include <QCborValue>
 #include <QCborArray>
@@ -263,7 +265,9 @@ public:
 
         if ( !mask.isEmpty() )
         {
-            json["tt"_l] = 1;
+            // Track matte type: 1-2 alpha, 3-4 luma, even numbers are inverted
+            bool luma = forced_parent->mask->mask.get() == model::MaskSettings::Luma;
+            json["tt"_l] = (luma ? 3 : 1) + (forced_parent->mask->inverted.get() ? 1 : 0);
             output.push_front(json);
             output.push_front(mask);
         }
@@ -365,19 +369,31 @@ public:
         return QCborValue::fromVariant(v);
     }
 
-    void convert_object_from_meta(model::Object* obj, const QMetaObject* mo, QCborMap& json_obj)
+    /**
+     * \brief Field lists for \p mo and its base classes, base classes first
+     */
+    const std::vector<const QVector<FieldInfo>*>& type_fields(const QMetaObject* mo)
     {
-        if ( auto super = mo->superClass() )
-            convert_object_from_meta(obj, super, json_obj);
+        auto it = type_fields_cache.find(mo);
+        if ( it != type_fields_cache.end() )
+            return it->second;
 
-        auto it = fields.find(model::detail::naked_type_name(mo));
-        if ( it != fields.end() )
-            convert_object_properties(obj, *it, json_obj);
+        std::vector<const QVector<FieldInfo>*> type_fields;
+        for ( auto super = mo; super; super = super->superClass() )
+        {
+            auto fit = fields.find(model::detail::naked_type_name(super));
+            if ( fit != fields.end() )
+                type_fields.push_back(&*fit);
+        }
+        std::reverse(type_fields.begin(), type_fields.end());
+
+        return type_fields_cache.emplace(mo, std::move(type_fields)).first->second;
     }
 
     void convert_object_basic(model::Object* obj, QCborMap& json_obj)
     {
-        convert_object_from_meta(obj, obj->metaObject(), json_obj);
+        for ( auto type_fields : this->type_fields(obj->metaObject()) )
+            convert_object_properties(obj, *type_fields, json_obj);
     }
 
     void convert_object_properties(model::Object* obj, const QVector<FieldInfo>& fields, QCborMap& json_obj)
@@ -387,7 +403,7 @@ public:
             if ( field.mode != Auto || (strip && !field.essential) )
                 continue;
 
-            model::BaseProperty * prop = obj->get_property(field.name);
+            model::BaseProperty * prop = obj->get_property(field.id);
             if ( !prop )
             {
                 logger.stream() << field.name << "is not a property";
@@ -743,6 +759,7 @@ public:
     model::Document* document;
     bool strip;
     QMap<QUuid, int> layer_indices;
+    std::unordered_map<const QMetaObject*, std::vector<const QVector<FieldInfo>*>> type_fields_cache;
     app::log::Log logger{"Lottie Export"};
     model::Layer* mask = 0;
     bool strip_raster;
@@ -168,7 +168,6 @@ private:
 
         std::unique_ptr<model::ShapeElement> inner_shape;
         bool start_mask = json["td"].toInt();
-        start_mask = false;
 
         if ( ty == 0 )
         {
@@ -210,7 +209,8 @@ private:
             if ( mask && tt )
             {
                 mask->shapes.insert(std::move(inner_shape), 1);
-                auto mode = model::MaskSettings::MaskMode((tt + 1) / 2);
+                // Track mattes are rasterized: 1-2 alpha, 3-4 luma
+                auto mode = tt > 2 ? model::MaskSettings::Luma : model::MaskSettings::AlphaMatte;
                 mask->mask->mask.set(mode);
                 mask->mask->inverted.set(tt > 0 && tt % 2 == 0);
             }
@@ -688,7 +688,7 @@ private:
             if ( field.mode >= Ignored || !json_obj.contains(field.lottie) )
                 continue;
 
-            model::BaseProperty * prop = obj->get_property(field.name);
+            model::BaseProperty * prop = obj->get_property(field.id);
             if ( !prop )
             {
                 logger.stream() << field.name << "is not a property";
@@ -162,13 +162,15 @@ enum FieldMode
 struct FieldInfo
 {
     QString name;
+    /// Interned \p name, avoids hashing the name for every object
+    model::PropertyId id;
     QString lottie;
     bool essential;
     FieldMode mode;
     TransformFunc transform;
 
     FieldInfo(const char* lottie, const char* name, TransformFunc transform = {}, bool essential = true)
-        : name(name), lottie(lottie), essential(essential), mode(Auto), transform(std::move(transform))
+        : name(name), id(this->name), lottie(lottie), essential(essential), mode(Auto), transform(std::move(transform))
     {}
 
     FieldInfo(const char* lottie, FieldMode mode = Ignored)
@@ -176,7 +178,7 @@ struct FieldInfo
     {}
 
     FieldInfo(const char* lottie, const char* name, FieldMode mode, bool essential = true)
-        : name(name), lottie(lottie), essential(essential), mode(mode)
+        : name(name), id(this->name), lottie(lottie), essential(essential), mode(mode)
     {}
 };
 
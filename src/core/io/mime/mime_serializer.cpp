@@ -31,6 +31,51 @@ glaxnimate::io::mime::DeserializedData glaxnimate::io::mime::MimeSerializer::fro
     return {};
 }
 
+void glaxnimate::io::mime::MimeData::set_lazy_data(const QString& mime, const QByteArray& header, Producer payload)
+{
+    lazy[mime] = {header, std::move(payload)};
+}
+
+QByteArray glaxnimate::io::mime::MimeData::lazy_header(const QString& mime) const
+{
+    auto it = lazy.find(mime);
+    if ( it == lazy.end() )
+        return {};
+    return it->second.header;
+}
+
+bool glaxnimate::io::mime::MimeData::hasFormat(const QString& mime) const
+{
+    return lazy.count(mime) || QMimeData::hasFormat(mime);
+}
+
+QStringList glaxnimate::io::mime::MimeData::formats() const
+{
+    QStringList formats = QMimeData::formats();
+    for ( const auto& p : lazy )
+        if ( !formats.contains(p.first) )
+            formats.push_back(p.first);
+    return formats;
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+QVariant glaxnimate::io::mime::MimeData::retrieveData(const QString& mime, QMetaType type) const
+#else
+QVariant glaxnimate::io::mime::MimeData::retrieveData(const QString& mime, QVariant::Type type) const
+#endif
+{
+    auto it = lazy.find(mime);
+    if ( it != lazy.end() )
+    {
+        LazyData data = std::move(it->second);
+        lazy.erase(it);
+        // Stored so the payload is only produced once
+        const_cast<MimeData*>(this)->setData(mime, data.header + data.payload());
+    }
+
+    return QMimeData::retrieveData(mime, type);
+}
+
 void glaxnimate::io::mime::MimeSerializer::message(const QString& message, app::log::Severity severity) const
 {
     app::log::Log(slug()).log(message, severity);
@@ -6,6 +6,8 @@
 
 #pragma once
 
+#include <functional>
+#include <map>
 #include <memory>
 
 #include <QString>
@@ -39,6 +41,48 @@ struct DeserializedData
     void initialize_data();
 };
 
+/**
+ * \brief Mime data that can delay producing some of its formats until they are requested
+ */
+class MimeData : public QMimeData
+{
+    Q_OBJECT
+
+public:
+    using Producer = std::function<QByteArray()>;
+
+    /**
+     * \brief Sets the data for \p mime to \p header followed by the result of \p payload
+     *
+     * \p payload is only called the first time the data is retrieved
+     */
+    void set_lazy_data(const QString& mime, const QByteArray& header, Producer payload);
+
+    /**
+     * \brief Header passed to set_lazy_data(), empty if the payload has already been produced
+     */
+    QByteArray lazy_header(const QString& mime) const;
+
+    bool hasFormat(const QString& mime) const override;
+    QStringList formats() const override;
+
+protected:
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    QVariant retrieveData(const QString& mime, QMetaType type) const override;
+#else
+    QVariant retrieveData(const QString& mime, QVariant::Type type) const override;
+#endif
+
+private:
+    struct LazyData
+    {
+        QByteArray header;
+        Producer payload;
+    };
+
+    mutable std::map<QString, LazyData> lazy;
+};
+
 class MimeSerializer
 {
 public:
@@ -61,7 +105,7 @@ public:
             out.setData(mime, data);
     }
 
-    io::mime::DeserializedData from_mime_data(const QMimeData& data) const;
+    virtual io::mime::DeserializedData from_mime_data(const QMimeData& data) const;
 
 protected:
     void message(const QString& message, app::log::Severity severity = app::log::Warning) const;
@@ -0,0 +1,805 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "animated_raster_format.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <unordered_map>
+
+#include <QFileInfo>
+#include <QImage>
+#include <QtConcurrent>
+#include <QThreadPool>
+
+#include <zlib.h>
+
+#include "model/assets/composition.hpp"
+#include "model/render_program.hpp"
+#include "utils/quantize.hpp"
+
+glaxnimate::io::Autoreg<glaxnimate::io::raster::AnimatedRasterFormat> glaxnimate::io::raster::AnimatedRasterFormat::autoreg;
+
+std::unique_ptr<app::settings::SettingsGroup> glaxnimate::io::raster::AnimatedRasterFormat::save_settings(model::Composition*) const
+{
+    QVariantMap palette_modes;
+    palette_modes[tr("Global")] = int(GlobalPalette);
+    palette_modes[tr("Per frame (GIF only)")] = int(FramePalette);
+
+    QVariantMap algorithms;
+    algorithms[tr("Octree")] = int(Octree);
+    algorithms[tr("k-means")] = int(KMeans);
+
+    return std::make_unique<app::settings::SettingsGroup>(app::settings::SettingList{
+        app::settings::Setting("palette", tr("Palette"), tr("Whether all the frames share the same colors"),
+                               app::settings::Setting::Int, int(GlobalPalette), palette_modes),
+        app::settings::Setting("quantize", tr("Quantization"), tr("Algorithm used to pick the palette colors"),
+                               app::settings::Setting::Int, int(Octree), algorithms),
+        app::settings::Setting("colors", tr("Colors"), tr("Maximum number of colors in a palette, besides transparent"), 255, 1, 255),
+        app::settings::Setting("frame_step", tr("Time Step"), tr("By how much each rendered frame should increase time (in frames)"), 1, 1, 16),
+        app::settings::Setting("loop", tr("Loop"), tr("Whether the animation should repeat"), true),
+    });
+}
+
+namespace {
+
+using glaxnimate::model::FrameTime;
+
+/// Palette index for pixels that are transparent or show the previous frame
+constexpr uchar transparent_index = 0;
+
+/// Opaque colors, index 0 is transparent
+using Palette = std::vector<QRgb>;
+
+enum class Disposal
+{
+    /// Leave the frame on the canvas
+    Keep,
+    /// Clear the frame area to transparent
+    Background,
+};
+
+/**
+ * \brief Area of the canvas updated by one encoded frame
+ */
+struct FramePlan
+{
+    /// Palette of the rendered frame shown
+    Palette palette;
+    QRect rect;
+    Disposal disposal = Disposal::Keep;
+    /// Time range shown, in composition frames
+    FrameTime start;
+    FrameTime end;
+    /// Palette indices for the pixels in rect
+    std::vector<uchar> data = {};
+};
+
+int palette_bits(const Palette& palette)
+{
+    int bits = 1;
+    while ( (1 << bits) < int(palette.size()) )
+        bits++;
+    return bits;
+}
+
+Palette build_palette(const QImage& image, int colors, glaxnimate::io::raster::AnimatedRasterFormat::QuantizeAlgorithm algorithm)
+{
+    using namespace glaxnimate::utils;
+
+    Palette palette{0};
+    std::vector<QRgb> quantized;
+    if ( algorithm == glaxnimate::io::raster::AnimatedRasterFormat::KMeans )
+        quantized = quantize::k_means(image, colors, 100, quantize::Closest);
+    else
+        quantized = quantize::octree(image, colors);
+
+    for ( QRgb color : quantized )
+        palette.push_back(color | 0xff000000);
+
+    // GIF color tables have at least 2 entries
+    if ( palette.size() < 2 )
+        palette.push_back(qRgb(0, 0, 0));
+    return palette;
+}
+
+QImage render_frame(const glaxnimate::model::RenderProgram& program, int time, const QSize& size)
+{
+    return program.render_image(time, size).convertToFormat(QImage::Format_ARGB32);
+}
+
+/**
+ * \brief Renders (a subset of) the frames at \p times stacked vertically to build a palette shared by all the frames
+ */
+QImage palette_sample(const glaxnimate::model::RenderProgram& program, const std::vector<int>& times, const QSize& size)
+{
+    constexpr qint64 max_pixels = 4'000'000;
+
+    qint64 frame_pixels = qint64(size.width()) * size.height();
+    int step = qMax<qint64>(1, (frame_pixels * times.size() + max_pixels - 1) / max_pixels);
+    int count = (times.size() + step - 1) / step;
+
+    QImage sample(size.width(), size.height() * count, QImage::Format_ARGB32);
+    // Taken once as scanLine() on a shared image isn't thread-safe
+    uchar* bits = sample.bits();
+    qsizetype bytes_per_line = sample.bytesPerLine();
+    std::vector<int> rows(count);
+    std::iota(rows.begin(), rows.end(), 0);
+    QtConcurrent::blockingMap(rows, [&program, &times, size, step, bits, bytes_per_line](int i){
+        QImage frame = render_frame(program, times[i * step], size);
+        for ( int y = 0; y < size.height(); y++ )
+            std::memcpy(bits + (i * size.height() + y) * bytes_per_line, frame.constScanLine(y), size.width() * 4);
+    });
+    return sample;
+}
+
+/**
+ * \brief Palette index of each pixel in \p image
+ */
+std::vector<uchar> map_to_palette(const QImage& image, const Palette& palette)
+{
+    std::vector<uchar> indices(image.width() * image.height());
+    std::unordered_map<QRgb, uchar> cache;
+
+    for ( int y = 0; y < image.height(); y++ )
+    {
+        auto line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        uchar* out = indices.data() + y * image.width();
+        for ( int x = 0; x < image.width(); x++ )
+        {
+            if ( qAlpha(line[x]) < 128 )
+            {
+                out[x] = transparent_index;
+                continue;
+            }
+
+            QRgb color = line[x] | 0xff000000;
+            auto it = cache.find(color);
+            if ( it == cache.end() )
+            {
+                uchar best = 1;
+                int best_distance = std::numeric_limits<int>::max();
+                for ( int i = 1; i < int(palette.size()); i++ )
+                {
+                    int dr = qRed(color) - qRed(palette[i]);
+                    int dg = qGreen(color) - qGreen(palette[i]);
+                    int db = qBlue(color) - qBlue(palette[i]);
+                    int distance = dr * dr + dg * dg + db * db;
+                    if ( distance < best_distance )
+                    {
+                        best_distance = distance;
+                        best = i;
+                    }
+                }
+                it = cache.emplace(color, best).first;
+            }
+            out[x] = it->second;
+        }
+    }
+
+    return indices;
+}
+
+/**
+ * \brief Quantized frame, colors are accessed by pixel offset
+ */
+struct IndexedFrame
+{
+    const std::vector<uchar>* indices;
+    const Palette* palette;
+
+    QRgb color(int offset) const
+    {
+        return (*palette)[(*indices)[offset]];
+    }
+};
+
+/**
+ * \brief Bounding box of the pixels where \p predicate holds
+ */
+template<class Predicate>
+QRect pixel_bounds(const QSize& size, const Predicate& predicate)
+{
+    int left = size.width();
+    int right = -1;
+    int top = size.height();
+    int bottom = -1;
+
+    for ( int y = 0; y < size.height(); y++ )
+    {
+        for ( int x = 0; x < size.width(); x++ )
+        {
+            if ( predicate(y * size.width() + x) )
+            {
+                left = qMin(left, x);
+                right = qMax(right, x);
+                top = qMin(top, y);
+                bottom = qMax(bottom, y);
+            }
+        }
+    }
+
+    if ( right == -1 )
+        return {};
+
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+void clear_rect(std::vector<QRgb>& canvas, const QSize& size, const QRect& rect)
+{
+    for ( int y = rect.top(); y <= rect.bottom(); y++ )
+        std::fill_n(canvas.begin() + y * size.width() + rect.left(), rect.width(), 0);
+}
+
+/**
+ * \brief Decides which area each frame updates, merging frames that don't change anything
+ *
+ * Frames are added in order, pixels can only be turned transparent by disposing
+ * of the previous frame so when that's needed the previous frame is enlarged to cover them.
+ * Because of that a plan is only final once the following frame has been added.
+ */
+class FramePlanner
+{
+public:
+    /**
+     * \param merge Whether frames that don't change anything extend the previous one,
+     * otherwise each frame gets its own plan
+     */
+    FramePlanner(const QSize& size, bool merge)
+        : size(size),
+          merge(merge),
+          canvas(size.width() * size.height(), 0),
+          shown(size.width() * size.height(), 0)
+    {}
+
+    /**
+     * \brief Adds the next frame, shown from \p start to \p end
+     *
+     * Plans that can no longer change are appended to \p done, with their data.
+     */
+    void add(std::vector<uchar> indices, const Palette& palette, FrameTime start, FrameTime end, std::vector<FramePlan>& done)
+    {
+        IndexedFrame target{&indices, &palette};
+
+        if ( !pending )
+        {
+            pending = FramePlan{palette, QRect(QPoint(0, 0), size), Disposal::Keep, start, end};
+            for ( int p = 0; p < int(canvas.size()); p++ )
+                canvas[p] = target.color(p);
+            pending_indices = std::move(indices);
+            return;
+        }
+
+        FramePlan& previous = *pending;
+        QRect clear = pixel_bounds(size, [this, &target](int p){
+            return canvas[p] != 0 && target.color(p) == 0;
+        });
+        if ( clear.isValid() )
+        {
+            previous.disposal = Disposal::Background;
+            previous.rect |= clear;
+            clear_rect(canvas, size, previous.rect);
+        }
+
+        QRect changed = pixel_bounds(size, [this, &target](int p){
+            return canvas[p] != target.color(p);
+        });
+
+        if ( !changed.isValid() )
+        {
+            if ( merge && previous.disposal == Disposal::Keep )
+            {
+                previous.end = end;
+                return;
+            }
+            changed = QRect(0, 0, 1, 1);
+        }
+
+        extract(previous);
+        done.push_back(std::move(previous));
+        planned++;
+
+        pending = FramePlan{palette, changed, Disposal::Keep, start, end};
+        for ( int y = changed.top(); y <= changed.bottom(); y++ )
+        {
+            for ( int x = changed.left(); x <= changed.right(); x++ )
+            {
+                int p = y * size.width() + x;
+                canvas[p] = target.color(p);
+            }
+        }
+        pending_indices = std::move(indices);
+    }
+
+    /**
+     * \brief Appends the last plan to \p done
+     */
+    void finish(std::vector<FramePlan>& done)
+    {
+        if ( !pending )
+            return;
+
+        // Some viewers don't clear the canvas when looping
+        if ( planned > 0 )
+        {
+            pending->disposal = Disposal::Background;
+            pending->rect = QRect(QPoint(0, 0), size);
+        }
+
+        extract(*pending);
+        done.push_back(std::move(*pending));
+        planned++;
+        pending.reset();
+    }
+
+    /**
+     * \brief Number of plans appended so far
+     */
+    int count() const
+    {
+        return planned;
+    }
+
+private:
+    /**
+     * \brief Fills FramePlan::data, leaving pixels already on the canvas transparent
+     */
+    void extract(FramePlan& plan)
+    {
+        if ( disposed.isValid() )
+            clear_rect(shown, size, disposed);
+
+        IndexedFrame target{&pending_indices, &plan.palette};
+        plan.data.reserve(plan.rect.width() * plan.rect.height());
+        for ( int y = plan.rect.top(); y <= plan.rect.bottom(); y++ )
+        {
+            for ( int x = plan.rect.left(); x <= plan.rect.right(); x++ )
+            {
+                int p = y * size.width() + x;
+                QRgb color = target.color(p);
+                if ( color == shown[p] )
+                {
+                    plan.data.push_back(transparent_index);
+                }
+                else
+                {
+                    plan.data.push_back(pending_indices[p]);
+                    shown[p] = color;
+                }
+            }
+        }
+
+        disposed = plan.disposal == Disposal::Background ? plan.rect : QRect();
+    }
+
+    QSize size;
+    bool merge;
+    /// Canvas after the pending plan
+    std::vector<QRgb> canvas;
+    /// Canvas as drawn by the plans already extracted
+    std::vector<QRgb> shown;
+    std::optional<FramePlan> pending;
+    /// Palette indices of the frame shown by pending
+    std::vector<uchar> pending_indices;
+    /// Area to clear before drawing the next extracted plan
+    QRect disposed;
+    int planned = 0;
+};
+
+/**
+ * \brief Writes variable-width codes least significant bit first, as used by GIF
+ */
+class BitWriter
+{
+public:
+    void write(int code, int bits)
+    {
+        buffer |= quint32(code) << buffer_bits;
+        buffer_bits += bits;
+        while ( buffer_bits >= 8 )
+        {
+            data.push_back(char(buffer & 0xff));
+            buffer >>= 8;
+            buffer_bits -= 8;
+        }
+    }
+
+    QByteArray finish()
+    {
+        if ( buffer_bits > 0 )
+            data.push_back(char(buffer & 0xff));
+        buffer = 0;
+        buffer_bits = 0;
+        return std::move(data);
+    }
+
+private:
+    QByteArray data;
+    quint32 buffer = 0;
+    int buffer_bits = 0;
+};
+
+QByteArray lzw_encode(const std::vector<uchar>& data, int min_code_size)
+{
+    const int clear_code = 1 << min_code_size;
+    const int end_code = clear_code + 1;
+    constexpr int max_codes = 4096;
+
+    BitWriter out;
+    int code_size = min_code_size + 1;
+    int last_code = end_code;
+    // (prefix code << 8 | next index) -> code
+    std::unordered_map<quint32, quint16> table;
+    table.reserve(max_codes);
+
+    out.write(clear_code, code_size);
+
+    if ( !data.empty() )
+    {
+        int prefix = data[0];
+        for ( std::size_t i = 1; i < data.size(); i++ )
+        {
+            quint32 key = (quint32(prefix) << 8) | data[i];
+            auto it = table.find(key);
+            if ( it != table.end() )
+            {
+                prefix = it->second;
+                continue;
+            }
+
+            out.write(prefix, code_size);
+            table.emplace(key, ++last_code);
+            if ( last_code >= (1 << code_size) )
+                code_size++;
+
+            if ( last_code == max_codes - 1 )
+            {
+                out.write(clear_code, code_size);
+                table.clear();
+                code_size = min_code_size + 1;
+                last_code = end_code;
+            }
+
+            prefix = data[i];
+        }
+        out.write(prefix, code_size);
+    }
+
+    out.write(end_code, code_size);
+    return out.finish();
+}
+
+void write_le16(QIODevice& file, int value)
+{
+    char bytes[2] = {char(value & 0xff), char((value >> 8) & 0xff)};
+    file.write(bytes, 2);
+}
+
+void write_color_table(QIODevice& file, const Palette& palette, int bits)
+{
+    QByteArray table((1 << bits) * 3, 0);
+    for ( int i = 0; i < int(palette.size()); i++ )
+    {
+        table[i * 3] = char(qRed(palette[i]));
+        table[i * 3 + 1] = char(qGreen(palette[i]));
+        table[i * 3 + 2] = char(qBlue(palette[i]));
+    }
+    file.write(table);
+}
+
+/// Centiseconds since the start of the animation
+int gif_time(FrameTime time, FrameTime start, qreal fps)
+{
+    return qRound((time - start) * 100 / fps);
+}
+
+void write_gif_header(QIODevice& file, const QSize& size, const Palette* global_palette, bool loop)
+{
+    file.write("GIF89a");
+    write_le16(file, size.width());
+    write_le16(file, size.height());
+
+    int global_bits = global_palette ? palette_bits(*global_palette) : 1;
+    // Color resolution 8 bits, global table size
+    char screen_flags = global_palette ? char(0xf0 | (global_bits - 1)) : 0x70;
+    file.write(&screen_flags, 1);
+    // Background index, pixel aspect ratio
+    file.write("\0\0", 2);
+    if ( global_palette )
+        write_color_table(file, *global_palette, global_bits);
+
+    if ( loop )
+    {
+        file.write("\x21\xff\x0bNETSCAPE2.0\x03\x01", 16);
+        write_le16(file, 0);
+        file.write("\0", 1);
+    }
+}
+
+void write_gif_frame(QIODevice& file, const FramePlan& plan, const QByteArray& encoded, bool per_frame, FrameTime start, qreal fps)
+{
+    int bits = palette_bits(plan.palette);
+
+    // Graphic control extension: disposal and transparent index
+    file.write("\x21\xf9\x04", 3);
+    char control_flags = char((plan.disposal == Disposal::Background ? 2 : 1) << 2 | 1);
+    file.write(&control_flags, 1);
+    write_le16(file, gif_time(plan.end, start, fps) - gif_time(plan.start, start, fps));
+    char transparent = char(transparent_index);
+    file.write(&transparent, 1);
+    file.write("\0", 1);
+
+    // Image descriptor
+    file.write("\x2c", 1);
+    write_le16(file, plan.rect.x());
+    write_le16(file, plan.rect.y());
+    write_le16(file, plan.rect.width());
+    write_le16(file, plan.rect.height());
+    char image_flags = per_frame ? char(0x80 | (bits - 1)) : 0;
+    file.write(&image_flags, 1);
+    if ( per_frame )
+        write_color_table(file, plan.palette, bits);
+
+    char min_code_size = char(qMax(2, bits));
+    file.write(&min_code_size, 1);
+    for ( int offset = 0; offset < encoded.size(); offset += 255 )
+    {
+        char block_size = char(qMin(255, int(encoded.size()) - offset));
+        file.write(&block_size, 1);
+        file.write(encoded.constData() + offset, uchar(block_size));
+    }
+    file.write("\0", 1);
+}
+
+void append_be32(QByteArray& data, quint32 value)
+{
+    data.append(char((value >> 24) & 0xff));
+    data.append(char((value >> 16) & 0xff));
+    data.append(char((value >> 8) & 0xff));
+    data.append(char(value & 0xff));
+}
+
+void append_be16(QByteArray& data, quint16 value)
+{
+    data.append(char((value >> 8) & 0xff));
+    data.append(char(value & 0xff));
+}
+
+void write_png_chunk(QIODevice& file, const char* type, const QByteArray& data)
+{
+    QByteArray chunk;
+    append_be32(chunk, data.size());
+    chunk.append(type, 4);
+    chunk.append(data);
+    uLong crc = crc32(0, reinterpret_cast<const Bytef*>(chunk.constData() + 4), chunk.size() - 4);
+    append_be32(chunk, crc);
+    file.write(chunk);
+}
+
+/**
+ * \brief Compressed PNG image data for the palette indices of \p plan
+ */
+QByteArray png_encode(const FramePlan& plan)
+{
+    int width = plan.rect.width();
+    int height = plan.rect.height();
+    QByteArray raw;
+    raw.reserve((width + 1) * height);
+    for ( int y = 0; y < height; y++ )
+    {
+        // Filter type: none, palette images rarely benefit from filtering
+        raw.append('\0');
+        raw.append(reinterpret_cast<const char*>(plan.data.data() + y * width), width);
+    }
+
+    uLongf size = compressBound(raw.size());
+    QByteArray compressed(size, Qt::Uninitialized);
+    compress2(reinterpret_cast<Bytef*>(compressed.data()), &size, reinterpret_cast<const Bytef*>(raw.constData()), raw.size(), Z_BEST_COMPRESSION);
+    compressed.resize(size);
+    return compressed;
+}
+
+QByteArray apng_animation_control(int frames, bool loop)
+{
+    QByteArray animation;
+    append_be32(animation, frames);
+    append_be32(animation, loop ? 0 : 1);
+    return animation;
+}
+
+/**
+ * \brief Writes the chunks before the frames
+ * \return Position of the animation control chunk, so the frame count can be updated
+ */
+qint64 write_apng_header(QIODevice& file, const QSize& size, const Palette& palette, int frames, bool loop)
+{
+    file.write("\x89PNG\r\n\x1a\n", 8);
+
+    QByteArray header;
+    append_be32(header, size.width());
+    append_be32(header, size.height());
+    // Bit depth 8, indexed color, default compression, filter and interlace
+    header.append("\x08\x03\0\0\0", 5);
+    write_png_chunk(file, "IHDR", header);
+
+    qint64 animation_pos = file.pos();
+    write_png_chunk(file, "acTL", apng_animation_control(frames, loop));
+
+    QByteArray colors;
+    for ( QRgb color : palette )
+    {
+        colors.append(char(qRed(color)));
+        colors.append(char(qGreen(color)));
+        colors.append(char(qBlue(color)));
+    }
+    write_png_chunk(file, "PLTE", colors);
+    // Only the first entry has alpha
+    write_png_chunk(file, "tRNS", QByteArray(1, '\0'));
+
+    return animation_pos;
+}
+
+void write_apng_frame(QIODevice& file, const FramePlan& plan, const QByteArray& encoded, quint32& sequence, FrameTime start, qreal fps)
+{
+    bool first = sequence == 0;
+
+    QByteArray control;
+    append_be32(control, sequence++);
+    append_be32(control, plan.rect.width());
+    append_be32(control, plan.rect.height());
+    append_be32(control, plan.rect.x());
+    append_be32(control, plan.rect.y());
+    // Delay in milliseconds, rounded from the start to avoid drifting
+    int delay = qRound((plan.end - start) * 1000 / fps) - qRound((plan.start - start) * 1000 / fps);
+    append_be16(control, delay);
+    append_be16(control, 1000);
+    control.append(char(plan.disposal == Disposal::Background ? 1 : 0));
+    // Blend over so transparent pixels keep the previous frame
+    control.append(char(1));
+    write_png_chunk(file, "fcTL", control);
+
+    if ( first )
+    {
+        write_png_chunk(file, "IDAT", encoded);
+    }
+    else
+    {
+        QByteArray frame_data;
+        append_be32(frame_data, sequence++);
+        frame_data.append(encoded);
+        write_png_chunk(file, "fdAT", frame_data);
+    }
+}
+
+} // namespace
+
+bool glaxnimate::io::raster::AnimatedRasterFormat::on_save(QIODevice& file, const QString& filename, model::Composition* comp, const QVariantMap& setting_values)
+{
+    bool apng = QFileInfo(filename).suffix().compare("apng", Qt::CaseInsensitive) == 0;
+    // APNG has a single palette
+    bool per_frame = !apng && setting_values.value("palette", int(GlobalPalette)).toInt() == FramePalette;
+    auto algorithm = QuantizeAlgorithm(setting_values.value("quantize", int(Octree)).toInt());
+    int colors = qBound(1, setting_values.value("colors", 255).toInt(), 255);
+    int frame_step = setting_values.value("frame_step", 1).toInt();
+    bool loop = setting_values.value("loop", true).toBool();
+
+    QSize size(comp->width.get(), comp->height.get());
+    if ( frame_step <= 0 || size.isEmpty() )
+        return false;
+
+    int first_frame = comp->animation->first_frame.get();
+    int last_frame = comp->animation->last_frame.get();
+    qreal fps = comp->fps.get();
+
+    std::vector<int> times;
+    for ( int t = first_frame; t < last_frame; t += frame_step )
+        times.push_back(t);
+    if ( times.empty() )
+        times.push_back(first_frame);
+
+    if ( !apng && frame_step * 100 / fps < 2 )
+        warning(tr("Most viewers slow down GIF frames shorter than 20ms, consider increasing the time step"));
+
+    // Rendering, quantization and compression work on each frame independently,
+    // only planning the updated areas needs to go through the frames in order.
+    // Frames are processed in batches so only a few of them are in memory at once
+    int frames = times.size();
+    emit progress_max_changed(frames);
+
+    model::RenderProgram program(comp);
+    Palette global_palette;
+    if ( !per_frame )
+        global_palette = build_palette(palette_sample(program, times, size), colors, algorithm);
+
+    // The APNG frame count comes before the frames, merging frames changes it
+    // so it can only be done if the count can be fixed afterwards
+    bool merge = !apng || !file.isSequential();
+    FramePlanner planner(size, merge);
+    FrameTime start = times[0];
+    quint32 sequence = 0;
+    qint64 animation_pos = 0;
+
+    if ( apng )
+        animation_pos = write_apng_header(file, size, global_palette, frames, loop);
+    else
+        write_gif_header(file, size, per_frame ? nullptr : &global_palette, loop);
+
+    auto write_plans = [&](const std::vector<FramePlan>& plans){
+        if ( apng )
+        {
+            QList<QByteArray> encoded = QtConcurrent::blockingMapped<QList<QByteArray>>(plans, &png_encode);
+            for ( int i = 0; i < int(plans.size()); i++ )
+                write_apng_frame(file, plans[i], encoded[i], sequence, start, fps);
+        }
+        else
+        {
+            QList<QByteArray> encoded = QtConcurrent::blockingMapped<QList<QByteArray>>(plans, [](const FramePlan& plan){
+                return lzw_encode(plan.data, qMax(2, palette_bits(plan.palette)));
+            });
+            for ( int i = 0; i < int(plans.size()); i++ )
+                write_gif_frame(file, plans[i], encoded[i], per_frame, start, fps);
+        }
+    };
+
+    struct QuantizedFrame
+    {
+        std::vector<uchar> indices;
+        Palette palette;
+    };
+
+    int batch_size = qMax(1, QThreadPool::globalInstance()->maxThreadCount());
+    std::vector<FramePlan> done;
+    for ( int batch_start = 0; batch_start < frames; batch_start += batch_size )
+    {
+        int batch_end = qMin(frames, batch_start + batch_size);
+        std::vector<int> batch(times.begin() + batch_start, times.begin() + batch_end);
+        QList<QuantizedFrame> quantized = QtConcurrent::blockingMapped<QList<QuantizedFrame>>(batch,
+            [&program, &global_palette, size, per_frame, colors, algorithm](int time){
+                QImage image = render_frame(program, time, size);
+                QuantizedFrame frame;
+                frame.palette = per_frame ? build_palette(image, colors, algorithm) : global_palette;
+                frame.indices = map_to_palette(image, frame.palette);
+                return frame;
+            }
+        );
+
+        for ( int i = batch_start; i < batch_end; i++ )
+        {
+            FrameTime end = i + 1 < frames ? times[i + 1] : last_frame;
+            auto& frame = quantized[i - batch_start];
+            planner.add(std::move(frame.indices), frame.palette, times[i], end, done);
+        }
+
+        write_plans(done);
+        done.clear();
+        emit progress(batch_end);
+    }
+
+    planner.finish(done);
+    write_plans(done);
+
+    if ( apng )
+    {
+        write_png_chunk(file, "IEND", {});
+        if ( planner.count() != frames )
+        {
+            qint64 end_pos = file.pos();
+            file.seek(animation_pos);
+            write_png_chunk(file, "acTL", apng_animation_control(planner.count(), loop));
+            file.seek(end_pos);
+        }
+    }
+    else
+    {
+        file.write("\x3b", 1);
+    }
+
+    emit progress(frames);
+    return true;
+}
@@ -0,0 +1,56 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include "io/base.hpp"
+#include "io/io_registry.hpp"
+
+namespace glaxnimate::io::raster {
+
+/**
+ * \brief Exports animated GIF and APNG with an optimized palette
+ *
+ * Only the area that changed since the previous frame is encoded,
+ * pixels within that area that didn't change are left transparent.
+ */
+class AnimatedRasterFormat : public ImportExport
+{
+    Q_OBJECT
+
+public:
+    enum PaletteMode
+    {
+        GlobalPalette,
+        FramePalette,
+    };
+
+    enum QuantizeAlgorithm
+    {
+        Octree,
+        KMeans,
+    };
+
+    QString slug() const override { return "animated_raster"; }
+    QString name() const override { return tr("Animated GIF / PNG"); }
+    QStringList extensions() const override { return {"gif", "apng"}; }
+
+    std::unique_ptr<app::settings::SettingsGroup> save_settings(model::Composition* comp) const override;
+
+    bool can_save() const override { return true; }
+    bool can_open() const override { return false; }
+    // Takes precedence over the ffmpeg muxers for the same extensions
+    int priority() const override { return 1; }
+
+protected:
+    bool on_save(QIODevice & file, const QString & filename, model::Composition* comp, const QVariantMap & setting_values) override;
+
+private:
+    static Autoreg<AnimatedRasterFormat> autoreg;
+};
+
+
+} // namespace glaxnimate::io::raster
@@ -61,13 +61,13 @@ bool glaxnimate::io::raster::RasterFormat::on_open(QIODevice& dev, const QString
         bmp->data.set(dev.readAll());
     auto img = std::make_unique<model::Image>(document);
     img->image.set(bmp);
-    QPointF p(bmp->pixmap().width() / 2.0, bmp->pixmap().height() / 2.0);
+    QPointF p(bmp->width.get() / 2.0, bmp->height.get() / 2.0);
     if ( !filename.isEmpty() )
         img->name.set(QFileInfo(filename).baseName());
     img->transform->anchor_point.set(p);
     img->transform->position.set(p);
     main->shapes.insert(std::move(img));
-    main->width.set(bmp->pixmap().width());
-    main->height.set(bmp->pixmap().height());
-    return !bmp->pixmap().isNull();
+    main->width.set(bmp->width.get());
+    main->height.set(bmp->height.get());
+    return !bmp->size().isEmpty();
 }
@@ -91,7 +91,7 @@ public:
         bmp->data.set(data);
         auto img = std::make_unique<model::Image>(out.document.get());
         img->image.set(bmp);
-        QPointF p(bmp->pixmap().width() / 2.0, bmp->pixmap().height() / 2.0);
+        QPointF p(bmp->width.get() / 2.0, bmp->height.get() / 2.0);
         img->transform->anchor_point.set(p);
         img->transform->position.set(p);
         out.main->shapes.insert(std::move(img));
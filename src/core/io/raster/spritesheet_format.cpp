@@ -6,10 +6,20 @@
 
 #include "spritesheet_format.hpp"
 #include "model/assets/composition.hpp"
+#include "model/render_program.hpp"
+#include "app_info.hpp"
 
 #include <QImage>
 #include <QPainter>
 #include <QImageWriter>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QCryptographicHash>
+#include <QtConcurrent>
 
 glaxnimate::io::Autoreg<glaxnimate::io::raster::SpritesheetFormat> glaxnimate::io::raster::SpritesheetFormat::autoreg;
 
@@ -33,50 +43,281 @@ std::unique_ptr<app::settings::SettingsGroup> glaxnimate::io::raster::Spriteshee
         app::settings::Setting("frame_height", tr("Frame Height"), tr("Height of each frame"), comp->height.get(), 1, 999'999),
         app::settings::Setting("columns", tr("Columns"), tr("Number of columns in the sheet"), std::ceil(math::sqrt(frames)), 1, 64),
         app::settings::Setting("frame_step", tr("Time Step"), tr("By how much each rendered frame should increase time (in frames)"), 1, 1, 16),
+        app::settings::Setting("packed", tr("Packed Atlas"),
+            tr("Trim transparent borders, merge identical frames and write the frame layout in a JSON file next to the image"), false),
     });
 }
 
-bool glaxnimate::io::raster::SpritesheetFormat::on_save(QIODevice& file, const QString& filename, model::Composition* comp, const QVariantMap& setting_values)
+namespace {
+
+struct Sprite
+{
+    QSize size;
+    /// Position in the atlas
+    QPoint pos;
+    /// First frame showing this sprite
+    int frame;
+};
+
+/**
+ * \brief Bounding box of the non-transparent pixels in \p image
+ */
+QRect opaque_rect(const QImage& image)
+{
+    int left = image.width();
+    int right = -1;
+    int top = image.height();
+    int bottom = -1;
+
+    for ( int y = 0; y < image.height(); y++ )
+    {
+        auto line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        for ( int x = 0; x < image.width(); x++ )
+        {
+            if ( qAlpha(line[x]) )
+            {
+                left = qMin(left, x);
+                right = qMax(right, x);
+                top = qMin(top, y);
+                bottom = qMax(bottom, y);
+            }
+        }
+    }
+
+    if ( right == -1 )
+        return {};
+
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+QByteArray pixel_hash(const QImage& image, const QRect& rect)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    int width = rect.width();
+    int height = rect.height();
+    hash.addData(reinterpret_cast<const char*>(&width), sizeof(width));
+    hash.addData(reinterpret_cast<const char*>(&height), sizeof(height));
+    for ( int y = rect.top(); y <= rect.bottom(); y++ )
+    {
+        auto line = reinterpret_cast<const char*>(image.constScanLine(y)) + rect.left() * 4;
+#if QT_VERSION_MAJOR < 6
+        hash.addData(line, width * 4);
+#else
+        hash.addData(QByteArrayView(line, width * 4));
+#endif
+    }
+    return hash.result();
+}
+
+/**
+ * \brief Shelf packing of the sprites, tallest first
+ * \returns Size of the atlas
+ */
+QSize pack_sprites(std::vector<Sprite>& sprites)
+{
+    std::vector<Sprite*> sorted;
+    qint64 area = 0;
+    int max_width = 0;
+    for ( auto& sprite : sprites )
+    {
+        if ( sprite.size.isEmpty() )
+            continue;
+        sorted.push_back(&sprite);
+        area += qint64(sprite.size.width()) * sprite.size.height();
+        max_width = qMax(max_width, sprite.size.width());
+    }
+
+    if ( sorted.empty() )
+        return {1, 1};
+
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Sprite* a, const Sprite* b){
+        return a->size.height() > b->size.height();
+    });
+
+    // Aim for a roughly square atlas
+    int atlas_width = qMax(max_width, int(std::ceil(std::sqrt(double(area)))));
+    int x = 0;
+    int y = 0;
+    int shelf_height = 0;
+    int used_width = 0;
+    for ( auto sprite : sorted )
+    {
+        if ( x + sprite->size.width() > atlas_width )
+        {
+            y += shelf_height;
+            x = 0;
+            shelf_height = 0;
+        }
+
+        sprite->pos = QPoint(x, y);
+        x += sprite->size.width();
+        used_width = qMax(used_width, x);
+        shelf_height = qMax(shelf_height, sprite->size.height());
+    }
+
+    return {used_width, y + shelf_height};
+}
+
+QJsonObject json_rect(const QRect& rect)
+{
+    return {
+        {"x", rect.x()},
+        {"y", rect.y()},
+        {"w", rect.width()},
+        {"h", rect.height()},
+    };
+}
+
+QJsonObject json_size(const QSize& size)
 {
-    Q_UNUSED(filename);
+    return {
+        {"w", size.width()},
+        {"h", size.height()},
+    };
+}
+
+} // namespace
 
+bool glaxnimate::io::raster::SpritesheetFormat::on_save(QIODevice& file, const QString& filename, model::Composition* comp, const QVariantMap& setting_values)
+{
     int frame_w = setting_values["frame_width"].toInt();
     int frame_h = setting_values["frame_height"].toInt();
     int columns = setting_values["columns"].toInt();
     int frame_step = setting_values["frame_step"].toInt();
+    bool packed = setting_values["packed"].toBool();
 
     if ( frame_w <= 0 || frame_h <= 0 || columns <= 0 || frame_step <= 0 )
         return false;
 
     int first_frame = comp->animation->first_frame.get();
     int last_frame = comp->animation->last_frame.get();
-    int frames = (last_frame - first_frame) / frame_step;
-    int rows = frames / columns;
 
-    qreal scale_x = qreal(frame_w) / comp->width.get();
-    qreal scale_y = qreal(frame_h) / comp->height.get();
+    std::vector<int> times;
+    for ( int t = first_frame; t < last_frame; t += frame_step )
+        times.push_back(t);
+
+    if ( times.empty() )
+        times.push_back(first_frame);
+
+    int frames = times.size();
+    emit progress_max_changed(frames);
+
+    // Frames are independent so they can be rendered concurrently, only the atlas layout is serial
+    QSize frame_size(frame_w, frame_h);
+    model::RenderProgram program(comp);
+    QList<QImage> images = QtConcurrent::blockingMapped<QList<QImage>>(times, [&program, frame_size](int time){
+        return program.render_image(time, frame_size).convertToFormat(QImage::Format_ARGB32);
+    });
+
+    QImage bmp;
+    // For each frame, index in sprites and visible area
+    std::vector<int> frame_sprite(frames);
+    std::vector<QRect> frame_trim(frames);
+    std::vector<Sprite> sprites;
 
-    QImage bmp(frame_w * columns, frame_h * rows, QImage::Format_ARGB32);
-    QPainter painter(&bmp);
-    for ( int i = first_frame; i <= last_frame; i += frame_step )
+    if ( !packed )
     {
-        painter.save();
-        painter.scale(scale_x, scale_y);
-        painter.translate((i % columns) * frame_w, (i / columns) * frame_h);
-        painter.setClipRect(0, 0, frame_w, frame_h);
-        comp->paint(&painter, i, model::VisualNode::Render);
-        painter.restore();
+        int rows = (frames + columns - 1) / columns;
+        bmp = QImage(frame_w * columns, frame_h * rows, QImage::Format_ARGB32);
+        bmp.fill(Qt::transparent);
+
+        QPainter painter(&bmp);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        for ( int i = 0; i < frames; i++ )
+        {
+            painter.drawImage((i % columns) * frame_w, (i / columns) * frame_h, images[i]);
+            emit progress(i);
+        }
     }
+    else
+    {
+        std::unordered_map<QByteArray, int> unique;
+        for ( int i = 0; i < frames; i++ )
+        {
+            frame_trim[i] = opaque_rect(images[i]);
+            QByteArray hash = pixel_hash(images[i], frame_trim[i]);
+            auto it = unique.find(hash);
+            if ( it != unique.end() )
+            {
+                frame_sprite[i] = it->second;
+            }
+            else
+            {
+                frame_sprite[i] = sprites.size();
+                unique.emplace(hash, sprites.size());
+                sprites.push_back({frame_trim[i].size(), {}, i});
+            }
+        }
 
-    painter.end();
+        bmp = QImage(pack_sprites(sprites), QImage::Format_ARGB32);
+        bmp.fill(Qt::transparent);
+
+        QPainter painter(&bmp);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        for ( int i = 0; i < frames; i++ )
+        {
+            const Sprite& sprite = sprites[frame_sprite[i]];
+            if ( sprite.frame == i && !sprite.size.isEmpty() )
+                painter.drawImage(sprite.pos, images[i], frame_trim[i]);
+            emit progress(i);
+        }
+    }
 
+    images.clear();
 
     QImageWriter writer(&file, {});
     writer.setOptimizedWrite(true);
-    if ( writer.write(bmp) )
-        return true;
+    if ( !writer.write(bmp) )
+    {
+        error(writer.errorString());
+        return false;
+    }
 
-    error(writer.errorString());
-    return false;
-}
+    if ( packed )
+    {
+        if ( filename.isEmpty() )
+        {
+            warning(tr("Could not write the frame map without a file name"));
+            return true;
+        }
+
+        QFileInfo image_info(filename);
+        QJsonArray json_frames;
+        for ( int i = 0; i < frames; i++ )
+        {
+            const Sprite& sprite = sprites[frame_sprite[i]];
+            json_frames.push_back(QJsonObject{
+                {"filename", QString::number(times[i])},
+                {"frame", json_rect(QRect(sprite.pos, sprite.size))},
+                {"rotated", false},
+                {"trimmed", frame_trim[i] != QRect(QPoint(0, 0), frame_size)},
+                {"spriteSourceSize", json_rect(frame_trim[i])},
+                {"sourceSize", json_size(frame_size)},
+                {"duration", frame_step / comp->fps.get() * 1000},
+            });
+        }
+
+        QJsonObject json{
+            {"frames", json_frames},
+            {"meta", QJsonObject{
+                {"app", AppInfo::instance().name()},
+                {"version", AppInfo::instance().version()},
+                {"image", image_info.fileName()},
+                {"format", "RGBA8888"},
+                {"size", json_size(bmp.size())},
+                {"scale", "1"},
+                {"frameRate", comp->fps.get() / frame_step},
+            }},
+        };
 
+        QFile map_file(image_info.dir().filePath(image_info.completeBaseName() + ".json"));
+        if ( !map_file.open(QIODevice::WriteOnly) )
+        {
+            error(tr("Could not write the frame map to %1").arg(map_file.fileName()));
+            return false;
+        }
+        map_file.write(QJsonDocument(json).toJson(QJsonDocument::Indented));
+    }
+
+    return true;
+}
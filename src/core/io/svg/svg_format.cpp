@@ -79,17 +79,20 @@ std::unique_ptr<app::settings::SettingsGroup> glaxnimate::io::svg::SvgFormat::sa
 bool glaxnimate::io::svg::SvgFormat::on_save(QIODevice& file, const QString& filename, model::Composition* comp, const QVariantMap& options)
 {
     auto on_error = [this](const QString& s){warning(s);};
-    SvgRenderer rend(SMIL, CssFontType(options["font_type"].toInt()));
-    rend.write_main(comp);
+    CssFontType font_type(options["font_type"].toInt());
     if ( filename.endsWith(".svgz") || options.value("compressed", false).toBool() )
     {
         utils::gzip::GzipStream compressed(&file, on_error);
         compressed.open(QIODevice::WriteOnly);
-        rend.write(&compressed, false);
+        SvgRenderer rend(&compressed, SMIL, font_type, false);
+        rend.write_main(comp);
+        rend.close();
     }
     else
     {
-        rend.write(&file, true);
+        SvgRenderer rend(&file, SMIL, font_type, true);
+        rend.write_main(comp);
+        rend.close();
     }
 
     return true;
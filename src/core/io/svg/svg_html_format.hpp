@@ -25,9 +25,9 @@ private:
     {
         file.write(lottie::LottieHtmlFormat::html_head(this, comp, {}));
         file.write("<body><div id='animation'>");
-        SvgRenderer rend(SMIL, CssFontType::FontFace);
+        SvgRenderer rend(&file, SMIL, CssFontType::FontFace, true);
         rend.write_main(comp);
-        rend.write(&file, true);
+        rend.close();
         file.write("</div></body></html>");
         return true;
 
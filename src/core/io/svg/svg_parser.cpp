@@ -458,7 +458,12 @@ private:
         auto layer = add_layer(args.shape_parent);
         apply_common_style(layer, args.element, style);
         set_name(layer, args.element);
-        layer->mask->mask.set(model::MaskSettings::Alpha);
+        // <mask> defaults to luminance, alpha masks are loaded as clip paths
+        // mask-type isn't inherited so it's read without the parent style
+        if ( mask_element.tagName() == "mask" && parse_style(mask_element, {}).get("mask-type", "luminance") == "luminance" )
+            layer->mask->mask.set(model::MaskSettings::Luma);
+        else
+            layer->mask->mask.set(model::MaskSettings::Alpha);
 
         QDomElement element = args.element;
 
@@ -497,6 +502,8 @@ private:
         auto it = shape_parsers.find(args.element.tagName());
         if ( it != shape_parsers.end() )
         {
+            if ( io && io->cancelled() )
+                return;
             mark_progress();
             (this->*it->second)(args);
         }
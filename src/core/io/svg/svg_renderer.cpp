@@ -6,6 +6,11 @@
 
 #include "svg_renderer.hpp"
 
+#include <algorithm>
+#include <iterator>
+
+#include <QXmlStreamWriter>
+
 #include "model/document.hpp"
 #include "model/shapes/group.hpp"
 #include "model/shapes/layer.hpp"
@@ -33,10 +38,299 @@ using namespace glaxnimate;
 class io::svg::SvgRenderer::Private
 {
 public:
-    void collect_defs(model::Composition* comp)
+    /**
+     * \brief Element attributes, setting an existing attribute replaces its value
+     */
+    class Attributes
+    {
+    public:
+        void set(const QString& name, const QString& value)
+        {
+            for ( auto& attr : values )
+            {
+                if ( attr.first == name )
+                {
+                    attr.second = value;
+                    return;
+                }
+            }
+            values.emplace_back(name, value);
+        }
+
+        void merge(const Attributes& other)
+        {
+            for ( const auto& attr : other.values )
+                set(attr.first, attr.second);
+        }
+
+        auto begin() const { return values.begin(); }
+        auto end() const { return values.end(); }
+
+    private:
+        std::vector<std::pair<QString, QString>> values;
+    };
+
+    /**
+     * \brief Element built in full before being written
+     *
+     * Only used for elements whose content is small (leaves, animations and wrappers),
+     * everything else is passed to the writer as it's traversed.
+     */
+    struct Element
+    {
+        QString tag = {};
+        Attributes attributes = {};
+        /// Written before the children
+        QString text = {};
+        std::vector<Element> children = {};
+
+        void set_attribute(const QString& name, const QString& value)
+        {
+            attributes.set(name, value);
+        }
+
+        /**
+         * \note The returned reference is invalidated by the next call
+         */
+        Element& add_child(const QString& tag)
+        {
+            children.push_back({tag});
+            return children.back();
+        }
+    };
+
+    /**
+     * \brief Receives elements in document order
+     */
+    class Writer
+    {
+    public:
+        virtual ~Writer() = default;
+
+        virtual void start_element(const QString& tag, const Attributes& attributes) = 0;
+        virtual void text(const QString& text) = 0;
+        virtual void end_element() = 0;
+
+        /**
+         * \brief Adds attributes to the root <svg> element
+         */
+        virtual void root_attributes(const Attributes& attributes) = 0;
+
+        /**
+         * \brief Starts an element to add more definitions into, closed with end_element()
+         */
+        virtual void continue_defs() = 0;
+
+        /**
+         * \brief Closes all the open elements
+         */
+        virtual void finish() = 0;
+    };
+
+    /**
+     * \brief Builds a QDomDocument
+     */
+    class DomWriter : public Writer
+    {
+    public:
+        explicit DomWriter(QDomDocument& dom)
+            : dom(dom)
+        {
+            stack.push_back(dom.createElement("svg"));
+            dom.appendChild(stack.back());
+        }
+
+        void start_element(const QString& tag, const Attributes& attributes) override
+        {
+            QDomElement element = dom.createElement(tag);
+            for ( const auto& attr : attributes )
+                element.setAttribute(attr.first, attr.second);
+            stack.back().appendChild(element);
+            if ( stack.size() == 1 && tag == "defs" )
+                defs = element;
+            stack.push_back(element);
+        }
+
+        void text(const QString& text) override
+        {
+            stack.back().appendChild(dom.createTextNode(text));
+        }
+
+        void end_element() override
+        {
+            stack.pop_back();
+        }
+
+        void root_attributes(const Attributes& attributes) override
+        {
+            for ( const auto& attr : attributes )
+                stack.front().setAttribute(attr.first, attr.second);
+        }
+
+        void continue_defs() override
+        {
+            if ( defs.isNull() )
+                start_element("defs", {});
+            else
+                stack.push_back(defs);
+        }
+
+        void finish() override
+        {
+            stack.resize(1);
+        }
+
+    private:
+        QDomDocument& dom;
+        std::vector<QDomElement> stack;
+        QDomElement defs;
+    };
+
+    /**
+     * \brief Writes XML directly to a device
+     */
+    class StreamWriter : public Writer
+    {
+    public:
+        StreamWriter(QIODevice* device, bool indent)
+            : writer(device)
+        {
+            writer.setAutoFormatting(indent);
+            writer.setAutoFormattingIndent(4);
+        }
+
+        void start_element(const QString& tag, const Attributes& attributes) override
+        {
+            start_root();
+            writer.writeStartElement(tag);
+            for ( const auto& attr : attributes )
+                writer.writeAttribute(attr.first, attr.second);
+        }
+
+        void text(const QString& text) override
+        {
+            writer.writeCharacters(text);
+        }
+
+        void end_element() override
+        {
+            writer.writeEndElement();
+        }
+
+        void root_attributes(const Attributes& attributes) override
+        {
+            // The root start tag is written with the first child,
+            // attributes added after that are lost
+            if ( !root_started )
+                root.merge(attributes);
+        }
+
+        void continue_defs() override
+        {
+            // SVG allows any number of <defs>
+            start_element("defs", {});
+        }
+
+        void finish() override
+        {
+            if ( finished )
+                return;
+            start_root();
+            writer.writeEndDocument();
+            finished = true;
+        }
+
+    private:
+        void start_root()
+        {
+            if ( root_started )
+                return;
+            root_started = true;
+            writer.writeStartElement("svg");
+            for ( const auto& attr : root )
+                writer.writeAttribute(attr.first, attr.second);
+        }
+
+        QXmlStreamWriter writer;
+        Attributes root;
+        bool root_started = false;
+        bool finished = false;
+    };
+
+    /**
+     * \brief Element in <defs> found while traversing the shapes, along with the timing to write it with
+     */
+    struct DefsItem
+    {
+        /// Layer for masks, PreCompLayer for clip paths
+        model::ShapeElement* shape;
+        std::vector<model::StretchableTime*> timing;
+        qreal time_stretch;
+        model::FrameTime time_start;
+    };
+
+    void start(const Element& e)
+    {
+        writer->start_element(e.tag, e.attributes);
+        if ( !e.text.isNull() )
+            writer->text(e.text);
+        for ( const auto& child : e.children )
+            write(child);
+    }
+
+    void end()
+    {
+        writer->end_element();
+    }
+
+    /**
+     * \brief Closes an element started with start_tag(), its children are written before the end tag
+     */
+    void end(const Element& e)
+    {
+        for ( const auto& child : e.children )
+            write(child);
+        end();
+    }
+
+    void start_tag(const Element& e)
+    {
+        writer->start_element(e.tag, e.attributes);
+    }
+
+    void write(const Element& e)
+    {
+        start(e);
+        end();
+    }
+
+    /**
+     * \brief Starts elements wrapping the next one, the outermost is the first
+     */
+    void start_wrappers(const std::vector<Element>& wrappers)
+    {
+        for ( const auto& wrapper : wrappers )
+            start_tag(wrapper);
+    }
+
+    void end_wrappers(const std::vector<Element>& wrappers)
+    {
+        for ( auto it = wrappers.rbegin(); it != wrappers.rend(); ++it )
+            end(*it);
+    }
+
+    void collect_defs(model::Composition* comp, const std::vector<DefsItem>& items)
     {
         if ( !at_start )
+        {
+            if ( !items.empty() )
+            {
+                writer->continue_defs();
+                write_defs_items(items);
+                end();
+            }
             return;
+        }
 
         fps = comp->fps.get();
         ip = comp->animation->first_frame.get();
@@ -45,51 +339,168 @@ public:
             animated = NotAnimated;
 
         at_start = false;
-        defs = element(svg, "defs");
+        writer->start_element("defs", {});
         for ( const auto& color : comp->document()->assets()->colors->values )
-            write_named_color(defs, color.get());
+            write_named_color(color.get());
         for ( const auto& color : comp->document()->assets()->gradient_colors->values )
-            write_gradient_colors(defs, color.get());
+            write_gradient_colors(color.get());
         for ( const auto& gradient : comp->document()->assets()->gradients->values )
-            write_gradient(defs, gradient.get());
-
-        auto view = element(svg, "sodipodi:namedview");
-        view.setAttribute("inkscape:pagecheckerboard", "true");
-        view.setAttribute("borderlayer", "true");
-        view.setAttribute("bordercolor", "#666666");
-        view.setAttribute("pagecolor", "#ffffff");
-        view.setAttribute("inkscape:document-units", "px");
+            write_gradient(gradient.get());
+        write_defs_items(items);
+        end();
+
+        Element view{"sodipodi:namedview"};
+        view.set_attribute("inkscape:pagecheckerboard", "true");
+        view.set_attribute("borderlayer", "true");
+        view.set_attribute("bordercolor", "#666666");
+        view.set_attribute("pagecolor", "#ffffff");
+        view.set_attribute("inkscape:document-units", "px");
+        write(view);
 
         add_fonts(comp->document());
 
         write_meta(comp);
     }
 
-    void write_meta(model::Composition* comp)
+    /**
+     * \brief Finds elements that go in <defs> from \p shape, following the same traversal as write_shape()
+     */
+    void collect_shape_defs(model::ShapeElement* shape, std::vector<DefsItem>& items)
     {
-        auto rdf = element(element(svg, "metadata"), "rdf:RDF");
-        auto work = element(rdf, "cc:Work");
-        element(work, "dc:format").appendChild(dom.createTextNode("image/svg+xml"));
-        QString dc_type = animated ? "MovingImage" : "StillImage";
-        element(work, "dc:type").setAttribute("rdf:resource", "http://purl.org/dc/dcmitype/" + dc_type);
-        element(work, "dc:title").appendChild(dom.createTextNode(comp->name.get()));
-        auto document = comp->document();
+        if ( auto grp = qobject_cast<model::Group*>(shape) )
+        {
+            bool has_mask = false;
+            if ( auto layer = grp->cast<model::Layer>() )
+            {
+                if ( !layer->render.get() )
+                    return;
+
+                if ( layer->mask->has_mask() )
+                {
+                    has_mask = true;
+                    items.push_back({layer, timing, time_stretch, time_start});
+                    if ( layer->shapes.size() > 1 )
+                        collect_shape_defs(layer->shapes[0], items);
+                }
+            }
+            collect_shapes_defs(grp->shapes, has_mask, items);
+        }
+        else if ( auto layer = qobject_cast<model::PreCompLayer*>(shape) )
+        {
+            if ( layer->composition.get() )
+            {
+                timing.push_back(layer->timing.get());
+                items.push_back({layer, timing, time_stretch, time_start});
+                time_stretch = layer->timing->stretch.get();
+                time_start = layer->timing->start_time.get();
+                collect_shapes_defs(layer->composition->shapes, false, items);
+                time_stretch = 1;
+                time_start = 0;
+                timing.pop_back();
+            }
+        }
+        else if ( auto repeater = qobject_cast<model::Repeater*>(shape) )
+        {
+            if ( repeater->max_copies() >= 1 )
+            {
+                for ( const auto& sib : repeater->affected() )
+                    collect_shape_defs(sib, items);
+            }
+        }
+    }
 
-        if ( document->info().empty() )
+    void collect_shapes_defs(const model::ShapeListProperty& shapes, bool has_mask, std::vector<DefsItem>& items)
+    {
+        if ( shapes.empty() )
             return;
 
-        if ( !document->info().author.isEmpty() )
-            element(element(element(work, "dc:creator"), "cc:Agent"), "dc:title").appendChild(dom.createTextNode(document->info().author));
+        auto it = shapes.begin();
+        if ( has_mask )
+            ++it;
+
+        for ( ; it != shapes.end(); ++it )
+            collect_shape_defs(it->get(), items);
+    }
+
+    void write_defs_items(const std::vector<DefsItem>& items)
+    {
+        auto old_timing = std::move(timing);
+        qreal old_stretch = time_stretch;
+        model::FrameTime old_start = time_start;
+
+        for ( const auto& item : items )
+        {
+            timing = item.timing;
+            time_stretch = item.time_stretch;
+            time_start = item.time_start;
+
+            if ( auto layer = qobject_cast<model::PreCompLayer*>(item.shape) )
+                write_precomp_clip(layer);
+            else
+                write_mask(static_cast<model::Layer*>(item.shape));
+        }
+
+        timing = std::move(old_timing);
+        time_stretch = old_stretch;
+        time_start = old_start;
+    }
+
+    void write_precomp_clip(model::PreCompLayer* layer)
+    {
+        Element clip{"clipPath"};
+        set_attribute(clip, "id", "clip_" + id(layer));
+        set_attribute(clip, "clipPathUnits", "userSpaceOnUse");
+        Element& clip_rect = clip.add_child("rect");
+        set_attribute(clip_rect, "x", "0");
+        set_attribute(clip_rect, "y", "0");
+        set_attribute(clip_rect, "width", layer->size.get().width());
+        set_attribute(clip_rect, "height", layer->size.get().height());
+        write(clip);
+    }
+
+    void write_mask(model::Layer* layer)
+    {
+        Element clip{"mask"};
+        clip.set_attribute("id", "clip_" + id(layer));
+        clip.set_attribute("mask-type", layer->mask->mask.get() == model::MaskSettings::Luma ? "luminance" : "alpha");
+        bool has_content = layer->shapes.size() > 1;
+        if ( has_content )
+            collect_parent_attributes(clip, layer->shapes[0], false);
+
+        start(clip);
+        if ( has_content )
+            write_shape(layer->shapes[0], false);
+        end();
+    }
 
-        if ( !document->info().description.isEmpty() )
-            element(work, "dc:description").appendChild(dom.createTextNode(document->info().description));
+    void write_meta(model::Composition* comp)
+    {
+        Element metadata{"metadata"};
+        Element& rdf = metadata.add_child("rdf:RDF");
+        Element& work = rdf.add_child("cc:Work");
+        work.add_child("dc:format").text = "image/svg+xml";
+        QString dc_type = animated ? "MovingImage" : "StillImage";
+        work.add_child("dc:type").set_attribute("rdf:resource", "http://purl.org/dc/dcmitype/" + dc_type);
+        work.add_child("dc:title").text = comp->name.get();
+        auto document = comp->document();
 
-        if ( !document->info().keywords.empty() )
+        if ( !document->info().empty() )
         {
-            auto bag = element(element(work, "dc:subject"), "rdf:Bag");
-            for ( const auto& kw: document->info().keywords )
-                element(bag, "rdf:li").appendChild(dom.createTextNode(kw));
+            if ( !document->info().author.isEmpty() )
+                work.add_child("dc:creator").add_child("cc:Agent").add_child("dc:title").text = document->info().author;
+
+            if ( !document->info().description.isEmpty() )
+                work.add_child("dc:description").text = document->info().description;
+
+            if ( !document->info().keywords.empty() )
+            {
+                Element& bag = work.add_child("dc:subject").add_child("rdf:Bag");
+                for ( const auto& kw: document->info().keywords )
+                    bag.add_child("rdf:li").text = kw;
+            }
         }
+
+        write(metadata);
     }
 
     void add_fonts(model::Document* document)
@@ -118,11 +529,12 @@ public:
 
             if ( type == CssFontType::Link )
             {
-                auto link = element(svg, "link");
-                link.setAttribute("xmlns", "http://www.w3.org/1999/xhtml");
-                link.setAttribute("rel", "stylesheet");
-                link.setAttribute("href", font->css_url.get());
-                link.setAttribute("type", "text/css");
+                Element link{"link"};
+                link.set_attribute("xmlns", "http://www.w3.org/1999/xhtml");
+                link.set_attribute("rel", "stylesheet");
+                link.set_attribute("href", font->css_url.get());
+                link.set_attribute("type", "text/css");
+                write(link);
             }
             else if ( type == CssFontType::FontFace )
             {
@@ -148,31 +560,28 @@ public:
         }
 
         if ( !css.isEmpty() )
-            element(svg, "style").appendChild(dom.createTextNode(css));
-    }
-
-    QDomElement element(QDomNode parent, const char* tag)
-    {
-        QDomElement e = dom.createElement(tag);
-        parent.appendChild(e);
-        return e;
+        {
+            Element style{"style"};
+            style.text = css;
+            write(style);
+        }
     }
 
-    void write_composition(QDomElement& parent, model::Composition* comp)
+    void write_composition(model::Composition* comp)
     {
         for ( const auto& lay : comp->shapes )
-            write_shape(parent, lay.get(), false);
+            write_shape(lay.get(), false);
     }
 
-    void write_visibility_attributes(QDomElement& parent, model::VisualNode* node)
+    void write_visibility_attributes(Element& element, model::VisualNode* node)
     {
         if ( !node->visible.get() )
-            parent.setAttribute("display", "none");
+            element.set_attribute("display", "none");
         if ( node->locked.get() )
-            parent.setAttribute("sodipodi:insensitive", "true");
+            element.set_attribute("sodipodi:insensitive", "true");
     }
 
-    void write_shapes(QDomElement& parent, const model::ShapeListProperty& shapes, bool has_mask = false)
+    void write_shapes(const model::ShapeListProperty& shapes, bool has_mask = false)
     {
         if ( shapes.empty() )
             return;
@@ -182,9 +591,50 @@ public:
             ++it;
 
         for ( ; it != shapes.end(); ++it )
-            write_shape(parent, it->get(), false);
+            write_shape(it->get(), false);
     }
 
+    /**
+     * \brief Adds to \p parent the attributes that write_shape() sets on the element containing \p shape
+     *
+     * These need to be known before the start tag of \p parent is written
+     */
+    void collect_parent_attributes(Element& parent, model::ShapeElement* shape, bool force_draw)
+    {
+        if ( qobject_cast<model::Group*>(shape) || qobject_cast<model::Image*>(shape) || qobject_cast<model::Repeater*>(shape) )
+        {
+            return;
+        }
+        else if ( qobject_cast<model::Stroke*>(shape) || qobject_cast<model::Fill*>(shape) )
+        {
+            auto styler = static_cast<model::Styler*>(shape);
+            if ( styler->visible.get() && styler->affected().size() == 1 )
+                parent.attributes.merge(styler_target(styler).attributes);
+        }
+        else if ( auto layer = qobject_cast<model::PreCompLayer*>(shape) )
+        {
+            if ( layer->composition.get() )
+                write_visibility_attributes(parent, layer);
+        }
+        else if ( force_draw )
+        {
+            write_visibility_attributes(parent, shape);
+            set_attribute(parent, "id", id(shape));
+        }
+    }
+
+    void collect_shapes_attributes(Element& parent, const model::ShapeListProperty& shapes, bool has_mask)
+    {
+        if ( shapes.empty() )
+            return;
+
+        auto it = shapes.begin();
+        if ( has_mask )
+            ++it;
+
+        for ( ; it != shapes.end(); ++it )
+            collect_parent_attributes(parent, it->get(), false);
+    }
 
     QString styler_to_css(model::Styler* styler)
     {
@@ -195,27 +645,55 @@ public:
         return styler->color.get().name();
     }
 
-    QDomElement write_styler_shapes(QDomElement& parent, model::Styler* styler, const Style::Map& style)
+    /**
+     * \brief Attributes and animations a styler sets on the element containing its shapes
+     */
+    Element styler_target(model::Styler* styler)
     {
+        Element target;
+        write_visibility_attributes(target, styler);
+        target.set_attribute("id", id(styler));
+
+        if ( animated )
+        {
+            if ( auto stroke = qobject_cast<model::Stroke*>(styler) )
+            {
+                write_styler_attrs(target, stroke, "stroke");
+                write_property(target, &stroke->width, "stroke-width");
+            }
+            else
+            {
+                write_styler_attrs(target, styler, "fill");
+            }
+        }
+
+        return target;
+    }
+
+    void write_styler_shapes(model::Styler* styler, const Style::Map& style)
+    {
+        Element target = styler_target(styler);
+
         if ( styler->affected().size() == 1 )
         {
-            write_shape_shape(parent, styler->affected()[0], style);
-            write_visibility_attributes(parent, styler);
-            parent.setAttribute("id", id(styler));
-            return parent;
+            // The attributes have been added to the parent by collect_parent_attributes()
+            write_shape_shape(styler->affected()[0], style);
+            for ( const auto& animation : target.children )
+                write(animation);
+            return;
         }
 
-        auto g = start_group(parent, styler);
+        Element g = group_element(styler);
         write_style(g, style);
-        write_visibility_attributes(g, styler);
-        g.setAttribute("id", id(styler));
+        g.attributes.merge(target.attributes);
+        start_tag(g);
 
         for ( model::ShapeElement* subshape : styler->affected() )
         {
-            write_shape_shape(g, subshape, style);
+            write_shape_shape(subshape, style);
         }
 
-        return g;
+        end(target);
     }
 
     QString unlerp_time(model::FrameTime time) const
@@ -292,7 +770,7 @@ public:
         }
 
         void add_dom(
-            QDomElement& element, const char* tag = "animate", const QString& type = {},
+            Element& element, const char* tag = "animate", const QString& type = {},
             const QString& path = {}, bool auto_orient = false
         )
         {
@@ -314,22 +792,22 @@ public:
             QString key_splines_str = key_splines.join("; ");
             for ( const auto& data : attributes )
             {
-                QDomElement animation = parent->element(element, tag);
-                animation.setAttribute("begin", parent->clock(time_start + time_stretch * parent->ip));
-                animation.setAttribute("dur", parent->clock(time_start + time_stretch * parent->op-parent->ip));
-                animation.setAttribute("attributeName", data.attribute);
-                animation.setAttribute("calcMode", "spline");
+                Element& animation = element.add_child(tag);
+                animation.set_attribute("begin", parent->clock(time_start + time_stretch * parent->ip));
+                animation.set_attribute("dur", parent->clock(time_start + time_stretch * parent->op-parent->ip));
+                animation.set_attribute("attributeName", data.attribute);
+                animation.set_attribute("calcMode", "spline");
                 if ( !path.isEmpty() )
                 {
-                    animation.setAttribute("path", path);
+                    animation.set_attribute("path", path);
                     if ( auto_orient )
-                        animation.setAttribute("rotate", "auto");
+                        animation.set_attribute("rotate", "auto");
                 }
-                animation.setAttribute("keyTimes", key_times_str);
-                animation.setAttribute("keySplines", key_splines_str);
-                animation.setAttribute("repeatCount", "indefinite");
+                animation.set_attribute("keyTimes", key_times_str);
+                animation.set_attribute("keySplines", key_splines_str);
+                animation.set_attribute("repeatCount", "indefinite");
                 if ( !type.isEmpty() )
-                    animation.setAttribute("type", type);
+                    animation.set_attribute("type", type);
             }
         }
 
@@ -344,12 +822,12 @@ public:
     };
 
     void write_property(
-        QDomElement& element,
+        Element& element,
         model::AnimatableBase* property,
         const QString& attr
     )
     {
-        element.setAttribute(attr, property->value().toString());
+        element.set_attribute(attr, property->value().toString());
 
         if ( animated )
         {
@@ -379,7 +857,7 @@ public:
 
     template<class Callback>
     void write_properties(
-        QDomElement& element,
+        Element& element,
         std::vector<const model::AnimatableBase*> properties,
         const std::vector<QString>& attrs,
         const Callback& callback
@@ -391,7 +869,7 @@ public:
         {
             auto vals = callback(j.current_value());
             for ( std::size_t i = 0; i != attrs.size(); i++ )
-                element.setAttribute(attrs[i], vals[i]);
+                element.set_attribute(attrs[i], vals[i]);
         }
 
         if ( j.animated() && animated )
@@ -419,9 +897,9 @@ public:
         };
     }
 
-    void write_shape_rect(QDomElement& parent, model::Rect* rect, const Style::Map& style)
+    void write_shape_rect(model::Rect* rect, const Style::Map& style)
     {
-        auto e = element(parent, "rect");
+        Element e{"rect"};
         write_style(e, style);
         write_properties(e, {&rect->position, &rect->size}, {"x", "y"},
             [](const std::vector<QVariant>& values){
@@ -443,11 +921,12 @@ public:
             }
         );
         write_property(e, &rect->rounded, "ry");
+        write(e);
     }
 
-    void write_shape_ellipse(QDomElement& parent, model::Ellipse* ellipse, const Style::Map& style)
+    void write_shape_ellipse(model::Ellipse* ellipse, const Style::Map& style)
     {
-        auto e = element(parent, "ellipse");
+        Element e{"ellipse"};
         write_style(e, style);
         write_properties(e, {&ellipse->position}, {"cx", "cy"}, &Private::callback_point);
         write_properties(e, {&ellipse->size}, {"rx", "ry"},
@@ -459,36 +938,39 @@ public:
                 };
             }
         );
+        write(e);
     }
 
-    void write_shape_star(QDomElement& parent, model::PolyStar* star, const Style::Map& style)
+    void write_shape_star(model::PolyStar* star, const Style::Map& style)
     {
         model::FrameTime time = star->time();
 
-        auto e = write_bezier(parent, star, style);
+        Element e = bezier_element(star, style);
 
-        if ( star->outer_roundness.animated() || !qFuzzyIsNull(star->outer_roundness.get()) ||
-             star->inner_roundness.animated() || !qFuzzyIsNull(star->inner_roundness.get()) )
-            return;
+        if ( !star->outer_roundness.animated() && qFuzzyIsNull(star->outer_roundness.get()) &&
+             !star->inner_roundness.animated() && qFuzzyIsNull(star->inner_roundness.get()) )
+        {
+            set_attribute(e, "sodipodi:type", "star");
+            set_attribute(e, "inkscape:randomized", "0");
+            // inkscape:rounded Works differently than lottie so we leave it as 0
+            set_attribute(e, "inkscape:rounded", "0");
+            int sides = star->points.get_at(time);
+            set_attribute(e, "sodipodi:sides", sides);
+            set_attribute(e, "inkscape:flatsided", star->type.get() == model::PolyStar::Polygon);
+            QPointF c = star->position.get_at(time);
+            set_attribute(e, "sodipodi:cx", c.x());
+            set_attribute(e, "sodipodi:cy", c.y());
+            set_attribute(e, "sodipodi:r1", star->outer_radius.get_at(time));
+            set_attribute(e, "sodipodi:r2", star->inner_radius.get_at(time));
+            qreal angle = math::deg2rad(star->angle.get_at(time) - 90);
+            set_attribute(e, "sodipodi:arg1", angle);
+            set_attribute(e, "sodipodi:arg2", angle + math::pi / sides);
+        }
+
+        write(e);
+    }
 
-        set_attribute(e, "sodipodi:type", "star");
-        set_attribute(e, "inkscape:randomized", "0");
-        // inkscape:rounded Works differently than lottie so we leave it as 0
-        set_attribute(e, "inkscape:rounded", "0");
-        int sides = star->points.get_at(time);
-        set_attribute(e, "sodipodi:sides", sides);
-        set_attribute(e, "inkscape:flatsided", star->type.get() == model::PolyStar::Polygon);
-        QPointF c = star->position.get_at(time);
-        set_attribute(e, "sodipodi:cx", c.x());
-        set_attribute(e, "sodipodi:cy", c.y());
-        set_attribute(e, "sodipodi:r1", star->outer_radius.get_at(time));
-        set_attribute(e, "sodipodi:r2", star->inner_radius.get_at(time));
-        qreal angle = math::deg2rad(star->angle.get_at(time) - 90);
-        set_attribute(e, "sodipodi:arg1", angle);
-        set_attribute(e, "sodipodi:arg2", angle + math::pi / sides);
-    }
-
-    void write_shape_text(QDomElement& parent, model::TextShape* text, Style::Map style)
+    void write_shape_text(model::TextShape* text, Style::Map style)
     {
         QFontInfo font_info(text->font->query());
 
@@ -511,74 +993,80 @@ public:
             case QFont::StyleOblique: style["font-style"] = "oblique"; break;
         }
 
-        auto e = element(parent, "text");
+        Element e{"text"};
         write_style(e, style);
         write_properties(e, {&text->position}, {"x", "y"}, &Private::callback_point);
 
         model::Font::CharDataCache cache;
         for ( const auto& line : text->font->layout(text->text.get()) )
         {
-            auto tspan = element(e, "tspan");
-            tspan.appendChild(dom.createTextNode(line.text));
+            Element& tspan = e.add_child("tspan");
+            tspan.text = line.text;
             set_attribute(tspan, "sodipodi:role", "line");
 
             write_properties(tspan, {&text->position}, {"x", "y"}, [base=line.baseline](const std::vector<QVariant>& values){
                 return callback_point_result(values[0].toPointF() + base);
             });
-            tspan.setAttribute("xml:space", "preserve");
+            tspan.set_attribute("xml:space", "preserve");
         }
+
+        write(e);
     }
 
-    void write_shape_shape(QDomElement& parent, model::ShapeElement* shape, const Style::Map& style)
+    void write_shape_shape(model::ShapeElement* shape, const Style::Map& style)
     {
         if ( auto rect = qobject_cast<model::Rect*>(shape) )
         {
-            write_shape_rect(parent, rect, style);
+            write_shape_rect(rect, style);
         }
         else if ( auto ellipse = qobject_cast<model::Ellipse*>(shape) )
         {
-            write_shape_ellipse(parent, ellipse, style);
+            write_shape_ellipse(ellipse, style);
         }
         else if ( auto star = qobject_cast<model::PolyStar*>(shape) )
         {
-            write_shape_star(parent, star, style);
+            write_shape_star(star, style);
         }
         else if ( auto text = shape->cast<model::TextShape>() )
         {
-            write_shape_text(parent, text, style);
+            write_shape_text(text, style);
         }
         else if ( !qobject_cast<model::Styler*>(shape) )
         {
-            write_bezier(parent, shape, style);
+            write(bezier_element(shape, style));
         }
     }
 
-    void write_styler_attrs(QDomElement& element, model::Styler* styler, const QString& attr)
+    void write_styler_attrs(Element& element, model::Styler* styler, const QString& attr)
     {
         if ( styler->use.get() )
         {
-            element.setAttribute(attr, "url(#" + non_uuid_ids_map[styler->use.get()] + ")");
+            element.set_attribute(attr, "url(#" + non_uuid_ids_map[styler->use.get()] + ")");
             return;
         }
 
         write_property(element, &styler->color, attr);
         write_property(element, &styler->opacity, attr+"-opacity");
     }
-    void write_image(model::Image* img, QDomElement& parent)
+
+    void write_image(model::Image* img)
     {
         if ( img->image.get() )
         {
-            auto e = element(parent, "image");
+            Element e{"image"};
             set_attribute(e, "x", 0);
             set_attribute(e, "y", 0);
             set_attribute(e, "width", img->image->width.get());
             set_attribute(e, "height", img->image->height.get());
-            transform_to_attr(e, img->transform.get());
+            auto wrappers = transform_to_attr(e, img->transform.get());
             set_attribute(e, "xlink:href", img->image->to_url().toString());
+            start_wrappers(wrappers);
+            write(e);
+            end_wrappers(wrappers);
         }
     }
 
-    void write_stroke(model::Stroke* stroke, QDomElement& parent)
+    void write_stroke(model::Stroke* stroke)
     {
         Style::Map style;
         style["fill"] = "none";
@@ -615,15 +1103,10 @@ public:
                 break;
         }
         style["stroke-dasharray"] = "none";
-        QDomElement g = write_styler_shapes(parent, stroke, style);
-        if ( animated )
-        {
-            write_styler_attrs(g, stroke, "stroke");
-            write_property(g, &stroke->width, "stroke-width");
-        }
+        write_styler_shapes(stroke, style);
     }
 
-    void write_fill(model::Fill* fill, QDomElement& parent)
+    void write_fill(model::Fill* fill)
     {
         Style::Map style;
         if ( !animated )
@@ -632,41 +1115,37 @@ public:
             style["fill-opacity"] = QString::number(fill->opacity.get());
         }
         style["stroke"] = "none";
-        QDomElement g = write_styler_shapes(parent, fill, style);
-        if ( animated )
-            write_styler_attrs(g, fill, "fill");
+        write_styler_shapes(fill, style);
     }
 
-    void write_precomp_layer(model::PreCompLayer* layer, QDomElement& parent)
+    void write_precomp_layer(model::PreCompLayer* layer)
     {
         if ( layer->composition.get() )
         {
             timing.push_back(layer->timing.get());
-            auto clip = element(defs, "clipPath");
-            set_attribute(clip, "id", "clip_" + id(layer));
-            set_attribute(clip, "clipPathUnits", "userSpaceOnUse");
-            auto clip_rect = element(clip, "rect");
-            set_attribute(clip_rect, "x", "0");
-            set_attribute(clip_rect, "y", "0");
-            set_attribute(clip_rect, "width", layer->size.get().width());
-            set_attribute(clip_rect, "height", layer->size.get().height());
-
-            auto e = start_layer(parent, layer);
-            transform_to_attr(e, layer->transform.get());
+
+            Element e = layer_element(layer);
+            auto wrappers = transform_to_attr(e, layer->transform.get());
             write_property(e, &layer->opacity, "opacity");
-            write_visibility_attributes(parent, layer);
             time_stretch = layer->timing->stretch.get();
             time_start = layer->timing->start_time.get();
-            write_composition(e, layer->composition.get());
+            collect_shapes_attributes(e, layer->composition->shapes, false);
+
+            start_wrappers(wrappers);
+            start(e);
+            write_composition(layer->composition.get());
+            end();
+            end_wrappers(wrappers);
+
             time_stretch = 1;
             time_start = 0;
             timing.pop_back();
         }
     }
 
-    void write_repeater_vis(QDomElement& element, model::Repeater* repeater, int index, int n_copies)
+    void write_repeater_vis(Element& element, model::Repeater* repeater, int index, int n_copies)
     {
-        element.setAttribute("display", index < repeater->copies.get() ? "block" : "none");
+        element.set_attribute("display", index < repeater->copies.get() ? "block" : "none");
 
         float alpha_lerp = float(index) / (n_copies == 1 ? 1 : n_copies - 1);
         model::JoinAnimatables opacity({&repeater->start_opacity, &repeater->end_opacity}, model::JoinAnimatables::NoValues);
@@ -706,73 +1185,82 @@ public:
         }
     }
 
-    void write_repeater(model::Repeater* repeater, QDomElement& parent, bool force_draw)
+    void write_repeater(model::Repeater* repeater, bool force_draw)
     {
         int n_copies = repeater->max_copies();
         if ( n_copies < 1 )
             return;
 
-        QDomElement container = start_group(parent, repeater);
+        start(group_element(repeater));
         QString base_id = id(repeater);
         QString prev_clone_id = base_id + "_0";
-        QDomElement og = element(container, "g");
-        og.setAttribute("id", prev_clone_id);
-        for ( const auto& sib : repeater->affected() )
-            write_shape(og, sib, force_draw);
 
+        Element og{"g"};
+        og.set_attribute("id", prev_clone_id);
+        for ( const auto& sib : repeater->affected() )
+            collect_parent_attributes(og, sib, force_draw);
         write_repeater_vis(og, repeater, 0, n_copies);
 
+        start_tag(og);
+        for ( const auto& sib : repeater->affected() )
+            write_shape(sib, force_draw);
+        end(og);
+
         for ( int i = 1; i < n_copies; i++ )
         {
             QString clone_id = base_id + "_" + QString::number(i);;
-            QDomElement use = element(container, "use");
-            use.setAttribute("xlink:href", "#" + prev_clone_id);
-            use.setAttribute("id", clone_id);
+            Element use{"use"};
+            use.set_attribute("xlink:href", "#" + prev_clone_id);
+            use.set_attribute("id", clone_id);
             write_repeater_vis(use, repeater, i, n_copies);
-            transform_to_attr(use, repeater->transform.get());
+            auto wrappers = transform_to_attr(use, repeater->transform.get());
+            start_wrappers(wrappers);
+            write(use);
+            end_wrappers(wrappers);
             prev_clone_id = clone_id;
         }
+
+        end();
     }
 
-    void write_shape(QDomElement& parent, model::ShapeElement* shape, bool force_draw)
+    void write_shape(model::ShapeElement* shape, bool force_draw)
     {
         if ( auto grp = qobject_cast<model::Group*>(shape) )
         {
-            write_group_shape(parent, grp);
+            write_group_shape(grp);
         }
         else if ( auto stroke = qobject_cast<model::Stroke*>(shape) )
         {
             if ( stroke->visible.get() )
-                write_stroke(stroke, parent);
+                write_stroke(stroke);
         }
         else if ( auto fill = qobject_cast<model::Fill*>(shape) )
         {
             if ( fill->visible.get() )
-                write_fill(fill, parent);
+                write_fill(fill);
         }
         else if ( auto img = qobject_cast<model::Image*>(shape) )
         {
-            write_image(img, parent);
+            write_image(img);
         }
         else if ( auto layer = qobject_cast<model::PreCompLayer*>(shape) )
         {
-            write_precomp_layer(layer, parent);
+            write_precomp_layer(layer);
         }
         else if ( auto repeater = qobject_cast<model::Repeater*>(shape) )
         {
-            write_repeater(repeater, parent, force_draw);
+            write_repeater(repeater, force_draw);
         }
         else if ( force_draw )
         {
-            write_shape_shape(parent, shape, {});
-            write_visibility_attributes(parent, shape);
-            set_attribute(parent, "id", id(shape));
+            // Visibility and id are added to the parent by collect_parent_attributes()
+            write_shape_shape(shape, {});
         }
     }
 
-    QDomElement write_bezier(QDomElement& parent, model::ShapeElement* shape, const Style::Map& style)
+    Element bezier_element(model::ShapeElement* shape, const Style::Map& style)
     {
-        QDomElement path = element(parent, "path");
+        Element path{"path"};
         write_style(path, style);
         QString d;
         QString nodetypes;
@@ -806,36 +1294,40 @@ public:
 
     /**
      * \brief Creates a <g> element for recurse_parents
-     * \param parent        DOM element to add the <g> into
      * \param ancestor      Ancestor layer (to create the <g> for)
      * \param descendant    Descendant layer
+     * \param elements      Output list, receives the <g> and its transform wrappers
      */
-    QDomElement start_layer_recurse_parents(const QDomElement& parent, model::Layer* ancestor, model::Layer* descendant)
+    void start_layer_recurse_parents(model::Layer* ancestor, model::Layer* descendant, std::vector<Element>& elements)
     {
-        QDomElement g = element(parent, "g");
-        g.setAttribute("id", id(descendant) + "_" + id(ancestor));
-        g.setAttribute("inkscape:label", QObject::tr("%1 (%2)").arg(descendant->object_name()).arg(ancestor->object_name()));
-        g.setAttribute("inkscape:groupmode", "layer");
-        transform_to_attr(g, ancestor->transform.get());
-        return g;
+        Element g{"g"};
+        g.set_attribute("id", id(descendant) + "_" + id(ancestor));
+        g.set_attribute("inkscape:label", QObject::tr("%1 (%2)").arg(descendant->object_name()).arg(ancestor->object_name()));
+        g.set_attribute("inkscape:groupmode", "layer");
+        auto wrappers = transform_to_attr(g, ancestor->transform.get());
+        std::move(wrappers.begin(), wrappers.end(), std::back_inserter(elements));
+        elements.push_back(std::move(g));
     }
 
     /**
      * \brief Creates nested <g> elements for each layer parent (using the parent property)
-     * \param parent        DOM element to add the elements into
      * \param ancestor      Ancestor layer (searched recursively for parents)
      * \param descendant    Descendant layer
+     * \returns Elements to be started with start_wrappers(), outermost first
      */
-    QDomElement recurse_parents(const QDomElement& parent, model::Layer* ancestor, model::Layer* descendant)
+    std::vector<Element> recurse_parents(model::Layer* ancestor, model::Layer* descendant)
     {
-        if ( !ancestor->parent.get() )
-            return start_layer_recurse_parents(parent, ancestor, descendant);
-        return start_layer_recurse_parents(recurse_parents(parent, ancestor->parent.get(), descendant), ancestor, descendant);
+        std::vector<Element> elements;
+        if ( ancestor->parent.get() )
+            elements = recurse_parents(ancestor->parent.get(), descendant);
+        start_layer_recurse_parents(ancestor, descendant, elements);
+        return elements;
     }
 
-    void write_group_shape(QDomElement& parent, model::Group* group)
+    void write_group_shape(model::Group* group)
     {
-        QDomElement g;
+        Element g;
+        std::vector<Element> wrappers;
         bool has_mask = false;
         if ( auto layer = group->cast<model::Layer>() )
         {
@@ -843,27 +1335,15 @@ public:
                 return;
 
             if ( layer->parent.get() )
-            {
-                QDomElement parent_g = recurse_parents(parent, layer->parent.get(), layer);
-                g = start_layer(parent_g, group);
-            }
-            else
-            {
-                g = start_layer(parent, group);
-            }
+                wrappers = recurse_parents(layer->parent.get(), layer);
+
+            g = layer_element(group);
 
             if ( layer->mask->has_mask() )
             {
+                // The mask itself is written in <defs> by collect_defs()
                 has_mask = true;
-
-                QDomElement clip = element(defs, "mask");
-                QString mask_id = "clip_" + id(layer);
-                clip.setAttribute("id", mask_id);
-                clip.setAttribute("mask-type", "alpha");
-                if ( layer->shapes.size() > 1 )
-                    write_shape(clip, layer->shapes[0], false);
-
-                g.setAttribute("mask", "url(#" + mask_id + ")");
+                g.set_attribute("mask", "url(#clip_" + id(layer) + ")");
             }
 
             if ( animated && layer->visible.get() )
@@ -875,12 +1355,12 @@ public:
 
                 if ( has_start || has_end )
                 {
-                    QDomElement animation = element(g, "animate");
-                    animation.setAttribute("begin", clock(ip));
-                    animation.setAttribute("dur", clock(op-ip));
-                    animation.setAttribute("calcMode", "discrete");
-                    animation.setAttribute("attributeName", "display");
-                    animation.setAttribute("repeatCount", "indefinite");
+                    Element& animation = g.add_child("animate");
+                    animation.set_attribute("begin", clock(ip));
+                    animation.set_attribute("dur", clock(op-ip));
+                    animation.set_attribute("calcMode", "discrete");
+                    animation.set_attribute("attributeName", "display");
+                    animation.set_attribute("repeatCount", "indefinite");
                     QString times;
                     QString vals;
 
@@ -902,35 +1382,41 @@ public:
                         times += unlerp_time(lay_range->last_frame.get()) + ";";
                     }
 
-                    animation.setAttribute("values", vals);
-                    animation.setAttribute("keyTimes", times);
+                    animation.set_attribute("values", vals);
+                    animation.set_attribute("keyTimes", times);
                 }
             }
         }
         else
         {
-            g = start_group(parent, group);
+            g = group_element(group);
         }
 
-        transform_to_attr(g, group->transform.get(), group->auto_orient.get());
+        auto transform = transform_to_attr(g, group->transform.get(), group->auto_orient.get());
+        std::move(transform.begin(), transform.end(), std::back_inserter(wrappers));
         write_property(g, &group->opacity, "opacity");
         write_visibility_attributes(g, group);
-        write_shapes(g, group->shapes, has_mask);
+        collect_shapes_attributes(g, group->shapes, has_mask);
+
+        start_wrappers(wrappers);
+        start(g);
+        write_shapes(group->shapes, has_mask);
+        end();
+        end_wrappers(wrappers);
     }
 
+    /**
+     * \brief Adds a <g> with a transform for \p prop around the elements already in \p wrappers
+     */
     template<class PropT, class Callback>
-    QDomElement transform_property(
-        QDomElement& e, const char* name, PropT* prop, const Callback& callback,
+    void transform_property(
+        std::vector<Element>& wrappers, const char* name, PropT* prop, const Callback& callback,
         const QString& path = {}, bool auto_orient = false
     )
     {
         model::JoinAnimatables j({prop}, model::JoinAnimatables::NoValues);
 
-        auto parent = e.parentNode();
-        QDomElement g = dom.createElement("g");
-        parent.insertBefore(g, e);
-        parent.removeChild(e);
-        g.appendChild(e);
+        Element g{"g"};
 
         if ( j.animated() )
         {
@@ -951,34 +1437,39 @@ public:
             }
         }
 
-        g.setAttribute("transform", QString("%1(%2)").arg(name).arg(callback(prop->get())));
-        return g;
+        g.set_attribute("transform", QString("%1(%2)").arg(name).arg(callback(prop->get())));
+        wrappers.insert(wrappers.begin(), std::move(g));
     }
 
-    void transform_to_attr(QDomElement& parent, model::Transform* transf, bool auto_orient = false)
+    /**
+     * \brief Writes \p transf on \p element
+     * \returns <g> elements to be written around \p element when the transform is animated
+     */
+    std::vector<Element> transform_to_attr(Element& element, model::Transform* transf, bool auto_orient = false)
     {
+        std::vector<Element> wrappers;
+
         if ( animated && (transf->position.animated() || transf->scale.animated() || transf->rotation.animated() || transf->anchor_point.animated()) )
         {
-            QDomElement subject = parent;
-            subject = transform_property(subject, "translate", &transf->anchor_point, [](const QPointF& val){
+            transform_property(wrappers, "translate", &transf->anchor_point, [](const QPointF& val){
                 return QString("%1 %2").arg(-val.x()).arg(-val.y());
             });
-            subject = transform_property(subject, "scale", &transf->scale, [](const QVector2D& val){
+            transform_property(wrappers, "scale", &transf->scale, [](const QVector2D& val){
                 return QString("%1 %2").arg(val.x()).arg(val.y());
             });
-            subject = transform_property(subject, "rotate", &transf->rotation, [](qreal val){
+            transform_property(wrappers, "rotate", &transf->rotation, [](qreal val){
                 return QString::number(val);
             });
             math::bezier::MultiBezier mb;
             mb.beziers().push_back(transf->position.bezier());
-            subject = transform_property(subject, "translate", &transf->position, [](const QPointF& val){
+            transform_property(wrappers, "translate", &transf->position, [](const QPointF& val){
                 return QString("%1 %2").arg(val.x()).arg(val.y());
             }, path_data(mb).first, auto_orient);
         }
         else
         {
             auto matr = transf->transform_matrix(transf->time());
-            parent.setAttribute("transform", QString("matrix(%1, %2, %3, %4, %5, %6)")
+            element.set_attribute("transform", QString("matrix(%1, %2, %3, %4, %5, %6)")
                 .arg(matr.m11())
                 .arg(matr.m12())
                 .arg(matr.m21())
@@ -987,9 +1478,11 @@ public:
                 .arg(matr.m32())
             );
         }
+
+        return wrappers;
     }
 
-    void write_style(QDomElement& element, const Style::Map& s)
+    void write_style(Element& element, const Style::Map& s)
     {
         QString st;
         for ( auto it : s )
@@ -999,21 +1492,21 @@ public:
             st.append(it.second);
             st.append(';');
         }
-        element.setAttribute("style", st);
+        element.set_attribute("style", st);
     }
 
-    QDomElement start_group(QDomElement& parent, model::DocumentNode* node)
+    Element group_element(model::DocumentNode* node)
     {
-        QDomElement g = element(parent, "g");
-        g.setAttribute("id", id(node));
-        g.setAttribute("inkscape:label", node->object_name());
+        Element g{"g"};
+        g.set_attribute("id", id(node));
+        g.set_attribute("inkscape:label", node->object_name());
         return g;
     }
 
-    QDomElement start_layer(QDomElement& parent, model::DocumentNode* node)
+    Element layer_element(model::DocumentNode* node)
     {
-        auto g = start_group(parent, node);
-        g.setAttribute("inkscape:groupmode", "layer");
+        auto g = group_element(node);
+        g.set_attribute("inkscape:groupmode", "layer");
         return g;
     }
 
@@ -1037,17 +1530,18 @@ public:
                 c == '-';
     }
 
-    void write_named_color(QDomElement& parent, model::NamedColor* color)
+    void write_named_color(model::NamedColor* color)
     {
-        auto gradient = element(parent, "linearGradient");
-        gradient.setAttribute("osb:paint", "solid");
+        Element gradient{"linearGradient"};
+        gradient.set_attribute("osb:paint", "solid");
         QString id = pretty_id(color->name.get(), color);
         non_uuid_ids_map[color] = id;
-        gradient.setAttribute("id", id);
+        gradient.set_attribute("id", id);
 
-        auto stop = element(gradient, "stop");
-        stop.setAttribute("offset", "0");
+        Element& stop = gradient.add_child("stop");
+        stop.set_attribute("offset", "0");
         write_property(stop, &color->color, "stop-color");
+        write(gradient);
     }
 
     QString pretty_id(const QString& s, model::DocumentNode* node)
@@ -1081,34 +1575,34 @@ public:
 
     template<class T>
     std::enable_if_t<std::is_arithmetic_v<T> && !std::is_same_v<T, bool>>
-    set_attribute(QDomElement& e, const QString& name, T val)
+    set_attribute(Element& e, const QString& name, T val)
     {
-        // not using e.setAttribute overloads to bypass locale settings
-        e.setAttribute(name, QString::number(val));
+        // QString::number bypasses locale settings
+        e.set_attribute(name, QString::number(val));
     }
 
-    void set_attribute(QDomElement& e, const QString& name, bool val)
+    void set_attribute(Element& e, const QString& name, bool val)
     {
-        e.setAttribute(name, val ? "true" : "false");
+        e.set_attribute(name, val ? "true" : "false");
     }
 
-    void set_attribute(QDomElement& e, const QString& name, const char* val)
+    void set_attribute(Element& e, const QString& name, const char* val)
     {
-        e.setAttribute(name, val);
+        e.set_attribute(name, val);
     }
 
-    void set_attribute(QDomElement& e, const QString& name, const QString& val)
+    void set_attribute(Element& e, const QString& name, const QString& val)
     {
-        e.setAttribute(name, val);
+        e.set_attribute(name, val);
     }
 
 
-    void write_gradient_colors(QDomElement& parent, model::GradientColors* gradient)
+    void write_gradient_colors(model::GradientColors* gradient)
     {
-        auto e = element(parent, "linearGradient");
+        Element e{"linearGradient"};
         QString id = pretty_id(gradient->name.get(), gradient);
         non_uuid_ids_map[gradient] = id;
-        e.setAttribute("id", id);
+        e.set_attribute("id", id);
 
         if ( animated && gradient->colors.keyframe_count() > 1 )
         {
@@ -1131,10 +1625,10 @@ public:
                     );
                 }
 
-                auto s = element(e, "stop");
-                s.setAttribute("stop-opacity", "1");
+                Element& s = e.add_child("stop");
+                s.set_attribute("stop-opacity", "1");
                 set_attribute(s, "offset", stops[i].first);
-                s.setAttribute("stop-color", stops[i].second.name());
+                s.set_attribute("stop-color", stops[i].second.name());
                 data.add_dom(s);
             }
         }
@@ -1142,20 +1636,22 @@ public:
         {
             for ( const auto& stop : gradient->colors.get() )
             {
-                auto s = element(e, "stop");
-                s.setAttribute("stop-opacity", "1");
+                Element& s = e.add_child("stop");
+                s.set_attribute("stop-opacity", "1");
                 set_attribute(s, "offset", stop.first);
-                s.setAttribute("stop-color", stop.second.name());
+                s.set_attribute("stop-color", stop.second.name());
             }
         }
+
+        write(e);
     }
 
-    void write_gradient(QDomElement& parent, model::Gradient* gradient)
+    void write_gradient(model::Gradient* gradient)
     {
-        QDomElement e;
+        Element e;
         if ( gradient->type.get() == model::Gradient::Radial || gradient->type.get() == model::Gradient::Conical )
         {
-            e = element(parent, "radialGradient");
+            e.tag = "radialGradient";
             write_properties(e, {&gradient->start_point}, {"cx", "cy"}, &Private::callback_point);
             write_properties(e, {&gradient->highlight}, {"fx", "fy"}, &Private::callback_point);
 
@@ -1168,19 +1664,21 @@ public:
         }
         else
         {
-            e = element(parent, "linearGradient");
+            e.tag = "linearGradient";
             write_properties(e, {&gradient->start_point}, {"x1", "y1"}, &Private::callback_point);
             write_properties(e, {&gradient->end_point}, {"x2", "y2"}, &Private::callback_point);
         }
 
         QString id = pretty_id(gradient->name.get(), gradient);
         non_uuid_ids_map[gradient] = id;
-        e.setAttribute("id", id);
-        e.setAttribute("gradientUnits", "userSpaceOnUse");
+        e.set_attribute("id", id);
+        e.set_attribute("gradientUnits", "userSpaceOnUse");
 
         auto it = non_uuid_ids_map.find(gradient->colors.get());
         if ( it != non_uuid_ids_map.end() )
-            e.setAttribute("xlink:href", "#" + it->second);
+            e.set_attribute("xlink:href", "#" + it->second);
+
+        write(e);
     }
 
     QString clock(model::FrameTime time)
@@ -1188,8 +1686,34 @@ public:
         return QString::number(time / fps, 'f');
     }
 
+    void write_root_composition(model::Composition* comp)
+    {
+        std::vector<DefsItem> defs_items;
+        collect_shapes_defs(comp->shapes, false, defs_items);
+        collect_defs(comp, defs_items);
+
+        Element g = layer_element(comp);
+        collect_shapes_attributes(g, comp->shapes, false);
+        start(g);
+        write_composition(comp);
+        end();
+    }
+
+    void write_root_shape(model::ShapeElement* shape)
+    {
+        std::vector<DefsItem> defs_items;
+        collect_shape_defs(shape, defs_items);
+        collect_defs(shape->owner_composition(), defs_items);
+
+        Element root;
+        collect_parent_attributes(root, shape, true);
+        writer->root_attributes(root.attributes);
+        write_shape(shape, true);
+    }
+
     std::vector<model::StretchableTime*> timing;
     QDomDocument dom;
+    std::unique_ptr<Writer> writer;
     qreal fps = 60;
     qreal ip = 0;
     qreal op = 60;
@@ -1197,8 +1721,6 @@ public:
     std::set<QString> non_uuid_ids;
     std::map<model::DocumentNode*, QString> non_uuid_ids_map;
     AnimationType animated;
-    QDomElement svg;
-    QDomElement defs;
     CssFontType font_type;
     qreal time_stretch = 1;
     model::FrameTime time_start = 0;
@@ -1207,36 +1729,54 @@ public:
 
 io::svg::SvgRenderer::SvgRenderer(AnimationType animated, CssFontType font_type)
     : d(std::make_unique<Private>())
+{
+    d->writer = std::make_unique<Private::DomWriter>(d->dom);
+    init(animated, font_type);
+}
+
+io::svg::SvgRenderer::SvgRenderer(QIODevice* device, AnimationType animated, CssFontType font_type, bool indent)
+    : d(std::make_unique<Private>())
+{
+    d->writer = std::make_unique<Private::StreamWriter>(device, indent);
+    init(animated, font_type);
+}
+
+void io::svg::SvgRenderer::init(AnimationType animated, CssFontType font_type)
 {
     d->animated = animated;
     d->font_type = font_type;
-    d->svg = d->dom.createElement("svg");
-    d->dom.appendChild(d->svg);
-    d->svg.setAttribute("xmlns", detail::xmlns.at("svg"));
+
+    Private::Element svg;
+    svg.set_attribute("xmlns", detail::xmlns.at("svg"));
     for ( const auto& p : detail::xmlns )
     {
         if ( !p.second.contains("android") )
-            d->svg.setAttribute("xmlns:" + p.first, p.second);
+            svg.set_attribute("xmlns:" + p.first, p.second);
     }
 
-    d->write_style(d->svg, {
+    d->write_style(svg, {
         {"fill", "none"},
         {"stroke", "none"}
     });
-    d->svg.setAttribute("inkscape:export-xdpi", "96");
-    d->svg.setAttribute("inkscape:export-ydpi", "96");
-    d->svg.setAttribute("version", "1.1");
+    svg.set_attribute("inkscape:export-xdpi", "96");
+    svg.set_attribute("inkscape:export-ydpi", "96");
+    svg.set_attribute("version", "1.1");
+    d->writer->root_attributes(svg.attributes);
 }
 
 io::svg::SvgRenderer::~SvgRenderer()
 {
+    close();
+}
+
+void io::svg::SvgRenderer::close()
+{
+    d->writer->finish();
 }
 
 void io::svg::SvgRenderer::write_composition(model::Composition* comp)
 {
-    d->collect_defs(comp);
-    auto g = d->start_layer(d->svg, comp);
-    d->write_composition(g, comp);
+    d->write_root_composition(comp);
 }
 
 
@@ -1246,22 +1786,23 @@ void io::svg::SvgRenderer::write_main(model::Composition* comp)
     {
         QString w  = QString::number(comp->width.get());
         QString h = QString::number(comp->height.get());
-        d->svg.setAttribute("width", w);
-        d->svg.setAttribute("height", h);
-        d->svg.setAttribute("viewBox", QString("0 0 %1 %2").arg(w).arg(h));
-        d->svg.appendChild(d->dom.createElement("title")).appendChild(d->dom.createTextNode(comp->name.get()));
-        write_composition(comp);
-    }
-    else
-    {
-        write_composition(comp);
+        Private::Attributes size;
+        size.set("width", w);
+        size.set("height", h);
+        size.set("viewBox", QString("0 0 %1 %2").arg(w).arg(h));
+        d->writer->root_attributes(size);
+
+        Private::Element title{"title"};
+        title.text = comp->name.get();
+        d->write(title);
     }
+
+    write_composition(comp);
 }
 
 void io::svg::SvgRenderer::write_shape(model::ShapeElement* shape)
 {
-    d->collect_defs(shape->owner_composition());
-    d->write_shape(d->svg, shape, true);
+    d->write_root_shape(shape);
 }
 
 void io::svg::SvgRenderer::write_node(model::DocumentNode* node)
@@ -34,7 +34,19 @@ enum class CssFontType
 class SvgRenderer
 {
 public:
+    /**
+     * \brief Renders into a DOM, accessible with dom() and write()
+     */
     SvgRenderer(AnimationType animated, CssFontType font_type);
+
+    /**
+     * \brief Streams elements to \p device while traversing the model, without building a DOM
+     *
+     * The document is completed by close() (or the destructor),
+     * \p device must be valid until then.
+     * Only the first node written can add attributes to the root element.
+     */
+    SvgRenderer(QIODevice* device, AnimationType animated, CssFontType font_type, bool indent);
     ~SvgRenderer();
 
     void write_composition(model::Composition* comp);
@@ -42,12 +54,25 @@ public:
     void write_shape(model::ShapeElement* shape);
     void write_node(model::DocumentNode* node);
 
+    /**
+     * \brief Closes any open element, needed only when streaming to a device
+     */
+    void close();
+
+    /**
+     * \brief Rendered document, empty when streaming to a device
+     */
     QDomDocument dom() const;
 
+    /**
+     * \brief Writes dom() to \p device
+     */
     void write(QIODevice* device, bool indent);
 
     static CssFontType suggested_type(model::EmbeddedFont* font);
 private:
+    void init(AnimationType animated, CssFontType font_type);
+
     class Private;
     std::unique_ptr<Private> d;
 };
@@ -21,6 +21,7 @@ extern "C" {
 #include "app/qstring_exception.hpp"
 #include "app/log/log.hpp"
 #include "model/assets/composition.hpp"
+#include "model/render_program.hpp"
 
 namespace glaxnimate::av {
 
@@ -827,9 +828,10 @@ bool glaxnimate::io::video::VideoFormat::on_save(QIODevice& dev, const QString&
         auto last_frame = comp->animation->last_frame.get();
         QColor background = settings["background"].value<QColor>();
         emit progress_max_changed(last_frame - first_frame);
+        model::RenderProgram program(comp);
         for ( auto i = first_frame; i < last_frame; i++ )
         {
-            video.write_video_frame(comp->render_image(i, {width, height}, background));
+            video.write_video_frame(program.render_image(i, {width, height}, background));
             emit progress(i - first_frame);
         }
 
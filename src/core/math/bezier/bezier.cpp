@@ -6,28 +6,172 @@
 
 #include "bezier.hpp"
 
+#include <cstddef>
+
+#if (defined(__SSE2__) || defined(_M_X64)) && !defined(QT_COORD_TYPE)
+#   include <emmintrin.h>
+#   define GLAXNIMATE_BEZIER_SSE2
+#endif
+
 using namespace glaxnimate;
 
+namespace {
+
+using math::bezier::Point;
+
+/*
+ * The kernels below work on the coordinates of pos, tan_in and tan_out
+ * as 3 consecutive (x, y) pairs, so each pair can be processed in a single
+ * SIMD register without changing the layout exposed by Point
+ */
+static_assert(offsetof(Point, tan_in) == offsetof(Point, pos) + sizeof(QPointF));
+static_assert(offsetof(Point, tan_out) == offsetof(Point, tan_in) + sizeof(QPointF));
+static_assert(sizeof(QPointF) == 2 * sizeof(qreal));
+
+inline qreal* coords(Point& p)
+{
+    return reinterpret_cast<qreal*>(&p.pos);
+}
+
+inline const qreal* coords(const Point& p)
+{
+    return reinterpret_cast<const qreal*>(&p.pos);
+}
+
+/**
+ * \brief Applies the affine part of \p t to all the coordinates of \p points
+ */
+void affine_map(Point* points, std::size_t count, const QTransform& t)
+{
+#ifdef GLAXNIMATE_BEZIER_SSE2
+    const __m128d col_x = _mm_set_pd(t.m12(), t.m11());
+    const __m128d col_y = _mm_set_pd(t.m22(), t.m21());
+    const __m128d offset = _mm_set_pd(t.dy(), t.dx());
+    for ( std::size_t i = 0; i < count; i++ )
+    {
+        qreal* data = coords(points[i]);
+        for ( int j = 0; j < 6; j += 2 )
+        {
+            __m128d x = _mm_set1_pd(data[j]);
+            __m128d y = _mm_set1_pd(data[j+1]);
+            _mm_storeu_pd(data + j, _mm_add_pd(_mm_add_pd(_mm_mul_pd(x, col_x), _mm_mul_pd(y, col_y)), offset));
+        }
+    }
+#else
+    const qreal m11 = t.m11(), m12 = t.m12(), m21 = t.m21(), m22 = t.m22(), dx = t.dx(), dy = t.dy();
+    for ( std::size_t i = 0; i < count; i++ )
+    {
+        qreal* data = coords(points[i]);
+        for ( int j = 0; j < 6; j += 2 )
+        {
+            qreal x = data[j];
+            qreal y = data[j+1];
+            data[j] = m11 * x + m21 * y + dx;
+            data[j+1] = m12 * x + m22 * y + dy;
+        }
+    }
+#endif
+}
+
+/**
+ * \brief Bounding box of the positions of \p points (\p count must be > 0)
+ */
+void position_bounds(const Point* points, std::size_t count, QPointF& min, QPointF& max)
+{
+#ifdef GLAXNIMATE_BEZIER_SSE2
+    __m128d lo = _mm_loadu_pd(coords(points[0]));
+    __m128d hi = lo;
+    for ( std::size_t i = 1; i < count; i++ )
+    {
+        __m128d pos = _mm_loadu_pd(coords(points[i]));
+        lo = _mm_min_pd(lo, pos);
+        hi = _mm_max_pd(hi, pos);
+    }
+    _mm_storeu_pd(&min.rx(), lo);
+    _mm_storeu_pd(&max.rx(), hi);
+#else
+    min = max = points[0].pos;
+    for ( std::size_t i = 1; i < count; i++ )
+    {
+        const QPointF& pos = points[i].pos;
+        min.rx() = qMin(min.x(), pos.x());
+        min.ry() = qMin(min.y(), pos.y());
+        max.rx() = qMax(max.x(), pos.x());
+        max.ry() = qMax(max.y(), pos.y());
+    }
+#endif
+}
+
+/**
+ * \brief Interpolates positions and tangents relative to their position
+ */
+void lerp_points(const Point* a, const Point* b, Point* out, std::size_t count, qreal factor)
+{
+#ifdef GLAXNIMATE_BEZIER_SSE2
+    const __m128d fa = _mm_set1_pd(1 - factor);
+    const __m128d fb = _mm_set1_pd(factor);
+    for ( std::size_t i = 0; i < count; i++ )
+    {
+        const qreal* da = coords(a[i]);
+        const qreal* db = coords(b[i]);
+        qreal* dout = coords(out[i]);
+        __m128d pos_a = _mm_loadu_pd(da);
+        __m128d pos_b = _mm_loadu_pd(db);
+        __m128d pos = _mm_add_pd(_mm_mul_pd(pos_a, fa), _mm_mul_pd(pos_b, fb));
+        _mm_storeu_pd(dout, pos);
+        for ( int j = 2; j < 6; j += 2 )
+        {
+            __m128d rel_a = _mm_sub_pd(_mm_loadu_pd(da + j), pos_a);
+            __m128d rel_b = _mm_sub_pd(_mm_loadu_pd(db + j), pos_b);
+            __m128d rel = _mm_add_pd(_mm_mul_pd(rel_a, fa), _mm_mul_pd(rel_b, fb));
+            _mm_storeu_pd(dout + j, _mm_add_pd(pos, rel));
+        }
+    }
+#else
+    for ( std::size_t i = 0; i < count; i++ )
+    {
+        QPointF pos = math::lerp(a[i].pos, b[i].pos, factor);
+        out[i].pos = pos;
+        out[i].tan_in = pos + math::lerp(a[i].tan_in - a[i].pos, b[i].tan_in - b[i].pos, factor);
+        out[i].tan_out = pos + math::lerp(a[i].tan_out - a[i].pos, b[i].tan_out - b[i].pos, factor);
+    }
+#endif
+}
+
+bool in_box(const QPointF& p, const QPointF& min, const QPointF& max)
+{
+    return p.x() >= min.x() && p.x() <= max.x() && p.y() >= min.y() && p.y() <= max.y();
+}
+
+} // namespace
+
 QRectF math::bezier::Bezier::bounding_box() const
 {
     if ( size() < 2 )
         return {};
 
-    auto pair = solver_for_point(0).bounds();
-    QRectF box(pair.first, pair.second);
-    for ( int i = 1; i < size() - 1; i++ )
-    {
-        pair = solver_for_point(i).bounds();
-        box |= QRectF(pair.first, pair.second);
-    }
+    // Every point is the end of a segment so it's part of the bounds
+    QPointF min, max;
+    position_bounds(points_.data(), points_.size(), min, max);
 
-    if ( closed_ )
+    // A segment lies inside the convex hull of its control points,
+    // so only segments with a tangent outside the box need to be solved
+    int count = segment_count();
+    for ( int i = 0; i < count; i++ )
     {
-        pair = solver_for_point(size()-1).bounds();
-        box |= QRectF(pair.first, pair.second);
+        const Point& from = points_[i];
+        const Point& to = points_[(i + 1) % size()];
+        if ( in_box(from.tan_out, min, max) && in_box(to.tan_in, min, max) )
+            continue;
+
+        auto pair = solver_for_point(i).bounds();
+        min.rx() = qMin(min.x(), pair.first.x());
+        min.ry() = qMin(min.y(), pair.first.y());
+        max.rx() = qMax(max.x(), pair.second.x());
+        max.ry() = qMax(max.y(), pair.second.y());
     }
 
-    return box;
+    return QRectF(min, max);
 }
 
 void math::bezier::Bezier::split_segment(int index, qreal factor)
@@ -110,21 +254,8 @@ math::bezier::Bezier math::bezier::Bezier::lerp(const math::bezier::Bezier& othe
 
     math::bezier::Bezier lerped;
     lerped.closed_ = closed_;
-    lerped.points_.reserve(size());
-    for ( int i = 0; i < size(); i++ )
-        lerped.points_.push_back(Point::from_relative(
-            math::lerp(points_[i].pos, other.points_[i].pos, factor),
-            math::lerp(
-                points_[i].tan_in - points_[i].pos,
-                other.points_[i].tan_in - other.points_[i].pos,
-                factor
-            ),
-            math::lerp(
-                points_[i].tan_out - points_[i].pos,
-                other.points_[i].tan_out - other.points_[i].pos,
-                factor
-            )
-        ));
+    lerped.points_.resize(size());
+    lerp_points(points_.data(), other.points_.data(), lerped.points_.data(), points_.size(), factor);
     return lerped;
 }
 
@@ -180,6 +311,15 @@ math::bezier::Bezier math::bezier::Bezier::transformed(const QTransform& t) cons
 
 void math::bezier::Bezier::transform(const QTransform& t)
 {
+    if ( t.isIdentity() )
+        return;
+
+    if ( t.isAffine() )
+    {
+        affine_map(points_.data(), points_.size(), t);
+        return;
+    }
+
     for ( auto& p : points_ )
         p.transform(t);
 }
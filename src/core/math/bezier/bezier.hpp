@@ -12,6 +12,7 @@
 #include "math/bezier/solver.hpp"
 #include "math/bezier/point.hpp"
 #include "math/bezier/segment.hpp"
+#include "math/bezier/frame_arena.hpp"
 
 namespace glaxnimate::math::bezier {
 
@@ -21,17 +22,45 @@ class Bezier
 {
 public:
     using value_type = Point;
-
+    using PointList = std::pmr::vector<Point>;
+    using allocator_type = PointList::allocator_type;
+
+    /*
+     * Unless an allocator is passed explicitly, beziers (including copies and
+     * moves) allocate from the default resource, so only the geometry evaluation
+     * code that asks for FrameArena::resource() uses the arena.
+     * Moving out of a bezier with a different resource copies the points,
+     * the move constructor is still noexcept as running out of memory there
+     * isn't recoverable anyway.
+     */
     Bezier() = default;
-    explicit Bezier(const Point& initial_point)
-        : points_(1, initial_point)
+    explicit Bezier(const allocator_type& allocator)
+        : points_(allocator)
+    {}
+    Bezier(const Bezier& other)
+        : Bezier(other, allocator_type())
+    {}
+    Bezier(const Bezier& other, const allocator_type& allocator)
+        : points_(other.points_, allocator), closed_(other.closed_)
+    {}
+    Bezier(Bezier&& other) noexcept
+        : Bezier(std::move(other), allocator_type())
+    {}
+    Bezier(Bezier&& other, const allocator_type& allocator)
+        : points_(std::move(other.points_), allocator), closed_(other.closed_)
+    {}
+    Bezier& operator=(const Bezier& other) = default;
+    Bezier& operator=(Bezier&& other) = default;
+
+    explicit Bezier(const Point& initial_point, const allocator_type& allocator = {})
+        : points_(1, initial_point, allocator)
     {}
-    explicit Bezier(const QPointF& initial_point)
-        : points_(1, initial_point)
+    explicit Bezier(const QPointF& initial_point, const allocator_type& allocator = {})
+        : points_(1, initial_point, allocator)
     {}
 
-    const std::vector<Point>& points() const { return points_; }
-    std::vector<Point>& points() { return points_; }
+    const PointList& points() const { return points_; }
+    PointList& points() { return points_; }
 
     int size() const { return points_.size(); }
     int closed_size() const { return points_.size() + (closed_ ? 1 : 0); }
@@ -213,7 +242,7 @@ private:
         return segment(p);
     }
 
-    std::vector<Point> points_;
+    PointList points_;
     bool closed_ = false;
 };
 
@@ -221,15 +250,35 @@ private:
 class MultiBezier
 {
 public:
-    const std::vector<Bezier>& beziers() const { return beziers_; }
-    std::vector<Bezier>& beziers() { return beziers_; }
+    using BezierList = std::pmr::vector<Bezier>;
+    using allocator_type = BezierList::allocator_type;
+
+    /*
+     * Same allocation rules as Bezier, the beziers in the list always use
+     * the allocator of the list
+     */
+    MultiBezier() = default;
+    explicit MultiBezier(const allocator_type& allocator)
+        : beziers_(allocator)
+    {}
+    MultiBezier(const MultiBezier& other)
+        : beziers_(other.beziers_, allocator_type()), at_end(other.at_end)
+    {}
+    MultiBezier(MultiBezier&& other) noexcept
+        : beziers_(std::move(other.beziers_), allocator_type()), at_end(other.at_end)
+    {}
+    MultiBezier& operator=(const MultiBezier& other) = default;
+    MultiBezier& operator=(MultiBezier&& other) = default;
+
+    const BezierList& beziers() const { return beziers_; }
+    BezierList& beziers() { return beziers_; }
 
     Bezier& back() { return beziers_.back(); }
     const Bezier& back() const { return beziers_.back(); }
 
     MultiBezier& move_to(const QPointF& p)
     {
-        beziers_.push_back(Bezier(p));
+        beziers_.emplace_back(p);
         at_end = false;
         return *this;
     }
@@ -302,14 +351,14 @@ private:
     {
         if ( at_end )
         {
-            beziers_.push_back(Bezier());
+            beziers_.emplace_back();
             if ( beziers_.size() > 1 )
                 beziers_.back().add_point(beziers_[beziers_.size()-2].points().back().pos);
             at_end = false;
         }
     }
 
-    std::vector<Bezier> beziers_;
+    BezierList beziers_;
     bool at_end = true;
 };
 
@@ -8,7 +8,8 @@
 
 
 
-glaxnimate::math::bezier::LengthData::LengthData(const Solver& segment, int steps)
+glaxnimate::math::bezier::LengthData::LengthData(const Solver& segment, int steps, std::pmr::memory_resource* resource)
+    : children_(resource)
 {
     if ( steps == 0 )
         return;
@@ -28,26 +29,28 @@ glaxnimate::math::bezier::LengthData::LengthData(const Solver& segment, int step
     }
 }
 
-glaxnimate::math::bezier::LengthData::LengthData(const Bezier& bez, int steps)
+glaxnimate::math::bezier::LengthData::LengthData(const Bezier& bez, int steps, std::pmr::memory_resource* resource)
+    : children_(resource)
 {
     children_.reserve(bez.size());
     int count = bez.segment_count();
 
     for ( int i = 0; i < count; i++ )
     {
-        children_.emplace_back(bez.segment(i), steps);
+        children_.emplace_back(bez.segment(i), steps, resource);
         length_ += children_.back().length_;
         children_.back().cumulative_length_ = length_;
     }
 }
 
-glaxnimate::math::bezier::LengthData::LengthData(const MultiBezier& mbez, int steps)
+glaxnimate::math::bezier::LengthData::LengthData(const MultiBezier& mbez, int steps, std::pmr::memory_resource* resource)
+    : children_(resource)
 {
     children_.reserve(mbez.size());
 
     for ( const auto& bez : mbez.beziers() )
     {
-        children_.emplace_back(bez, steps);
+        children_.emplace_back(bez, steps, resource);
         length_ += children_.back().length_;
         children_.back().cumulative_length_ = length_;
     }
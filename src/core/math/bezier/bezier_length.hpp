@@ -26,11 +26,15 @@ public:
         }
     };
 
-    explicit LengthData(const Solver& segment, int steps);
+    /**
+     * \brief Computes the length data for \p segment
+     * \param resource Memory resource for the children, eg: FrameArena::resource()
+     */
+    explicit LengthData(const Solver& segment, int steps, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
-    explicit LengthData(const Bezier& bez, int steps);
+    explicit LengthData(const Bezier& bez, int steps, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
-    explicit LengthData(const MultiBezier& mbez, int steps);
+    explicit LengthData(const MultiBezier& mbez, int steps, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
 
     SplitInfo at_ratio(qreal ratio) const;
@@ -61,7 +65,7 @@ private:
     qreal t_ = 0;
     qreal length_ = 0;
     qreal cumulative_length_ = 0;
-    std::vector<LengthData> children_;
+    std::pmr::vector<LengthData> children_;
     bool leaf_ = false;
 
 };
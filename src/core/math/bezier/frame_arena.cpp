@@ -0,0 +1,106 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "frame_arena.hpp"
+
+#include <memory>
+#include <optional>
+
+using namespace glaxnimate;
+
+namespace {
+
+/**
+ * \brief Forwards to the heap, keeping track of how much has been requested
+ */
+class OverflowResource : public std::pmr::memory_resource
+{
+public:
+    std::size_t allocated = 0;
+
+protected:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        allocated += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+    {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+struct ThreadArena
+{
+    static constexpr std::size_t initial_size = 64 * 1024;
+
+    void begin()
+    {
+        if ( !block )
+            block = std::make_unique<std::byte[]>(block_size);
+        overflow.allocated = 0;
+        buffer.emplace(block.get(), block_size, &overflow);
+    }
+
+    void end()
+    {
+        buffer.reset();
+
+        // Grow the block so the next frame fits in it
+        if ( overflow.allocated )
+        {
+            block_size += overflow.allocated;
+            block.reset();
+        }
+    }
+
+    int depth = 0;
+    std::size_t block_size = initial_size;
+    std::unique_ptr<std::byte[]> block;
+    OverflowResource overflow;
+    std::optional<std::pmr::monotonic_buffer_resource> buffer;
+};
+
+ThreadArena& thread_arena()
+{
+    thread_local ThreadArena arena;
+    return arena;
+}
+
+} // namespace
+
+thread_local std::pmr::memory_resource* math::bezier::FrameArena::current = nullptr;
+
+math::bezier::FrameArena::Scope::Scope()
+{
+    ThreadArena& arena = thread_arena();
+    if ( arena.depth++ == 0 )
+    {
+        arena.begin();
+        current = &*arena.buffer;
+    }
+}
+
+math::bezier::FrameArena::Scope::~Scope()
+{
+    ThreadArena& arena = thread_arena();
+    if ( --arena.depth == 0 )
+    {
+        current = nullptr;
+        arena.end();
+    }
+}
+
+std::size_t math::bezier::FrameArena::capacity()
+{
+    return thread_arena().block_size;
+}
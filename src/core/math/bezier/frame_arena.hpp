@@ -0,0 +1,55 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <memory_resource>
+
+namespace glaxnimate::math::bezier {
+
+/**
+ * \brief Per-thread arena for the temporary geometry created while rendering a frame
+ *
+ * While a Scope is alive, resource() returns a monotonic buffer for the current
+ * thread that is released when the outermost Scope ends.
+ * The buffer grows to the peak usage of previous frames so in the long run
+ * rendering a frame doesn't need heap allocations for geometry.
+ *
+ * Only the geometry evaluation code passes resource() explicitly to the
+ * temporary beziers and length data it creates, copies and moves of those
+ * allocate from the default resource so they can safely outlive the frame.
+ */
+class FrameArena
+{
+public:
+    class Scope
+    {
+    public:
+        Scope();
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    /**
+     * \brief Memory resource new geometry on the current thread should allocate from
+     */
+    static std::pmr::memory_resource* resource() noexcept
+    {
+        return current ? current : std::pmr::get_default_resource();
+    }
+
+    /**
+     * \brief Number of bytes reserved by the arena of the current thread
+     */
+    static std::size_t capacity();
+
+private:
+    static thread_local std::pmr::memory_resource* current;
+};
+
+} // namespace glaxnimate::math::bezier
@@ -0,0 +1,534 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "rasterizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "math/math.hpp"
+#include "math/bezier/frame_arena.hpp"
+
+using namespace glaxnimate;
+using namespace glaxnimate::math::bezier;
+
+namespace {
+
+// Maximum distance in pixels between a curve and its flattened polyline
+constexpr qreal device_tolerance = 0.2;
+constexpr int max_steps = 256;
+
+// Multiplies each 8 bit channel of x by a / 255
+inline QRgb byte_mul(QRgb x, uint a)
+{
+    uint t = (x & 0xff00ff) * a;
+    t = (t + ((t >> 8) & 0xff00ff) + 0x800080) >> 8;
+    t &= 0xff00ff;
+
+    x = ((x >> 8) & 0xff00ff) * a;
+    x = (x + ((x >> 8) & 0xff00ff) + 0x800080);
+    x &= 0xff00ff00;
+    return x | t;
+}
+
+QRgb premultiplied_color(const QColor& color, qreal opacity)
+{
+    QColor rgb = color.toRgb();
+    rgb.setAlphaF(qBound<qreal>(0, rgb.alphaF() * opacity, 1));
+    return qPremultiply(rgb.rgba());
+}
+
+QPointF unit(const QPointF& vector)
+{
+    qreal length = std::hypot(vector.x(), vector.y());
+    if ( length == 0 )
+        return {};
+    return vector / length;
+}
+
+void flatten_cubic(const QPointF& p0, const QPointF& p1, const QPointF& p2, const QPointF& p3, qreal tolerance, std::pmr::vector<QPointF>& out)
+{
+    // Wang's formula: number of lines keeping the distance from the curve within tolerance
+    QPointF d1 = p0 - 2 * p1 + p2;
+    QPointF d2 = p1 - 2 * p2 + p3;
+    qreal dd = std::max(std::hypot(d1.x(), d1.y()), std::hypot(d2.x(), d2.y()));
+    int steps = qBound(1, int(std::ceil(std::sqrt(0.75 * dd / tolerance))), max_steps);
+
+    for ( int i = 1; i < steps; i++ )
+    {
+        qreal t = qreal(i) / steps;
+        qreal u = 1 - t;
+        QPointF p = u*u*u * p0 + 3*u*u*t * p1 + 3*u*t*t * p2 + t*t*t * p3;
+        if ( p != out.back() )
+            out.push_back(p);
+    }
+
+    if ( p3 != out.back() )
+        out.push_back(p3);
+}
+
+} // namespace
+
+Rasterizer::Rasterizer(QImage& target, const QTransform& transform)
+    : target(target),
+    transform(transform),
+    polyline(FrameArena::resource()),
+    piece(FrameArena::resource()),
+    edges(FrameArena::resource()),
+    active(FrameArena::resource()),
+    crossings(FrameArena::resource()),
+    area(FrameArena::resource()),
+    cover(FrameArena::resource())
+{
+    auto format = target.format();
+    byte_order = format == QImage::Format_RGBA8888 || format == QImage::Format_RGBA8888_Premultiplied || format == QImage::Format_RGBX8888;
+    premultiplied = format != QImage::Format_ARGB32 && format != QImage::Format_RGBA8888;
+
+    // Upper bound of how much the transform stretches distances
+    qreal scale = std::sqrt(
+        transform.m11() * transform.m11() + transform.m12() * transform.m12() +
+        transform.m21() * transform.m21() + transform.m22() * transform.m22()
+    );
+    tolerance = scale > 0 ? device_tolerance / scale : 1;
+}
+
+bool Rasterizer::supported(const QImage& image)
+{
+    switch ( image.format() )
+    {
+        case QImage::Format_RGB32:
+        case QImage::Format_ARGB32:
+        case QImage::Format_ARGB32_Premultiplied:
+        case QImage::Format_RGBX8888:
+        case QImage::Format_RGBA8888:
+        case QImage::Format_RGBA8888_Premultiplied:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void Rasterizer::fill(const MultiBezier& shape, Qt::FillRule rule, const QColor& color, qreal opacity)
+{
+    for ( const auto& bezier : shape.beziers() )
+    {
+        flatten(bezier, polyline);
+        add_polygon(polyline.data(), polyline.size(), false);
+    }
+
+    render(rule, premultiplied_color(color, opacity));
+}
+
+void Rasterizer::stroke(const MultiBezier& shape, const QPen& pen, qreal opacity)
+{
+    for ( const auto& bezier : shape.beziers() )
+    {
+        flatten(bezier, polyline);
+        stroke_polyline(polyline, bezier.closed(), pen);
+    }
+
+    // All the pieces wind the same way so the non-zero rule gives their union
+    render(Qt::WindingFill, premultiplied_color(pen.color(), opacity));
+}
+
+QImage* Rasterizer::direct_target(QPainter* painter, const QBrush& brush)
+{
+    if ( brush.style() != Qt::SolidPattern )
+        return nullptr;
+
+    if ( painter->compositionMode() != QPainter::CompositionMode_SourceOver ||
+         painter->hasClipping() || !painter->testRenderHint(QPainter::Antialiasing) )
+        return nullptr;
+
+    QPaintDevice* device = painter->device();
+    if ( !device || device->devType() != QInternal::Image )
+        return nullptr;
+
+    // A shared image would be detached when accessing its pixels, away from the painter
+    auto image = static_cast<QImage*>(device);
+    if ( !supported(*image) || !image->isDetached() || image->devicePixelRatio() != 1 )
+        return nullptr;
+
+    if ( painter->combinedTransform().type() == QTransform::TxProject )
+        return nullptr;
+
+    return image;
+}
+
+bool Rasterizer::fill(QPainter* painter, const MultiBezier& shape, Qt::FillRule rule, const QBrush& brush)
+{
+    QImage* image = direct_target(painter, brush);
+    if ( !image )
+        return false;
+
+    Rasterizer(*image, painter->combinedTransform()).fill(shape, rule, brush.color(), painter->opacity());
+    return true;
+}
+
+bool Rasterizer::stroke(QPainter* painter, const MultiBezier& shape, const QPen& pen)
+{
+    if ( pen.style() != Qt::SolidLine || pen.isCosmetic() || pen.widthF() <= 0 )
+        return false;
+
+    QImage* image = direct_target(painter, pen.brush());
+    if ( !image )
+        return false;
+
+    Rasterizer(*image, painter->combinedTransform()).stroke(shape, pen, painter->opacity());
+    return true;
+}
+
+void Rasterizer::flatten(const Bezier& bezier, Polyline& out) const
+{
+    out.clear();
+    // Same as Bezier::add_to_painter_path()
+    if ( bezier.size() < 2 )
+        return;
+
+    out.push_back(bezier[0].pos);
+    int segments = bezier.closed() ? bezier.size() : bezier.size() - 1;
+    for ( int i = 0; i < segments; i++ )
+    {
+        const Point& start = bezier[i];
+        const Point& end = bezier[i + 1];
+        flatten_cubic(start.pos, start.tan_out, end.tan_in, end.pos, tolerance, out);
+    }
+
+    if ( bezier.closed() && out.size() > 1 && out.back() == out.front() )
+        out.pop_back();
+}
+
+void Rasterizer::add_polygon(const QPointF* points, int count, bool positive)
+{
+    if ( count < 3 )
+        return;
+
+    int winding = 1;
+    if ( positive )
+    {
+        qreal signed_area = 0;
+        for ( int i = 0, j = count - 1; i < count; j = i++ )
+            signed_area += points[j].x() * points[i].y() - points[i].x() * points[j].y();
+        if ( signed_area < 0 )
+            winding = -1;
+    }
+
+    QPointF previous = transform.map(points[count - 1]);
+    for ( int i = 0; i < count; i++ )
+    {
+        QPointF current = transform.map(points[i]);
+        add_edge(previous, current, winding);
+        previous = current;
+    }
+}
+
+void Rasterizer::add_edge(const QPointF& p1, const QPointF& p2, int winding)
+{
+    if ( p1.y() == p2.y() )
+        return;
+
+    if ( p1.y() < p2.y() )
+        edges.push_back({p1.y(), p2.y(), p1.x(), (p2.x() - p1.x()) / (p2.y() - p1.y()), winding});
+    else
+        edges.push_back({p2.y(), p1.y(), p2.x(), (p1.x() - p2.x()) / (p1.y() - p2.y()), -winding});
+}
+
+void Rasterizer::stroke_polyline(const Polyline& points, bool closed, const QPen& pen)
+{
+    int count = points.size();
+    if ( count < 2 )
+        return;
+
+    qreal half = pen.widthF() / 2;
+    int segments = closed ? count : count - 1;
+    QPointF first_dir;
+    QPointF previous_dir;
+    for ( int i = 0; i < segments; i++ )
+    {
+        const QPointF& start = points[i];
+        const QPointF& end = points[(i + 1) % count];
+        QPointF dir = unit(end - start);
+        QPointF normal(-dir.y() * half, dir.x() * half);
+        QPointF quad[4] = {start + normal, end + normal, end - normal, start - normal};
+        add_polygon(quad, 4, true);
+
+        if ( i == 0 )
+            first_dir = dir;
+        else
+            add_join(start, previous_dir, dir, pen);
+        previous_dir = dir;
+    }
+
+    if ( closed )
+    {
+        add_join(points[0], previous_dir, first_dir, pen);
+    }
+    else
+    {
+        add_cap(points[0], -first_dir, pen);
+        add_cap(points[count - 1], previous_dir, pen);
+    }
+}
+
+void Rasterizer::add_join(const QPointF& vertex, const QPointF& dir_in, const QPointF& dir_out, const QPen& pen)
+{
+    qreal cross = dir_in.x() * dir_out.y() - dir_in.y() * dir_out.x();
+    qreal dot = dir_in.x() * dir_out.x() + dir_in.y() * dir_out.y();
+    if ( qFuzzyIsNull(cross) && dot > 0 )
+        return;
+
+    // The gap to fill is on the side opposite to where the line turns
+    qreal half = pen.widthF() / 2;
+    qreal side = cross > 0 ? -half : half;
+    QPointF offset_in(-dir_in.y() * side, dir_in.x() * side);
+    QPointF offset_out(-dir_out.y() * side, dir_out.x() * side);
+
+    switch ( pen.joinStyle() )
+    {
+        case Qt::RoundJoin:
+            add_arc(vertex, offset_in, std::atan2(
+                offset_in.x() * offset_out.y() - offset_in.y() * offset_out.x(),
+                offset_in.x() * offset_out.x() + offset_in.y() * offset_out.y()
+            ));
+            return;
+
+        case Qt::MiterJoin:
+        case Qt::SvgMiterJoin:
+        {
+            // Ratio between the miter length and half the width is 1 / cos(angle / 2)
+            qreal cos_half = std::sqrt((1 + dot) / 2);
+            if ( cos_half > 0 && 1 / cos_half <= pen.miterLimit() )
+            {
+                QPointF tip = vertex + unit(offset_in + offset_out) * (half / cos_half);
+                QPointF quad[4] = {vertex, vertex + offset_in, tip, vertex + offset_out};
+                add_polygon(quad, 4, true);
+                return;
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    QPointF triangle[3] = {vertex, vertex + offset_in, vertex + offset_out};
+    add_polygon(triangle, 3, true);
+}
+
+void Rasterizer::add_cap(const QPointF& end, const QPointF& dir, const QPen& pen)
+{
+    qreal half = pen.widthF() / 2;
+    QPointF normal(-dir.y() * half, dir.x() * half);
+
+    switch ( pen.capStyle() )
+    {
+        case Qt::SquareCap:
+        {
+            QPointF extent = dir * half;
+            QPointF quad[4] = {end + normal, end + normal + extent, end - normal + extent, end - normal};
+            add_polygon(quad, 4, true);
+            break;
+        }
+
+        case Qt::RoundCap:
+            add_arc(end, normal, -math::pi);
+            break;
+
+        default:
+            break;
+    }
+}
+
+void Rasterizer::add_arc(const QPointF& center, const QPointF& from, qreal angle)
+{
+    qreal radius = std::hypot(from.x(), from.y());
+    if ( radius == 0 || angle == 0 )
+        return;
+
+    // Largest step keeping the chords within the flattening tolerance
+    qreal max_step = tolerance < radius ? 2 * std::acos(1 - tolerance / radius) : math::pi;
+    int steps = qBound(1, int(std::ceil(std::abs(angle) / max_step)), max_steps);
+
+    piece.clear();
+    piece.push_back(center);
+    for ( int i = 0; i <= steps; i++ )
+    {
+        qreal a = angle * i / steps;
+        qreal cos_a = std::cos(a);
+        qreal sin_a = std::sin(a);
+        piece.push_back(center + QPointF(from.x() * cos_a - from.y() * sin_a, from.x() * sin_a + from.y() * cos_a));
+    }
+
+    add_polygon(piece.data(), piece.size(), true);
+}
+
+void Rasterizer::render(Qt::FillRule rule, QRgb color)
+{
+    if ( edges.empty() || qAlpha(color) == 0 )
+    {
+        edges.clear();
+        return;
+    }
+
+    std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b){
+        return a.y_top < b.y_top;
+    });
+
+    qreal top = edges.front().y_top;
+    qreal bottom = top;
+    qreal left = edges.front().x_top;
+    qreal right = left;
+    for ( const auto& edge : edges )
+    {
+        qreal x_bottom = edge.x_top + (edge.y_bottom - edge.y_top) * edge.dxdy;
+        bottom = std::max(bottom, edge.y_bottom);
+        left = std::min({left, edge.x_top, x_bottom});
+        right = std::max({right, edge.x_top, x_bottom});
+    }
+
+    if ( !std::isfinite(top) || !std::isfinite(bottom) || !std::isfinite(left) || !std::isfinite(right) )
+    {
+        edges.clear();
+        return;
+    }
+
+    int row_begin = int(qBound<qreal>(0, std::floor(top), target.height()));
+    int row_end = int(qBound<qreal>(0, std::ceil(bottom), target.height()));
+    span_begin = int(qBound<qreal>(0, std::floor(left), target.width()));
+    span_end = int(qBound<qreal>(0, std::ceil(right), target.width()));
+    int width = span_end - span_begin;
+    if ( row_begin >= row_end || width <= 0 )
+    {
+        edges.clear();
+        return;
+    }
+
+    area.assign(width + 2, 0);
+    cover.assign(width + 2, 0);
+    dirty_begin = width;
+    dirty_end = 0;
+
+    const float weight = 1.f / subsamples;
+    std::size_t next = 0;
+    active.clear();
+    for ( int y = row_begin; y < row_end; y++ )
+    {
+        for ( int sub = 0; sub < subsamples; sub++ )
+        {
+            qreal sample_y = y + (sub + 0.5) / subsamples;
+
+            while ( next < edges.size() && edges[next].y_top <= sample_y )
+                active.push_back(int(next++));
+
+            active.erase(std::remove_if(active.begin(), active.end(), [this, sample_y](int index){
+                return edges[index].y_bottom <= sample_y;
+            }), active.end());
+
+            if ( active.empty() )
+                continue;
+
+            crossings.clear();
+            for ( int index : active )
+            {
+                const Edge& edge = edges[index];
+                crossings.push_back({edge.x_top + (sample_y - edge.y_top) * edge.dxdy, edge.winding});
+            }
+
+            std::sort(crossings.begin(), crossings.end(), [](const Crossing& a, const Crossing& b){
+                return a.x < b.x;
+            });
+
+            int winding = 0;
+            qreal span_start = 0;
+            for ( const auto& crossing : crossings )
+            {
+                bool was_inside = rule == Qt::WindingFill ? winding != 0 : (winding & 1);
+                winding += crossing.winding;
+                bool is_inside = rule == Qt::WindingFill ? winding != 0 : (winding & 1);
+
+                if ( !was_inside && is_inside )
+                    span_start = crossing.x;
+                else if ( was_inside && !is_inside )
+                    add_span(span_start, crossing.x, weight);
+            }
+        }
+
+        if ( dirty_begin < dirty_end )
+            blend_row(y, color);
+    }
+
+    edges.clear();
+}
+
+void Rasterizer::add_span(qreal x1, qreal x2, float weight)
+{
+    x1 = qBound<qreal>(span_begin, x1, span_end) - span_begin;
+    x2 = qBound<qreal>(span_begin, x2, span_end) - span_begin;
+    if ( x2 <= x1 )
+        return;
+
+    // Partial coverage goes in area, full pixels are a delta in cover
+    int first = int(x1);
+    int last = int(x2);
+    if ( first == last )
+    {
+        area[first] += (x2 - x1) * weight;
+    }
+    else
+    {
+        area[first] += (first + 1 - x1) * weight;
+        cover[first + 1] += weight;
+        cover[last] -= weight;
+        area[last] += (x2 - last) * weight;
+    }
+
+    dirty_begin = std::min(dirty_begin, first);
+    dirty_end = std::max(dirty_end, last + 1);
+}
+
+void Rasterizer::blend_row(int y, QRgb color)
+{
+    uchar* pixel = target.scanLine(y) + 4 * (span_begin + dirty_begin);
+    int end = std::min(dirty_end, span_end - span_begin);
+    float accumulated = 0;
+
+    for ( int i = dirty_begin; i < end; i++, pixel += 4 )
+    {
+        accumulated += cover[i];
+        int alpha = int(qBound(0.f, area[i] + accumulated, 1.f) * 255 + 0.5f);
+        if ( alpha == 0 )
+            continue;
+
+        QRgb source = alpha == 255 ? color : byte_mul(color, alpha);
+        if ( qAlpha(source) != 255 )
+        {
+            QRgb dest = byte_order ? qRgba(pixel[0], pixel[1], pixel[2], pixel[3]) : *reinterpret_cast<QRgb*>(pixel);
+            if ( !premultiplied )
+                dest = qPremultiply(dest);
+            source += byte_mul(dest, 255 - qAlpha(source));
+        }
+
+        if ( !premultiplied )
+            source = qUnpremultiply(source);
+
+        if ( byte_order )
+        {
+            pixel[0] = qRed(source);
+            pixel[1] = qGreen(source);
+            pixel[2] = qBlue(source);
+            pixel[3] = qAlpha(source);
+        }
+        else
+        {
+            *reinterpret_cast<QRgb*>(pixel) = source;
+        }
+    }
+
+    std::fill(area.begin() + dirty_begin, area.begin() + dirty_end + 1, 0.f);
+    std::fill(cover.begin() + dirty_begin, cover.begin() + dirty_end + 1, 0.f);
+    dirty_begin = span_end - span_begin;
+    dirty_end = 0;
+}
@@ -0,0 +1,136 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <memory_resource>
+
+#include <QImage>
+#include <QPainter>
+#include <QTransform>
+
+#include "math/bezier/bezier.hpp"
+
+namespace glaxnimate::math::bezier {
+
+/**
+ * \brief Anti-aliased scanline rasterizer that draws a MultiBezier directly on a QImage
+ *
+ * Curves are flattened to edges in device space, coverage is accumulated
+ * with exact horizontal span coverage on a few sub-scanlines per pixel row.
+ * Strokes are built as the non-zero union of segment quads, joins and caps,
+ * so no intermediate QPainterPath is created.
+ *
+ * Only solid colors are supported, the target must be a 32 bit RGB(A) image.
+ */
+class Rasterizer
+{
+public:
+    /**
+     * \brief Number of sub-scanlines sampled for each pixel row
+     */
+    static constexpr int subsamples = 16;
+
+    /**
+     * \param target    Image to draw on, must be supported()
+     * \param transform Maps shape coordinates to pixels, must be affine
+     */
+    explicit Rasterizer(QImage& target, const QTransform& transform = {});
+
+    /**
+     * \brief Whether \p image has a pixel format the rasterizer can write
+     */
+    static bool supported(const QImage& image);
+
+    /**
+     * \brief Fills \p shape with \p color using the source-over operator
+     */
+    void fill(const MultiBezier& shape, Qt::FillRule rule, const QColor& color, qreal opacity = 1);
+
+    /**
+     * \brief Strokes \p shape with the width, cap, join and color of \p pen
+     * \pre \p pen is a solid, non-cosmetic pen with a solid color brush
+     */
+    void stroke(const MultiBezier& shape, const QPen& pen, qreal opacity = 1);
+
+    /**
+     * \brief Fills \p shape on the image \p painter is drawing on
+     *
+     * Uses the painter transform and opacity
+     * \returns \b false if the result wouldn't match QPainter, in which case nothing is drawn
+     */
+    static bool fill(QPainter* painter, const MultiBezier& shape, Qt::FillRule rule, const QBrush& brush);
+
+    /**
+     * \brief Strokes \p shape on the image \p painter is drawing on
+     * \returns \b false if the result wouldn't match QPainter, in which case nothing is drawn
+     */
+    static bool stroke(QPainter* painter, const MultiBezier& shape, const QPen& pen);
+
+private:
+    struct Edge
+    {
+        qreal y_top;
+        qreal y_bottom;
+        qreal x_top;
+        qreal dxdy;
+        int winding;
+    };
+
+    struct Crossing
+    {
+        qreal x;
+        int winding;
+    };
+
+    using Polyline = std::pmr::vector<QPointF>;
+
+    /**
+     * \brief Image \p painter draws on if drawing \p brush on it directly gives the same result
+     */
+    static QImage* direct_target(QPainter* painter, const QBrush& brush);
+
+    /**
+     * \brief Replaces \p out with the flattened points of \p bezier, in shape coordinates
+     */
+    void flatten(const Bezier& bezier, Polyline& out) const;
+
+    /**
+     * \brief Adds the edges of a closed polygon in shape coordinates
+     * \param positive Whether the edges should wind the same way regardless of the polygon orientation
+     */
+    void add_polygon(const QPointF* points, int count, bool positive);
+    void add_edge(const QPointF& p1, const QPointF& p2, int winding);
+
+    void stroke_polyline(const Polyline& points, bool closed, const QPen& pen);
+    void add_join(const QPointF& vertex, const QPointF& dir_in, const QPointF& dir_out, const QPen& pen);
+    void add_cap(const QPointF& end, const QPointF& dir, const QPen& pen);
+    void add_arc(const QPointF& center, const QPointF& from, qreal angle);
+
+    void render(Qt::FillRule rule, QRgb color);
+    void add_span(qreal x1, qreal x2, float weight);
+    void blend_row(int y, QRgb color);
+
+    QImage& target;
+    QTransform transform;
+    bool byte_order;
+    bool premultiplied;
+    /// Maximum flattening error in shape coordinates
+    qreal tolerance;
+    Polyline polyline;
+    Polyline piece;
+    std::pmr::vector<Edge> edges;
+    std::pmr::vector<int> active;
+    std::pmr::vector<Crossing> crossings;
+    std::pmr::vector<float> area;
+    std::pmr::vector<float> cover;
+    int span_begin = 0;
+    int span_end = 0;
+    int dirty_begin = 0;
+    int dirty_end = 0;
+};
+
+} // namespace glaxnimate::math::bezier
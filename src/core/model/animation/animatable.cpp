@@ -139,6 +139,20 @@ std::unique_ptr<glaxnimate::model::KeyframeBase::KeyframeSplitter> glaxnimate::m
     return std::make_unique<PointKeyframeSplitter>(this, static_cast<const Keyframe<QPointF>*>(other));
 }
 
+glaxnimate::model::AnimatableBase::AnimatableBase(Object* object, const QString& name, PropertyTraits traits)
+    : BaseProperty(object, name, traits)
+{
+    if ( !object )
+        return;
+
+    // Keyframe edits away from the current time don't change the value
+    auto edited = [this]{ keyframes_changed(); };
+    connect(this, &AnimatableBase::keyframe_added, this, edited);
+    connect(this, &AnimatableBase::keyframe_removed, this, edited);
+    connect(this, &AnimatableBase::keyframe_updated, this, edited);
+    connect(this, &AnimatableBase::keyframe_transition_changed, this, edited);
+}
+
 bool glaxnimate::model::AnimatableBase::assign_from(const model::BaseProperty* prop)
 {
     if ( prop->traits().flags != traits().flags || prop->traits().type != traits().type )
@@ -154,9 +168,9 @@ bool glaxnimate::model::AnimatableBase::assign_from(const model::BaseProperty* p
     for ( int i = 0, e = other->keyframe_count(); i < e; i++ )
     {
         const KeyframeBase* kf_other = other->keyframe(i);
-        KeyframeBase* kf = set_keyframe(kf_other->time(), kf_other->value());
-        if ( kf )
-            kf->set_transition(kf_other->transition());
+        SetKeyframeInfo info;
+        if ( set_keyframe(kf_other->time(), kf_other->value(), &info) )
+            set_keyframe_transition(info.index, kf_other->transition());
     }
 
     return true;
@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <limits>
 #include <iterator>
 
@@ -35,12 +36,14 @@ private:
 
 namespace glaxnimate::model {
 
-class KeyframeBase : public QObject
+/**
+ * \brief Plain keyframe data, owned by the property it belongs to
+ *
+ * Keyframes are stored by value in their property so they don't emit any signal,
+ * changes are notified by the owning AnimatableBase.
+ */
+class KeyframeBase
 {
-    Q_OBJECT
-
-    Q_PROPERTY(QVariant value READ value)
-    Q_PROPERTY(double time READ time)
 public:
     explicit KeyframeBase(FrameTime time) : time_ { time } {}
     virtual ~KeyframeBase() = default;
@@ -56,10 +59,13 @@ public:
      */
     const KeyframeTransition& transition() const { return transition_; }
 
+    /**
+     * \brief Sets the transition without notifying anything
+     * \see AnimatableBase::set_keyframe_transition()
+     */
     void set_transition(const KeyframeTransition& trans)
     {
         transition_ = trans;
-        emit transition_changed(transition_.before_descriptive(), transition_.after_descriptive());
     }
 
     void stretch_time(qreal multiplier)
@@ -85,10 +91,12 @@ public:
         return clone;
     }
 
-signals:
-    void transition_changed(KeyframeTransition::Descriptive before, KeyframeTransition::Descriptive after);
-
 protected:
+    KeyframeBase(const KeyframeBase&) = default;
+    KeyframeBase(KeyframeBase&&) = default;
+    KeyframeBase& operator=(const KeyframeBase&) = default;
+    KeyframeBase& operator=(KeyframeBase&&) = default;
+
     virtual std::unique_ptr<KeyframeBase> do_clone() const = 0;
 
     class KeyframeSplitter
@@ -146,7 +154,7 @@ public:
         model::KeyframeTransition to_next;
     };
 
-    using BaseProperty::BaseProperty;
+    AnimatableBase(Object* object, const QString& name, PropertyTraits traits);
 
     virtual ~AnimatableBase() = default;
 
@@ -161,6 +169,8 @@ public:
      * \return the Corresponding keyframe or nullptr if not found
      *
      * keyframe(i).time() < keyframe(j).time() <=> i < j
+     *
+     * \note The returned pointer is invalidated when keyframes are added or removed
      */
     virtual const KeyframeBase* keyframe(int i) const = 0;
     virtual KeyframeBase* keyframe(int i) = 0;
@@ -243,6 +253,21 @@ public:
         return false;
     }
 
+    /**
+     * \brief Set the transition for the given keyframe
+     * \post emits keyframe_transition_changed()
+     */
+    bool set_keyframe_transition(int keyframe_index, const KeyframeTransition& transition)
+    {
+        auto kf = keyframe(keyframe_index);
+        if ( !kf )
+            return false;
+
+        kf->set_transition(transition);
+        emit keyframe_transition_changed(keyframe_index, transition.before_descriptive(), transition.after_descriptive());
+        return true;
+    }
+
     /**
      * \brief Whether it has multiple keyframes
      */
@@ -262,15 +287,29 @@ public:
     {
         auto kfcount = keyframe_count();
 
-        for ( int i = 0; i < kfcount; i++ )
+        // Binary search for the first keyframe with time >= time
+        int first = 0;
+        int count = kfcount;
+        while ( count > 0 )
         {
-            auto kftime = keyframe(i)->time();
-            if ( kftime == time )
-                return i;
-            else if ( kftime > time )
-                return std::max(0, i-1);
+            int step = count / 2;
+            int mid = first + step;
+            if ( keyframe(mid)->time() < time )
+            {
+                first = mid + 1;
+                count -= step + 1;
+            }
+            else
+            {
+                count = step;
+            }
         }
-        return kfcount - 1;
+
+        if ( first == kfcount )
+            return kfcount - 1;
+        if ( keyframe(first)->time() == time )
+            return first;
+        return std::max(0, first - 1);
     }
 
     int keyframe_index(KeyframeBase* kf) const
@@ -320,6 +359,7 @@ signals:
     void keyframe_added(int index, KeyframeBase* keyframe);
     void keyframe_removed(int index);
     void keyframe_updated(int index, KeyframeBase* keyframe);
+    void keyframe_transition_changed(int index, KeyframeTransition::Descriptive before, KeyframeTransition::Descriptive after);
 
 protected:
     virtual void on_set_time(FrameTime time) = 0;
@@ -539,8 +579,8 @@ public:
         iterator(const AnimatedProperty* prop, int index) noexcept
         : prop(prop), index(index) {}
 
-        reference operator*() const { return *prop->keyframes_[index]; }
-        pointer operator->() const { return prop->keyframes_[index].get(); }
+        reference operator*() const { return prop->keyframes_[index]; }
+        pointer operator->() const { return &prop->keyframes_[index]; }
 
         bool operator==(const iterator& other) const noexcept
         {
@@ -643,14 +683,14 @@ public:
     {
         if ( i < 0 || i >= int(keyframes_.size()) )
             return nullptr;
-        return keyframes_[i].get();
+        return &keyframes_[i];
     }
 
     keyframe_type* keyframe(int i) override
     {
         if ( i < 0 || i >= int(keyframes_.size()) )
             return nullptr;
-        return keyframes_[i].get();
+        return &keyframes_[i];
     }
 
     QVariant value() const override
@@ -692,7 +732,7 @@ public:
     {
         for ( auto it = keyframes_.begin(); it != keyframes_.end(); ++it )
         {
-            if ( (*it)->time() == time )
+            if ( it->time() == time )
             {
                 int index = it - keyframes_.begin();
                 keyframes_.erase(it);
@@ -735,11 +775,11 @@ public:
             value_ = value;
             this->value_changed();
             emitter(this->object(), value_);
-            keyframes_.push_back(std::make_unique<keyframe_type>(time, value));
-            emit this->keyframe_added(0, keyframes_.back().get());
+            keyframes_.emplace_back(time, value);
+            emit this->keyframe_added(0, &keyframes_.back());
             if ( info )
                 *info = {true, 0};
-            return keyframes_.back().get();
+            return &keyframes_.back();
         }
 
         // Current time, update value_
@@ -768,24 +808,21 @@ public:
         // First keyframe not at 0, might have to add the new keyframe at 0
         if ( index == 0 && kf->time() > time )
         {
-            keyframes_.insert(keyframes_.begin(), std::make_unique<keyframe_type>(time, value));
-            emit this->keyframe_added(0, keyframes_.front().get());
+            keyframes_.emplace(keyframes_.begin(), time, value);
+            emit this->keyframe_added(0, &keyframes_.front());
             on_keyframe_updated(time, -1, 1);
             if ( info )
                 *info = {true, 0};
-            return keyframes_.front().get();
+            return &keyframes_.front();
         }
 
         // Insert somewhere in the middle
-        auto it = keyframes_.insert(
-            keyframes_.begin() + index + 1,
-            std::make_unique<keyframe_type>(time, value)
-        );
-        emit this->keyframe_added(index + 1, it->get());
+        auto it = keyframes_.emplace(keyframes_.begin() + index + 1, time, value);
+        emit this->keyframe_added(index + 1, &*it);
         on_keyframe_updated(time, index, index+2);
         if ( info )
             *info = {true, index+1};
-        return it->get();
+        return &keyframes_[index + 1];
     }
 
     value_type get() const
@@ -813,14 +850,14 @@ public:
         int new_index = 0;
         for ( ; new_index < int(keyframes_.size()); new_index++ )
         {
-            if ( keyframes_[new_index]->time() > time )
+            if ( keyframes_[new_index].time() > time )
                 break;
         }
 
         if ( new_index > keyframe_index )
             new_index--;
 
-        keyframes_[keyframe_index]->set_time(time);
+        keyframes_[keyframe_index].set_time(time);
 
         if ( keyframe_index != new_index )
         {
@@ -828,16 +865,18 @@ public:
             QPointF incoming(-1, -1);
             if ( keyframe_index > 0 )
             {
-                auto trans_before_src = keyframes_[keyframe_index - 1]->transition();
+                auto trans_before_src = keyframes_[keyframe_index - 1].transition();
                 incoming = trans_before_src.after();
-                trans_before_src.set_after(keyframes_[keyframe_index]->transition().after());
-                keyframes_[keyframe_index - 1]->set_transition(trans_before_src);
+                trans_before_src.set_after(keyframes_[keyframe_index].transition().after());
+                this->set_keyframe_transition(keyframe_index - 1, trans_before_src);
             }
 
 
-            auto move = std::move(keyframes_[keyframe_index]);
-            keyframes_.erase(keyframes_.begin() + keyframe_index);
-            keyframes_.insert(keyframes_.begin() + new_index, std::move(move));
+            // Shift the keyframes in between rather than erasing and inserting
+            if ( new_index > keyframe_index )
+                std::rotate(keyframes_.begin() + keyframe_index, keyframes_.begin() + keyframe_index + 1, keyframes_.begin() + new_index + 1);
+            else
+                std::rotate(keyframes_.begin() + new_index, keyframes_.begin() + keyframe_index, keyframes_.begin() + keyframe_index + 1);
 
             int ia = keyframe_index;
             int ib = new_index;
@@ -846,26 +885,26 @@ public:
 
             if ( new_index > 0 )
             {
-                auto trans_before_dst = keyframes_[new_index - 1]->transition();
+                auto trans_before_dst = keyframes_[new_index - 1].transition();
                 QPointF outgoing = trans_before_dst.after();
 
                 if ( incoming.x() != -1 )
                 {
                     trans_before_dst.set_after(incoming);
-                    keyframes_[new_index - 1]->set_transition(trans_before_dst);
+                    this->set_keyframe_transition(new_index - 1, trans_before_dst);
                 }
 
-                auto trans_moved = keyframes_[new_index]->transition();
+                auto trans_moved = keyframes_[new_index].transition();
                 trans_moved.set_after(outgoing);
-                keyframes_[new_index]->set_transition(trans_moved);
+                this->set_keyframe_transition(new_index, trans_moved);
             }
 
             for ( ; ia <= ib; ia++ )
-                emit this->keyframe_updated(ia, keyframes_[ia].get());
+                emit this->keyframe_updated(ia, &keyframes_[ia]);
         }
         else
         {
-            emit this->keyframe_updated(keyframe_index, keyframes_[keyframe_index].get());
+            emit this->keyframe_updated(keyframe_index, &keyframes_[keyframe_index]);
         }
 
         return new_index;
@@ -878,8 +917,8 @@ public:
     {
         for ( std::size_t i = 0; i < keyframes_.size(); i++ )
         {
-            keyframes_[i]->stretch_time(multiplier);
-            emit keyframe_updated(i, keyframes_[i].get());
+            keyframes_[i].stretch_time(multiplier);
+            emit keyframe_updated(i, &keyframes_[i]);
         }
 
         current_time *= multiplier;
@@ -907,13 +946,13 @@ protected:
             if ( kf_time > cur_time )
             {
                 // if the modified keyframe is far ahead => don't update value_
-                if ( prev_index >= 0 && keyframes_[prev_index]->time() > cur_time )
+                if ( prev_index >= 0 && keyframes_[prev_index].time() > cur_time )
                     return;
             }
             else
             {
                 // if the modified keyframe is far behind => don't update value_
-                if ( next_index < int(keyframes_.size()) && keyframes_[next_index]->time() < cur_time )
+                if ( next_index < int(keyframes_.size()) && keyframes_[next_index].time() < cur_time )
                     return;
             }
         }
@@ -956,7 +995,8 @@ protected:
     }
 
     value_type value_;
-    std::vector<std::unique_ptr<keyframe_type>> keyframes_;
+    /// Stored contiguously so interpolation doesn't chase pointers
+    std::vector<keyframe_type> keyframes_;
     bool mismatched_ = false;
     PropertyCallback<void, Type> emitter;
 };
@@ -98,7 +98,7 @@ glaxnimate::model::Bitmap * glaxnimate::model::Assets::add_image_file(const QStr
 {
     auto image = std::make_unique<glaxnimate::model::Bitmap>(document());
     image->filename.set(filename);
-    if ( image->pixmap().isNull() )
+    if ( image->size().isEmpty() )
         return nullptr;
     image->embed(embed);
     auto ptr = image.get();
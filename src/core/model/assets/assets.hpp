@@ -11,6 +11,7 @@
 #include "model/property/sub_object_property.hpp"
 #include "named_color.hpp"
 #include "bitmap.hpp"
+#include "bitmap_store.hpp"
 #include "gradient.hpp"
 #include "composition.hpp"
 #include "embedded_font.hpp"
@@ -207,6 +208,7 @@ public:
     QString type_name_human() const override { return tr("Assets"); }
 
     NetworkDownloader network_downloader;
+    BitmapStore bitmap_store;
 };
 
 } // namespace glaxnimate::model
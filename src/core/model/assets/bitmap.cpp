@@ -5,10 +5,14 @@
  */
 
 #include "bitmap.hpp"
+
+#include <cmath>
+
 #include <QPainter>
 #include <QImageWriter>
 #include <QImageReader>
 #include <QFileInfo>
+#include <QFile>
 #include <QBuffer>
 #include <QUrl>
 
@@ -20,16 +24,41 @@ GLAXNIMATE_OBJECT_IMPL(glaxnimate::model::Bitmap)
 
 void glaxnimate::model::Bitmap::paint(QPainter* painter) const
 {
-    painter->drawPixmap(0, 0, image);
+    if ( !entry || entry->null() )
+        return;
+
+    // Pick a downscaled copy when drawing thumbnails / low resolution renders
+    QTransform trans = painter->worldTransform();
+    qreal scale = qMax(std::hypot(trans.m11(), trans.m12()), std::hypot(trans.m21(), trans.m22()));
+    int level = entry->mip_level(scale);
+    if ( level == 0 )
+        painter->drawImage(0, 0, entry->image());
+    else
+        painter->drawImage(QRectF(QPointF(0, 0), entry->size()), entry->mip(level));
 }
 
-void glaxnimate::model::Bitmap::refresh(bool rebuild_embedded)
+void glaxnimate::model::Bitmap::set_entry(const QByteArray& encoded)
 {
-    QImageReader reader;
-    QImage qimage;
+    if ( encoded.isEmpty() )
+        entry.reset();
+    else
+        entry = document()->assets()->bitmap_store.get(encoded);
 
-    bool load_data = true;
+    if ( entry )
+    {
+        format.set(entry->format());
+        width.set(entry->size().width());
+        height.set(entry->size().height());
+    }
+    else
+    {
+        width.set(0);
+        height.set(0);
+    }
+}
 
+void glaxnimate::model::Bitmap::refresh(bool rebuild_embedded)
+{
     if ( rebuild_embedded || data.get().isEmpty() )
     {
         if ( !filename.get().isEmpty() )
@@ -37,29 +66,21 @@ void glaxnimate::model::Bitmap::refresh(bool rebuild_embedded)
             QFileInfo finfo = file_info();
             if ( !finfo.isFile() )
                 return;
-            reader.setFileName(finfo.absoluteFilePath());
-            format.set(reader.format());
-            qimage = reader.read();
-            if ( rebuild_embedded && embedded() )
-                data.set(build_embedded(qimage));
-            load_data = false;
+            QFile file(finfo.absoluteFilePath());
+            if ( !file.open(QIODevice::ReadOnly) )
+                return;
+            set_entry(file.readAll());
+            if ( rebuild_embedded && embedded() && entry )
+                data.set(entry->data());
+            emit loaded();
+            return;
         }
         else if ( !url.get().isEmpty() )
         {
             document()->assets()->network_downloader.get(url.get(), [this, rebuild_embedded](QByteArray response){
-                QImageReader reader;
-                QImage qimage;
-                QBuffer buf(&response);
-                buf.open(QIODevice::ReadOnly);
-                reader.setDevice(&buf);
-                format.set(reader.format());
-                qimage = reader.read();
-                if ( rebuild_embedded && embedded() )
-                    data.set(build_embedded(qimage));
-
-                image = QPixmap::fromImage(qimage);
-                width.set(image.width());
-                height.set(image.height());
+                set_entry(response);
+                if ( rebuild_embedded && embedded() && entry )
+                    data.set(entry->data());
 
                 document()->graphics_invalidated();
                 emit loaded();
@@ -68,18 +89,7 @@ void glaxnimate::model::Bitmap::refresh(bool rebuild_embedded)
         }
     }
 
-    if ( load_data )
-    {
-        QBuffer buf(const_cast<QByteArray*>(&data.get()));
-        buf.open(QIODevice::ReadOnly);
-        reader.setDevice(&buf);
-        format.set(reader.format());
-        qimage = reader.read();
-    }
-
-    image = QPixmap::fromImage(qimage);
-    width.set(image.width());
-    height.set(image.height());
+    set_entry(data.get());
 
     emit loaded();
 }
@@ -107,7 +117,7 @@ void glaxnimate::model::Bitmap::embed(bool embedded)
     if ( !embedded )
         data.set_undoable({});
     else
-        data.set_undoable(build_embedded(image.toImage()));
+        data.set_undoable(image_data());
 }
 
 void glaxnimate::model::Bitmap::on_refresh()
@@ -117,7 +127,13 @@ void glaxnimate::model::Bitmap::on_refresh()
 
 QIcon glaxnimate::model::Bitmap::instance_icon() const
 {
-    return image;
+    if ( !entry || entry->null() )
+        return {};
+
+    // Icons are small, no need to keep them at full resolution
+    static constexpr qreal icon_size = 128;
+    int max_size = qMax(entry->size().width(), entry->size().height());
+    return QPixmap::fromImage(entry->mip(entry->mip_level(icon_size / max_size)));
 }
 
 bool glaxnimate::model::Bitmap::from_url(const QUrl& url)
@@ -136,7 +152,7 @@ bool glaxnimate::model::Bitmap::from_url(const QUrl& url)
 bool glaxnimate::model::Bitmap::from_file(const QString& file)
 {
     filename.set(file);
-    return !image.isNull();
+    return !size().isEmpty();
 }
 
 bool glaxnimate::model::Bitmap::from_base64(const QString& data)
@@ -155,7 +171,7 @@ bool glaxnimate::model::Bitmap::from_base64(const QString& data)
     auto decoded = QByteArray::fromBase64(chunks[1].toLatin1());
     format.set(formats[0]);
     this->data.set(decoded);
-    return !image.isNull();
+    return !size().isEmpty();
 }
 
 
@@ -169,7 +185,7 @@ bool glaxnimate::model::Bitmap::from_raw_data(const QByteArray& data)
 
     this->format.set(format);
     this->data.set(data);
-    return !image.isNull();
+    return !size().isEmpty();
 
 }
 
@@ -237,10 +253,25 @@ QByteArray glaxnimate::model::Bitmap::image_data() const
     if ( !data.get().isEmpty() )
         return data.get();
 
-    if ( image.isNull() )
+    if ( !entry )
         return {};
 
-    return build_embedded(image.toImage());
+    return entry->data();
+}
+
+const QPixmap & glaxnimate::model::Bitmap::pixmap() const
+{
+    static const QPixmap null;
+    if ( !entry )
+        return null;
+    return entry->pixmap();
+}
+
+QImage glaxnimate::model::Bitmap::get_image() const
+{
+    if ( !entry )
+        return {};
+    return entry->image();
 }
 
 QSize glaxnimate::model::Bitmap::size() const
@@ -12,6 +12,7 @@
 #include <QUrl>
 
 #include "model/assets/asset.hpp"
+#include "model/assets/bitmap_store.hpp"
 
 namespace glaxnimate::model {
 
@@ -52,15 +53,25 @@ public:
 
     QFileInfo file_info() const;
 
-    const QPixmap& pixmap() const { return image; }
+    /**
+     * \brief Full resolution pixmap
+     * \note The image is decoded on first access
+     */
+    const QPixmap& pixmap() const;
     void set_pixmap(const QImage& qimage, const QString& format);
 
     bool remove_if_unused(bool clean_lists) override;
 
-    QImage get_image() const
-    {
-        return image.toImage();
-    }
+    /**
+     * \brief Full resolution image
+     * \note The image is decoded on first access
+     */
+    QImage get_image() const;
+
+    /**
+     * \brief Shared decoded data from the document bitmap store
+     */
+    const BitmapStore::EntryPtr& store_entry() const { return entry; }
 
     /**
      * \brief If `embedded()` returns `data`, otherwise tries to load the data based on filename
@@ -76,6 +87,7 @@ public slots:
 
 private:
     QByteArray build_embedded(const QImage& img) const;
+    void set_entry(const QByteArray& encoded);
 
 private slots:
     void on_refresh();
@@ -84,7 +96,7 @@ signals:
     void loaded();
 
 private:
-    QPixmap image;
+    BitmapStore::EntryPtr entry;
 
 };
 
@@ -0,0 +1,140 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "bitmap_store.hpp"
+
+#include <cmath>
+
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QImageReader>
+
+glaxnimate::model::BitmapStore::Entry::Entry(QByteArray key, QByteArray data)
+    : key_(std::move(key)), data_(std::move(data))
+{
+    QBuffer buf(&data_);
+    buf.open(QIODevice::ReadOnly);
+    QImageReader reader(&buf);
+    format_ = reader.format();
+    size_ = reader.size();
+
+    // Some formats can't tell the size without decoding
+    if ( !size_.isValid() )
+    {
+        buf.close();
+        decode();
+        size_ = mips[0].size();
+    }
+}
+
+void glaxnimate::model::BitmapStore::Entry::decode() const
+{
+    std::lock_guard lock(mutex);
+    if ( decoded_ )
+        return;
+
+    QBuffer buf(const_cast<QByteArray*>(&data_));
+    buf.open(QIODevice::ReadOnly);
+    QImageReader reader(&buf);
+    mips.assign(1, reader.read());
+    decoded_ = true;
+}
+
+bool glaxnimate::model::BitmapStore::Entry::decoded() const
+{
+    std::lock_guard lock(mutex);
+    return decoded_;
+}
+
+QImage glaxnimate::model::BitmapStore::Entry::image() const
+{
+    std::lock_guard lock(mutex);
+    decode();
+    return mips[0];
+}
+
+const QPixmap & glaxnimate::model::BitmapStore::Entry::pixmap() const
+{
+    std::lock_guard lock(mutex);
+    if ( pixmap_.isNull() )
+        pixmap_ = QPixmap::fromImage(image());
+    return pixmap_;
+}
+
+QImage glaxnimate::model::BitmapStore::Entry::mip(int level) const
+{
+    std::lock_guard lock(mutex);
+    decode();
+
+    level = qBound(0, level, mip_level(0));
+    while ( int(mips.size()) <= level )
+    {
+        QImage prev = mips.back();
+        // Halving one level at a time keeps the filtering quality without resampling the full image
+        QSize size(qMax(1, prev.width() / 2), qMax(1, prev.height() / 2));
+        mips.push_back(prev.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+    }
+    return mips[level];
+}
+
+int glaxnimate::model::BitmapStore::Entry::mip_level(qreal scale) const
+{
+    int max_size = qMax(size_.width(), size_.height());
+    if ( max_size <= 1 )
+        return 0;
+
+    // Smallest level that still has at least one pixel along the longest side
+    int max_level = std::floor(std::log2(max_size));
+    if ( scale <= 0 )
+        return max_level;
+
+    if ( scale >= 1 )
+        return 0;
+
+    return qBound(0, int(std::floor(std::log2(1 / scale))), max_level);
+}
+
+glaxnimate::model::BitmapStore::EntryPtr glaxnimate::model::BitmapStore::get(const QByteArray& data)
+{
+    QByteArray key = hash(data);
+
+    std::lock_guard lock(mutex);
+
+    auto it = entries.find(key);
+    if ( it != entries.end() )
+    {
+        if ( auto entry = it->second.lock() )
+            return entry;
+    }
+
+    // Drop entries for images nobody uses anymore
+    for ( auto iter = entries.begin(); iter != entries.end(); )
+    {
+        if ( iter->second.expired() )
+            iter = entries.erase(iter);
+        else
+            ++iter;
+    }
+
+    auto entry = std::make_shared<const Entry>(key, data);
+    entries[key] = entry;
+    return entry;
+}
+
+int glaxnimate::model::BitmapStore::size() const
+{
+    std::lock_guard lock(mutex);
+    int count = 0;
+    for ( const auto& p : entries )
+        if ( !p.second.expired() )
+            count++;
+    return count;
+}
+
+QByteArray glaxnimate::model::BitmapStore::hash(const QByteArray& data)
+{
+    return QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+}
@@ -0,0 +1,121 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <QByteArray>
+#include <QImage>
+#include <QPixmap>
+#include <QSize>
+
+namespace glaxnimate::model {
+
+/**
+ * \brief Document-level storage for encoded image data, keyed by content hash
+ *
+ * Bitmaps with the same bytes share a single entry, so they are only kept in
+ * memory and decoded once.
+ */
+class BitmapStore
+{
+public:
+    /**
+     * \brief Encoded image data with lazily decoded image and mip levels
+     */
+    class Entry
+    {
+    public:
+        Entry(QByteArray key, QByteArray data);
+
+        const QByteArray& key() const { return key_; }
+
+        /**
+         * \brief Encoded bytes as read from the file / embedded data
+         */
+        const QByteArray& data() const { return data_; }
+
+        /**
+         * \brief Format as detected by QImageReader
+         */
+        const QByteArray& format() const { return format_; }
+
+        /**
+         * \brief Image size, available without decoding the full image
+         */
+        QSize size() const { return size_; }
+
+        bool null() const { return size_.isEmpty(); }
+
+        /**
+         * \brief Full resolution image, decoded on first access
+         *
+         * Returned by value as other threads can add mip levels at any time
+         */
+        QImage image() const;
+
+        /**
+         * \brief Full resolution image as a pixmap, converted on first access
+         */
+        const QPixmap& pixmap() const;
+
+        /**
+         * \brief Image downscaled by a factor of 2^level, generated on demand
+         * \note Level 0 is the full resolution image
+         */
+        QImage mip(int level) const;
+
+        /**
+         * \brief Returns the mip level best suited to be drawn with the given scale factor
+         */
+        int mip_level(qreal scale) const;
+
+        /**
+         * \brief Whether the full image has been decoded
+         */
+        bool decoded() const;
+
+    private:
+        void decode() const;
+
+        QByteArray key_;
+        QByteArray data_;
+        QByteArray format_;
+        QSize size_;
+        mutable std::recursive_mutex mutex;
+        mutable bool decoded_ = false;
+        mutable QPixmap pixmap_;
+        /// mips[0] is the full image
+        mutable std::vector<QImage> mips;
+    };
+
+    using EntryPtr = std::shared_ptr<const Entry>;
+
+    /**
+     * \brief Returns the entry for the given data, creating it if needed
+     */
+    EntryPtr get(const QByteArray& data);
+
+    /**
+     * \brief Number of distinct images currently in use
+     */
+    int size() const;
+
+    /**
+     * \brief Content hash used as key for \p data
+     */
+    static QByteArray hash(const QByteArray& data);
+
+private:
+    std::unordered_map<QByteArray, std::weak_ptr<const Entry>> entries;
+    mutable std::mutex mutex;
+};
+
+} // namespace glaxnimate::model
@@ -14,6 +14,18 @@ using namespace glaxnimate;
 
 GLAXNIMATE_OBJECT_IMPL(glaxnimate::model::Composition)
 
+glaxnimate::model::Composition::Composition(Document* document)
+    : VisualNode(document)
+{
+    // Layer time invariance depends on the composition range
+    auto invalidate_layers = [this]{
+        for ( auto layer : docnode_find_by_type<Layer>() )
+            layer->docnode_invalidate_time_invariant();
+    };
+    connect(animation.get(), &AnimationContainer::first_frame_changed, this, invalidate_layers);
+    connect(animation.get(), &AnimationContainer::last_frame_changed, this, invalidate_layers);
+}
+
 QIcon glaxnimate::model::Composition::tree_icon() const
 {
     return QIcon::fromTheme("video-x-generic");
@@ -59,20 +71,25 @@ QImage glaxnimate::model::Composition::render_image(float time, QSize image_size
     if ( !image_size.isValid() )
         image_size = real_size.toSize();
     QImage image(image_size, QImage::Format_RGBA8888);
+    render_into(image, time, background);
+    return image;
+}
+
+void glaxnimate::model::Composition::render_into(QImage& image, FrameTime time, const QColor& background) const
+{
     if ( !background.isValid() )
         image.fill(Qt::transparent);
     else
         image.fill(background);
 
+    QSizeF real_size = size();
     QPainter painter(&image);
     painter.setRenderHint(QPainter::Antialiasing);
     painter.scale(
-        image_size.width() / real_size.width(),
-        image_size.height() / real_size.height()
+        image.width() / real_size.width(),
+        image.height() / real_size.height()
     );
     paint(&painter, time, VisualNode::Render);
-
-    return image;
 }
 
 QImage glaxnimate::model::Composition::render_image() const
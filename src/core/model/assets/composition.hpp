@@ -30,7 +30,7 @@ class Composition : public VisualNode, public AssetBase
     Q_PROPERTY(QRectF rect READ rect)
 
 public:
-    using VisualNode::VisualNode;
+    explicit Composition(Document* document);
 
     utils::Range<Layer::ChildLayerIterator> top_level() const
     {
@@ -64,6 +64,12 @@ public:
     Q_INVOKABLE QImage render_image(float time, QSize size = {}, const QColor& background = {}) const;
     Q_INVOKABLE QImage render_image() const;
 
+    /**
+     * \brief Renders the frame at \p time into an existing image, scaling to fit its size
+     * \param background If valid, the image is filled with it, otherwise the image is cleared
+     */
+    void render_into(QImage& image, FrameTime time, const QColor& background = {}) const;
+
 signals:
     void fps_changed(float fps);
     void width_changed(int);
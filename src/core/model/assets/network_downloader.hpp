@@ -105,7 +105,8 @@ signals:
     void download_finished();
 
 private:
-    QNetworkAccessManager manager;
+    // Child so it follows the downloader to other threads
+    QNetworkAccessManager manager{this};
     std::unordered_map<QObject*, PendingRequest> pending;
     qint64 total = 0;
     qint64 received = 0;
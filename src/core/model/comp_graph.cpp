@@ -82,6 +82,24 @@ std::vector<glaxnimate::model::Composition *> glaxnimate::model::CompGraph::chil
     return std::vector<glaxnimate::model::Composition *>(vals.begin(), vals.end());
 }
 
+std::vector<glaxnimate::model::Composition *> glaxnimate::model::CompGraph::users(glaxnimate::model::Composition* comp) const
+{
+    std::vector<glaxnimate::model::Composition *> vals;
+    for ( const auto& p : layers )
+    {
+        for ( auto layer : p.second )
+        {
+            if ( layer->composition.get() == comp )
+            {
+                vals.push_back(p.first);
+                break;
+            }
+        }
+    }
+
+    return vals;
+}
+
 static bool recursive_is_ancestor_of(
     glaxnimate::model::Composition* ancestor,
     glaxnimate::model::Composition* descendant,
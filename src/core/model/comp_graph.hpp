@@ -51,6 +51,11 @@ public:
      */
     std::vector<model::Composition*> children(model::Composition* comp) const;
 
+    /**
+     * \brief Returns a list of compositions with layers using \p comp
+     */
+    std::vector<model::Composition*> users(model::Composition* comp) const;
+
     /**
      * \brief Returns whether starting from \p ancestor you can find a path to \p descendant using precomp layers.
      *
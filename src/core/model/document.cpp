@@ -8,9 +8,12 @@
 
 #include <QRegularExpression>
 
+#include "command/spill_store.hpp"
 #include "io/glaxnimate/glaxnimate_format.hpp"
 #include "model/assets/assets.hpp"
 #include "model/assets/pending_asset.hpp"
+#include "model/precomp_render_cache.hpp"
+#include "model/static_render_cache.hpp"
 
 
 class glaxnimate::model::Document::Private
@@ -19,7 +22,7 @@ public:
     using NameIndex = unsigned long long;
 
     Private(Document* doc)
-        : assets(doc)
+        : assets(doc), precomp_cache(&comp_graph), static_render_cache(&comp_graph)
     {
         io_options.format = io::glaxnimate::GlaxnimateFormat::instance();
     }
@@ -84,12 +87,16 @@ public:
     }
 
     QUndoStack undo_stack;
+    command::SpillStore spill_store{&undo_stack};
     QVariantMap metadata;
     io::Options io_options;
     FrameTime current_time = 0;
     bool record_to_keyframe = false;
     Assets assets;
     glaxnimate::model::CompGraph comp_graph;
+    glaxnimate::model::PrecompRenderCache precomp_cache;
+    glaxnimate::model::StaticRenderCache static_render_cache;
+    bool direct_rasterization = false;
     std::unordered_map<QString, NameIndex> name_indices;
     std::map<int, PendingAsset> pending_assets;
     int max_pending_id = 0;
@@ -103,6 +110,10 @@ glaxnimate::model::Document::Document(const QString& filename)
 {
     d->io_options.filename = filename;
     d->uuid = QUuid::createUuid();
+    connect(this, &Document::object_edited, this, [this](model::Object* object){
+        d->precomp_cache.object_edited(object);
+        d->static_render_cache.object_edited(object);
+    });
 }
 
 glaxnimate::model::Document::~Document() = default;
@@ -127,6 +138,11 @@ QUndoStack & glaxnimate::model::Document::undo_stack()
     return d->undo_stack;
 }
 
+glaxnimate::command::SpillStore & glaxnimate::model::Document::undo_spill_store()
+{
+    return d->spill_store;
+}
+
 const glaxnimate::io::Options & glaxnimate::model::Document::io_options() const
 {
     return d->io_options;
@@ -236,6 +252,26 @@ glaxnimate::model::CompGraph & glaxnimate::model::Document::comp_graph()
     return d->comp_graph;
 }
 
+glaxnimate::model::PrecompRenderCache & glaxnimate::model::Document::precomp_cache()
+{
+    return d->precomp_cache;
+}
+
+glaxnimate::model::StaticRenderCache & glaxnimate::model::Document::static_render_cache()
+{
+    return d->static_render_cache;
+}
+
+bool glaxnimate::model::Document::direct_rasterization() const
+{
+    return d->direct_rasterization;
+}
+
+void glaxnimate::model::Document::set_direct_rasterization(bool enabled)
+{
+    d->direct_rasterization = enabled;
+}
+
 void glaxnimate::model::Document::decrease_node_name(const QString& old_name)
 {
     if ( !old_name.isEmpty() )
@@ -256,6 +292,15 @@ void glaxnimate::model::Document::stretch_time(qreal multiplier)
     set_current_time(qRound(time * multiplier));
 }
 
+void glaxnimate::model::Document::move_to_thread(QThread* thread)
+{
+    moveToThread(thread);
+    d->undo_stack.moveToThread(thread);
+    d->assets.network_downloader.moveToThread(thread);
+    // Objects follow the thread of their document on transfer
+    d->assets.transfer(this);
+}
+
 int glaxnimate::model::Document::add_pending_asset(const QString& name, const QByteArray& data)
 {
     return d->add_pending_asset({}, data, name);
@@ -14,9 +14,15 @@
 #include "model/comp_graph.hpp"
 #include "model/document_node.hpp"
 
+namespace glaxnimate::command {
+class SpillStore;
+} // namespace glaxnimate::command
+
 namespace glaxnimate::model {
 
 class Assets;
+class PrecompRenderCache;
+class StaticRenderCache;
 struct PendingAsset;
 class Composition;
 
@@ -59,6 +65,11 @@ public:
 
     QUndoStack& undo_stack();
 
+    /**
+     * \brief Keeps the memory used by undo_stack() within a budget
+     */
+    command::SpillStore& undo_spill_store();
+
     const io::Options& io_options() const;
 
     void set_io_options(const io::Options& opt);
@@ -88,8 +99,35 @@ public:
 
     model::CompGraph& comp_graph();
 
+    /**
+     * \brief Cache used to paint precomp layers, disabled by default
+     */
+    model::PrecompRenderCache& precomp_cache();
+
+    /**
+     * \brief Cache used to paint groups that don't change over time, disabled by default
+     */
+    model::StaticRenderCache& static_render_cache();
+
+    /**
+     * \brief Whether fills and strokes are drawn directly on the target image, disabled by default
+     *
+     * When enabled, shapes painted on a QImage with a solid color skip the QPainterPath
+     * conversion and use math::bezier::Rasterizer instead
+     */
+    bool direct_rasterization() const;
+    void set_direct_rasterization(bool enabled);
+
     void stretch_time(qreal multiplier);
 
+    /**
+     * \brief Moves the document and all of its objects to \p thread
+     *
+     * Must be called from the thread the document lives in,
+     * eg: to hand a document loaded in a worker thread to the GUI
+     */
+    void move_to_thread(QThread* thread);
+
     int add_pending_asset(const QString& name, const QUrl& url);
     int add_pending_asset(const QString& name, const QByteArray& data);
     int add_pending_asset(const model::PendingAsset& asset);
@@ -103,6 +141,12 @@ signals:
     void current_time_changed(FrameTime t);
     void record_to_keyframe_changed(bool r);
     void graphics_invalidated();
+    /**
+     * \brief Emitted when a property of \p object changes, except for changes caused by set_time()
+     *
+     * \p object might not be in the document tree (yet)
+     */
+    void object_edited(model::Object* object, const model::BaseProperty* property);
 
 private:
     Object* assets_obj() const;
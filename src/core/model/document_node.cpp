@@ -7,10 +7,16 @@
 #include "document_node.hpp"
 #include "document.hpp"
 
+#include <atomic>
+#include <mutex>
+
 #include <QPainter>
 #include <QGraphicsItem>
 
+#include "math/bezier/frame_arena.hpp"
 #include "model/shapes/shape.hpp"
+#include "model/static_render_cache.hpp"
+#include "utils/profiler.hpp"
 #include "model/property/reference_property.hpp"
 #include "model/property/sub_object_property.hpp"
 #include "utils/pseudo_mutex.hpp"
@@ -18,11 +24,79 @@
 class glaxnimate::model::DocumentNode::Private
 {
 public:
+    enum TimeInvariance
+    {
+        Unknown,
+        Computing,
+        Invariant,
+        Variant,
+    };
+
     std::unordered_set<User*> users;
     utils::PseudoMutex detaching;
     DocumentNode* list_parent = nullptr;
+    std::atomic<int> time_invariance = Unknown;
+    bool watching_keyframes = false;
+    int child_span = 0;
 };
 
+namespace {
+
+// Time invariance is computed lazily, possibly from render threads
+std::recursive_mutex time_invariance_mutex;
+
+bool properties_time_invariant(const glaxnimate::model::Object* object)
+{
+    using namespace glaxnimate::model;
+
+    bool invariant = true;
+    for ( auto prop : object->properties() )
+    {
+        const auto& traits = prop->traits();
+        if ( traits.flags & PropertyTraits::Animated )
+        {
+            if ( static_cast<const AnimatableBase*>(prop)->animated() )
+                invariant = false;
+        }
+        else if ( traits.type == PropertyTraits::Object )
+        {
+            // Lists of objects are the node children
+            if ( !(traits.flags & PropertyTraits::List) &&
+                 !properties_time_invariant(static_cast<const SubObjectPropertyBase*>(prop)->sub_object()) )
+                invariant = false;
+        }
+        else if ( traits.type == PropertyTraits::ObjectReference )
+        {
+            auto target = prop->value().value<DocumentNode*>();
+            if ( target && !target->docnode_time_invariant() )
+                invariant = false;
+        }
+    }
+    return invariant;
+}
+
+void watch_keyframes(const glaxnimate::model::Object* object, glaxnimate::model::DocumentNode* node)
+{
+    using namespace glaxnimate::model;
+
+    for ( auto prop : object->properties() )
+    {
+        const auto& traits = prop->traits();
+        if ( traits.flags & PropertyTraits::Animated )
+        {
+            auto anim = const_cast<AnimatableBase*>(static_cast<const AnimatableBase*>(prop));
+            QObject::connect(anim, &AnimatableBase::keyframe_added, node, &DocumentNode::docnode_invalidate_time_invariant);
+            QObject::connect(anim, &AnimatableBase::keyframe_removed, node, &DocumentNode::docnode_invalidate_time_invariant);
+        }
+        else if ( traits.type == PropertyTraits::Object && !(traits.flags & PropertyTraits::List) )
+        {
+            watch_keyframes(static_cast<const SubObjectPropertyBase*>(prop)->sub_object(), node);
+        }
+    }
+}
+
+} // namespace
+
 glaxnimate::model::DocumentNode::DocumentNode(glaxnimate::model::Document* document)
     : DocumentNode(document, std::make_unique<Private>())
 {
@@ -32,6 +106,10 @@ glaxnimate::model::DocumentNode::DocumentNode(glaxnimate::model::Document* docum
     : Object ( document ), d(std::move(d))
 {
     uuid.set_value(QUuid::createUuid());
+    connect(this, &Object::property_changed, this, [this](const BaseProperty* prop){
+        if ( prop->traits().type == PropertyTraits::ObjectReference )
+            docnode_invalidate_time_invariant();
+    });
 }
 
 
@@ -41,6 +119,8 @@ void glaxnimate::model::DocumentNode::removed_from_list()
 {
     auto old = d->list_parent;
     d->list_parent = nullptr;
+    if ( old )
+        old->docnode_invalidate_time_invariant();
     document()->decrease_node_name(name.get());
     on_parent_changed(old, d->list_parent);
     emit removed();
@@ -50,10 +130,39 @@ void glaxnimate::model::DocumentNode::added_to_list ( glaxnimate::model::Documen
 {
     auto old = d->list_parent;
     d->list_parent = new_parent;
+    if ( old )
+        old->docnode_invalidate_time_invariant();
+    // Might depend on the owner composition
+    docnode_invalidate_time_invariant();
+    if ( new_parent )
+        new_parent->docnode_invalidate_time_invariant();
     document()->increase_node_name(name.get());
     on_parent_changed(old, d->list_parent);
 }
 
+void glaxnimate::model::DocumentNode::child_span_begin(bool insert, int row, int count)
+{
+    d->child_span++;
+    if ( insert )
+        emit docnode_child_add_span_begin(row, count);
+    else
+        emit docnode_child_remove_span_begin(row, count);
+}
+
+void glaxnimate::model::DocumentNode::child_span_end(bool insert, int row, int count)
+{
+    d->child_span--;
+    if ( insert )
+        emit docnode_child_add_span_end(row, count);
+    else
+        emit docnode_child_remove_span_end(row, count);
+}
+
+bool glaxnimate::model::DocumentNode::docnode_child_span_active() const
+{
+    return d->child_span > 0;
+}
+
 void glaxnimate::model::DocumentNode::on_name_changed(const QString& name, const QString& old_name)
 {
     if ( old_name != name )
@@ -115,6 +224,68 @@ void glaxnimate::model::DocumentNode::refresh_uuid()
     }
 }
 
+bool glaxnimate::model::DocumentNode::docnode_time_invariant() const
+{
+    int state = d->time_invariance;
+    if ( state == Private::Invariant || state == Private::Variant )
+        return state == Private::Invariant;
+
+    std::lock_guard lock(time_invariance_mutex);
+
+    state = d->time_invariance;
+    if ( state == Private::Invariant || state == Private::Variant )
+        return state == Private::Invariant;
+
+    // Reference loop, assume the worst
+    if ( state == Private::Computing )
+        return false;
+
+    d->time_invariance = Private::Computing;
+
+    if ( !d->watching_keyframes )
+    {
+        d->watching_keyframes = true;
+        watch_keyframes(this, const_cast<DocumentNode*>(this));
+    }
+
+    bool invariant = docnode_self_time_invariant();
+
+    // All children are evaluated so they have a cached value whenever the parent does
+    for ( auto child : docnode_children() )
+    {
+        if ( !child->docnode_time_invariant() )
+            invariant = false;
+    }
+
+    d->time_invariance = invariant ? Private::Invariant : Private::Variant;
+    return invariant;
+}
+
+bool glaxnimate::model::DocumentNode::docnode_self_time_invariant() const
+{
+    return properties_time_invariant(this);
+}
+
+void glaxnimate::model::DocumentNode::docnode_invalidate_time_invariant()
+{
+    std::lock_guard lock(time_invariance_mutex);
+
+    // Parents and users are only evaluated after this, so they are already outdated
+    if ( d->time_invariance == Private::Unknown )
+        return;
+
+    d->time_invariance = Private::Unknown;
+
+    if ( auto parent = docnode_parent() )
+        parent->docnode_invalidate_time_invariant();
+
+    for ( auto user : d->users )
+    {
+        if ( auto node = qobject_cast<DocumentNode*>(user->object()) )
+            node->docnode_invalidate_time_invariant();
+    }
+}
+
 QString glaxnimate::model::DocumentNode::object_name() const
 {
     if ( name.get().isEmpty() )
@@ -305,6 +476,13 @@ void glaxnimate::model::VisualNode::paint(QPainter* painter, FrameTime time, Pai
     if ( !visible.get() )
         return;
 
+    utils::profiler::Scope scope("paint", this);
+    // Geometry evaluated while painting is released when the outermost paint() returns
+    math::bezier::FrameArena::Scope arena;
+
+    if ( !modifier && document()->static_render_cache().enabled() && document()->static_render_cache().paint(this, painter, time, mode) )
+        return;
+
     painter->save();
     painter->setTransform(group_transform_matrix(time), true);
 
@@ -206,7 +206,36 @@ public:
      */
     bool is_descendant_of(const model::DocumentNode* other) const;
 
+    /**
+     * \brief Whether this node and its children look the same at any time
+     *
+     * Takes into account animated properties, children and referenced nodes.
+     * The result is cached and updated when keyframes are added or removed,
+     * references change or the tree structure changes.
+     */
+    bool docnode_time_invariant() const;
+
+    /**
+     * \brief Marks the cached value for docnode_time_invariant() as outdated
+     *
+     * Also affects parents and nodes referencing this one.
+     */
+    void docnode_invalidate_time_invariant();
+
+    /**
+     * \brief Whether a range of children is being inserted or removed as a single change
+     *
+     * While this is true, docnode_child_add_begin() and similar are still emitted
+     * for every child but listeners can wait for the span signals instead.
+     */
+    bool docnode_child_span_active() const;
+
 protected:
+    /**
+     * \brief Whether the properties of this node (ignoring children) are not animated
+     */
+    virtual bool docnode_self_time_invariant() const;
+
     virtual void on_parent_changed(model::DocumentNode* old_parent, model::DocumentNode* new_parent)
     {
         Q_UNUSED(old_parent);
@@ -231,6 +260,8 @@ private:
 
     void removed_from_list();
     void added_to_list(DocumentNode* new_parent);
+    void child_span_begin(bool insert, int row, int count);
+    void child_span_end(bool insert, int row, int count);
 
     void on_name_changed(const QString& name, const QString& old_name);
 
@@ -244,6 +275,24 @@ signals:
     void docnode_child_move_begin(int from, int to);
     void docnode_child_move_end(DocumentNode* node, int from, int to);
 
+    /**
+     * \brief Emitted before inserting \p count children starting from \p row
+     */
+    void docnode_child_add_span_begin(int row, int count);
+    /**
+     * \brief Emitted once all the children in the span have been inserted
+     */
+    void docnode_child_add_span_end(int row, int count);
+
+    /**
+     * \brief Emitted before removing \p count children starting from \p row
+     */
+    void docnode_child_remove_span_begin(int row, int count);
+    /**
+     * \brief Emitted once all the children in the span have been removed
+     */
+    void docnode_child_remove_span_end(int row, int count);
+
     void name_changed(const QString&);
 
 signals:
@@ -21,7 +21,12 @@ public:
     enum MaskMode
     {
         NoMask = 0,
+        /// Clips to the outline of the mask shape
         Alpha = 1,
+        /// Multiplies by the luminance of the rendered mask
+        Luma = 2,
+        /// Multiplies by the opacity of the rendered mask
+        AlphaMatte = 3,
     };
     Q_ENUM(MaskMode)
 
@@ -34,6 +39,11 @@ public:
     QString type_name_human() const override;
 
     bool has_mask() const { return mask.get(); }
+
+    /**
+     * \brief Whether the mask is rendered to an offscreen buffer rather than used as a clip path
+     */
+    bool is_matte() const { return mask.get() == Luma || mask.get() == AlphaMatte; }
 };
 
 } // namespace glaxnimate::model
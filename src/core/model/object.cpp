@@ -6,19 +6,130 @@
 
 #include "object.hpp"
 
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
 #include <unordered_map>
 
 #include "property/property.hpp"
 #include "model/document.hpp"
 #include "app/log/log.hpp"
 
+namespace {
+
+/**
+ * \brief Maps property ids to their position in Object::properties(), shared by all objects of the same type
+ *
+ * All objects of a given class declare the same properties in the same order,
+ * so the table is computed once per class.
+ */
+class PropertyTable
+{
+public:
+    using BaseProperty = glaxnimate::model::BaseProperty;
+    using PropertyId = glaxnimate::model::PropertyId;
+
+    explicit PropertyTable(const std::vector<BaseProperty*>& properties)
+        : count(properties.size())
+    {
+        for ( int i = 0; i < count; i++ )
+        {
+            int index = properties[i]->id().index();
+            if ( index >= int(positions.size()) )
+                positions.resize(index + 1, -1);
+            positions[index] = i;
+        }
+    }
+
+    /**
+     * \brief Position of \p id in the properties, -1 if not found
+     */
+    int position(PropertyId id) const
+    {
+        int index = id.index();
+        if ( index < 0 || index >= int(positions.size()) )
+            return -1;
+        return positions[index];
+    }
+
+    /**
+     * \brief Returns the table for \p meta, creating it from \p properties if needed
+     */
+    static const PropertyTable* get(const QMetaObject* meta, const std::vector<BaseProperty*>& properties)
+    {
+        static std::shared_mutex mutex;
+        static std::unordered_map<const QMetaObject*, const PropertyTable*> tables;
+        // Never freed as objects keep pointers to them
+        static std::deque<PropertyTable> storage;
+
+        {
+            std::shared_lock lock(mutex);
+            auto it = tables.find(meta);
+            if ( it != tables.end() && it->second->count >= int(properties.size()) )
+                return it->second;
+        }
+
+        // Either the first object of this type or the existing table was
+        // built while an object was still being constructed
+        std::unique_lock lock(mutex);
+        auto& table = tables[meta];
+        if ( !table || table->count < int(properties.size()) )
+        {
+            storage.emplace_back(properties);
+            table = &storage.back();
+        }
+        return table;
+    }
+
+    int count;
+
+private:
+    std::vector<int> positions;
+};
+
+/**
+ * \brief Non-zero while set_time() is running on the current thread
+ *
+ * Values changing because of the time aren't edits to the document
+ */
+thread_local int setting_time = 0;
+
+} // namespace
 
 class glaxnimate::model::Object::Private
 {
 public:
-    std::unordered_map<QString, BaseProperty*> props;
+    BaseProperty* find(const Object* object, PropertyId id)
+    {
+        if ( !id.valid() )
+            return nullptr;
+
+        const PropertyTable* table = this->table.load(std::memory_order_acquire);
+        if ( !table || table->count != int(prop_order.size()) )
+        {
+            table = PropertyTable::get(object->metaObject(), prop_order);
+            if ( table->count == int(prop_order.size()) )
+                this->table.store(table, std::memory_order_release);
+        }
+
+        int pos = table->position(id);
+        if ( pos != -1 && pos < int(prop_order.size()) && prop_order[pos]->id() == id )
+            return prop_order[pos];
+
+        // Objects still being constructed or with properties added at runtime
+        // might not match the table
+        for ( auto prop : prop_order )
+            if ( prop->id() == id )
+                return prop;
+
+        return nullptr;
+    }
+
     std::vector<BaseProperty*> prop_order;
+    std::atomic<const PropertyTable*> table = nullptr;
     Document* document;
+    SubObjectPropertyBase* owner_property = nullptr;
     FrameTime current_time = 0;
 };
 
@@ -61,7 +172,7 @@ void glaxnimate::model::Object::clone_into(glaxnimate::model::Object* dest) cons
     }
 
     for ( BaseProperty* prop : d->prop_order )
-        dest->get_property(prop->name())->assign_from(prop);
+        dest->get_property(prop->id())->assign_from(prop);
 }
 
 
@@ -74,42 +185,63 @@ void glaxnimate::model::Object::property_value_changed(const BaseProperty* prop,
         d->document->graphics_invalidated();
         emit visual_property_changed(prop, value);
     }
+
+    if ( !setting_time && d->document )
+        d->document->object_edited(this, prop);
+}
+
+void glaxnimate::model::Object::property_keyframes_changed(const BaseProperty* prop)
+{
+    // Keyframes can change without affecting the current value
+    if ( !setting_time && d->document )
+        d->document->object_edited(this, prop);
 }
 
 void glaxnimate::model::Object::add_property(glaxnimate::model::BaseProperty* prop)
 {
-    d->props[prop->name()] = prop;
     d->prop_order.push_back(prop);
 }
 
 QVariant glaxnimate::model::Object::get(const QString& property) const
 {
-    auto it = d->props.find(property);
-    if ( it == d->props.end() )
+    auto prop = get_property(PropertyId::find(property));
+    if ( !prop )
          return QVariant{};
-    return it->second->value();
+    return prop->value();
 }
 
 glaxnimate::model::BaseProperty * glaxnimate::model::Object::get_property ( const QString& property )
 {
-    auto it = d->props.find(property);
-    if ( it == d->props.end() )
-        return nullptr;
-    return it->second;
+    return get_property(PropertyId::find(property));
+}
+
+const glaxnimate::model::BaseProperty * glaxnimate::model::Object::get_property ( const QString& property ) const
+{
+    return get_property(PropertyId::find(property));
+}
+
+glaxnimate::model::BaseProperty * glaxnimate::model::Object::get_property(PropertyId property)
+{
+    return d->find(this, property);
+}
+
+const glaxnimate::model::BaseProperty * glaxnimate::model::Object::get_property(PropertyId property) const
+{
+    return d->find(this, property);
 }
 
 bool glaxnimate::model::Object::set(const QString& property, const QVariant& value)
 {
-    auto it = d->props.find(property);
-    if ( it == d->props.end() )
+    auto prop = get_property(PropertyId::find(property));
+    if ( !prop )
         return false;
 
-    return it->second->set_value(value);
+    return prop->set_value(value);
 }
 
 bool glaxnimate::model::Object::has ( const QString& property ) const
 {
-    return d->props.find(property) != d->props.end();
+    return get_property(PropertyId::find(property));
 }
 
 
@@ -144,18 +276,18 @@ void glaxnimate::model::Object::push_command(QUndoCommand* cmd)
 
 bool glaxnimate::model::Object::set_undoable ( const QString& property, const QVariant& value )
 {
-
-    auto it = d->props.find(property);
-    if ( it != d->props.end() )
-        return it->second->set_undoable(value);
+    if ( auto prop = get_property(PropertyId::find(property)) )
+        return prop->set_undoable(value);
     return false;
 }
 
 void glaxnimate::model::Object::set_time(glaxnimate::model::FrameTime t)
 {
+    setting_time++;
     d->current_time = t;
     for ( auto prop: d->prop_order )
         prop->set_time(t);
+    setting_time--;
 }
 
 glaxnimate::model::FrameTime glaxnimate::model::Object::time() const
@@ -163,6 +295,16 @@ glaxnimate::model::FrameTime glaxnimate::model::Object::time() const
     return d->current_time;
 }
 
+glaxnimate::model::SubObjectPropertyBase * glaxnimate::model::Object::owner_property() const
+{
+    return d->owner_property;
+}
+
+void glaxnimate::model::Object::set_owner_property(SubObjectPropertyBase* property)
+{
+    d->owner_property = property;
+}
+
 void glaxnimate::model::Object::stretch_time(qreal multiplier)
 {
     for ( const auto& prop : d->prop_order )
@@ -13,6 +13,7 @@
 #include <QVariant>
 
 #include "model/animation/frame_time.hpp"
+#include "model/property/property_id.hpp"
 #include "model/factory.hpp"
 
 class QUndoCommand;
@@ -53,6 +54,7 @@ namespace glaxnimate::model {
 
 class ObjectListPropertyBase;
 class BaseProperty;
+class SubObjectPropertyBase;
 class Document;
 
 class Object : public QObject
@@ -84,6 +86,14 @@ public:
 
     const std::vector<BaseProperty*>& properties() const;
     BaseProperty* get_property(const QString& property);
+    const BaseProperty* get_property(const QString& property) const;
+
+    /**
+     * \brief Property lookup without hashing the name
+     * \returns The property or nullptr if this object doesn't have it
+     */
+    BaseProperty* get_property(PropertyId property);
+    const BaseProperty* get_property(PropertyId property) const;
 
     virtual QString object_name() const { return type_name_human(); }
     virtual QString type_name_human() const { return tr("Unknown Object"); }
@@ -102,6 +112,11 @@ public:
 
     virtual void stretch_time(qreal multiplier);
 
+    /**
+     * \brief Property this object is the sub-object of, nullptr for stand-alone objects
+     */
+    SubObjectPropertyBase* owner_property() const;
+
 signals:
     void property_changed(const model::BaseProperty* prop, const QVariant& value);
     void visual_property_changed(const model::BaseProperty* prop, const QVariant& value);
@@ -132,8 +147,11 @@ private:
 
     void add_property(BaseProperty* prop);
     void property_value_changed(const BaseProperty* prop, const QVariant& value);
+    void property_keyframes_changed(const BaseProperty* prop);
+    void set_owner_property(SubObjectPropertyBase* property);
 
     friend BaseProperty;
+    friend SubObjectPropertyBase;
     class Private;
     std::unique_ptr<Private> d;
 };
@@ -0,0 +1,209 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "precomp_render_cache.hpp"
+
+#include <cmath>
+#include <limits>
+#include <unordered_set>
+
+#include <QPainter>
+
+#include "model/assets/composition.hpp"
+#include "model/comp_graph.hpp"
+#include "model/property/sub_object_property.hpp"
+
+glaxnimate::model::PrecompRenderCache::PrecompRenderCache(CompGraph* comp_graph)
+    : comp_graph(comp_graph)
+{
+}
+
+glaxnimate::model::PrecompRenderCache::~PrecompRenderCache()
+{
+    clear();
+}
+
+bool glaxnimate::model::PrecompRenderCache::enabled() const
+{
+    return enabled_;
+}
+
+void glaxnimate::model::PrecompRenderCache::set_enabled(bool enabled)
+{
+    enabled_ = enabled;
+    if ( !enabled )
+        clear();
+}
+
+qint64 glaxnimate::model::PrecompRenderCache::max_bytes() const
+{
+    return max_bytes_;
+}
+
+void glaxnimate::model::PrecompRenderCache::set_max_bytes(qint64 bytes)
+{
+    std::lock_guard lock(mutex);
+    max_bytes_ = bytes;
+    evict();
+}
+
+int glaxnimate::model::PrecompRenderCache::size() const
+{
+    std::lock_guard lock(mutex);
+    return entries.size();
+}
+
+QImage glaxnimate::model::PrecompRenderCache::image(
+    Composition* comp, FrameTime time, const QSizeF& size, qreal scale_x, qreal scale_y, VisualNode::PaintMode mode
+)
+{
+    Key key{comp, time, scale_x, scale_y, size, mode};
+
+    {
+        std::lock_guard lock(mutex);
+        auto it = entries.find(key);
+        if ( it != entries.end() )
+        {
+            it->second.last_used = ++clock;
+            return it->second.image;
+        }
+    }
+
+    // Rendered without holding the lock so other threads can paint in the meantime
+    QSize pixel_size(std::ceil(size.width() * scale_x), std::ceil(size.height() * scale_y));
+    QImage image(pixel_size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    {
+        QPainter painter(&image);
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.setRenderHint(QPainter::SmoothPixmapTransform);
+        painter.scale(scale_x, scale_y);
+        comp->paint(&painter, time, mode);
+    }
+
+    std::lock_guard lock(mutex);
+    watch(comp);
+    auto& entry = entries[key];
+    if ( entry.image.isNull() )
+    {
+        entry.image = image;
+        bytes += image.sizeInBytes();
+    }
+    entry.last_used = ++clock;
+    image = entry.image;
+    evict();
+    return image;
+}
+
+void glaxnimate::model::PrecompRenderCache::watch(Composition* comp)
+{
+    auto& connections = watched[comp];
+    if ( !connections.empty() )
+        return;
+
+    auto invalidate = [this, comp]{ this->invalidate(comp); };
+    connections.push_back(QObject::connect(comp, &VisualNode::bounding_rect_changed, invalidate));
+    connections.push_back(QObject::connect(comp, &DocumentNode::docnode_child_add_end, invalidate));
+    connections.push_back(QObject::connect(comp, &DocumentNode::docnode_child_remove_end, invalidate));
+    connections.push_back(QObject::connect(comp, &DocumentNode::docnode_child_move_end, invalidate));
+    connections.push_back(QObject::connect(comp, &Object::visual_property_changed, invalidate));
+    connections.push_back(QObject::connect(comp, &QObject::destroyed, [this, comp]{
+        std::lock_guard lock(mutex);
+        drop(comp);
+        watched.erase(comp);
+    }));
+
+    // Nested precomps are painted directly when their layer isn't cacheable,
+    // structural changes in those need to reach the users as well
+    for ( auto child : comp_graph->children(comp) )
+        watch(child);
+}
+
+void glaxnimate::model::PrecompRenderCache::object_edited(Object* object)
+{
+    std::lock_guard lock(mutex);
+    if ( entries.empty() )
+        return;
+
+    while ( object )
+    {
+        if ( auto comp = qobject_cast<Composition*>(object) )
+        {
+            invalidate(comp);
+            return;
+        }
+
+        if ( auto node = qobject_cast<DocumentNode*>(object) )
+            object = node->docnode_parent();
+        else if ( auto property = object->owner_property() )
+            object = property->object();
+        else
+            break;
+    }
+
+    // Not part of a composition, any image could depend on it
+    clear();
+}
+
+void glaxnimate::model::PrecompRenderCache::drop(Composition* comp)
+{
+    auto begin = entries.lower_bound(Key{comp, std::numeric_limits<FrameTime>::lowest(), 0, 0, {}, VisualNode::Canvas});
+    auto end = begin;
+    while ( end != entries.end() && end->first.comp == comp )
+    {
+        bytes -= end->second.image.sizeInBytes();
+        ++end;
+    }
+    entries.erase(begin, end);
+}
+
+void glaxnimate::model::PrecompRenderCache::invalidate(Composition* comp)
+{
+    std::lock_guard lock(mutex);
+    if ( entries.empty() )
+        return;
+
+    // Anything using comp as a precomp has it baked in its images
+    std::unordered_set<Composition*> checked{comp};
+    std::vector<Composition*> queue{comp};
+    while ( !queue.empty() )
+    {
+        Composition* current = queue.back();
+        queue.pop_back();
+        drop(current);
+        for ( auto user : comp_graph->users(current) )
+        {
+            if ( checked.insert(user).second )
+                queue.push_back(user);
+        }
+    }
+}
+
+void glaxnimate::model::PrecompRenderCache::evict()
+{
+    while ( bytes > max_bytes_ && !entries.empty() )
+    {
+        auto oldest = entries.begin();
+        for ( auto it = entries.begin(); it != entries.end(); ++it )
+        {
+            if ( it->second.last_used < oldest->second.last_used )
+                oldest = it;
+        }
+        bytes -= oldest->second.image.sizeInBytes();
+        entries.erase(oldest);
+    }
+}
+
+void glaxnimate::model::PrecompRenderCache::clear()
+{
+    std::lock_guard lock(mutex);
+    for ( const auto& p : watched )
+        for ( const auto& connection : p.second )
+            QObject::disconnect(connection);
+    watched.clear();
+    entries.clear();
+    bytes = 0;
+}
@@ -0,0 +1,119 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include <QImage>
+#include <QMetaObject>
+
+#include "model/animation/frame_time.hpp"
+#include "model/document_node.hpp"
+
+namespace glaxnimate::model {
+
+class Composition;
+class CompGraph;
+
+/**
+ * \brief Cache of rasterized precompositions
+ *
+ * Used by PreCompLayer when painting with a transform that only translates and scales,
+ * so multiple instances of the same composition at the same local time are only rendered once.
+ *
+ * Entries are dropped when the composition (or any composition it uses) changes,
+ * edits to assets (gradients, colors, bitmaps...) drop all the entries.
+ * Disabled by default.
+ */
+class PrecompRenderCache
+{
+public:
+    explicit PrecompRenderCache(CompGraph* comp_graph);
+    ~PrecompRenderCache();
+
+    PrecompRenderCache(const PrecompRenderCache&) = delete;
+    PrecompRenderCache& operator=(const PrecompRenderCache&) = delete;
+
+    bool enabled() const;
+    void set_enabled(bool enabled);
+
+    /**
+     * \brief Maximum memory used by the cached images, in bytes
+     */
+    qint64 max_bytes() const;
+    void set_max_bytes(qint64 bytes);
+
+    /**
+     * \brief Returns the image of \p comp at \p time painted with the given scale factors
+     *
+     * The image covers the rectangle (0, 0, \p size) in composition coordinates.
+     * It's rendered if not already cached.
+     */
+    QImage image(Composition* comp, FrameTime time, const QSizeF& size, qreal scale_x, qreal scale_y, VisualNode::PaintMode mode);
+
+    /**
+     * \brief Drops cached images for \p comp and every composition that uses it
+     */
+    void invalidate(Composition* comp);
+
+    /**
+     * \brief Drops cached images affected by changes to \p object
+     *
+     * Objects inside a composition invalidate that composition,
+     * anything else (eg: assets) clears the whole cache.
+     */
+    void object_edited(Object* object);
+
+    void clear();
+
+    /**
+     * \brief Number of cached images
+     */
+    int size() const;
+
+private:
+    struct Key
+    {
+        Composition* comp;
+        FrameTime time;
+        qreal scale_x;
+        qreal scale_y;
+        QSizeF size;
+        VisualNode::PaintMode mode;
+
+        bool operator<(const Key& o) const
+        {
+            return std::make_tuple(comp, time, scale_x, scale_y, mode, size.width(), size.height()) <
+                   std::make_tuple(o.comp, o.time, o.scale_x, o.scale_y, o.mode, o.size.width(), o.size.height());
+        }
+    };
+
+    struct Entry
+    {
+        QImage image;
+        quint64 last_used = 0;
+    };
+
+    void watch(Composition* comp);
+    void drop(Composition* comp);
+    void evict();
+
+    CompGraph* comp_graph;
+    bool enabled_ = false;
+    qint64 max_bytes_ = 256 * 1024 * 1024;
+    qint64 bytes = 0;
+    quint64 clock = 0;
+    std::map<Key, Entry> entries;
+    std::unordered_map<Composition*, std::vector<QMetaObject::Connection>> watched;
+    mutable std::recursive_mutex mutex;
+};
+
+} // namespace glaxnimate::model
@@ -5,6 +5,9 @@
  */
 
 #pragma once
+
+#include <algorithm>
+
 #include "property.hpp"
 #include "model/document_node.hpp"
 
@@ -79,6 +82,16 @@ protected:
     {
         ptr->added_to_list(static_cast<DocumentNode*>(object()));
     }
+
+    void span_begin(bool insert, int position, int count)
+    {
+        static_cast<DocumentNode*>(object())->child_span_begin(insert, position, count);
+    }
+
+    void span_end(bool insert, int position, int count)
+    {
+        static_cast<DocumentNode*>(object())->child_span_end(insert, position, count);
+    }
 };
 
 namespace detail {
@@ -170,6 +183,51 @@ public:
         return ptr;
     }
 
+    /**
+     * \brief Inserts several objects starting from \p position as a single change
+     *
+     * The per-object callbacks are still invoked but they are enclosed by
+     * DocumentNode::docnode_child_add_span_begin() and DocumentNode::docnode_child_add_span_end()
+     * so views can update all the rows at once.
+     * \return Pointers to the inserted objects
+     */
+    std::vector<value_type*> insert_range(std::vector<pointer> items, int position = -1)
+    {
+        std::vector<value_type*> inserted;
+        if ( items.empty() )
+            return inserted;
+
+        if ( !valid_index(position) )
+            position = size();
+
+        int count = items.size();
+        inserted.reserve(count);
+        span_begin(true, position, count);
+        for ( int i = 0; i < count; i++ )
+            inserted.push_back(insert(std::move(items[i]), position + i));
+        span_end(true, position, count);
+        return inserted;
+    }
+
+    /**
+     * \brief Removes \p count objects starting from \p position as a single change
+     * \see insert_range()
+     */
+    std::vector<pointer> remove_range(int position, int count)
+    {
+        std::vector<pointer> removed;
+        if ( !valid_index(position) || count <= 0 )
+            return removed;
+
+        count = std::min(count, size() - position);
+        removed.reserve(count);
+        span_begin(false, position, count);
+        for ( int i = 0; i < count; i++ )
+            removed.push_back(remove(position));
+        span_end(false, position, count);
+        return removed;
+    }
+
     bool valid_index(int index)
     {
         return index >= 0 && index < int(objects.size());
@@ -9,7 +9,7 @@
 #include "command/property_commands.hpp"
 
 glaxnimate::model::BaseProperty::BaseProperty(Object* object, const QString& name, PropertyTraits traits)
-    : object_(object), name_(name), traits_(traits)
+    : object_(object), id_(name), traits_(traits)
 {
     if ( object )
         object_->add_property(this);
@@ -20,6 +20,11 @@ void glaxnimate::model::BaseProperty::value_changed()
     object_->property_value_changed(this, value());
 }
 
+void glaxnimate::model::BaseProperty::keyframes_changed()
+{
+    object_->property_keyframes_changed(this);
+}
+
 bool glaxnimate::model::BaseProperty::set_undoable ( const QVariant& val, bool commit )
 {
     if ( !valid_value(val) )
@@ -20,6 +20,7 @@
 #include <QGradient>
 
 #include "model/animation/frame_time.hpp"
+#include "model/property/property_id.hpp"
 
 namespace glaxnimate::math::bezier { class Bezier; }
 
@@ -192,7 +193,15 @@ public:
 
     const QString& name() const
     {
-        return name_;
+        return id_.name();
+    }
+
+    /**
+     * \brief Interned name, faster than name() for lookups and comparisons
+     */
+    PropertyId id() const
+    {
+        return id_;
     }
 
     PropertyTraits traits() const
@@ -207,10 +216,11 @@ public:
 
 protected:
     void value_changed();
+    void keyframes_changed();
 
 private:
     Object* object_;
-    QString name_;
+    PropertyId id_;
     PropertyTraits traits_;
 };
 
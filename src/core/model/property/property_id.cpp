@@ -0,0 +1,74 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "property_id.hpp"
+
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include "app/utils/qstring_hash.hpp"
+
+struct glaxnimate::model::PropertyId::Registry
+{
+    std::shared_mutex mutex;
+    /// deque so pointers to existing entries aren't invalidated on insertion
+    std::deque<Entry> entries;
+    std::unordered_map<QString, const Entry*> by_name;
+};
+
+glaxnimate::model::PropertyId::Registry & glaxnimate::model::PropertyId::registry()
+{
+    // Function-local so ids can be used by static data in other translation units
+    static Registry registry;
+    return registry;
+}
+
+glaxnimate::model::PropertyId::PropertyId(const QString& name)
+{
+    Registry& registry = PropertyId::registry();
+
+    {
+        std::shared_lock lock(registry.mutex);
+        auto it = registry.by_name.find(name);
+        if ( it != registry.by_name.end() )
+        {
+            entry = it->second;
+            return;
+        }
+    }
+
+    std::unique_lock lock(registry.mutex);
+    // Another thread might have registered it in the meantime
+    auto it = registry.by_name.find(name);
+    if ( it != registry.by_name.end() )
+    {
+        entry = it->second;
+        return;
+    }
+
+    registry.entries.push_back({name, int(registry.entries.size())});
+    entry = &registry.entries.back();
+    registry.by_name.emplace(name, entry);
+}
+
+glaxnimate::model::PropertyId glaxnimate::model::PropertyId::find(const QString& name)
+{
+    Registry& registry = PropertyId::registry();
+
+    std::shared_lock lock(registry.mutex);
+    auto it = registry.by_name.find(name);
+    if ( it == registry.by_name.end() )
+        return {};
+    return PropertyId(it->second);
+}
+
+const QString & glaxnimate::model::PropertyId::name() const noexcept
+{
+    static const QString empty;
+    return entry ? entry->name : empty;
+}
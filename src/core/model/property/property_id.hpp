@@ -0,0 +1,66 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <QString>
+
+namespace glaxnimate::model {
+
+/**
+ * \brief Interned property name
+ *
+ * Each distinct name is registered once (the first time a property with that
+ * name is constructed) and gets a small sequential index,
+ * so properties can be compared and looked up without hashing strings.
+ */
+class PropertyId
+{
+public:
+    /**
+     * \brief Invalid id, doesn't match any property
+     */
+    constexpr PropertyId() noexcept = default;
+
+    /**
+     * \brief Returns the id for \p name, registering it if needed
+     */
+    explicit PropertyId(const QString& name);
+
+    /**
+     * \brief Returns the id for \p name if it has been registered, an invalid id otherwise
+     */
+    static PropertyId find(const QString& name);
+
+    bool valid() const noexcept { return entry; }
+
+    /**
+     * \brief Sequential index, -1 if not valid
+     */
+    int index() const noexcept { return entry ? entry->index : -1; }
+
+    const QString& name() const noexcept;
+
+    bool operator==(const PropertyId& other) const noexcept { return entry == other.entry; }
+    bool operator!=(const PropertyId& other) const noexcept { return entry != other.entry; }
+
+private:
+    struct Entry
+    {
+        QString name;
+        int index;
+    };
+
+    explicit PropertyId(const Entry* entry) noexcept : entry(entry) {}
+
+    struct Registry;
+    static Registry& registry();
+
+    /// Entries are never freed so ids and names stay valid for the whole program
+    const Entry* entry = nullptr;
+};
+
+} // namespace glaxnimate::model
@@ -27,6 +27,12 @@ public:
 
     virtual const model::Object* sub_object() const = 0;
     virtual model::Object* sub_object() = 0;
+
+protected:
+    void adopt(model::Object* sub_object)
+    {
+        sub_object->set_owner_property(this);
+    }
 };
 
 template<class Type>
@@ -36,7 +42,9 @@ public:
     SubObjectProperty(Object* obj, const QString& name)
         : SubObjectPropertyBase(obj, name),
         sub_obj(obj->document())
-    {}
+    {
+        adopt(&sub_obj);
+    }
 
     const Type* operator->() const
     {
@@ -0,0 +1,503 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "render_program.hpp"
+
+#include <unordered_set>
+
+#include <QPainter>
+#include <QtConcurrent>
+
+#include "math/bezier/frame_arena.hpp"
+#include "model/document.hpp"
+#include "model/assets/composition.hpp"
+#include "model/shapes/fill.hpp"
+#include "model/shapes/layer.hpp"
+#include "model/shapes/precomp_layer.hpp"
+#include "model/shapes/stroke.hpp"
+#include "model/shapes/text.hpp"
+
+namespace {
+
+using namespace glaxnimate::model;
+
+/**
+ * \brief Whether nothing affecting \p object is animated, following sub-objects and references
+ */
+bool is_static(const Object* object, std::unordered_set<const Object*>& visited)
+{
+    if ( !object || !visited.insert(object).second )
+        return true;
+
+    for ( auto prop : object->properties() )
+    {
+        const auto& traits = prop->traits();
+        if ( traits.flags & PropertyTraits::Animated )
+        {
+            if ( static_cast<const AnimatableBase*>(prop)->animated() )
+                return false;
+        }
+        else if ( traits.is_object() )
+        {
+            QVariant value = prop->value();
+            if ( traits.flags & PropertyTraits::List )
+            {
+                for ( const auto& item : value.toList() )
+                    if ( !is_static(item.value<Object*>(), visited) )
+                        return false;
+            }
+            else if ( !is_static(value.value<Object*>(), visited) )
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool is_static(const Object* object)
+{
+    std::unordered_set<const Object*> visited;
+    return is_static(object, visited);
+}
+
+bool local_transform_static(const VisualNode* node)
+{
+    if ( auto group = qobject_cast<const Group*>(node) )
+        return is_static(group->transform.get());
+    if ( auto layer = qobject_cast<const PreCompLayer*>(node) )
+        return is_static(layer->transform.get());
+    return true;
+}
+
+/**
+ * \brief Whether VisualNode::transform_matrix() for \p node is constant
+ */
+bool transform_static(const VisualNode* node)
+{
+    if ( !node )
+        return true;
+
+    return local_transform_static(node) &&
+        transform_static(node->docnode_visual_parent()) &&
+        transform_static(node->docnode_group_parent());
+}
+
+/**
+ * \brief Whether VisualNode::group_transform_matrix() for \p node is constant
+ */
+bool group_transform_static(const VisualNode* node)
+{
+    return local_transform_static(node) && transform_static(node->docnode_group_parent());
+}
+
+} // namespace
+
+glaxnimate::model::RenderProgram::RenderProgram(Composition* comp, VisualNode::PaintMode mode)
+    : comp(comp), mode(mode)
+{
+    // All edits go through the undo stack, so this catches any change in structure or static values
+    undo_connection = QObject::connect(&comp->document()->undo_stack(), &QUndoStack::indexChanged, [this]{
+        outdated_ = true;
+    });
+    compile();
+}
+
+glaxnimate::model::RenderProgram::~RenderProgram()
+{
+    QObject::disconnect(undo_connection);
+}
+
+bool glaxnimate::model::RenderProgram::outdated() const
+{
+    return outdated_;
+}
+
+void glaxnimate::model::RenderProgram::set_parallel(bool parallel)
+{
+    parallel_ = parallel;
+}
+
+bool glaxnimate::model::RenderProgram::parallel() const
+{
+    return parallel_;
+}
+
+int glaxnimate::model::RenderProgram::size() const
+{
+    return ops.size();
+}
+
+int glaxnimate::model::RenderProgram::dynamic_slots() const
+{
+    int count = times.size() - 1;
+    for ( const auto& slot : transforms )
+        count += slot.dynamic;
+    for ( const auto& slot : opacities )
+        count += slot.dynamic;
+    for ( const auto& slot : draws )
+        count += slot.dynamic_path + slot.dynamic_style;
+    return count;
+}
+
+void glaxnimate::model::RenderProgram::add_op(OpCode code, int slot, int time)
+{
+    ops.push_back({code, slot, time});
+}
+
+void glaxnimate::model::RenderProgram::add_segment(int begin)
+{
+    int end = ops.size();
+    if ( end == begin )
+        return;
+
+    bool dynamic = false;
+    for ( int i = begin; i < end && !dynamic; i++ )
+        dynamic = ops[i].code == OpCode::Draw && draws[ops[i].slot].dynamic_path;
+
+    segments.push_back({begin, end, dynamic});
+}
+
+void glaxnimate::model::RenderProgram::compile()
+{
+    outdated_ = false;
+    ops.clear();
+    times.clear();
+    transforms.clear();
+    opacities.clear();
+    draws.clear();
+    nodes.clear();
+    segments.clear();
+
+    // Time slot 0 is the time passed to render()
+    times.push_back({nullptr, -1});
+
+    if ( !comp->visible.get() )
+        return;
+
+    add_op(OpCode::Save);
+    compile_children(comp, 0);
+    add_op(OpCode::Restore);
+}
+
+void glaxnimate::model::RenderProgram::compile_children(const VisualNode* node, int time)
+{
+    // Same as VisualNode::paint()
+    bool top_level = node == comp;
+    for ( auto child : node->docnode_visual_children() )
+    {
+        int begin = ops.size();
+
+        if ( child->is_instance<Modifier>() )
+        {
+            if ( child->visible.get() )
+            {
+                add_op(OpCode::PaintNode, nodes.size(), time);
+                nodes.push_back(child);
+            }
+            if ( top_level )
+                add_segment(begin);
+            break;
+        }
+
+        compile_node(child, time);
+        if ( top_level )
+            add_segment(begin);
+    }
+}
+
+void glaxnimate::model::RenderProgram::compile_node(const VisualNode* node, int time)
+{
+    if ( !node->visible.get() )
+        return;
+
+    if ( auto layer = qobject_cast<const Layer*>(node) )
+    {
+        if ( mode == VisualNode::Render && !layer->render.get() )
+            return;
+
+        if ( !layer->mask->has_mask() )
+        {
+            int layer_time = times.size();
+            times.push_back({layer, time});
+            int op_index = ops.size();
+            add_op(OpCode::LayerTime, layer_time, time);
+            compile_group(layer, layer_time);
+            ops[op_index].jump = ops.size();
+            return;
+        }
+    }
+    else if ( auto group = qobject_cast<const Group*>(node) )
+    {
+        compile_group(group, time);
+        return;
+    }
+    else if ( auto styler = qobject_cast<const Styler*>(node) )
+    {
+        compile_draw(styler, time);
+        return;
+    }
+    else if ( qobject_cast<const Shape*>(node) || qobject_cast<const TextShape*>(node) )
+    {
+        // Only used by stylers
+        return;
+    }
+
+    add_op(OpCode::PaintNode, nodes.size(), time);
+    nodes.push_back(node);
+}
+
+void glaxnimate::model::RenderProgram::compile_group(const Group* group, int time)
+{
+    add_op(OpCode::Save);
+
+    bool dynamic = !group_transform_static(group);
+    QTransform transform = dynamic ? QTransform() : group->group_transform_matrix(0);
+    if ( dynamic || !transform.isIdentity() )
+    {
+        add_op(OpCode::Transform, transforms.size(), time);
+        transforms.push_back({group, dynamic, transform});
+    }
+
+    dynamic = group->opacity.animated();
+    qreal opacity = group->opacity.get();
+    if ( dynamic || opacity != 1 )
+    {
+        add_op(OpCode::Opacity, opacities.size(), time);
+        opacities.push_back({group, dynamic, opacity});
+    }
+
+    compile_children(group, time);
+
+    add_op(OpCode::Restore);
+}
+
+void glaxnimate::model::RenderProgram::compile_draw(const Styler* styler, int time)
+{
+    DrawSlot slot;
+    slot.styler = styler;
+    slot.stroke = qobject_cast<const Stroke*>(styler);
+
+    slot.dynamic_style = !is_static(styler);
+
+    std::unordered_set<const Object*> visited;
+    slot.dynamic_path = false;
+    for ( auto shape : styler->affected() )
+    {
+        if ( !is_static(shape, visited) )
+        {
+            slot.dynamic_path = true;
+            break;
+        }
+    }
+
+    if ( !slot.dynamic_path )
+        slot.path = draw_path(slot, 0);
+
+    if ( !slot.dynamic_style )
+        draw_style(slot, 0, slot.brush, slot.pen, slot.opacity);
+
+    add_op(OpCode::Draw, draws.size(), time);
+    draws.push_back(std::move(slot));
+}
+
+QPainterPath glaxnimate::model::RenderProgram::draw_path(const DrawSlot& slot, FrameTime time) const
+{
+    QPainterPath path = slot.styler->collect_shapes(time, {}).painter_path();
+    if ( !slot.stroke )
+        path.setFillRule(Qt::FillRule(static_cast<const Fill*>(slot.styler)->fill_rule.get()));
+    return path;
+}
+
+void glaxnimate::model::RenderProgram::draw_style(const DrawSlot& slot, FrameTime time, QBrush& brush, QPen& pen, qreal& opacity) const
+{
+    opacity = slot.styler->opacity.get_at(time);
+
+    if ( slot.stroke )
+    {
+        brush = Qt::NoBrush;
+        pen = static_cast<const Stroke*>(slot.styler)->pen(time);
+    }
+    else
+    {
+        brush = slot.styler->brush(time);
+        pen = Qt::NoPen;
+    }
+}
+
+void glaxnimate::model::RenderProgram::evaluate(const Segment& segment, FrameValues& values) const
+{
+    for ( int i = segment.begin; i < segment.end; i++ )
+    {
+        const Op& op = ops[i];
+        FrameTime t = values.times[op.time];
+
+        switch ( op.code )
+        {
+            case OpCode::LayerTime:
+            {
+                const Layer* layer = times[op.slot].layer;
+                FrameTime local = layer->relative_time(t);
+                values.times[op.slot] = local;
+                values.visible[op.slot] = layer->animation->time_visible(local);
+                if ( !values.visible[op.slot] )
+                    i = op.jump - 1;
+                break;
+            }
+
+            case OpCode::Transform:
+            {
+                const TransformSlot& slot = transforms[op.slot];
+                if ( slot.dynamic )
+                    values.transforms[op.slot] = slot.node->group_transform_matrix(t);
+                break;
+            }
+
+            case OpCode::Opacity:
+            {
+                const OpacitySlot& slot = opacities[op.slot];
+                if ( slot.dynamic )
+                    values.opacities[op.slot] = slot.group->opacity.get_at(t);
+                break;
+            }
+
+            case OpCode::Draw:
+            {
+                const DrawSlot& slot = draws[op.slot];
+                DrawRecord& record = values.draws[op.slot];
+                if ( slot.dynamic_style )
+                    draw_style(slot, t, record.brush, record.pen, record.opacity);
+                if ( slot.dynamic_path )
+                    record.path = draw_path(slot, t);
+                break;
+            }
+
+            case OpCode::Save:
+            case OpCode::Restore:
+            case OpCode::PaintNode:
+                break;
+        }
+    }
+}
+
+void glaxnimate::model::RenderProgram::replay(QPainter* painter, const FrameValues& values) const
+{
+    for ( int i = 0; i < int(ops.size()); i++ )
+    {
+        const Op& op = ops[i];
+
+        switch ( op.code )
+        {
+            case OpCode::Save:
+                painter->save();
+                break;
+
+            case OpCode::Restore:
+                painter->restore();
+                break;
+
+            case OpCode::LayerTime:
+                if ( !values.visible[op.slot] )
+                    i = op.jump - 1;
+                break;
+
+            case OpCode::Transform:
+            {
+                const TransformSlot& slot = transforms[op.slot];
+                painter->setTransform(slot.dynamic ? values.transforms[op.slot] : slot.value, true);
+                break;
+            }
+
+            case OpCode::Opacity:
+            {
+                const OpacitySlot& slot = opacities[op.slot];
+                painter->setOpacity(painter->opacity() * (slot.dynamic ? values.opacities[op.slot] : slot.value));
+                break;
+            }
+
+            case OpCode::Draw:
+            {
+                const DrawSlot& slot = draws[op.slot];
+                const DrawRecord& record = values.draws[op.slot];
+                qreal old_opacity = painter->opacity();
+                painter->setOpacity(old_opacity * (slot.dynamic_style ? record.opacity : slot.opacity));
+                painter->setBrush(slot.dynamic_style ? record.brush : slot.brush);
+                painter->setPen(slot.dynamic_style ? record.pen : slot.pen);
+                painter->drawPath(slot.dynamic_path ? record.path : slot.path);
+                painter->setOpacity(old_opacity);
+                break;
+            }
+
+            case OpCode::PaintNode:
+                nodes[op.slot]->paint(painter, values.times[op.time], mode);
+                break;
+        }
+    }
+}
+
+void glaxnimate::model::RenderProgram::render(QPainter* painter, FrameTime time) const
+{
+    // Draw records only hold Qt values, so the geometry can be released after each phase
+    math::bezier::FrameArena::Scope arena;
+
+    FrameValues values;
+    values.times.resize(times.size());
+    values.times[0] = time;
+    values.visible.resize(times.size(), true);
+    values.transforms.resize(transforms.size());
+    values.opacities.resize(opacities.size());
+    values.draws.resize(draws.size());
+
+    // Segments write to disjoint slots so they can be evaluated concurrently,
+    // only those with paths to build are worth sending to the thread pool
+    std::vector<Segment> concurrent;
+    for ( const auto& segment : segments )
+    {
+        if ( parallel_ && segment.dynamic )
+            concurrent.push_back(segment);
+        else
+            evaluate(segment, values);
+    }
+
+    if ( concurrent.size() > 1 )
+        QtConcurrent::blockingMap(concurrent, [this, &values](const Segment& segment){
+            math::bezier::FrameArena::Scope arena;
+            evaluate(segment, values);
+        });
+    else if ( !concurrent.empty() )
+        evaluate(concurrent[0], values);
+
+    replay(painter, values);
+}
+
+QImage glaxnimate::model::RenderProgram::render_image(FrameTime time, QSize image_size, const QColor& background) const
+{
+    if ( !image_size.isValid() )
+        image_size = comp->size().toSize();
+
+    QImage image(image_size, QImage::Format_RGBA8888);
+    render_into(image, time, background);
+    return image;
+}
+
+void glaxnimate::model::RenderProgram::render_into(QImage& image, FrameTime time, const QColor& background) const
+{
+    QSizeF real_size = comp->size();
+
+    if ( !background.isValid() )
+        image.fill(Qt::transparent);
+    else
+        image.fill(background);
+
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.scale(
+        image.width() / real_size.width(),
+        image.height() / real_size.height()
+    );
+    render(&painter, time);
+}
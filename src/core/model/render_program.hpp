@@ -0,0 +1,214 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+#include <QBrush>
+#include <QImage>
+#include <QMetaObject>
+#include <QPainterPath>
+#include <QPen>
+#include <QTransform>
+
+#include "model/document_node.hpp"
+
+namespace glaxnimate::model {
+
+class Composition;
+class Group;
+class Layer;
+class Styler;
+
+/**
+ * \brief Flat list of drawing operations compiled from a composition
+ *
+ * Compiling walks the document tree once, rendering replays the operations
+ * and only evaluates values that depend on animated properties, values that
+ * don't change over time are evaluated while compiling.
+ *
+ * Nodes that need the full tree logic (masks, modifiers, precomps, images)
+ * are painted through VisualNode::paint().
+ *
+ * The program doesn't track the tree structure, it becomes outdated() when the
+ * document is modified.
+ * Rendering doesn't modify the program so it can be used from multiple threads.
+ *
+ * Rendering a frame has two phases: first the animated values are evaluated
+ * into per-frame draw records, then the operations are replayed on the painter.
+ * The first phase is independent for each top-level node so it can be
+ * spread over the global thread pool (see set_parallel()),
+ * text layout is serialized by Font.
+ */
+class RenderProgram
+{
+public:
+    explicit RenderProgram(Composition* comp, VisualNode::PaintMode mode = VisualNode::Render);
+    ~RenderProgram();
+
+    RenderProgram(const RenderProgram&) = delete;
+    RenderProgram& operator=(const RenderProgram&) = delete;
+
+    /**
+     * \brief Whether the document has changed since the program has been compiled
+     */
+    bool outdated() const;
+
+    /**
+     * \brief Rebuilds the operations from the current state of the composition
+     */
+    void compile();
+
+    /**
+     * \brief Paints the composition at the given time
+     */
+    void render(QPainter* painter, FrameTime time) const;
+
+    /**
+     * \brief Renders a frame to an image, same as Composition::render_image()
+     */
+    QImage render_image(FrameTime time, QSize image_size = {}, const QColor& background = {}) const;
+
+    /**
+     * \brief Renders a frame into an existing image, scaled to fill it
+     *
+     * The image can wrap external memory, its pixels are overwritten.
+     */
+    void render_into(QImage& image, FrameTime time, const QColor& background = {}) const;
+
+    /**
+     * \brief Whether render() evaluates top-level nodes concurrently
+     *
+     * This reduces the latency of a single frame, when rendering several frames
+     * at the same time it's better to leave it disabled.
+     */
+    void set_parallel(bool parallel);
+    bool parallel() const;
+
+    /**
+     * \brief Number of operations in the program
+     */
+    int size() const;
+
+    /**
+     * \brief Number of values that need to be evaluated on every frame
+     */
+    int dynamic_slots() const;
+
+private:
+    enum class OpCode
+    {
+        Save,
+        Restore,
+        /// Evaluates a layer time and skips to jump if the layer is not visible
+        LayerTime,
+        Transform,
+        Opacity,
+        Draw,
+        /// Fallback to VisualNode::paint
+        PaintNode,
+    };
+
+    struct Op
+    {
+        OpCode code;
+        /// Index in the slot array for the op code
+        int slot = -1;
+        /// Index of the time slot used to evaluate the op
+        int time = 0;
+        /// Next op for LayerTime
+        int jump = -1;
+    };
+
+    struct TimeSlot
+    {
+        const Layer* layer;
+        int parent;
+    };
+
+    struct TransformSlot
+    {
+        const VisualNode* node;
+        bool dynamic;
+        QTransform value;
+    };
+
+    struct OpacitySlot
+    {
+        const Group* group;
+        bool dynamic;
+        qreal value;
+    };
+
+    /// Range of ops compiled from a top-level node
+    struct Segment
+    {
+        int begin;
+        int end;
+        /// Whether it contains paths evaluated at render time
+        bool dynamic;
+    };
+
+    /// Values evaluated for a single frame
+    struct DrawRecord
+    {
+        QPainterPath path;
+        QBrush brush;
+        QPen pen;
+        qreal opacity = 1;
+    };
+
+    struct FrameValues
+    {
+        std::vector<FrameTime> times;
+        std::vector<char> visible;
+        std::vector<QTransform> transforms;
+        std::vector<qreal> opacities;
+        std::vector<DrawRecord> draws;
+    };
+
+    struct DrawSlot
+    {
+        const Styler* styler;
+        bool stroke;
+        bool dynamic_path;
+        bool dynamic_style;
+        QPainterPath path;
+        QBrush brush;
+        QPen pen;
+        qreal opacity;
+    };
+
+    void compile_node(const VisualNode* node, int time);
+    void compile_group(const Group* group, int time);
+    void compile_children(const VisualNode* node, int time);
+    void compile_draw(const Styler* styler, int time);
+    void add_op(OpCode code, int slot = -1, int time = 0);
+    void add_segment(int begin);
+
+    void evaluate(const Segment& segment, FrameValues& values) const;
+    void replay(QPainter* painter, const FrameValues& values) const;
+
+    QPainterPath draw_path(const DrawSlot& slot, FrameTime time) const;
+    void draw_style(const DrawSlot& slot, FrameTime time, QBrush& brush, QPen& pen, qreal& opacity) const;
+
+    Composition* comp;
+    VisualNode::PaintMode mode;
+    std::vector<Op> ops;
+    std::vector<TimeSlot> times;
+    std::vector<TransformSlot> transforms;
+    std::vector<OpacitySlot> opacities;
+    std::vector<DrawSlot> draws;
+    std::vector<const VisualNode*> nodes;
+    std::vector<Segment> segments;
+    bool parallel_ = false;
+    std::atomic<bool> outdated_ = false;
+    QMetaObject::Connection undo_connection;
+};
+
+} // namespace glaxnimate::model
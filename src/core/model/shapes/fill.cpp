@@ -6,6 +6,9 @@
 
 #include "fill.hpp"
 
+#include "model/document.hpp"
+#include "math/bezier/rasterizer.hpp"
+
 GLAXNIMATE_OBJECT_IMPL(glaxnimate::model::Fill)
 
 void glaxnimate::model::Fill::on_paint(QPainter* p, glaxnimate::model::FrameTime t, glaxnimate::model::VisualNode::PaintMode, glaxnimate::model::Modifier* modifier) const
@@ -14,12 +17,15 @@ void glaxnimate::model::Fill::on_paint(QPainter* p, glaxnimate::model::FrameTime
     p->setOpacity(p->opacity() * opacity.get_at(t));
     p->setPen(Qt::NoPen);
 
-    math::bezier::MultiBezier bez;
+    math::bezier::MultiBezier bez(math::bezier::FrameArena::resource());
     if ( modifier )
         bez = modifier->collect_shapes_from(affected(), t, {});
     else
         bez = collect_shapes(t, {});
 
+    if ( document()->direct_rasterization() && math::bezier::Rasterizer::fill(p, bez, Qt::FillRule(fill_rule.get()), p->brush()) )
+        return;
+
     QPainterPath path = bez.painter_path();
 
     path.setFillRule(Qt::FillRule(fill_rule.get()));
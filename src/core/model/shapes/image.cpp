@@ -89,6 +89,6 @@ QPainterPath glaxnimate::model::Image::to_painter_path_impl(FrameTime time) cons
 {
     auto trans = transform.get()->transform_matrix(time);
     QPainterPath p;
-    p.addPolygon(trans.map(QRectF(QPointF(0, 0), image.get() ? image->pixmap().size() : QSize(0, 0))));
+    p.addPolygon(trans.map(QRectF(QPointF(0, 0), image.get() ? image->size() : QSize(0, 0))));
     return p;
 }
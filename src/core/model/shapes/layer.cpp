@@ -8,11 +8,20 @@
 
 #include <QPainter>
 
+#include "math/bezier/frame_arena.hpp"
 #include "model/assets/composition.hpp"
 #include "model/document.hpp"
+#include "utils/profiler.hpp"
 
 GLAXNIMATE_OBJECT_IMPL(glaxnimate::model::Layer)
 
+glaxnimate::model::Layer::Layer(Document* document)
+    : Ctor(document)
+{
+    connect(animation.get(), &AnimationContainer::first_frame_changed, this, &Layer::docnode_invalidate_time_invariant);
+    connect(animation.get(), &AnimationContainer::last_frame_changed, this, &Layer::docnode_invalidate_time_invariant);
+}
+
 void glaxnimate::model::Layer::ChildLayerIterator::find_first()
 {
     while ( index < comp->size() && (*comp)[index]->docnode_group_parent() != parent )
@@ -123,6 +132,16 @@ void glaxnimate::model::Layer::paint(QPainter* painter, FrameTime time, PaintMod
         if ( n_shapes <= 1 )
             return;
 
+        // Masked layers don't go through VisualNode::paint()
+        utils::profiler::Scope scope("paint", this);
+        math::bezier::FrameArena::Scope arena;
+
+        if ( mask->is_matte() )
+        {
+            paint_matte(painter, time, mode, modifier);
+            return;
+        }
+
         painter->save();
         auto transform = group_transform_matrix(time);
         painter->setTransform(transform, true);
@@ -156,6 +175,75 @@ void glaxnimate::model::Layer::paint(QPainter* painter, FrameTime time, PaintMod
     }
 }
 
+void glaxnimate::model::Layer::paint_matte(QPainter* painter, FrameTime time, PaintMode mode, glaxnimate::model::Modifier* modifier) const
+{
+    QTransform transform = group_transform_matrix(time) * painter->transform();
+
+    // Only the visible part of the device is rendered
+    QRectF area = painter->viewport();
+    if ( painter->hasClipping() )
+        area &= painter->transform().mapRect(painter->clipBoundingRect());
+    QRect rect = area.toAlignedRect();
+    if ( rect.isEmpty() )
+        return;
+
+    qreal dpr = painter->device()->devicePixelRatioF();
+    QTransform offset = transform * QTransform::fromTranslate(-rect.left(), -rect.top());
+
+    QImage content(rect.size() * dpr, QImage::Format_ARGB32_Premultiplied);
+    content.setDevicePixelRatio(dpr);
+    content.fill(Qt::transparent);
+    QPainter content_painter(&content);
+    content_painter.setRenderHints(painter->renderHints());
+    content_painter.setTransform(offset);
+    on_paint(&content_painter, time, mode, modifier);
+    for ( int i = 1, n_shapes = shapes.size(); i < n_shapes; i++ )
+        docnode_visual_child(i)->paint(&content_painter, time, mode);
+
+    if ( shapes[0]->visible.get() )
+    {
+        QImage matte(content.size(), QImage::Format_ARGB32_Premultiplied);
+        matte.setDevicePixelRatio(dpr);
+        matte.fill(Qt::transparent);
+        {
+            QPainter matte_painter(&matte);
+            matte_painter.setRenderHints(painter->renderHints());
+            matte_painter.setTransform(offset);
+            docnode_visual_child(0)->paint(&matte_painter, time, mode);
+        }
+
+        bool luma = mask->mask.get() == MaskSettings::Luma;
+        bool inverted = mask->inverted.get();
+        if ( luma || inverted )
+        {
+            for ( int y = 0; y < matte.height(); y++ )
+            {
+                QRgb* line = reinterpret_cast<QRgb*>(matte.scanLine(y));
+                for ( int x = 0; x < matte.width(); x++ )
+                {
+                    // Pixels are premultiplied so the luminance already accounts for the alpha
+                    QRgb pixel = line[x];
+                    int value = luma ? (qRed(pixel) * 299 + qGreen(pixel) * 587 + qBlue(pixel) * 114) / 1000 : qAlpha(pixel);
+                    if ( inverted )
+                        value = 255 - value;
+                    line[x] = qRgba(value, value, value, value);
+                }
+            }
+        }
+
+        content_painter.resetTransform();
+        content_painter.setOpacity(1);
+        content_painter.setCompositionMode(QPainter::CompositionMode_DestinationIn);
+        content_painter.drawImage(0, 0, matte);
+    }
+    content_painter.end();
+
+    painter->save();
+    painter->resetTransform();
+    painter->drawImage(rect.topLeft(), content);
+    painter->restore();
+}
+
 QPainterPath glaxnimate::model::Layer::to_clip(glaxnimate::model::FrameTime time) const
 {
     time = relative_time(time);
@@ -203,3 +291,15 @@ std::unique_ptr<glaxnimate::model::ShapeElement> glaxnimate::model::Layer::to_pa
 
     return clone;
 }
+
+bool glaxnimate::model::Layer::docnode_self_time_invariant() const
+{
+    if ( !Group::docnode_self_time_invariant() )
+        return false;
+
+    // Layers only shown for part of the composition change over time
+    auto comp = owner_composition();
+    return comp &&
+        animation->first_frame.get() <= comp->animation->first_frame.get() &&
+        animation->last_frame.get() >= comp->animation->last_frame.get();
+}
@@ -71,7 +71,7 @@ public:
         int index;
     };
 
-    using Ctor::Ctor;
+    explicit Layer(Document* document);
 
     VisualNode* docnode_group_parent() const override;
     int docnode_group_child_count() const override;
@@ -104,9 +104,15 @@ public:
 
 protected:
     QPainterPath to_painter_path_impl(model::FrameTime t) const override;
+    bool docnode_self_time_invariant() const override;
 
 private:
     std::vector<DocumentNode*> valid_parents() const;
+
+    /**
+     * \brief Paints the masked content through an offscreen buffer using the first shape as matte
+     */
+    void paint_matte(QPainter* painter, FrameTime time, PaintMode mode, model::Modifier* modifier) const;
 };
 
 } // namespace glaxnimate::model
@@ -19,18 +19,20 @@ static void to_path_value(
     glaxnimate::model::Document* document
 )
 {
+    std::vector<std::unique_ptr<glaxnimate::model::ShapeElement>> added;
     for ( int i = 0; i < mbez.size(); i++ )
     {
         if ( i >= int(paths.size()) )
         {
             auto new_path = std::make_unique<glaxnimate::model::Path>(document);
             paths.push_back(new_path.get());
-            group->shapes.insert(std::move(new_path));
+            added.push_back(std::move(new_path));
         }
 
         auto path = paths[i];
         path->shape.set(mbez.beziers()[i]);
     }
+    group->shapes.insert_range(std::move(added));
 }
 
 static void to_path_frame(
@@ -42,6 +44,7 @@ static void to_path_frame(
     glaxnimate::model::Document* document
 )
 {
+    std::vector<std::unique_ptr<glaxnimate::model::ShapeElement>> added;
     for ( int i = 0; i < mbez.size(); i++ )
     {
         if ( i >= int(paths.size()) )
@@ -54,12 +57,13 @@ static void to_path_frame(
                 new_path->shape.set_keyframe(0, glaxnimate::math::bezier::Bezier{})->set_transition({trans});
             }
             paths.push_back(new_path.get());
-            group->shapes.insert(std::move(new_path));
+            added.push_back(std::move(new_path));
         }
 
         auto path = paths[i];
         path->shape.set_keyframe(t, mbez.beziers()[i])->set_transition(transition);
     }
+    group->shapes.insert_range(std::move(added));
 }
 
 std::unique_ptr<glaxnimate::model::ShapeElement> glaxnimate::model::PathModifier::to_path() const
@@ -11,6 +11,7 @@
 #include "model/document.hpp"
 #include "model/assets/composition.hpp"
 #include "model/assets/assets.hpp"
+#include "model/precomp_render_cache.hpp"
 
 GLAXNIMATE_OBJECT_IMPL(glaxnimate::model::PreCompLayer)
 
@@ -63,6 +64,20 @@ void glaxnimate::model::PreCompLayer::on_paint(QPainter* painter, glaxnimate::mo
         painter->setOpacity(
             painter->opacity() * opacity.get_at(time)
         );
+
+        auto& cache = document()->precomp_cache();
+        QTransform world = painter->worldTransform();
+        // The cached image can only be blitted if it doesn't need resampling
+        if ( cache.enabled() && world.type() <= QTransform::TxScale && world.m11() > 0 && world.m22() > 0 )
+        {
+            QImage image = cache.image(composition.get(), time, size.get(), world.m11(), world.m22(), mode);
+            painter->save();
+            painter->resetTransform();
+            painter->drawImage(QPointF(world.dx(), world.dy()), image);
+            painter->restore();
+            return;
+        }
+
         painter->setClipRect(QRectF(QPointF(0, 0), size.get()), Qt::IntersectClip);
         composition->paint(painter, time, mode);
     }
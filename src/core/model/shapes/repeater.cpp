@@ -8,8 +8,15 @@
 
 #include <QPainter>
 
+#include "math/bezier/rasterizer.hpp"
+#include "model/document.hpp"
 #include "model/shapes/group.hpp"
+#include "model/shapes/layer.hpp"
+#include "model/shapes/fill.hpp"
+#include "model/shapes/stroke.hpp"
+#include "model/shapes/text.hpp"
 #include "model/animation/join_animatables.hpp"
+#include "utils/profiler.hpp"
 
 using namespace glaxnimate;
 
@@ -29,12 +36,22 @@ QString glaxnimate::model::Repeater::static_type_name_human()
 math::bezier::MultiBezier glaxnimate::model::Repeater::process(FrameTime t, const math::bezier::MultiBezier& mbez) const
 {
     QTransform matrix = transform->transform_matrix(t);
+    int n_copies = copies.get_at(t);
     math::bezier::MultiBezier out;
-    math::bezier::MultiBezier copy = mbez;
-    for ( int i = 0; i < copies.get_at(t); i++ )
+    auto& beziers = out.beziers();
+    beziers.reserve(mbez.size() * qMax(0, n_copies));
+
+    QTransform copy_matrix;
+    for ( int i = 0; i < n_copies; i++ )
     {
-        out.append(copy);
-        copy.transform(matrix);
+        auto start = beziers.size();
+        out.append(mbez);
+        if ( i > 0 )
+        {
+            for ( auto it = beziers.begin() + start; it != beziers.end(); ++it )
+                it->transform(copy_matrix);
+        }
+        copy_matrix = copy_matrix * matrix;
     }
     return out;
 
@@ -45,27 +62,138 @@ bool glaxnimate::model::Repeater::process_collected() const
     return true;
 }
 
+void glaxnimate::model::Repeater::on_graphics_changed()
+{
+    Modifier::on_graphics_changed();
+    instance_cache.mark_dirty();
+}
+
+void glaxnimate::model::Repeater::collect_instance(const VisualNode* node, FrameTime t, const QTransform& transform, qreal opacity, std::vector<Instance>& out) const
+{
+    // Same logic as VisualNode::paint() but flattened
+    if ( !node->visible.get() )
+        return;
+
+    if ( auto styler = qobject_cast<const Styler*>(node) )
+    {
+        math::bezier::MultiBezier shape = styler->collect_shapes(t, {});
+        QPainterPath path = shape.painter_path();
+        Qt::FillRule fill_rule = Qt::WindingFill;
+        if ( auto fill = qobject_cast<const Fill*>(styler) )
+            fill_rule = Qt::FillRule(fill->fill_rule.get());
+        path.setFillRule(fill_rule);
+        out.push_back({transform, opacity, styler, path, std::move(shape), fill_rule});
+    }
+    else if ( qobject_cast<const Shape*>(node) || qobject_cast<const TextShape*>(node) )
+    {
+        // Only used by stylers
+    }
+    else if ( qobject_cast<const Group*>(node) && !qobject_cast<const Layer*>(node) )
+    {
+        // Layers have their own timing and masks so they are painted normally
+        auto group = static_cast<const Group*>(node);
+        QTransform group_transform = group->group_transform_matrix(t) * transform;
+        qreal group_opacity = opacity * group->opacity.get_at(t);
+        for ( auto child : group->docnode_visual_children() )
+        {
+            if ( child->is_instance<Modifier>() )
+            {
+                if ( child->visible.get() )
+                    out.push_back({group_transform, group_opacity, nullptr, {}, {}, Qt::WindingFill, child});
+                break;
+            }
+            collect_instance(child, t, group_transform, group_opacity, out);
+        }
+    }
+    else
+    {
+        out.push_back({transform, opacity, nullptr, {}, {}, Qt::WindingFill, node});
+    }
+}
+
+glaxnimate::model::Repeater::InstanceList glaxnimate::model::Repeater::collect_instances(FrameTime t) const
+{
+    utils::profiler::Scope scope("collect_instances", this);
+    auto instances = std::make_shared<std::vector<Instance>>();
+    for ( auto sib : affected() )
+        collect_instance(sib, t, {}, 1, *instances);
+    return instances;
+}
+
 void glaxnimate::model::Repeater::on_paint(QPainter* painter, glaxnimate::model::FrameTime t, glaxnimate::model::VisualNode::PaintMode mode, glaxnimate::model::Modifier*) const
 {
     QTransform matrix = transform->transform_matrix(t);
     auto alpha_s = start_opacity.get_at(t);
     auto alpha_e = end_opacity.get_at(t);
     int n_copies = copies.get_at(t);
+    if ( n_copies <= 0 )
+        return;
+
+    InstanceList instances = instance_cache.get(t, [this, t]{ return collect_instances(t); });
+
+    // Styles can change without invalidating the cache (eg: gradient assets)
+    // but they only need to be evaluated once per frame
+    struct Style
+    {
+        QBrush brush;
+        QPen pen;
+        qreal opacity;
+    };
+    std::vector<Style> styles;
+    styles.reserve(instances->size());
+    for ( const auto& instance : *instances )
+    {
+        Style style{Qt::NoBrush, Qt::NoPen, instance.opacity};
+        if ( auto stroke = qobject_cast<const Stroke*>(instance.styler) )
+            style.pen = stroke->pen(t);
+        else if ( instance.styler )
+            style.brush = instance.styler->brush(t);
+
+        if ( instance.styler )
+            style.opacity *= instance.styler->opacity.get_at(t);
+        styles.push_back(std::move(style));
+    }
+
+    // Same as Fill::on_paint() and Stroke::on_paint(), falls back to QPainter when not supported
+    bool direct = document()->direct_rasterization();
+    auto rasterize = [painter](const Instance& instance, const Style& style){
+        if ( style.pen.style() != Qt::NoPen )
+            return math::bezier::Rasterizer::stroke(painter, instance.shape, style.pen);
+        return math::bezier::Rasterizer::fill(painter, instance.shape, instance.fill_rule, style.brush);
+    };
+
+    QTransform base_transform = painter->transform();
+    qreal base_opacity = painter->opacity();
+    QTransform copy_transform = base_transform;
 
     for ( int i = 0; i < n_copies; i++ )
     {
         float alpha_lerp = float(i) / (n_copies == 1 ? 1 : n_copies - 1);
-        auto alpha = math::lerp(alpha_s, alpha_e, alpha_lerp);
-        painter->setOpacity(alpha * painter->opacity());
+        qreal alpha = math::lerp(alpha_s, alpha_e, alpha_lerp) * base_opacity;
 
-        for ( auto sib : affected() )
+        for ( int j = 0; j < int(instances->size()); j++ )
         {
-            if ( sib->visible.get() )
-                sib->paint(painter, t, mode);
+            const Instance& instance = (*instances)[j];
+            painter->setTransform(instance.transform * copy_transform);
+            painter->setOpacity(alpha * styles[j].opacity);
+
+            if ( instance.node )
+            {
+                instance.node->paint(painter, t, mode);
+            }
+            else if ( !direct || !rasterize(instance, styles[j]) )
+            {
+                painter->setBrush(styles[j].brush);
+                painter->setPen(styles[j].pen);
+                painter->drawPath(instance.path);
+            }
         }
 
-        painter->setTransform(matrix, true);
+        copy_transform = matrix * copy_transform;
     }
+
+    painter->setTransform(base_transform);
+    painter->setOpacity(base_opacity);
 }
 
 
@@ -6,6 +6,10 @@
 
 #pragma once
 
+#include <memory>
+
+#include <QPainterPath>
+
 #include "shape.hpp"
 
 #include "model/transform.hpp"
@@ -13,6 +17,8 @@
 
 namespace glaxnimate::model {
 
+class Styler;
+
 class Repeater : public StaticOverrides<Repeater, Modifier>
 {
     GLAXNIMATE_OBJECT(Repeater)
@@ -35,7 +41,33 @@ protected:
     math::bezier::MultiBezier process(FrameTime t, const math::bezier::MultiBezier& mbez) const override;
     void on_paint(QPainter* p, FrameTime t, PaintMode, model::Modifier*) const override;
     bool process_collected() const override;
+    void on_graphics_changed() override;
+
+private:
+    /**
+     * \brief Something to draw for each copy, relative to the repeater
+     */
+    struct Instance
+    {
+        QTransform transform;
+        qreal opacity = 1;
+        /// If not null the path is drawn with its brush or pen
+        const Styler* styler = nullptr;
+        QPainterPath path;
+        /// Same as path, for the direct rasterizer
+        math::bezier::MultiBezier shape;
+        Qt::FillRule fill_rule = Qt::WindingFill;
+        /// Nodes that can't be flattened are painted normally
+        const VisualNode* node = nullptr;
+    };
+
+    using InstanceList = std::shared_ptr<const std::vector<Instance>>;
+
+    InstanceList collect_instances(FrameTime t) const;
+    void collect_instance(const VisualNode* node, FrameTime t, const QTransform& transform, qreal opacity, std::vector<Instance>& out) const;
 
+    /// Shared by all the copies (and threads) drawing the same frame
+    mutable PathCache<InstanceList> instance_cache;
 };
 
 } // namespace glaxnimate::model
@@ -9,6 +9,7 @@
 #include "styler.hpp"
 #include "path.hpp"
 #include "model/animation/join_animatables.hpp"
+#include "utils/profiler.hpp"
 
 using namespace glaxnimate;
 
@@ -131,9 +132,7 @@ QPainterPath glaxnimate::model::ShapeElement::to_clip(FrameTime t) const
 
 QPainterPath glaxnimate::model::ShapeElement::to_painter_path(FrameTime t) const
 {
-    if ( d->cached_path.is_dirty(t) )
-        d->cached_path.set_path(t, to_painter_path_impl(t));
-    return d->cached_path.path();
+    return d->cached_path.get(t, [this, t]{ return to_painter_path_impl(t); });
 }
 
 void glaxnimate::model::ShapeElement::on_graphics_changed()
@@ -240,7 +239,7 @@ void glaxnimate::model::ShapeOperator::do_collect_shapes(const std::vector<Shape
 
 math::bezier::MultiBezier glaxnimate::model::ShapeOperator::collect_shapes_from(const std::vector<ShapeElement *>& shapes, glaxnimate::model::FrameTime t, const QTransform& transform) const
 {
-    math::bezier::MultiBezier bez;
+    math::bezier::MultiBezier bez(math::bezier::FrameArena::resource());
     if ( visible.get() )
         do_collect_shapes(shapes, t, bez, transform);
     return bez;
@@ -249,9 +248,10 @@ math::bezier::MultiBezier glaxnimate::model::ShapeOperator::collect_shapes_from(
 
 math::bezier::MultiBezier glaxnimate::model::ShapeOperator::collect_shapes(FrameTime t, const QTransform& transform) const
 {
-    if ( bezier_cache.is_dirty(t) )
-        bezier_cache.set_path(t, collect_shapes_from(affected_elements, t, transform));
-    return bezier_cache.path();
+    return bezier_cache.get(t, [this, t, &transform]{
+        utils::profiler::Scope scope("collect_shapes", this);
+        return collect_shapes_from(affected_elements, t, transform);
+    });
 }
 
 void glaxnimate::model::ShapeOperator::update_affected()
@@ -292,16 +292,21 @@ void glaxnimate::model::Modifier::do_collect_shapes(const std::vector<ShapeEleme
 {
     bool post = process_collected();
 
+    auto profiled_process = [this, t](const math::bezier::MultiBezier& input){
+        utils::profiler::Scope scope("process", this);
+        return process(t, input);
+    };
+
     if ( post )
     {
-        math::bezier::MultiBezier temp;
+        math::bezier::MultiBezier temp(math::bezier::FrameArena::resource());
         for ( auto sib : shapes )
         {
             if ( sib->visible.get() )
                 sib->add_shapes(t, temp, transform);
         }
 
-        bez.append(process(t, temp));
+        bez.append(profiled_process(temp));
     }
     else
     {
@@ -309,9 +314,9 @@ void glaxnimate::model::Modifier::do_collect_shapes(const std::vector<ShapeEleme
         {
             if ( sib->visible.get() )
             {
-                math::bezier::MultiBezier temp;
+                math::bezier::MultiBezier temp(math::bezier::FrameArena::resource());
                 sib->add_shapes(t, temp, transform);
-                bez.append(process(t, temp));
+                bez.append(profiled_process(temp));
             }
         }
     }
@@ -319,7 +324,7 @@ void glaxnimate::model::Modifier::do_collect_shapes(const std::vector<ShapeEleme
 
 QPainterPath glaxnimate::model::Modifier::to_painter_path_impl(glaxnimate::model::FrameTime t) const
 {
-    math::bezier::MultiBezier bez;
+    math::bezier::MultiBezier bez(math::bezier::FrameArena::resource());
     add_shapes(t, bez, {});
     return bez.painter_path();
 }
@@ -6,6 +6,8 @@
 
 #pragma once
 
+#include <mutex>
+
 #include "model/document_node.hpp"
 #include "math/bezier/bezier.hpp"
 #include "model/property/object_list_property.hpp"
@@ -15,30 +17,58 @@ namespace glaxnimate::model {
 using ShapeListProperty = ObjectListProperty<class ShapeElement>;
 class Composition;
 
+/**
+ * \brief Caches the path for the last requested time
+ *
+ * Safe to use from multiple threads rendering at the same time.
+ */
 template<class T>
 class PathCache
 {
 public:
-    bool is_dirty(FrameTime time) const
+    void mark_dirty()
     {
-        return time != cached_time || dirty;
+        std::lock_guard lock(mutex);
+        dirty = true;
+        generation++;
     }
 
-    void mark_dirty() { dirty = true; }
-
-    const T& path() const { return cached_path; }
-
-    void set_path(FrameTime time, const T& path)
+    /**
+     * \brief Returns the cached path, calling \p generate if it's not valid for \p time
+     *
+     * \p generate is called without holding the lock as it can reach the caches of other nodes,
+     * if two threads miss at the same time both generate the path and the first one is kept.
+     */
+    template<class Func>
+    T get(FrameTime time, const Func& generate)
     {
-        cached_time = time;
-        dirty = false;
-        cached_path = path;
+        quint64 started;
+        {
+            std::lock_guard lock(mutex);
+            if ( time == cached_time && !dirty )
+                return cached_path;
+            started = generation;
+        }
+
+        T path = generate();
+
+        std::lock_guard lock(mutex);
+        // Don't publish a path that has been invalidated while it was being generated
+        if ( generation == started && (dirty || time != cached_time) )
+        {
+            cached_path = path;
+            cached_time = time;
+            dirty = false;
+        }
+        return path;
     }
 
 private:
     bool dirty = true;
     T cached_path = {};
     FrameTime cached_time = 0;
+    quint64 generation = 0;
+    std::mutex mutex;
 };
 
 /**
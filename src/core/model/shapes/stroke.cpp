@@ -5,27 +5,39 @@
  */
 
 #include "stroke.hpp"
+
+#include "model/document.hpp"
+#include "math/bezier/rasterizer.hpp"
+
 GLAXNIMATE_OBJECT_IMPL(glaxnimate::model::Stroke)
 
 void glaxnimate::model::Stroke::on_paint(QPainter* p, glaxnimate::model::FrameTime t, glaxnimate::model::VisualNode::PaintMode, glaxnimate::model::Modifier* modifier) const
 {
-    QPen pen(brush(t), width.get_at(t));
-    pen.setCapStyle(Qt::PenCapStyle(cap.get()));
-    pen.setJoinStyle(Qt::PenJoinStyle(join.get()));
-    pen.setMiterLimit(miter_limit.get());
     p->setBrush(Qt::NoBrush);
-    p->setPen(pen);
+    p->setPen(pen(t));
     p->setOpacity(p->opacity() * opacity.get_at(t));
 
-    math::bezier::MultiBezier bez;
+    math::bezier::MultiBezier bez(math::bezier::FrameArena::resource());
     if ( modifier )
         bez = modifier->collect_shapes(t, {});
     else
         bez = collect_shapes(t, {});
 
+    if ( document()->direct_rasterization() && math::bezier::Rasterizer::stroke(p, bez, p->pen()) )
+        return;
+
     p->drawPath(bez.painter_path());
 }
 
+QPen glaxnimate::model::Stroke::pen(glaxnimate::model::FrameTime t) const
+{
+    QPen pen(brush(t), width.get_at(t));
+    pen.setCapStyle(Qt::PenCapStyle(cap.get()));
+    pen.setJoinStyle(Qt::PenJoinStyle(join.get()));
+    pen.setMiterLimit(miter_limit.get());
+    return pen;
+}
+
 void glaxnimate::model::Stroke::set_pen_style ( const QPen& pen_style )
 {
     color.set(pen_style.color());
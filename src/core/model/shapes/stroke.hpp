@@ -71,6 +71,11 @@ public:
     void set_pen_style(const QPen& p);
     void set_pen_style_undoable(const QPen& p);
 
+    /**
+     * \brief Pen used to paint the stroke at the given time
+     */
+    QPen pen(FrameTime t) const;
+
 
 protected:
     QPainterPath to_painter_path_impl(FrameTime t) const override;
@@ -29,7 +29,9 @@ public:
 
     void add_shapes(FrameTime, math::bezier::MultiBezier&, const QTransform&) const override {}
 
-protected:
+    /**
+     * \brief Brush used to paint at the given time, from either color or use
+     */
     QBrush brush(FrameTime t) const;
 
 private:
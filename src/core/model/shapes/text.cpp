@@ -6,6 +6,8 @@
 
 #include "text.hpp"
 
+#include <mutex>
+
 #include <QTextLayout>
 #include <QFontInfo>
 #include <QMetaEnum>
@@ -20,6 +22,14 @@
 GLAXNIMATE_OBJECT_IMPL(glaxnimate::model::Font)
 GLAXNIMATE_OBJECT_IMPL(glaxnimate::model::TextShape)
 
+namespace {
+
+// Text layout and glyph outlines go through font engines Qt shares between fonts,
+// layers evaluated in parallel by RenderProgram must not use them at the same time
+std::mutex font_engine_mutex;
+
+} // namespace
+
 
 class glaxnimate::model::Font::Private
 {
@@ -239,7 +249,11 @@ QPainterPath glaxnimate::model::Font::path_for_glyph(quint32 glyph, glaxnimate::
     if ( it != cache.end() )
         return it->second;
 
-    QPainterPath path = d->path_for_glyph(glyph, fix_paint);
+    QPainterPath path;
+    {
+        std::lock_guard lock(font_engine_mutex);
+        path = d->path_for_glyph(glyph, fix_paint);
+    }
     cache.emplace(glyph, path);
     return path;
 }
@@ -257,6 +271,7 @@ void glaxnimate::model::Font::from_qfont(const QFont& f)
 
 glaxnimate::model::Font::ParagraphData glaxnimate::model::Font::layout(const QString& text) const
 {
+    std::lock_guard lock(font_engine_mutex);
     glaxnimate::model::Font::ParagraphData para_data;
 
     auto lines = text.split('\n');
@@ -372,67 +387,89 @@ glaxnimate::model::TextShape::TextShape(glaxnimate::model::Document* document)
 
 void glaxnimate::model::TextShape::on_text_changed()
 {
+    std::unique_lock lock(cache_mutex);
 #if QT_VERSION >= QT_VERSION_CHECK(5, 13, 0)
     shape_cache.clear();
 #else
     shape_cache = QPainterPath();
 #endif
+    shape_cache_generation++;
+    lock.unlock();
     propagate_bounding_rect_changed();
 }
 
 void glaxnimate::model::TextShape::on_font_changed()
 {
-    cache.clear();
+    {
+        std::lock_guard lock(cache_mutex);
+        cache.clear();
+    }
     on_text_changed();
 }
 
-const QPainterPath & glaxnimate::model::TextShape::untranslated_path(FrameTime t) const
+QPainterPath glaxnimate::model::TextShape::untranslated_path(FrameTime t) const
 {
-    if ( shape_cache.isEmpty() )
+    quint64 started;
     {
-        if ( path.get() )
-        {
-            QString txt = text.get();
-            txt.replace('\n', ' ');
-            auto bezier = path->shapes(t);
-            const int length_steps = 5;
+        std::lock_guard lock(cache_mutex);
+        if ( !shape_cache.isEmpty() )
+            return shape_cache;
+        started = shape_cache_generation;
+    }
+
+    // The glyph cache only belongs to this shape, so it's fine to lock it
+    // but the path is generated unlocked as path->shapes() uses other caches
+    auto glyph_path = [this](quint32 glyph){
+        std::lock_guard lock(cache_mutex);
+        return font->path_for_glyph(glyph, cache, true);
+    };
 
-            math::bezier::LengthData length_data(bezier, length_steps);
-            for ( const auto& line : font->layout(txt) )
+    QPainterPath generated;
+    if ( path.get() )
+    {
+        QString txt = text.get();
+        txt.replace('\n', ' ');
+        auto bezier = path->shapes(t);
+        const int length_steps = 5;
+
+        math::bezier::LengthData length_data(bezier, length_steps);
+        for ( const auto& line : font->layout(txt) )
+        {
+            for ( const auto& glyph : line.glyphs )
             {
-                for ( const auto& glyph : line.glyphs )
-                {
-                    qreal x = path_offset.get_at(t) + glyph.position.x();
-                    if ( x > length_data.length() || x < 0 )
-                        continue;
+                qreal x = path_offset.get_at(t) + glyph.position.x();
+                if ( x > length_data.length() || x < 0 )
+                    continue;
 
-                    auto glyph_shape = font->path_for_glyph(glyph.glyph, cache, true);
-                    auto glyph_rect = glyph_shape.boundingRect();
+                auto glyph_shape = glyph_path(glyph.glyph);
+                auto glyph_rect = glyph_shape.boundingRect();
 
-                    auto start1 = length_data.at_length(x);
-                    auto start2 = start1.descend();
-                    auto start_p = bezier.beziers()[start1.index].split_segment_point(start2.index, start2.ratio);
+                auto start1 = length_data.at_length(x);
+                auto start2 = start1.descend();
+                auto start_p = bezier.beziers()[start1.index].split_segment_point(start2.index, start2.ratio);
 
-                    auto end1 = length_data.at_length(x + glyph_rect.width());
-                    auto end2 = end1.descend();
-                    auto end_p = bezier.beziers()[end1.index].split_segment_point(end2.index, end2.ratio);
+                auto end1 = length_data.at_length(x + glyph_rect.width());
+                auto end2 = end1.descend();
+                auto end_p = bezier.beziers()[end1.index].split_segment_point(end2.index, end2.ratio);
 
-                    QTransform mat;
-                    mat.translate(start_p.pos.x(), start_p.pos.y());
-                    mat.rotate(qRadiansToDegrees(math::atan2(end_p.pos.y() - start_p.pos.y(), end_p.pos.x() - start_p.pos.x())));
-                    shape_cache += mat.map(glyph_shape);
-                }
+                QTransform mat;
+                mat.translate(start_p.pos.x(), start_p.pos.y());
+                mat.rotate(qRadiansToDegrees(math::atan2(end_p.pos.y() - start_p.pos.y(), end_p.pos.x() - start_p.pos.x())));
+                generated += mat.map(glyph_shape);
             }
         }
-        else
-        {
-            for ( const auto& line : font->layout(text.get()) )
-                for ( const auto& glyph : line.glyphs )
-                    shape_cache += font->path_for_glyph(glyph.glyph, cache, true).translated(glyph.position);
-        }
+    }
+    else
+    {
+        for ( const auto& line : font->layout(text.get()) )
+            for ( const auto& glyph : line.glyphs )
+                generated += glyph_path(glyph.glyph).translated(glyph.position);
     }
 
-    return shape_cache;
+    std::lock_guard lock(cache_mutex);
+    if ( shape_cache_generation == started && shape_cache.isEmpty() )
+        shape_cache = generated;
+    return generated;
 }
 
 
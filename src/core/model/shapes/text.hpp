@@ -62,6 +62,9 @@ public:
 
     QString type_name_human() const override;
 
+    /**
+     * \brief Lays out \p string, can be called from multiple threads
+     */
     ParagraphData layout(const QString& string) const;
 
     /**
@@ -126,7 +129,7 @@ protected:
 private:
     void on_font_changed();
     void on_text_changed();
-    const QPainterPath& untranslated_path(FrameTime t) const;
+    QPainterPath untranslated_path(FrameTime t) const;
 
     std::vector<DocumentNode*> valid_paths() const;
     bool is_valid_path(DocumentNode* node) const;
@@ -134,6 +137,8 @@ private:
 
     mutable Font::CharDataCache cache;
     mutable QPainterPath shape_cache;
+    mutable quint64 shape_cache_generation = 0;
+    mutable std::mutex cache_mutex;
 };
 
 } // namespace glaxnimate::model
@@ -160,7 +160,7 @@ glaxnimate::math::bezier::MultiBezier glaxnimate::model::Trim::process(
 
     const int length_steps = 5;
     math::bezier::MultiBezier out;
-    math::bezier::LengthData length_data(mbez, length_steps);
+    math::bezier::LengthData length_data(mbez, length_steps, math::bezier::FrameArena::resource());
 
     for ( const auto& chunk : chunks )
     {
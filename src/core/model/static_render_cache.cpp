@@ -0,0 +1,266 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "static_render_cache.hpp"
+
+#include <cmath>
+#include <limits>
+#include <unordered_set>
+
+#include <QPainter>
+
+#include "model/comp_graph.hpp"
+#include "model/assets/composition.hpp"
+#include "model/property/sub_object_property.hpp"
+#include "model/shapes/group.hpp"
+
+namespace {
+
+// Set while rendering a node into the cache, its children are part of the same image
+thread_local bool filling_cache = false;
+
+} // namespace
+
+glaxnimate::model::StaticRenderCache::StaticRenderCache(CompGraph* comp_graph)
+    : comp_graph(comp_graph)
+{
+}
+
+glaxnimate::model::StaticRenderCache::~StaticRenderCache()
+{
+    clear();
+}
+
+bool glaxnimate::model::StaticRenderCache::enabled() const
+{
+    return enabled_;
+}
+
+void glaxnimate::model::StaticRenderCache::set_enabled(bool enabled)
+{
+    enabled_ = enabled;
+    if ( !enabled )
+        clear();
+}
+
+qint64 glaxnimate::model::StaticRenderCache::max_bytes() const
+{
+    return max_bytes_;
+}
+
+void glaxnimate::model::StaticRenderCache::set_max_bytes(qint64 bytes)
+{
+    std::lock_guard lock(mutex);
+    max_bytes_ = bytes;
+    evict();
+}
+
+int glaxnimate::model::StaticRenderCache::size() const
+{
+    std::lock_guard lock(mutex);
+    return entries.size();
+}
+
+bool glaxnimate::model::StaticRenderCache::paint(const VisualNode* node, QPainter* painter, FrameTime time, VisualNode::PaintMode mode)
+{
+    if ( !enabled_ || filling_cache || !qobject_cast<const Group*>(node) || !node->docnode_time_invariant() )
+        return false;
+
+    QTransform group_transform = node->group_transform_matrix(time);
+    QTransform total = group_transform * painter->worldTransform();
+    if ( total.type() > QTransform::TxScale || total.m11() <= 0 || total.m22() <= 0 || !group_transform.isInvertible() )
+        return false;
+
+    qreal scale_x = total.m11();
+    qreal scale_y = total.m22();
+    qreal offset_x = std::floor(total.dx());
+    qreal offset_y = std::floor(total.dy());
+    Key key{
+        node, mode, scale_x, scale_y,
+        qRound((total.dx() - offset_x) * subpixel_steps),
+        qRound((total.dy() - offset_y) * subpixel_steps),
+    };
+
+    QImage image;
+    QPoint origin;
+    {
+        std::lock_guard lock(mutex);
+        auto it = entries.find(key);
+        if ( it != entries.end() )
+        {
+            lru.splice(lru.end(), lru, it->second.lru_position);
+            image = it->second.image;
+            origin = it->second.origin;
+        }
+    }
+
+    if ( image.isNull() )
+    {
+        QRectF local = node->local_bounding_rect(time);
+        if ( local.isEmpty() )
+            return false;
+
+        QRectF scaled = QTransform::fromScale(scale_x, scale_y).mapRect(local);
+        origin = QPoint(std::floor(scaled.left()) - margin, std::floor(scaled.top()) - margin);
+        QSize size(
+            std::ceil(scaled.right()) + margin + 1 - origin.x(),
+            std::ceil(scaled.bottom()) + margin + 1 - origin.y()
+        );
+
+        image = QImage(size, QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::transparent);
+        {
+            QPainter image_painter(&image);
+            image_painter.setRenderHints(painter->renderHints());
+            // VisualNode::paint() applies the group transform again
+            image_painter.setTransform(group_transform.inverted() * QTransform(
+                scale_x, 0, 0, scale_y,
+                key.offset_x / qreal(subpixel_steps) - origin.x(),
+                key.offset_y / qreal(subpixel_steps) - origin.y()
+            ));
+            filling_cache = true;
+            node->paint(&image_painter, time, mode);
+            filling_cache = false;
+        }
+
+        std::lock_guard lock(mutex);
+        watch(node);
+        auto inserted = entries.try_emplace(key);
+        auto& entry = inserted.first->second;
+        if ( inserted.second )
+        {
+            entry.image = image;
+            entry.origin = origin;
+            entry.lru_position = lru.insert(lru.end(), key);
+            bytes += image.sizeInBytes();
+        }
+        else
+        {
+            lru.splice(lru.end(), lru, entry.lru_position);
+        }
+        evict();
+    }
+
+    painter->save();
+    painter->resetTransform();
+    painter->drawImage(QPointF(offset_x + origin.x(), offset_y + origin.y()), image);
+    painter->restore();
+    return true;
+}
+
+void glaxnimate::model::StaticRenderCache::watch(const VisualNode* node)
+{
+    auto& connections = watched[node];
+    if ( !connections.empty() )
+        return;
+
+    auto mutable_node = const_cast<VisualNode*>(node);
+    auto invalidate = [this, node]{ this->invalidate(node); };
+    connections.push_back(QObject::connect(mutable_node, &VisualNode::bounding_rect_changed, invalidate));
+    connections.push_back(QObject::connect(mutable_node, &Object::visual_property_changed, invalidate));
+    connections.push_back(QObject::connect(mutable_node, &QObject::destroyed, [this, node]{
+        std::lock_guard lock(mutex);
+        drop(node);
+        watched.erase(node);
+    }));
+}
+
+void glaxnimate::model::StaticRenderCache::drop(const VisualNode* node)
+{
+    auto it = entries.lower_bound(Key{node, VisualNode::Canvas, std::numeric_limits<qreal>::lowest(), 0, 0, 0});
+    while ( it != entries.end() && it->first.node == node )
+        it = erase(it);
+}
+
+void glaxnimate::model::StaticRenderCache::drop_users(Composition* comp)
+{
+    // Compositions showing comp through precomp layers, directly or not
+    std::unordered_set<const Composition*> users;
+    std::vector<Composition*> queue{comp};
+    while ( !queue.empty() )
+    {
+        Composition* current = queue.back();
+        queue.pop_back();
+        for ( auto user : comp_graph->users(current) )
+        {
+            if ( users.insert(user).second )
+                queue.push_back(user);
+        }
+    }
+
+    if ( users.empty() )
+        return;
+
+    for ( auto it = entries.begin(); it != entries.end(); )
+    {
+        auto shape = static_cast<const ShapeElement*>(it->first.node);
+        if ( users.count(shape->owner_composition()) )
+            it = erase(it);
+        else
+            ++it;
+    }
+}
+
+glaxnimate::model::StaticRenderCache::EntryMap::iterator glaxnimate::model::StaticRenderCache::erase(EntryMap::iterator it)
+{
+    bytes -= it->second.image.sizeInBytes();
+    lru.erase(it->second.lru_position);
+    return entries.erase(it);
+}
+
+void glaxnimate::model::StaticRenderCache::invalidate(const VisualNode* node)
+{
+    std::lock_guard lock(mutex);
+    drop(node);
+}
+
+void glaxnimate::model::StaticRenderCache::object_edited(Object* object)
+{
+    std::lock_guard lock(mutex);
+    if ( entries.empty() )
+        return;
+
+    // Every group containing object has it baked in its images
+    while ( object )
+    {
+        if ( auto comp = qobject_cast<Composition*>(object) )
+        {
+            drop_users(comp);
+            return;
+        }
+
+        if ( auto node = qobject_cast<VisualNode*>(object) )
+            drop(node);
+
+        if ( auto node = qobject_cast<DocumentNode*>(object) )
+            object = node->docnode_parent();
+        else if ( auto property = object->owner_property() )
+            object = property->object();
+        else
+            break;
+    }
+
+    // Not part of a composition, any image could depend on it
+    clear();
+}
+
+void glaxnimate::model::StaticRenderCache::evict()
+{
+    while ( bytes > max_bytes_ && !lru.empty() )
+        erase(entries.find(lru.front()));
+}
+
+void glaxnimate::model::StaticRenderCache::clear()
+{
+    std::lock_guard lock(mutex);
+    for ( const auto& p : watched )
+        for ( const auto& connection : p.second )
+            QObject::disconnect(connection);
+    watched.clear();
+    entries.clear();
+    lru.clear();
+    bytes = 0;
+}
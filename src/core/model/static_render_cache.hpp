@@ -0,0 +1,134 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include <QImage>
+#include <QMetaObject>
+
+#include "model/document_node.hpp"
+
+namespace glaxnimate::model {
+
+class CompGraph;
+class Composition;
+
+/**
+ * \brief Cache of rasterized groups that don't change over time
+ *
+ * Used by VisualNode::paint() on groups where DocumentNode::docnode_time_invariant()
+ * is true, these are rendered once for each scale factor and the image
+ * is reused for all frames.
+ *
+ * Only applies when painting with a transform that only translates and scales.
+ * Images are dropped when anything inside the group changes or when a
+ * composition it shows through a precomp layer changes,
+ * edits to assets drop all the images.
+ * When over budget, the least recently used images are dropped first.
+ * Disabled by default.
+ */
+class StaticRenderCache
+{
+public:
+    explicit StaticRenderCache(CompGraph* comp_graph);
+    ~StaticRenderCache();
+
+    StaticRenderCache(const StaticRenderCache&) = delete;
+    StaticRenderCache& operator=(const StaticRenderCache&) = delete;
+
+    bool enabled() const;
+    void set_enabled(bool enabled);
+
+    /**
+     * \brief Maximum memory used by the cached images, in bytes
+     */
+    qint64 max_bytes() const;
+    void set_max_bytes(qint64 bytes);
+
+    /**
+     * \brief Paints \p node from the cache, rendering it if needed
+     * \returns \b false if \p node can't be painted from the cache
+     */
+    bool paint(const VisualNode* node, QPainter* painter, FrameTime time, VisualNode::PaintMode mode);
+
+    /**
+     * \brief Drops cached images for \p node
+     */
+    void invalidate(const VisualNode* node);
+
+    /**
+     * \brief Drops cached images affected by changes to \p object
+     *
+     * Drops the images of the nodes containing \p object and of the nodes
+     * in compositions using the composition of \p object,
+     * objects outside compositions (eg: assets) clear the whole cache.
+     */
+    void object_edited(Object* object);
+
+    void clear();
+
+    /**
+     * \brief Number of cached images
+     */
+    int size() const;
+
+private:
+    struct Key
+    {
+        const VisualNode* node;
+        VisualNode::PaintMode mode;
+        qreal scale_x;
+        qreal scale_y;
+        /// Sub-pixel offset, in 1/subpixel_steps of a pixel
+        int offset_x;
+        int offset_y;
+
+        bool operator<(const Key& o) const
+        {
+            return std::tie(node, mode, scale_x, scale_y, offset_x, offset_y) <
+                   std::tie(o.node, o.mode, o.scale_x, o.scale_y, o.offset_x, o.offset_y);
+        }
+    };
+
+    struct Entry
+    {
+        QImage image;
+        /// Position of the image relative to the integer part of the node offset
+        QPoint origin;
+        /// Position in lru
+        std::list<Key>::iterator lru_position;
+    };
+
+    using EntryMap = std::map<Key, Entry>;
+
+    void watch(const VisualNode* node);
+    void drop(const VisualNode* node);
+    void drop_users(Composition* comp);
+    EntryMap::iterator erase(EntryMap::iterator it);
+    void evict();
+
+    static constexpr int subpixel_steps = 8;
+    static constexpr int margin = 2;
+
+    bool enabled_ = false;
+    qint64 max_bytes_ = 256 * 1024 * 1024;
+    qint64 bytes = 0;
+    EntryMap entries;
+    /// Keys of the entries, least recently used first
+    std::list<Key> lru;
+    CompGraph* comp_graph;
+    std::unordered_map<const VisualNode*, std::vector<QMetaObject::Connection>> watched;
+    mutable std::recursive_mutex mutex;
+};
+
+} // namespace glaxnimate::model
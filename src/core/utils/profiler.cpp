@@ -0,0 +1,332 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <mutex>
+
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+
+#include "model/document_node.hpp"
+
+std::atomic<bool> glaxnimate::utils::profiler::detail::enabled = false;
+
+namespace {
+
+using namespace glaxnimate::utils::profiler;
+
+/**
+ * \brief Fixed size block of spans, the owner thread appends spans and links the next chunk
+ */
+struct Chunk
+{
+    static constexpr int capacity = 1024;
+
+    Span spans[capacity];
+    std::atomic<int> count = 0;
+    std::atomic<Chunk*> next = nullptr;
+};
+
+/**
+ * \brief Single producer / single consumer span queue
+ *
+ * The owner thread only touches \p tail, readers (serialized by Registry::mutex)
+ * only touch \p head and \p read.
+ */
+struct ThreadBuffer
+{
+    explicit ThreadBuffer(int thread, QString name)
+        : thread(thread), name(std::move(name)), head(new Chunk), tail(head)
+    {}
+
+    ~ThreadBuffer()
+    {
+        while ( head )
+        {
+            Chunk* next = head->next.load(std::memory_order_acquire);
+            delete head;
+            head = next;
+        }
+    }
+
+    void push(Span&& span)
+    {
+        int count = tail->count.load(std::memory_order_relaxed);
+        if ( count == Chunk::capacity )
+        {
+            Chunk* chunk = new Chunk;
+            tail->next.store(chunk, std::memory_order_release);
+            tail = chunk;
+            count = 0;
+        }
+        span.thread = thread;
+        tail->spans[count] = std::move(span);
+        tail->count.store(count + 1, std::memory_order_release);
+    }
+
+    /**
+     * \brief Moves the published spans into \p output
+     * \returns \b true if all the chunks have been consumed
+     */
+    bool consume(std::vector<Span>* output)
+    {
+        while ( true )
+        {
+            drain(output);
+
+            Chunk* next = head->next.load(std::memory_order_acquire);
+            if ( !next )
+                return true;
+
+            // Spans published between the drain and linking next are only
+            // guaranteed visible now, so the chunk is full at this point
+            drain(output);
+            delete head;
+            head = next;
+            read = 0;
+        }
+    }
+
+    void drain(std::vector<Span>* output)
+    {
+        int count = head->count.load(std::memory_order_acquire);
+        for ( ; read < count; read++ )
+        {
+            if ( output )
+                output->push_back(std::move(head->spans[read]));
+            else
+                head->spans[read] = {};
+        }
+    }
+
+    int thread;
+    QString name;
+    Chunk* head;
+    Chunk* tail;
+    int read = 0;
+    std::atomic<bool> finished = false;
+};
+
+struct Registry
+{
+    static Registry& instance()
+    {
+        static Registry instance;
+        return instance;
+    }
+
+    ThreadBuffer* create()
+    {
+        std::lock_guard lock(mutex);
+
+        int thread = next_thread++;
+        QString name;
+        if ( QCoreApplication::instance() && QThread::currentThread() == QCoreApplication::instance()->thread() )
+            name = "Main";
+        else if ( !QThread::currentThread()->objectName().isEmpty() )
+            name = QThread::currentThread()->objectName();
+        else
+            name = QString("Thread %1").arg(thread);
+
+        buffers.push_back(std::make_unique<ThreadBuffer>(thread, name));
+        thread_names[thread] = name;
+        return buffers.back().get();
+    }
+
+    void consume(std::vector<Span>* output)
+    {
+        std::lock_guard lock(mutex);
+        for ( auto it = buffers.begin(); it != buffers.end(); )
+        {
+            // Read finished before draining, so all the spans of an exited thread have been consumed
+            bool finished = (*it)->finished.load(std::memory_order_acquire);
+            if ( (*it)->consume(output) && finished )
+                it = buffers.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::map<int, QString> thread_names;
+    int next_thread = 1;
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+};
+
+/**
+ * \brief Marks the buffer as finished when its thread exits
+ */
+struct LocalBuffer
+{
+    LocalBuffer() : buffer(Registry::instance().create()) {}
+
+    ~LocalBuffer()
+    {
+        buffer->finished.store(true, std::memory_order_release);
+    }
+
+    ThreadBuffer* buffer;
+};
+
+ThreadBuffer* local_buffer()
+{
+    static thread_local LocalBuffer local;
+    return local.buffer;
+}
+
+qint64 now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - Registry::instance().epoch
+    ).count();
+}
+
+} // namespace
+
+void glaxnimate::utils::profiler::set_enabled(bool enabled)
+{
+    // Makes sure the epoch is set before any span is recorded
+    Registry::instance();
+    detail::enabled.store(enabled);
+}
+
+std::vector<glaxnimate::utils::profiler::Span> glaxnimate::utils::profiler::take()
+{
+    std::vector<Span> spans;
+    Registry::instance().consume(&spans);
+    return spans;
+}
+
+void glaxnimate::utils::profiler::clear()
+{
+    Registry::instance().consume(nullptr);
+}
+
+std::vector<glaxnimate::utils::profiler::Stats> glaxnimate::utils::profiler::summarize(const std::vector<Span>& spans)
+{
+    std::vector<const Span*> sorted;
+    sorted.reserve(spans.size());
+    for ( const auto& span : spans )
+        sorted.push_back(&span);
+
+    // Parents start before their children, or at the same time but last longer
+    std::sort(sorted.begin(), sorted.end(), [](const Span* a, const Span* b){
+        if ( a->thread != b->thread )
+            return a->thread < b->thread;
+        if ( a->start != b->start )
+            return a->start < b->start;
+        return a->duration > b->duration;
+    });
+
+    std::map<std::pair<const void*, QString>, Stats> stats;
+    std::vector<std::pair<const Span*, Stats*>> stack;
+
+    for ( const Span* span : sorted )
+    {
+        while ( !stack.empty() && (
+            stack.back().first->thread != span->thread ||
+            stack.back().first->start + stack.back().first->duration <= span->start
+        ) )
+            stack.pop_back();
+
+        QString category = QString::fromLatin1(span->category);
+        Stats& stat = stats[{span->id ? span->id : span->category, category + span->name}];
+        stat.category = span->category;
+        stat.name = span->name;
+        stat.id = span->id;
+        stat.count++;
+        stat.total += span->duration;
+        stat.self += span->duration;
+
+        if ( !stack.empty() )
+            stack.back().second->self -= span->duration;
+
+        stack.emplace_back(span, &stat);
+    }
+
+    std::vector<Stats> result;
+    result.reserve(stats.size());
+    for ( auto& p : stats )
+        result.push_back(std::move(p.second));
+
+    std::sort(result.begin(), result.end(), [](const Stats& a, const Stats& b){
+        return a.self > b.self;
+    });
+    return result;
+}
+
+QByteArray glaxnimate::utils::profiler::chrome_trace(const std::vector<Span>& spans)
+{
+    QJsonArray events;
+
+    std::map<int, QString> thread_names;
+    {
+        auto& registry = Registry::instance();
+        std::lock_guard lock(registry.mutex);
+        thread_names = registry.thread_names;
+    }
+
+    for ( const auto& p : thread_names )
+    {
+        events.push_back(QJsonObject{
+            {"name", "thread_name"},
+            {"ph", "M"},
+            {"pid", 1},
+            {"tid", p.first},
+            {"args", QJsonObject{{"name", p.second}}},
+        });
+    }
+
+    for ( const auto& span : spans )
+    {
+        QJsonObject event{
+            {"name", span.name.isEmpty() ? QString::fromLatin1(span.category) : span.name},
+            {"cat", QString::fromLatin1(span.category)},
+            {"ph", "X"},
+            {"pid", 1},
+            {"tid", span.thread},
+            // Trace event times are in microseconds
+            {"ts", span.start / 1000.},
+            {"dur", span.duration / 1000.},
+        };
+        if ( span.id )
+            event["args"] = QJsonObject{{"id", QString::number(quintptr(span.id), 16)}};
+        events.push_back(event);
+    }
+
+    QJsonObject root{
+        {"traceEvents", events},
+        {"displayTimeUnit", "ms"},
+    };
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+void glaxnimate::utils::profiler::Scope::begin(const char* category, const QString& name, const void* id)
+{
+    span.category = category;
+    span.name = name;
+    span.id = id;
+    span.start = now();
+}
+
+void glaxnimate::utils::profiler::Scope::begin(const char* category, const model::DocumentNode* node)
+{
+    begin(category, node->object_name(), node);
+}
+
+void glaxnimate::utils::profiler::Scope::end()
+{
+    span.duration = now() - span.start;
+    local_buffer()->push(std::move(span));
+}
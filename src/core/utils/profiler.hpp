@@ -0,0 +1,125 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+#include <QByteArray>
+#include <QString>
+
+namespace glaxnimate::model {
+class DocumentNode;
+} // namespace glaxnimate::model
+
+/**
+ * \brief Opt-in timing of the rendering and I/O hot paths
+ *
+ * Spans are recorded by Scope objects into per-thread buffers that only
+ * their thread writes to, so recording never takes a lock.
+ * When profiling is disabled a Scope only costs an atomic load.
+ */
+namespace glaxnimate::utils::profiler {
+
+struct Span
+{
+    /// Static string describing the operation (eg: "paint")
+    const char* category = nullptr;
+    QString name;
+    /// Identifies the profiled object, used to group spans
+    const void* id = nullptr;
+    /// Nanoseconds since the profiler was first used
+    qint64 start = 0;
+    qint64 duration = 0;
+    int thread = 0;
+};
+
+/**
+ * \brief Time spent on a single object, aggregated over multiple spans
+ */
+struct Stats
+{
+    const char* category = nullptr;
+    QString name;
+    const void* id = nullptr;
+    int count = 0;
+    /// Nanoseconds including nested spans
+    qint64 total = 0;
+    /// Nanoseconds excluding nested spans
+    qint64 self = 0;
+};
+
+namespace detail {
+extern std::atomic<bool> enabled;
+} // namespace detail
+
+inline bool enabled()
+{
+    return detail::enabled.load(std::memory_order_relaxed);
+}
+
+void set_enabled(bool enabled);
+
+/**
+ * \brief Removes all the recorded spans from the thread buffers and returns them
+ */
+std::vector<Span> take();
+
+/**
+ * \brief Discards the recorded spans
+ */
+void clear();
+
+/**
+ * \brief Spans grouped by category and object, sorted by decreasing self time
+ */
+std::vector<Stats> summarize(const std::vector<Span>& spans);
+
+/**
+ * \brief Chrome / Perfetto trace event JSON
+ */
+QByteArray chrome_trace(const std::vector<Span>& spans);
+
+/**
+ * \brief Records the time between construction and destruction
+ */
+class Scope
+{
+public:
+    explicit Scope(const char* category, const QString& name = {}, const void* id = nullptr)
+    {
+        if ( enabled() )
+            begin(category, name, id);
+    }
+
+    /**
+     * \brief Uses the node name, which is only retrieved when profiling is enabled
+     */
+    Scope(const char* category, const model::DocumentNode* node)
+    {
+        if ( enabled() )
+            begin(category, node);
+    }
+
+    ~Scope()
+    {
+        if ( span.start >= 0 )
+            end();
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    void begin(const char* category, const QString& name, const void* id);
+    void begin(const char* category, const model::DocumentNode* node);
+    void end();
+
+    Span span{nullptr, {}, nullptr, -1};
+};
+
+} // namespace glaxnimate::utils::profiler
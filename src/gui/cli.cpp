@@ -12,8 +12,12 @@
 
 #include "app_info.hpp"
 #include "io/io_registry.hpp"
+#include "io/frame_server.hpp"
 #include "io/svg/svg_renderer.hpp"
 #include "io/raster/raster_mime.hpp"
+#include "model/precomp_render_cache.hpp"
+#include "model/static_render_cache.hpp"
+#include "utils/profiler.hpp"
 
 #include "plugin/executor.hpp"
 #include "plugin/plugin.hpp"
@@ -55,6 +59,29 @@ app::cli::ParsedArguments glaxnimate::gui::parse_cli(const QStringList& args)
     parser.add_argument({{"--debug"}, QApplication::tr("Enables the debug menu")});
 
 
+    parser.add_group(QApplication::tr("Frame Server Options"));
+    parser.add_argument({
+        {"--frame-server"},
+        QApplication::tr("Connect to the local socket/named pipe of a host application and render the frames it requests to shared memory, without starting the GUI"),
+        app::cli::Argument::String,
+        {},
+        "IPC-NAME"
+    });
+    parser.add_argument({
+        {"--frame-server-slots"},
+        QApplication::tr("Number of frames kept in shared memory, unless the host specifies it"),
+        app::cli::Argument::Int,
+        8,
+        "SLOTS"
+    });
+    parser.add_argument({
+        {"--frame-server-prefetch"},
+        QApplication::tr("Number of frames rendered ahead of the last frame requested by the host"),
+        app::cli::Argument::Int,
+        4,
+        "FRAMES"
+    });
+
     parser.add_group(QApplication::tr("Export Options"));
     parser.add_argument({
         {"--export", "-o"},
@@ -98,6 +125,28 @@ app::cli::ParsedArguments glaxnimate::gui::parse_cli(const QStringList& args)
         {"0"},
         "FRAME"
     });
+    parser.add_argument({
+        {"--render-precomp-cache"},
+        QApplication::tr("Render each precomposition once per frame and reuse the image for layers that only move or scale it"),
+        app::cli::Argument::Flag
+    });
+    parser.add_argument({
+        {"--render-static-cache"},
+        QApplication::tr("Render groups without animations once and reuse the image for all frames"),
+        app::cli::Argument::Flag
+    });
+    parser.add_argument({
+        {"--render-direct-raster"},
+        QApplication::tr("Draw solid fills and strokes directly on the image without converting them to painter paths"),
+        app::cli::Argument::Flag
+    });
+    parser.add_argument({
+        {"--render-profile"},
+        QApplication::tr("Write a Chrome / Perfetto trace of the time spent loading and rendering each node to the given file"),
+        app::cli::Argument::String,
+        {},
+        "TRACE-FILE"
+    });
     parser.add_argument({
         {"--render-format-list"},
         QApplication::tr("Shows possible values for --render-format"),
@@ -320,10 +369,10 @@ void render_frame(
 void render_frame_svg(glaxnimate::model::Composition* comp, glaxnimate::model::FrameTime time, QFile& file, const char*)
 {
     using namespace glaxnimate;
-    io::svg::SvgRenderer rend(io::svg::NotAnimated, io::svg::CssFontType::FontFace);
+    io::svg::SvgRenderer rend(&file, io::svg::NotAnimated, io::svg::CssFontType::FontFace, true);
     comp->set_time(time);
     rend.write_main(comp);
-    rend.write(&file, true);
+    rend.close();
 }
 
 void render_frame_img(glaxnimate::model::Composition* comp, glaxnimate::model::FrameTime time, QFile& file, const char* format)
@@ -364,10 +413,21 @@ bool cli_render(const app::cli::ParsedArguments& args)
     else
         renderer = &render_frame_img;
 
+    QString profile_filename = args.value("render-profile").toString();
+    if ( !profile_filename.isEmpty() )
+        utils::profiler::set_enabled(true);
+
     auto document = cli_open(args);
     if ( !document )
         return false;
 
+    if ( args.has_flag("render-precomp-cache") )
+        document->precomp_cache().set_enabled(true);
+    if ( args.has_flag("render-static-cache") )
+        document->static_render_cache().set_enabled(true);
+    if ( args.has_flag("render-direct-raster") )
+        document->set_direct_rasterization(true);
+
     auto dir = finfo.dir();
     if ( !dir.exists() )
     {
@@ -400,9 +460,45 @@ bool cli_render(const app::cli::ParsedArguments& args)
         render_frame(output_filename, cfmt, comp, frame.toDouble(), renderer);
     }
 
+    if ( !profile_filename.isEmpty() )
+    {
+        utils::profiler::set_enabled(false);
+        QFile profile_file(profile_filename);
+        if ( !profile_file.open(QIODevice::WriteOnly) )
+        {
+            app::cli::show_message(QApplication::tr("Could not save to %1").arg(profile_filename), true);
+            return false;
+        }
+        profile_file.write(utils::profiler::chrome_trace(utils::profiler::take()));
+    }
+
     return true;
 }
 
+int cli_frame_server(glaxnimate::gui::GlaxnimateApp& app, const app::cli::ParsedArguments& args)
+{
+    using namespace glaxnimate;
+
+    io::FrameServer server;
+    server.set_default_slots(args.value("frame-server-slots").toInt());
+    server.set_prefetch(args.value("frame-server-prefetch").toInt());
+
+    if ( args.is_defined("file") )
+    {
+        auto document = cli_open(args);
+        if ( !document )
+            return 1;
+        server.set_document(std::move(document));
+    }
+
+    // Queued as connection errors can be reported before the event loop starts
+    QObject::connect(&server, &io::FrameServer::finished, &app, [&app](bool success){
+        app.exit(success ? 0 : 1);
+    }, Qt::QueuedConnection);
+    server.connect_to_host(args.value("frame-server").toString());
+    return app.exec();
+}
+
 } // namespace
 
 void glaxnimate::gui::cli_main(gui::GlaxnimateApp& app, app::cli::ParsedArguments& args)
@@ -452,4 +548,10 @@ void glaxnimate::gui::cli_main(gui::GlaxnimateApp& app, app::cli::ParsedArgument
         else
             args.return_value = 0;
     }
+
+    if ( args.is_defined("frame-server") )
+    {
+        app.initialize();
+        args.return_value = cli_frame_server(app, args);
+    }
 }
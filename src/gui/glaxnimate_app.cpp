@@ -212,6 +212,9 @@ void GlaxnimateApp::on_initialize_settings()
         Setting("backup_frequency",
                 QT_TRANSLATE_NOOP("Settings", "Backup Frequency"),
                 QT_TRANSLATE_NOOP("Settings", "How often to save a backup copy (in minutes)"),  5, 0, 60),
+        Setting("undo_memory",
+                QT_TRANSLATE_NOOP("Settings", "Undo History Memory"),
+                QT_TRANSLATE_NOOP("Settings", "Memory (in MiB) used by the undo history before older steps are moved to a temporary file, 0 for no limit"),  256, 0, 65536),
         Setting("render_path",      {},         {},                        Setting::Internal,  QString{}),
         Setting("import_path",      {},         {},                        Setting::Internal,  QString{}),
         Setting("native_dialog",    QT_TRANSLATE_NOOP("Settings", "Use system file dialog"), {}, Setting::Bool, true),
@@ -6,6 +6,8 @@
 
 #include "bezier_item.hpp"
 
+#include <algorithm>
+
 #include "math/geom.hpp"
 
 #include "command/animation_commands.hpp"
@@ -371,9 +373,7 @@ void graphics::BezierItem::make_first(int index)
     if ( index == 0 || !bezier_.closed() )
         return;
 
-    std::vector<math::bezier::Point> new_points(bezier_.begin() + index, bezier_.end());
-    new_points.insert(new_points.end(), bezier_.points().begin(), bezier_.points().begin() + index);
-    std::swap(new_points, bezier_.points());
+    std::rotate(bezier_.points().begin(), bezier_.points().begin() + index, bezier_.points().end());
 
     std::set<int> selected;
 
@@ -8,7 +8,13 @@
 
 #pragma once
 
+#include <memory>
+
+#include <QTimer>
+
 #include "model/document.hpp"
+#include "model/render_program.hpp"
+#include "model/assets/assets.hpp"
 #include "model/assets/composition.hpp"
 #include "command/property_commands.hpp"
 
@@ -22,7 +28,7 @@ class CompositionItem : public DocumentNodeGraphicsItem
 {
 public:
     explicit CompositionItem (model::Composition* animation)
-        : DocumentNodeGraphicsItem(animation)
+        : DocumentNodeGraphicsItem(animation), animation(animation)
     {
         setFlag(QGraphicsItem::ItemIsSelectable, false);
         setFlag(QGraphicsItem::ItemHasNoContents, false);
@@ -30,11 +36,28 @@ public:
         connect(animation->document(), &model::Document::graphics_invalidated, this, [this]{refresh();});
         connect(animation, &model::Composition::width_changed, this, &CompositionItem::size_changed);
         connect(animation, &model::Composition::height_changed, this, &CompositionItem::size_changed);
+
+        // Changing the current time only affects animated values, which the program evaluates on every frame
+        connect(animation->document(), &model::Document::object_edited, this, [this]{program.reset();});
+        connect(animation->document()->assets()->fonts.get(), &model::FontList::font_added, this, [this]{program.reset();});
+
+        compile_timer.setSingleShot(true);
+        compile_timer.setInterval(250);
+        connect(&compile_timer, &QTimer::timeout, this, &CompositionItem::compile);
     }
 
     void paint(QPainter* painter, const QStyleOptionGraphicsItem*, QWidget*) override
     {
+        // Recompiling on every edit would slow down dragging things around,
+        // so the program is only rebuilt once the document stops changing
+        if ( program && !program->outdated() )
+        {
+            program->render(painter, node()->time());
+            return;
+        }
+
         node()->paint(painter, node()->time(), model::VisualNode::Canvas);
+        compile_timer.start();
     }
 
     void refresh()
@@ -47,6 +70,24 @@ private slots:
     {
         prepareGeometryChange();
     }
+
+    void compile()
+    {
+        if ( !program )
+        {
+            program = std::make_unique<model::RenderProgram>(animation, model::VisualNode::Canvas);
+            program->set_parallel(true);
+        }
+        else if ( program->outdated() )
+        {
+            program->compile();
+        }
+    }
+
+private:
+    model::Composition* animation;
+    std::unique_ptr<model::RenderProgram> program;
+    QTimer compile_timer;
 };
 
 
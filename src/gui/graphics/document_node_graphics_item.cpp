@@ -34,6 +34,7 @@ void graphics::DocumentNodeGraphicsItem::shape_changed()
 //     prepareGeometryChange();
     rect_cache = {};
     cache_dirty = true;
+    emit bounds_changed();
 }
 
 QRectF graphics::DocumentNodeGraphicsItem::boundingRect() const
@@ -56,7 +56,7 @@ public slots:
         setVisible(visible && visible_permitted);
     }
 
-    void shape_changed();
+    virtual void shape_changed();
 
     void set_transform_matrix(const QTransform& t)
     {
@@ -68,6 +68,12 @@ public slots:
         setOpacity(op);
     }
 
+signals:
+    /**
+     * \brief Emitted when the item geometry has been invalidated
+     */
+    void bounds_changed();
+
 protected:
     model::VisualNode* node_;
     bool visible_permitted = true;
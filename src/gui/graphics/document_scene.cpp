@@ -14,6 +14,7 @@
 #include "graphics/create_items.hpp"
 #include "graphics/graphics_editor.hpp"
 #include "graphics/item_data.hpp"
+#include "graphics/scene_index.hpp"
 #include "tools/base.hpp"
 #include "model/assets/composition.hpp"
 
@@ -62,13 +63,21 @@ public:
     }
 
 
-    std::vector<graphics::DocumentNodeGraphicsItem*> items_to_nodes(const QList<QGraphicsItem*>& items) const
+    /**
+     * \brief Finds the items from the index that pass \p test, topmost first
+     */
+    template<class Func>
+    std::vector<graphics::DocumentNodeGraphicsItem*> find_nodes(const QRectF& scene_rect, const Func& test)
     {
         std::vector<DocumentNodeGraphicsItem*> nodes;
-        for ( auto item : items )
+        for ( auto item : index.candidates(scene_rect) )
         {
-            if ( item_to_node(item) )
-                nodes.push_back(static_cast<DocumentNodeGraphicsItem*>(item));
+            // Same filtering as QGraphicsScene::items
+            if ( !item->isVisible() || qFuzzyIsNull(item->effectiveOpacity()) )
+                continue;
+
+            if ( test(item) )
+                nodes.push_back(item);
         }
         return nodes;
     }
@@ -99,6 +108,7 @@ public:
     QBrush back;
     model::Composition* comp = nullptr;
     bool show_masks = false;
+    SceneIndex index;
 };
 
 graphics::DocumentScene::DocumentScene()
@@ -142,6 +152,7 @@ void graphics::DocumentScene::set_composition(model::Composition* comp)
 
     clear_selection();
     clear();
+    d->index.clear();
 
     d->comp = comp;
 
@@ -160,6 +171,13 @@ void graphics::DocumentScene::connect_node ( model::DocumentNode* n )
 
     d->node_to_item[node] = child;
     child->setData(ItemData::NodePointer, QVariant::fromValue(node));
+
+    d->index.add(child);
+    auto invalidate_index = [this, child]{ d->index.invalidate(child); };
+    connect(child, &DocumentNodeGraphicsItem::bounds_changed, this, invalidate_index);
+    // Ancestor transforms affect the scene bounding box
+    connect(node, &model::VisualNode::transform_matrix_changed, child, invalidate_index);
+
     connect(node, &model::DocumentNode::docnode_child_add_end, this, &DocumentScene::connect_node);
     connect(node, &model::DocumentNode::docnode_child_remove_end, this, &DocumentScene::disconnect_node);
     connect(node, &model::DocumentNode::docnode_child_move_end, this, &DocumentScene::move_node);
@@ -201,6 +219,7 @@ void graphics::DocumentScene::disconnect_node ( model::DocumentNode* n )
     auto item = d->node_to_item.find(node);
     if ( item != d->node_to_item.end() )
     {
+        d->index.remove(item->second);
         delete item->second;
         d->node_to_item.erase(item);
     }
@@ -347,19 +366,30 @@ void graphics::DocumentScene::user_select(const std::vector<model::VisualNode*>&
 
 }
 
-std::vector<graphics::DocumentNodeGraphicsItem*> graphics::DocumentScene::nodes(const QPointF& point, const QTransform& device_transform) const
+/*
+ * Node items never ignore transformations so device_transform doesn't affect
+ * the result, it's kept for consistency with QGraphicsScene::items()
+ */
+std::vector<graphics::DocumentNodeGraphicsItem*> graphics::DocumentScene::nodes(const QPointF& point, const QTransform&) const
 {
-    return d->items_to_nodes(items(point, Qt::IntersectsItemShape, Qt::DescendingOrder, device_transform));
+    return d->find_nodes(QRectF(point, QSizeF(0, 0)), [&point](DocumentNodeGraphicsItem* item){
+        return item->contains(item->mapFromScene(point));
+    });
 }
 
-std::vector<graphics::DocumentNodeGraphicsItem*> graphics::DocumentScene::nodes(const QPainterPath& path, const QTransform& device_transform, Qt::ItemSelectionMode mode) const
+std::vector<graphics::DocumentNodeGraphicsItem*> graphics::DocumentScene::nodes(const QPainterPath& path, const QTransform&, Qt::ItemSelectionMode mode) const
 {
-    return d->items_to_nodes(items(path, mode, Qt::DescendingOrder, device_transform));
+    return d->find_nodes(path.boundingRect(), [&path, mode](DocumentNodeGraphicsItem* item){
+        return item->collidesWithPath(item->mapFromScene(path), mode);
+    });
 }
 
 std::vector<graphics::DocumentNodeGraphicsItem*> graphics::DocumentScene::nodes(const QPolygonF& path, const QTransform& device_transform, Qt::ItemSelectionMode mode) const
 {
-    return d->items_to_nodes(items(path, mode, Qt::DescendingOrder, device_transform));
+    QPainterPath painter_path;
+    painter_path.addPolygon(path);
+    painter_path.closeSubpath();
+    return nodes(painter_path, device_transform, mode);
 }
 
 bool graphics::DocumentScene::is_selected(model::VisualNode* node) const
@@ -453,6 +483,8 @@ void graphics::DocumentScene::move_node(model::DocumentNode* node, int, int)
         above = item;
     }
 
+    d->index.invalidate_order();
+
 }
 
 void graphics::DocumentScene::node_locked(bool locked)
@@ -0,0 +1,290 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "scene_index.hpp"
+
+#include <algorithm>
+
+#include "graphics/document_node_graphics_item.hpp"
+
+using namespace glaxnimate::gui;
+
+namespace {
+
+// Inclusive overlap so points and lines can be used as queries
+bool overlaps(const QRectF& a, const QRectF& b)
+{
+    return a.left() <= b.right() && b.left() <= a.right() &&
+           a.top() <= b.bottom() && b.top() <= a.bottom();
+}
+
+QRectF united(const QRectF& a, const QRectF& b)
+{
+    return QRectF(
+        QPointF(qMin(a.left(), b.left()), qMin(a.top(), b.top())),
+        QPointF(qMax(a.right(), b.right()), qMax(a.bottom(), b.bottom()))
+    );
+}
+
+struct OrderVisitor
+{
+    const std::unordered_map<graphics::DocumentNodeGraphicsItem*, int>& item_to_leaf;
+    std::vector<int>& orders;
+    int order = 0;
+
+    void visit(QGraphicsItem* item)
+    {
+        const auto children = item->childItems();
+
+        // Same rules QGraphicsScene uses to paint items
+        for ( auto child : children )
+            if ( child->flags() & QGraphicsItem::ItemStacksBehindParent || child->zValue() < 0 )
+                visit(child);
+
+        auto it = item_to_leaf.find(dynamic_cast<graphics::DocumentNodeGraphicsItem*>(item));
+        if ( it != item_to_leaf.end() )
+            orders[it->second] = order++;
+
+        for ( auto child : children )
+            if ( !(child->flags() & QGraphicsItem::ItemStacksBehindParent || child->zValue() < 0) )
+                visit(child);
+    }
+};
+
+} // namespace
+
+void graphics::SceneIndex::add(DocumentNodeGraphicsItem* item)
+{
+    item_to_leaf[item] = leaves.size();
+    leaves.push_back({item, {}});
+    structure_dirty = true;
+    order_dirty = true;
+}
+
+void graphics::SceneIndex::remove(DocumentNodeGraphicsItem* item)
+{
+    auto it = item_to_leaf.find(item);
+    if ( it == item_to_leaf.end() )
+        return;
+
+    int index = it->second;
+    item_to_leaf.erase(it);
+    if ( index != int(leaves.size()) - 1 )
+    {
+        leaves[index] = leaves.back();
+        item_to_leaf[leaves[index].item] = index;
+    }
+    leaves.pop_back();
+    structure_dirty = true;
+}
+
+void graphics::SceneIndex::clear()
+{
+    leaves.clear();
+    nodes.clear();
+    item_to_leaf.clear();
+    dirty_leaves.clear();
+    structure_dirty = true;
+    order_dirty = true;
+}
+
+void graphics::SceneIndex::invalidate(DocumentNodeGraphicsItem* item)
+{
+    if ( structure_dirty )
+        return;
+
+    auto it = item_to_leaf.find(item);
+    if ( it == item_to_leaf.end() )
+        return;
+
+    Leaf& leaf = leaves[it->second];
+    if ( !leaf.dirty )
+    {
+        leaf.dirty = true;
+        dirty_leaves.push_back(it->second);
+    }
+}
+
+void graphics::SceneIndex::invalidate_order()
+{
+    order_dirty = true;
+}
+
+QRectF graphics::SceneIndex::leaf_rect(const Leaf& leaf) const
+{
+    QRectF rect = leaf.item->sceneBoundingRect();
+
+    // Avoid missing lines, same as QGraphicsScene does
+    if ( rect.width() == 0 )
+        rect.adjust(-0.00001, 0, 0.00001, 0);
+    if ( rect.height() == 0 )
+        rect.adjust(0, -0.00001, 0, 0.00001);
+
+    return rect;
+}
+
+void graphics::SceneIndex::rebuild()
+{
+    for ( auto& leaf : leaves )
+    {
+        leaf.rect = leaf_rect(leaf);
+        leaf.dirty = false;
+    }
+
+    nodes.clear();
+    dirty_leaves.clear();
+    if ( !leaves.empty() )
+        build(-1, 0, leaves.size());
+
+    // build() reorders the leaves
+    for ( int i = 0; i < int(leaves.size()); i++ )
+        item_to_leaf[leaves[i].item] = i;
+
+    structure_dirty = false;
+    order_dirty = true;
+}
+
+int graphics::SceneIndex::build(int parent, int begin, int end)
+{
+    int index = nodes.size();
+    nodes.emplace_back();
+    nodes[index].parent = parent;
+    nodes[index].leaf_begin = begin;
+    nodes[index].leaf_end = end;
+
+    QRectF rect = leaves[begin].rect;
+    for ( int i = begin + 1; i < end; i++ )
+        rect = united(rect, leaves[i].rect);
+    nodes[index].rect = rect;
+
+    if ( end - begin <= max_leaves_per_node )
+    {
+        for ( int i = begin; i < end; i++ )
+            leaves[i].node = index;
+        return index;
+    }
+
+    // Median split along the longest axis
+    int mid = (begin + end) / 2;
+    if ( rect.width() > rect.height() )
+    {
+        std::nth_element(leaves.begin() + begin, leaves.begin() + mid, leaves.begin() + end, [](const Leaf& a, const Leaf& b){
+            return a.rect.center().x() < b.rect.center().x();
+        });
+    }
+    else
+    {
+        std::nth_element(leaves.begin() + begin, leaves.begin() + mid, leaves.begin() + end, [](const Leaf& a, const Leaf& b){
+            return a.rect.center().y() < b.rect.center().y();
+        });
+    }
+
+    build(index, begin, mid);
+    int right = build(index, mid, end);
+    nodes[index].right = right;
+    return index;
+}
+
+void graphics::SceneIndex::refit()
+{
+    for ( int leaf_index : dirty_leaves )
+    {
+        Leaf& leaf = leaves[leaf_index];
+        leaf.rect = leaf_rect(leaf);
+        leaf.dirty = false;
+
+        for ( int node_index = leaf.node; node_index != -1; node_index = nodes[node_index].parent )
+        {
+            Node& node = nodes[node_index];
+            if ( node.is_leaf() )
+            {
+                QRectF rect = leaves[node.leaf_begin].rect;
+                for ( int i = node.leaf_begin + 1; i < node.leaf_end; i++ )
+                    rect = united(rect, leaves[i].rect);
+                node.rect = rect;
+            }
+            else
+            {
+                node.rect = united(nodes[node_index + 1].rect, nodes[node.right].rect);
+            }
+        }
+    }
+
+    dirty_leaves.clear();
+}
+
+void graphics::SceneIndex::update_order()
+{
+    std::vector<int> orders(leaves.size(), 0);
+    OrderVisitor visitor{item_to_leaf, orders};
+
+    std::vector<QGraphicsItem*> roots;
+    for ( const auto& leaf : leaves )
+    {
+        QGraphicsItem* parent = leaf.item->parentItem();
+        if ( !parent || !item_to_leaf.count(dynamic_cast<DocumentNodeGraphicsItem*>(parent)) )
+            roots.push_back(leaf.item);
+    }
+    std::stable_sort(roots.begin(), roots.end(), [](QGraphicsItem* a, QGraphicsItem* b){
+        return a->zValue() < b->zValue();
+    });
+
+    for ( auto root : roots )
+        visitor.visit(root);
+
+    for ( int i = 0; i < int(leaves.size()); i++ )
+        leaves[i].order = orders[i];
+
+    order_dirty = false;
+}
+
+std::vector<graphics::DocumentNodeGraphicsItem*> graphics::SceneIndex::candidates(const QRectF& rect)
+{
+    if ( structure_dirty )
+        rebuild();
+    else if ( !dirty_leaves.empty() )
+        refit();
+
+    if ( order_dirty )
+        update_order();
+
+    std::vector<const Leaf*> found;
+    if ( !nodes.empty() )
+    {
+        std::vector<int> stack{0};
+        while ( !stack.empty() )
+        {
+            const Node& node = nodes[stack.back()];
+            int node_index = stack.back();
+            stack.pop_back();
+
+            if ( !overlaps(node.rect, rect) )
+                continue;
+
+            if ( node.is_leaf() )
+            {
+                for ( int i = node.leaf_begin; i < node.leaf_end; i++ )
+                    if ( overlaps(leaves[i].rect, rect) )
+                        found.push_back(&leaves[i]);
+            }
+            else
+            {
+                stack.push_back(node.right);
+                stack.push_back(node_index + 1);
+            }
+        }
+    }
+
+    std::sort(found.begin(), found.end(), [](const Leaf* a, const Leaf* b){
+        return a->order > b->order;
+    });
+
+    std::vector<DocumentNodeGraphicsItem*> items;
+    items.reserve(found.size());
+    for ( auto leaf : found )
+        items.push_back(leaf->item);
+    return items;
+}
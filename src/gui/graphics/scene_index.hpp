@@ -0,0 +1,86 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include <QRectF>
+
+namespace glaxnimate::gui::graphics {
+
+class DocumentNodeGraphicsItem;
+
+/**
+ * \brief Bounding volume hierarchy over the scene bounding boxes of node items
+ *
+ * Used to find hit-test candidates without going through every item in the scene.
+ * Changes in bounds only refit the affected branches, the tree is rebuilt
+ * only when items are added, removed or reordered.
+ * Everything is updated lazily on the next query.
+ */
+class SceneIndex
+{
+public:
+    void add(DocumentNodeGraphicsItem* item);
+    void remove(DocumentNodeGraphicsItem* item);
+    void clear();
+
+    /**
+     * \brief Marks the scene bounding box of \p item as outdated
+     */
+    void invalidate(DocumentNodeGraphicsItem* item);
+
+    /**
+     * \brief Marks the stacking order as outdated
+     */
+    void invalidate_order();
+
+    /**
+     * \brief Items whose scene bounding box intersects \p rect, topmost first
+     */
+    std::vector<DocumentNodeGraphicsItem*> candidates(const QRectF& rect);
+
+private:
+    struct Leaf
+    {
+        DocumentNodeGraphicsItem* item;
+        QRectF rect;
+        int order = 0;
+        int node = -1;
+        bool dirty = true;
+    };
+
+    struct Node
+    {
+        QRectF rect;
+        int parent = -1;
+        /// Index of the second child node, the first one is always the next node
+        int right = -1;
+        int leaf_begin = 0;
+        int leaf_end = 0;
+
+        bool is_leaf() const { return right == -1; }
+    };
+
+    void rebuild();
+    void refit();
+    void update_order();
+    int build(int parent, int begin, int end);
+    QRectF leaf_rect(const Leaf& leaf) const;
+
+    static constexpr int max_leaves_per_node = 4;
+
+    std::vector<Leaf> leaves;
+    std::vector<Node> nodes;
+    std::unordered_map<DocumentNodeGraphicsItem*, int> item_to_leaf;
+    std::vector<int> dirty_leaves;
+    bool structure_dirty = true;
+    bool order_dirty = true;
+};
+
+} // namespace glaxnimate::gui::graphics
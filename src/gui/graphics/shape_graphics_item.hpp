@@ -22,13 +22,29 @@ public:
 
     QPainterPath shape() const override
     {
-        return shape_element()->to_painter_path(shape_element()->time());
+        if ( shape_dirty )
+        {
+            shape_cache = shape_element()->to_painter_path(shape_element()->time());
+            shape_dirty = false;
+        }
+        return shape_cache;
+    }
+
+    void shape_changed() override
+    {
+        shape_cache = {};
+        shape_dirty = true;
+        DocumentNodeGraphicsItem::shape_changed();
     }
 
     model::ShapeElement* shape_element() const
     {
         return static_cast<model::ShapeElement*>(node());
     }
+
+private:
+    mutable QPainterPath shape_cache;
+    mutable bool shape_dirty = true;
 };
 
 } // namespace glaxnimate::gui::graphics
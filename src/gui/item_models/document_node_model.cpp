@@ -28,6 +28,9 @@ public:
     // Sometimes views send QModelIndex instances after they've been removed...
     // So we avoid accessing the internal pointer directly
     std::unordered_set<void*> ptrs;
+
+    // Nodes whose children have been exposed to the views and are connected
+    std::unordered_set<model::DocumentNode*> expanded;
 };
 
 item_models::DocumentNodeModel::DocumentNodeModel(QObject* parent)
@@ -41,24 +44,52 @@ item_models::DocumentNodeModel::~DocumentNodeModel()
 
 void item_models::DocumentNodeModel::connect_node ( model::DocumentNode* node )
 {
-    d->ptrs.insert(node);
+    if ( !d->ptrs.insert(node).second )
+        return;
 
     connect(node, &model::DocumentNode::docnode_child_add_begin, this, [this, node](int row) {
+        if ( node->docnode_child_span_active() )
+            return;
         int rows = node->docnode_child_count();
         beginInsertRows(node_index(node), rows - row, rows - row);
     });
-    connect(node, &model::DocumentNode::docnode_child_add_end, this, [this](model::DocumentNode* child) {
+    connect(node, &model::DocumentNode::docnode_child_add_end, this, [this, node](model::DocumentNode* child) {
+        if ( node->docnode_child_span_active() )
+            return;
+        endInsertRows();
+        if ( d->expanded.count(node) )
+            connect_node(child);
+    });
+    connect(node, &model::DocumentNode::docnode_child_add_span_begin, this, [this, node](int row, int count) {
+        int rows = node->docnode_child_count();
+        beginInsertRows(node_index(node), rows - row, rows - row + count - 1);
+    });
+    connect(node, &model::DocumentNode::docnode_child_add_span_end, this, [this, node](int row, int count) {
         endInsertRows();
-        connect_node(child);
+        if ( d->expanded.count(node) )
+        {
+            for ( int i = row; i < row + count; i++ )
+                connect_node(node->docnode_child(i));
+        }
     });
     connect(node, &model::DocumentNode::docnode_child_remove_begin, this, [this, node](int row) {
+        if ( node->docnode_child_span_active() )
+            return;
         int rows = node->docnode_child_count();
         beginRemoveRows(node_index(node), rows - row - 1, rows - row - 1);
     });
-    connect(node, &model::DocumentNode::docnode_child_remove_end, this, [this](model::DocumentNode* child) {
-        endRemoveRows();
+    connect(node, &model::DocumentNode::docnode_child_remove_end, this, [this, node](model::DocumentNode* child) {
+        if ( !node->docnode_child_span_active() )
+            endRemoveRows();
         disconnect_node(child);
     });
+    connect(node, &model::DocumentNode::docnode_child_remove_span_begin, this, [this, node](int row, int count) {
+        int rows = node->docnode_child_count();
+        beginRemoveRows(node_index(node), rows - row - count, rows - row - 1);
+    });
+    connect(node, &model::DocumentNode::docnode_child_remove_span_end, this, [this]() {
+        endRemoveRows();
+    });
     if ( auto visual = node->cast<model::VisualNode>() )
     {
         connect(visual, &model::VisualNode::docnode_visible_changed, this, [this, visual]() {
@@ -101,11 +132,9 @@ void item_models::DocumentNodeModel::connect_node ( model::DocumentNode* node )
         endMoveRows();
     });
 
-    for ( model::DocumentNode* child : node->docnode_children() )
-        connect_node(child);
-
     connect(node, &QObject::destroyed, this, [this, node]{
         d->ptrs.erase(node);
+        d->expanded.erase(node);
     });
 }
 
@@ -115,8 +144,37 @@ void item_models::DocumentNodeModel::disconnect_node ( model::DocumentNode* node
 
     disconnect(node, nullptr, this, nullptr);
 
+    // Children are only connected once the node has been expanded
+    if ( d->expanded.erase(node) )
+    {
+        for ( model::DocumentNode* child : node->docnode_children() )
+            disconnect_node(child);
+    }
+}
+
+void item_models::DocumentNodeModel::expand_node ( model::DocumentNode* node ) const
+{
+    if ( !node || d->expanded.count(node) || !d->ptrs.count(node) )
+        return;
+
+    d->expanded.insert(node);
+
+    auto self = const_cast<DocumentNodeModel*>(this);
     for ( model::DocumentNode* child : node->docnode_children() )
-        disconnect_node(child);
+        self->connect_node(child);
+}
+
+bool item_models::DocumentNodeModel::hasChildren ( const QModelIndex& parent ) const
+{
+    if ( !d->document )
+        return false;
+
+    if ( !parent.isValid() )
+        return true;
+
+    // Avoids rowCount() so collapsed nodes aren't expanded
+    auto n = node(parent);
+    return n && n->docnode_child_count() > 0;
 }
 
 int item_models::DocumentNodeModel::rowCount ( const QModelIndex& parent ) const
@@ -127,7 +185,12 @@ int item_models::DocumentNodeModel::rowCount ( const QModelIndex& parent ) const
     if ( !parent.isValid() )
         return 2;
 
-    return node(parent)->docnode_child_count();
+    auto n = node(parent);
+    if ( !n )
+        return 0;
+
+    expand_node(n);
+    return n->docnode_child_count();
 }
 
 int item_models::DocumentNodeModel::columnCount ( const QModelIndex& ) const
@@ -148,10 +211,14 @@ QModelIndex item_models::DocumentNodeModel::index ( int row, int column, const Q
     }
 
     auto n = node(parent);
+    if ( !n )
+        return {};
+
     int rows = n->docnode_child_count();
-    if ( !n || row < 0 || row >= rows )
+    if ( row < 0 || row >= rows )
         return {};
 
+    expand_node(n);
     return createIndex(row, column, n->docnode_child(rows - row - 1));
 }
 
@@ -295,7 +362,9 @@ void item_models::DocumentNodeModel::set_document ( model::Document* doc )
 
     if ( d->document )
     {
-        disconnect(d->document->assets(), nullptr, this, nullptr);
+        disconnect_node(d->document->assets());
+        d->ptrs.clear();
+        d->expanded.clear();
     }
 
     d->document = doc;
@@ -344,6 +413,12 @@ QModelIndex item_models::DocumentNodeModel::node_index ( model::DocumentNode* no
         return createIndex(0, 0, node);
     }
 
+    // Indices can be requested for nodes deep in the tree (eg: selection),
+    // make sure their rows are connected to keep the indices updated
+    if ( !d->ptrs.count(parent) && !node_index(parent).isValid() )
+        return {};
+    expand_node(parent);
+
     int rows = parent->docnode_child_count();
     for ( int i = 0; i < rows; i++ )
     {
@@ -30,6 +30,7 @@ public:
     ~DocumentNodeModel();
 
     int rowCount ( const QModelIndex & parent ) const override;
+    bool hasChildren ( const QModelIndex & parent = {} ) const override;
     int columnCount ( const QModelIndex & parent ) const override;
     bool moveRows ( const QModelIndex & sourceParent, int sourceRow, int count, const QModelIndex & destinationParent, int destinationChild ) override;
     bool removeRows ( int row, int count, const QModelIndex & parent ) override;
@@ -50,6 +51,10 @@ public:
 private:
     void connect_node(model::DocumentNode* node);
     void disconnect_node(model::DocumentNode* node);
+    /**
+     * \brief Connects the children of \p node the first time they are shown
+     */
+    void expand_node(model::DocumentNode* node) const;
 
     class Private;
     std::unique_ptr<Private> d;
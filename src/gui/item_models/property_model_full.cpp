@@ -166,10 +166,24 @@ public:
         auto id = insert_into->id;
         connect(node, &model::DocumentNode::docnode_child_add_end, model,
         [this, id, node](model::DocumentNode* child, int row) {
+            // Spans are added all at once at the end
+            if ( node->docnode_child_span_active() )
+                return;
             auto insert_into = this->node(id);
             int rows = node->docnode_child_count() - 1; // called at the end
             add_object(child, insert_into, true, rows -  row + insert_into->merged_children_offset);
         });
+        connect(node, &model::DocumentNode::docnode_child_add_span_end, model,
+        [this, id, node](int row, int count) {
+            auto insert_into = this->node(id);
+            if ( !insert_into )
+                return;
+            int first = node->docnode_child_count() - row - count + insert_into->merged_children_offset;
+            my_model()->beginInsertRows(subtree_index(insert_into), first, first + count - 1);
+            for ( int i = row + count - 1; i >= row; i-- )
+                add_object(node->docnode_child(i), insert_into, false, first++);
+            my_model()->endInsertRows();
+        });
         connect(node, &model::DocumentNode::docnode_child_remove_end, model,
         [this](model::DocumentNode* child) {
             on_delete_object(child);
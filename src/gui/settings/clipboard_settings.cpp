@@ -20,6 +20,7 @@ using namespace glaxnimate;
 static std::vector<settings::ClipboardSettings::MimeSettings>& mutable_mime_types()
 {
     static std::vector<settings::ClipboardSettings::MimeSettings> settings {
+        {io::IoRegistry::instance().serializer_from_slug("glaxnimate-binary"), true, QIcon(app::Application::instance()->data_file("images/logo.svg"))},
         {io::IoRegistry::instance().serializer_from_slug("glaxnimate"), true, QIcon(app::Application::instance()->data_file("images/logo.svg"))},
         {io::IoRegistry::instance().serializer_from_slug("svg"),        true, QIcon::fromTheme("image-svg+xml")},
         {io::IoRegistry::instance().serializer_from_slug("raster"),     true, QIcon::fromTheme("image-png")},
@@ -28,6 +29,14 @@ static std::vector<settings::ClipboardSettings::MimeSettings>& mutable_mime_type
     return settings;
 }
 
+/**
+ * \brief Native formats, needed for copy and paste to work
+ */
+static bool always_enabled(const settings::ClipboardSettings::MimeSettings& set)
+{
+    return set.serializer->slug() == "glaxnimate" || set.serializer->slug() == "glaxnimate-binary";
+}
+
 const std::vector<settings::ClipboardSettings::MimeSettings>& settings::ClipboardSettings::mime_types()
 {
     return mutable_mime_types();
@@ -36,14 +45,14 @@ const std::vector<settings::ClipboardSettings::MimeSettings>& settings::Clipboar
 void settings::ClipboardSettings::load(QSettings & settings)
 {
     for ( auto& set : mutable_mime_types() )
-        if ( set.serializer->slug() != "glaxnimate" )
+        if ( !always_enabled(set) )
             set.enabled = settings.value(set.serializer->slug(), set.enabled).toBool();
 }
 
 void settings::ClipboardSettings::save(QSettings & settings)
 {
     for ( auto& set : mutable_mime_types() )
-        if ( set.serializer->slug() != "glaxnimate" )
+        if ( !always_enabled(set) )
             settings.setValue(set.serializer->slug(), set.enabled);
 }
 
@@ -59,7 +68,7 @@ QWidget * settings::ClipboardSettings::make_widget(QWidget* parent)
         check->setCheckable(true);
         check->setChecked(mt.enabled);
         check->setIcon(mt.icon);
-        if ( mt.serializer->slug() == "glaxnimate" )
+        if ( always_enabled(mt) )
             check->setEnabled(false);
         else
             QObject::connect(check, &QCheckBox::clicked, [&mt](bool b){ mt.enabled = b; });
@@ -0,0 +1,73 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <QStyledItemDelegate>
+#include <QApplication>
+#include <QUndoView>
+#include <QPainter>
+#include <QLocale>
+
+#include "command/spill_store.hpp"
+
+namespace glaxnimate::gui::style {
+
+/*
+ * Shows how much memory each command in a QUndoView is using,
+ * or how much it takes on disk when it has been spilled
+ */
+class UndoMemoryDelegate : public QStyledItemDelegate
+{
+public:
+    UndoMemoryDelegate(QUndoView* view)
+        : QStyledItemDelegate(view), view(view) {}
+
+protected:
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override
+    {
+        QStyledItemDelegate::paint(painter, option, index);
+
+        QString text = size_text(index);
+        if ( text.isEmpty() )
+            return;
+
+        const QWidget* widget = option.widget;
+        QStyle *style = widget ? widget->style() : QApplication::style();
+        const int text_margin = style->pixelMetric(QStyle::PM_FocusFrameHMargin, nullptr, widget) + 1;
+        QRect rect = option.rect.adjusted(text_margin, 0, -text_margin, 0);
+
+        painter->save();
+        QPalette::ColorGroup group = option.state & QStyle::State_Enabled ? QPalette::Normal : QPalette::Disabled;
+        QColor color = option.palette.color(group, option.state & QStyle::State_Selected ? QPalette::HighlightedText : QPalette::Text);
+        color.setAlphaF(color.alphaF() * 0.6);
+        painter->setPen(color);
+        painter->setFont(option.font);
+        painter->drawText(rect, Qt::AlignRight | Qt::AlignVCenter, text);
+        painter->restore();
+    }
+
+private:
+    QString size_text(const QModelIndex& index) const
+    {
+        // Row 0 is the clean state before any command
+        QUndoStack* stack = view->stack();
+        if ( !stack || index.row() < 1 || index.row() > stack->count() )
+            return {};
+
+        const QUndoCommand* cmd = stack->command(index.row() - 1);
+        QLocale locale;
+        if ( qint64 spilled = command::SpillStore::spilled_size(cmd) )
+            return QApplication::translate("UndoMemoryDelegate", "%1 on disk").arg(locale.formattedDataSize(spilled));
+        if ( qint64 memory = command::SpillStore::memory_usage(cmd) )
+            return locale.formattedDataSize(memory);
+        return {};
+    }
+
+    QUndoView* view;
+};
+
+} // namespace glaxnimate::gui::style
@@ -137,6 +137,7 @@ void GlaxnimateWindow::preferences()
 {
     app::SettingsDialog(this).exec();
     d->autosave_timer_load_settings();
+    d->undo_memory_load_settings();
 }
 
 void GlaxnimateWindow::closeEvent ( QCloseEvent* event )
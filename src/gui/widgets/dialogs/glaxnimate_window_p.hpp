@@ -20,6 +20,7 @@
 
 #include "model/document.hpp"
 #include "command/structure_commands.hpp"
+#include "io/glaxnimate/glaxnimate_journal.hpp"
 
 #include "graphics/document_scene.hpp"
 #include "item_models/document_node_model.hpp"
@@ -155,6 +156,7 @@ public:
     int autosave_timer = 0;
     int autosave_timer_mins = 0;
     bool autosave_load = false;
+    std::unique_ptr<io::glaxnimate::AutosaveJournal> autosave_journal;
     QString undo_text;
     QString redo_text;
     style::PropertyDelegate property_delegate;
@@ -196,8 +198,11 @@ public:
     void validate_tgs();
     void validate_discord();
     void autosave_timer_load_settings();
+    void undo_memory_load_settings();
     void autosave_timer_start(int mins = -1);
     void autosave_timer_tick();
+    io::glaxnimate::AutosaveJournal* autosave_journal_get();
+    void autosave_journal_reset(bool remove_files);
     QString backup_name();
     void load_backup(model::Document* doc);
     QString drop_event_data(QDropEvent* ev);
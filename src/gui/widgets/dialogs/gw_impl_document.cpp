@@ -7,6 +7,7 @@
 #include "glaxnimate_window_p.hpp"
 
 #include <QTemporaryFile>
+#include <QBuffer>
 #include <QDesktopServices>
 #include <QFileDialog>
 #include <QImageWriter>
@@ -18,11 +19,14 @@
 #include <QSharedMemory>
 #include <QtGlobal>
 #include <QNetworkReply>
+#include <QElapsedTimer>
+#include <QThread>
 
 
 #include "io/lottie/lottie_html_format.hpp"
 #include "io/svg/svg_renderer.hpp"
 #include "io/svg/svg_html_format.hpp"
+#include "command/spill_store.hpp"
 #include "io/glaxnimate/glaxnimate_format.hpp"
 #include "io/raster/raster_mime.hpp"
 #include "io/lottie/tgs_format.hpp"
@@ -53,6 +57,34 @@ static void process_events(const QFuture<T>& promise)
     }
 }
 
+/**
+ * \brief Waits for \p promise, showing \p dialog if it takes a while so the user can cancel it
+ */
+template<class T>
+static void process_events(const QFuture<T>& promise, IoStatusDialog* dialog)
+{
+    QElapsedTimer timer;
+    timer.start();
+    Qt::WindowModality modality = dialog->windowModality();
+    if ( !dialog->isVisible() )
+        dialog->setWindowModality(Qt::ApplicationModal);
+
+    while ( !promise.isFinished() )
+    {
+        if ( !dialog->isVisible() && timer.elapsed() > 500 )
+            dialog->show();
+
+        // The modal dialog blocks input to the other windows
+        QEventLoop::ProcessEventsFlags flags = QEventLoop::WaitForMoreEvents;
+        if ( dialog->windowModality() != Qt::ApplicationModal || !dialog->isVisible() )
+            flags |= QEventLoop::ExcludeUserInputEvents;
+        qApp->processEvents(flags, 10);
+    }
+
+    if ( !dialog->isVisible() )
+        dialog->setWindowModality(modality);
+}
+
 void GlaxnimateWindow::Private::setup_document_ptr(std::unique_ptr<model::Document> doc)
 {
     if ( !close_document() )
@@ -89,12 +121,17 @@ void GlaxnimateWindow::Private::do_setup_document()
     // Undo Redo
     parent->undo_group().addStack(&current_document->undo_stack());
     parent->undo_group().setActiveStack(&current_document->undo_stack());
+    undo_memory_load_settings();
+    current_document->undo_spill_store().set_error_handler([this](const QString& message){
+        show_warning(tr("Undo"), message);
+    });
 
     // Views
     document_node_model.set_document(current_document.get());
     ui.view_document_node->set_composition(comp);
     ui.timeline_widget->set_document(current_document.get());
     ui.timeline_widget->set_composition(comp);
+    ui.render_profiler->set_composition(comp);
     ui.view_assets->setRootIndex(asset_model.mapFromSource(document_node_model.node_index(current_document->assets()).siblingAtColumn(1)));
 
     property_model.set_document(current_document.get());
@@ -118,6 +155,16 @@ void GlaxnimateWindow::Private::do_setup_document()
     QObject::connect(&current_document->undo_stack(), &QUndoStack::cleanChanged, parent, &GlaxnimateWindow::refresh_title);
     refresh_title();
 
+    // Autosave
+    QObject::connect(&current_document->undo_stack(), &QUndoStack::indexChanged, parent, [this]{
+        if ( auto journal = autosave_journal_get() )
+            journal->schedule_flush();
+    });
+    // The backup file name depends on the document file name
+    QObject::connect(current_document.get(), &model::Document::filename_changed, parent, [this]{
+        autosave_journal_reset(!autosave_load);
+    });
+
     // Playback
     ui.play_controls->set_record_enabled(false);
     ui.play_controls_2->set_record_enabled(false);
@@ -186,22 +233,35 @@ bool GlaxnimateWindow::Private::setup_document_open(QIODevice* file, const io::O
     if ( !close_document() )
         return false;
 
-    current_document = std::make_unique<model::Document>(options.filename);
-
     dialog_import_status->reset(options.format, options.filename);
-    /*auto promise = QtConcurrent::run(
-        [options, current_document=current_document.get()]{
-            QFile file(options.filename);
-            return options.format->open(file, options.filename, current_document, options.settings);
-        });
 
-    process_events(promise);
-
-    bool ok = promise.result();*/
+    bool ok;
+    // Python plugins need to run in the main thread
+    if ( !qobject_cast<plugin::IoFormat*>(options.format) )
+    {
+        dialog_import_status->allow_cancel();
+        // The document is built in a worker thread, connections are set up after it's been moved back
+        auto promise = QtConcurrent::run(
+            [file, options, gui_thread=QThread::currentThread()]{
+                auto document = std::make_unique<model::Document>(options.filename);
+                document->set_io_options(options);
+                bool ok = options.format->open(*file, options.filename, document.get(), options.settings);
+                document->move_to_thread(gui_thread);
+                return std::make_pair(ok, document.release());
+            });
 
-    current_document->set_io_options(options);
+        process_events(promise, dialog_import_status);
 
-    bool ok = options.format->open(*file, options.filename, current_document.get(), options.settings);
+        auto result = promise.result();
+        ok = result.first;
+        current_document.reset(result.second);
+    }
+    else
+    {
+        current_document = std::make_unique<model::Document>(options.filename);
+        current_document->set_io_options(options);
+        ok = options.format->open(*file, options.filename, current_document.get(), options.settings);
+    }
 
     do_setup_document();
 
@@ -270,8 +330,9 @@ bool GlaxnimateWindow::Private::close_document()
 {
     if ( current_document )
     {
+        autosave_journal_reset(false);
         if ( !autosave_load )
-            QDir().remove(backup_name());
+            io::glaxnimate::AutosaveJournal::remove_files(backup_name());
 
         if ( !current_document->undo_stack().isClean() )
         {
@@ -314,6 +375,7 @@ bool GlaxnimateWindow::Private::close_document()
     ui.document_swatch_widget->set_document(nullptr);
     ui.widget_gradients->set_document(nullptr);
     ui.view_document_node->set_composition(nullptr);
+    ui.render_profiler->set_composition(nullptr);
     ui.tab_bar->set_document(nullptr);
 
     for ( const auto& stack : parent->undo_group().stacks() )
@@ -578,9 +640,9 @@ void GlaxnimateWindow::Private::save_frame_svg()
         return;
     }
 
-    io::svg::SvgRenderer rend(io::svg::NotAnimated, io::svg::CssFontType::FontFace);
+    io::svg::SvgRenderer rend(&file, io::svg::NotAnimated, io::svg::CssFontType::FontFace, true);
     rend.write_main(comp);
-    rend.write(&file, true);
+    rend.close();
 }
 
 void GlaxnimateWindow::Private::validate_discord()
@@ -614,13 +676,29 @@ void GlaxnimateWindow::Private::autosave_timer_start(int mins)
 
 void GlaxnimateWindow::Private::autosave_timer_tick()
 {
-    if ( current_document && !current_document->undo_stack().isClean() && !autosave_load )
+    if ( current_document && !current_document->undo_stack().isClean() )
     {
-        QFile file(backup_name());
-        file.open(QIODevice::WriteOnly);
-        io::glaxnimate::GlaxnimateFormat().save(file, file.fileName(), comp, {});
+        if ( auto journal = autosave_journal_get() )
+            journal->snapshot();
     }
+}
 
+io::glaxnimate::AutosaveJournal* GlaxnimateWindow::Private::autosave_journal_get()
+{
+    if ( !autosave_timer_mins || autosave_load || !current_document )
+        return nullptr;
+
+    if ( !autosave_journal )
+        autosave_journal = std::make_unique<io::glaxnimate::AutosaveJournal>(current_document.get(), backup_name());
+
+    return autosave_journal.get();
+}
+
+void GlaxnimateWindow::Private::autosave_journal_reset(bool remove_files)
+{
+    if ( autosave_journal && remove_files )
+        autosave_journal->remove_files();
+    autosave_journal.reset();
 }
 
 void GlaxnimateWindow::Private::autosave_timer_load_settings()
@@ -635,6 +713,15 @@ void GlaxnimateWindow::Private::autosave_timer_load_settings()
     }
 }
 
+void GlaxnimateWindow::Private::undo_memory_load_settings()
+{
+    if ( current_document )
+    {
+        qint64 mib = app::settings::get<int>("open_save", "undo_memory");
+        current_document->undo_spill_store().set_budget(mib * 1024 * 1024);
+    }
+}
+
 QString GlaxnimateWindow::Private::backup_name()
 {
     const auto& options = current_document->io_options();
@@ -665,8 +752,17 @@ void GlaxnimateWindow::Private::load_backup(model::Document* doc)
         {}
     };
 
+    QByteArray data = io::glaxnimate::AutosaveJournal::recover(io_options_bak.filename);
+    if ( data.isEmpty() )
+    {
+        show_warning(tr("Backup"), tr("Could not load the backup"));
+        return;
+    }
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+
     autosave_load = true;
-    setup_document_open(io_options_bak);
+    setup_document_open(&buffer, io_options_bak, true);
     current_document->set_io_options(io_options_old);
     autosave_load = false;
 }
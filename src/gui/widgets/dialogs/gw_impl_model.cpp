@@ -248,7 +248,7 @@ void GlaxnimateWindow::Private::import_image()
     {
         auto bitmap = std::make_unique<model::Bitmap>(current_document.get());
         bitmap->filename.set(image_file);
-        if ( bitmap->pixmap().isNull() )
+        if ( bitmap->size().isEmpty() )
         {
             show_warning(tr("Import Image"), tr("Could not import image"));
             continue;
@@ -260,7 +260,7 @@ void GlaxnimateWindow::Private::import_image()
 
         auto image = std::make_unique<model::Image>(current_document.get());
         image->image.set(bmp_ptr);
-        QPointF p(bmp_ptr->pixmap().width() / 2.0, bmp_ptr->pixmap().height() / 2.0);
+        QPointF p(bmp_ptr->width.get() / 2.0, bmp_ptr->height.get() / 2.0);
         image->transform->anchor_point.set(p);
         image->transform->position.set(p);
         auto comp = current_composition();
@@ -407,6 +407,7 @@ void GlaxnimateWindow::Private::switch_composition(model::Composition* new_comp,
 
     ui.view_document_node->set_composition(comp);
     ui.timeline_widget->set_composition(comp);
+    ui.render_profiler->set_composition(comp);
     scene.set_composition(comp);
     scene.user_select(comp_selections[i].selection, graphics::DocumentScene::Replace);
     auto current = comp_selections[i].current;
@@ -44,6 +44,7 @@
 #include "widgets/shape_style/shape_style_preview_widget.hpp"
 
 #include "style/better_elide_delegate.hpp"
+#include "style/undo_memory_delegate.hpp"
 #include "tools/edit_tool.hpp"
 #include "plugin/action.hpp"
 #include "glaxnimate_app.hpp"
@@ -303,6 +304,7 @@ void GlaxnimateWindow::Private::init_actions()
         ui.action_undo->setText(undo_text.arg(s));
     });
     ui.view_undo->setGroup(&parent->undo_group());
+    ui.view_undo->setItemDelegate(new style::UndoMemoryDelegate(ui.view_undo));
 
 
 #ifdef Q_OS_WIN32
@@ -658,6 +660,7 @@ void GlaxnimateWindow::Private::layout_medium()
     parent->tabifyDockWidget(ui.dock_timeline, ui.dock_properties);
     parent->tabifyDockWidget(ui.dock_properties, ui.dock_script_console);
     parent->tabifyDockWidget(ui.dock_script_console, ui.dock_logs);
+    parent->tabifyDockWidget(ui.dock_logs, ui.dock_render_profiler);
     parent->tabifyDockWidget(ui.dock_logs, ui.dock_time_slider);
     ui.dock_timeline->raise();
     ui.dock_time_slider->setVisible(false);
@@ -705,6 +708,7 @@ void GlaxnimateWindow::Private::layout_medium()
     parent->resizeDocks({ui.dock_timeline}, {300}, Qt::Vertical);
     ui.dock_script_console->setVisible(false);
     ui.dock_logs->setVisible(false);
+    ui.dock_render_profiler->setVisible(false);
     ui.dock_tools->setVisible(false);
     ui.dock_snippets->setVisible(false);
 
@@ -722,6 +726,7 @@ void GlaxnimateWindow::Private::layout_wide()
     parent->tabifyDockWidget(ui.dock_timeline, ui.dock_properties);
     parent->tabifyDockWidget(ui.dock_properties, ui.dock_script_console);
     parent->tabifyDockWidget(ui.dock_script_console, ui.dock_logs);
+    parent->tabifyDockWidget(ui.dock_logs, ui.dock_render_profiler);
     parent->tabifyDockWidget(ui.dock_logs, ui.dock_time_slider);
     ui.dock_timeline->raise();
     ui.dock_time_slider->setVisible(false);
@@ -768,6 +773,7 @@ void GlaxnimateWindow::Private::layout_wide()
     parent->resizeDocks({ui.dock_timeline}, {1080/3}, Qt::Vertical);
     ui.dock_script_console->setVisible(false);
     ui.dock_logs->setVisible(false);
+    ui.dock_render_profiler->setVisible(false);
     ui.dock_tools->setVisible(false);
     ui.dock_snippets->setVisible(false);
 
@@ -785,6 +791,7 @@ void GlaxnimateWindow::Private::layout_compact()
     parent->tabifyDockWidget(ui.dock_time_slider, ui.dock_timeline);
     parent->tabifyDockWidget(ui.dock_timeline, ui.dock_script_console);
     parent->tabifyDockWidget(ui.dock_script_console, ui.dock_logs);
+    parent->tabifyDockWidget(ui.dock_logs, ui.dock_render_profiler);
     ui.dock_time_slider->raise();
     ui.dock_time_slider->setVisible(true);
     ui.dock_timeline->setVisible(false);
@@ -825,6 +832,7 @@ void GlaxnimateWindow::Private::layout_compact()
     parent->resizeDocks({ui.dock_time_slider}, {64}, Qt::Vertical);
     ui.dock_script_console->setVisible(false);
     ui.dock_logs->setVisible(false);
+    ui.dock_render_profiler->setVisible(false);
     ui.dock_tools->setVisible(false);
     ui.dock_snippets->setVisible(false);
 
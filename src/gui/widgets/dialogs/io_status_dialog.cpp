@@ -29,6 +29,11 @@ IoStatusDialog::IoStatusDialog(const QIcon& icon, const QString& title, bool del
     d->setupUi(this);
     setWindowTitle(title);
     setWindowIcon(icon);
+
+    connect(d->button_box, &QDialogButtonBox::rejected, this, [this]{
+        if ( !d->finished && d->ie )
+            d->ie->cancel();
+    });
 }
 
 IoStatusDialog::~IoStatusDialog() = default;
@@ -37,6 +42,7 @@ IoStatusDialog::~IoStatusDialog() = default;
 void IoStatusDialog::show_errors(const QString& success, const QString& failure)
 {
     d->progress_bar->hide();
+    d->button_box->setStandardButtons(QDialogButtonBox::Close);
     d->button_box->setEnabled(true);
 
     if ( d->has_errors )
@@ -62,6 +68,7 @@ void IoStatusDialog::_on_completed(bool success)
         show();
 
     d->progress_bar->hide();
+    d->button_box->setStandardButtons(QDialogButtonBox::Close);
     d->button_box->setEnabled(true);
 
     if ( !success )
@@ -119,6 +126,7 @@ void IoStatusDialog::reset(io::ImportExport* ie, const QString& label)
     d->progress_bar->setValue(0);
     d->progress_bar->setMaximum(0);
     d->list_widget->clear();
+    d->button_box->setStandardButtons(QDialogButtonBox::Close);
     d->button_box->setEnabled(false);
     d->group_box->hide();
     d->label->setText(label);
@@ -134,6 +142,15 @@ void IoStatusDialog::reset(io::ImportExport* ie, const QString& label)
     connect(ie, &io::ImportExport::completed, this, &IoStatusDialog::_on_completed);
 }
 
+void glaxnimate::gui::IoStatusDialog::allow_cancel()
+{
+    if ( !d->finished && d->ie )
+    {
+        d->button_box->setStandardButtons(QDialogButtonBox::Cancel);
+        d->button_box->setEnabled(true);
+    }
+}
+
 void glaxnimate::gui::IoStatusDialog::disconnect_import_export()
 {
     if ( d->ie )
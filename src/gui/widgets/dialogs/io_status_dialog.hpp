@@ -25,6 +25,11 @@ public:
     void reset(io::ImportExport* ie, const QString& label);
     void disconnect_import_export();
 
+    /**
+     * \brief Shows a button that cancels the running operation until it completes
+     */
+    void allow_cancel();
+
     bool has_errors() const;
     void show_errors(const QString& success, const QString& failure);
 
@@ -66,7 +66,8 @@ std::vector<model::VisualNode *> glaxnimate::gui::SelectionManager::copy() const
 
     if ( !selection.empty() )
     {
-        QMimeData* data = new QMimeData;
+        // Some formats are only produced when another application requests them
+        auto data = new io::mime::MimeData;
         for ( const auto& serializer : supported_mimes() )
         {
             serializer->to_mime_data(*data, std::vector<model::DocumentNode*>(selection.begin(), selection.end()));
@@ -192,19 +193,20 @@ void glaxnimate::gui::SelectionManager::paste_document(model::Document* document
     {
         if ( !comp->shapes.empty() )
         {
-            int shape_insertion_point = shape_cont->size();
+            // Added in one go so views get a single row insertion
+            std::vector<std::unique_ptr<model::ShapeElement>> shapes;
+            shapes.reserve(comp->shapes.size());
             for ( auto& shape : comp->shapes.raw() )
             {
-                auto ptr = shape.get();
                 shape->clear_owner();
                 shape->refresh_uuid();
-                if ( !as_comp )
-                    select.push_back(ptr);
+                select.push_back(shape.get());
                 shape->transfer(doc);
-                doc->push_command(new command::AddShape(shape_cont, std::move(shape), shape_insertion_point++));
-                if ( !as_comp )
-                    ptr->recursive_rename();
+                shapes.push_back(std::move(shape));
             }
+            doc->push_command(new command::AddShapes(shape_cont, std::move(shapes), shape_cont->size(), nullptr, macro_name));
+            for ( auto ptr : select )
+                ptr->recursive_rename();
         }
     }
 
@@ -0,0 +1,152 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "render_profiler_widget.hpp"
+
+#include <QCheckBox>
+#include <QEvent>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPointer>
+#include <QPushButton>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+#include "model/document.hpp"
+#include "model/assets/composition.hpp"
+#include "utils/profiler.hpp"
+
+using namespace glaxnimate::gui;
+using namespace glaxnimate;
+
+class RenderProfilerWidget::Private
+{
+public:
+    enum Columns
+    {
+        ColumnName,
+        ColumnCategory,
+        ColumnCount,
+        ColumnSelf,
+        ColumnTotal,
+    };
+
+    void setup_ui(RenderProfilerWidget* parent)
+    {
+        auto layout = new QVBoxLayout(parent);
+        layout->setContentsMargins(0, 0, 0, 0);
+
+        auto buttons = new QHBoxLayout();
+        layout->addLayout(buttons);
+        button_profile = new QPushButton(parent);
+        button_profile->setIcon(QIcon::fromTheme("chronometer"));
+        buttons->addWidget(button_profile);
+        check_follow = new QCheckBox(parent);
+        buttons->addWidget(check_follow);
+        buttons->addStretch();
+        label_total = new QLabel(parent);
+        buttons->addWidget(label_total);
+
+        tree = new QTreeWidget(parent);
+        tree->setRootIsDecorated(false);
+        tree->setSortingEnabled(true);
+        tree->setAlternatingRowColors(true);
+        tree->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+        tree->header()->setStretchLastSection(false);
+        tree->header()->setSectionResizeMode(ColumnName, QHeaderView::Stretch);
+        layout->addWidget(tree);
+
+        retranslate();
+    }
+
+    void retranslate()
+    {
+        button_profile->setText(tr("Profile Frame"));
+        check_follow->setText(tr("Follow Current Frame"));
+        tree->setHeaderLabels({tr("Node"), tr("Operation"), tr("Calls"), tr("Self (ms)"), tr("Total (ms)")});
+    }
+
+    void follow(bool on)
+    {
+        QObject::disconnect(time_connection);
+        if ( on && comp )
+            time_connection = QObject::connect(comp->document(), &model::Document::current_time_changed, parent, &RenderProfilerWidget::profile_frame);
+    }
+
+    RenderProfilerWidget* parent = nullptr;
+    QPushButton* button_profile = nullptr;
+    QCheckBox* check_follow = nullptr;
+    QLabel* label_total = nullptr;
+    QTreeWidget* tree = nullptr;
+    QPointer<model::Composition> comp;
+    QMetaObject::Connection time_connection;
+};
+
+RenderProfilerWidget::RenderProfilerWidget(QWidget* parent)
+    : QWidget(parent), d(std::make_unique<Private>())
+{
+    d->parent = this;
+    d->setup_ui(this);
+    connect(d->button_profile, &QPushButton::clicked, this, &RenderProfilerWidget::profile_frame);
+    connect(d->check_follow, &QCheckBox::toggled, this, [this](bool on){
+        d->follow(on);
+        if ( on )
+            profile_frame();
+    });
+}
+
+RenderProfilerWidget::~RenderProfilerWidget() = default;
+
+void RenderProfilerWidget::set_composition(model::Composition* comp)
+{
+    d->comp = comp;
+    d->tree->clear();
+    d->label_total->clear();
+    d->follow(d->check_follow->isChecked());
+}
+
+void RenderProfilerWidget::profile_frame()
+{
+    if ( !d->comp || !isVisible() )
+        return;
+
+    // Drop spans recorded by other users of the profiler
+    utils::profiler::clear();
+    utils::profiler::set_enabled(true);
+    d->comp->render_image(d->comp->document()->current_time());
+    utils::profiler::set_enabled(false);
+
+    auto spans = utils::profiler::take();
+    auto stats = utils::profiler::summarize(spans);
+
+    qint64 total = 0;
+    for ( const auto& stat : stats )
+        total += stat.self;
+
+    d->tree->setSortingEnabled(false);
+    d->tree->clear();
+    for ( const auto& stat : stats )
+    {
+        auto item = new QTreeWidgetItem(d->tree);
+        item->setText(Private::ColumnName, stat.name);
+        item->setText(Private::ColumnCategory, QString::fromLatin1(stat.category));
+        item->setData(Private::ColumnCount, Qt::DisplayRole, stat.count);
+        item->setData(Private::ColumnSelf, Qt::DisplayRole, stat.self / 1e6);
+        item->setData(Private::ColumnTotal, Qt::DisplayRole, stat.total / 1e6);
+    }
+    d->tree->setSortingEnabled(true);
+    d->tree->sortByColumn(Private::ColumnSelf, Qt::DescendingOrder);
+
+    d->label_total->setText(tr("Frame %1: %2 ms").arg(d->comp->document()->current_time()).arg(total / 1e6, 0, 'f', 2));
+}
+
+void RenderProfilerWidget::changeEvent(QEvent* e)
+{
+    QWidget::changeEvent(e);
+
+    if ( e->type() == QEvent::LanguageChange )
+        d->retranslate();
+}
@@ -0,0 +1,42 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <memory>
+#include <QWidget>
+
+namespace glaxnimate::model {
+class Composition;
+} // namespace glaxnimate::model
+
+namespace glaxnimate::gui {
+
+/**
+ * \brief Renders the current frame with the profiler enabled and lists the slowest nodes
+ */
+class RenderProfilerWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    RenderProfilerWidget(QWidget* parent = nullptr);
+    ~RenderProfilerWidget();
+
+    void set_composition(model::Composition* comp);
+
+public slots:
+    void profile_frame();
+
+protected:
+    void changeEvent(QEvent* e) override;
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+} // namespace glaxnimate::gui
@@ -415,6 +415,7 @@ timeline::AnimatableItem::AnimatableItem(quintptr id, model::Object* obj, model:
     connect(animatable, &model::AnimatableBase::keyframe_added, this, &AnimatableItem::add_keyframe);
     connect(animatable, &model::AnimatableBase::keyframe_removed, this, &AnimatableItem::remove_keyframe);
     connect(animatable, &model::AnimatableBase::keyframe_updated, this, &AnimatableItem::update_keyframe);
+    connect(animatable, &model::AnimatableBase::keyframe_transition_changed, this, &AnimatableItem::transition_changed);
 }
 
 std::pair<model::KeyframeBase*, model::KeyframeBase*> timeline::AnimatableItem::keyframes(KeyframeSplitItem* item)
@@ -454,8 +455,6 @@ void timeline::AnimatableItem::add_keyframe(int index)
     item->set_exit(kf->transition().before_descriptive());
     item->set_enter(prev ? prev->transition().after_descriptive() : model::KeyframeTransition::Hold);
     kf_split_items.insert(kf_split_items.begin() + index, item);
-
-    connect(kf, &model::KeyframeBase::transition_changed, this, &AnimatableItem::transition_changed);
 }
 
 void timeline::AnimatableItem::remove_keyframe(int index)
@@ -468,10 +467,9 @@ void timeline::AnimatableItem::remove_keyframe(int index)
     }
 }
 
-void timeline::AnimatableItem::transition_changed(model::KeyframeTransition::Descriptive before, model::KeyframeTransition::Descriptive after)
+void timeline::AnimatableItem::transition_changed(int index, model::KeyframeTransition::Descriptive before, model::KeyframeTransition::Descriptive after)
 {
-    int index = animatable->keyframe_index(static_cast<model::KeyframeBase*>(sender()));
-    if ( index == -1 )
+    if ( index < 0 || index >= int(kf_split_items.size()) )
         return;
 
     kf_split_items[index]->set_exit(before);
@@ -233,7 +233,7 @@ public slots:
     void remove_keyframe(int index);
 
 private slots:
-    void transition_changed(model::KeyframeTransition::Descriptive before, model::KeyframeTransition::Descriptive after);
+    void transition_changed(int index, model::KeyframeTransition::Descriptive before, model::KeyframeTransition::Descriptive after);
 
 
     void update_keyframe(int index, model::KeyframeBase* kf);
@@ -7,6 +7,8 @@
 #include "miscdefs.hpp"
 
 #include <pybind11/operators.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
 
 #include <QVector2D>
 #include <QPointF>
@@ -25,6 +27,67 @@
 
 using namespace glaxnimate;
 
+namespace {
+
+using FloatArray = py::array_t<double, py::array::c_style | py::array::forcecast>;
+using TypeArray = py::array_t<uint8_t, py::array::c_style | py::array::forcecast>;
+
+/// Number of floats per point in the bezier arrays: pos, tan_in, tan_out
+constexpr int bezier_point_floats = 6;
+
+FloatArray bezier_to_array(const math::bezier::Bezier& bez)
+{
+    FloatArray out({py::ssize_t(bez.size()), py::ssize_t(bezier_point_floats)});
+    double* data = out.mutable_data();
+    for ( const auto& point : bez )
+    {
+        *data++ = point.pos.x();
+        *data++ = point.pos.y();
+        *data++ = point.tan_in.x();
+        *data++ = point.tan_in.y();
+        *data++ = point.tan_out.x();
+        *data++ = point.tan_out.y();
+    }
+    return out;
+}
+
+TypeArray bezier_point_types(const math::bezier::Bezier& bez)
+{
+    TypeArray out(bez.size());
+    uint8_t* data = out.mutable_data();
+    for ( const auto& point : bez )
+        *data++ = point.type;
+    return out;
+}
+
+void bezier_set_array(math::bezier::Bezier& bez, const FloatArray& points, const std::optional<TypeArray>& types)
+{
+    if ( points.ndim() != 2 || points.shape(1) != bezier_point_floats )
+        throw py::value_error("points must be a (N, 6) array");
+
+    py::ssize_t count = points.shape(0);
+    if ( types && types->size() != count )
+        throw py::value_error("types must have one value per point");
+
+    const double* data = points.data();
+    const uint8_t* type_data = types ? types->data() : nullptr;
+
+    auto& out = bez.points();
+    out.clear();
+    out.reserve(count);
+    for ( py::ssize_t i = 0; i < count; i++, data += bezier_point_floats )
+    {
+        out.emplace_back(
+            QPointF(data[0], data[1]),
+            QPointF(data[2], data[3]),
+            QPointF(data[4], data[5]),
+            type_data ? math::bezier::PointType(type_data[i]) : math::bezier::Corner
+        );
+    }
+}
+
+} // namespace
+
 void define_bezier(py::module& m)
 {
     py::module bezier = m.def_submodule("bezier", "");
@@ -72,6 +135,23 @@ void define_bezier(py::module& m)
         .def("__iter__", [](const math::bezier::Bezier& bez){
             return py::make_iterator(bez.points().begin(), bez.points().end());
         })
+        .def("to_array", &bezier_to_array,
+            "Returns all points as a (N, 6) array, each row is pos.x, pos.y, tan_in.x, tan_in.y, tan_out.x, tan_out.y"
+        )
+        .def("point_types", &bezier_point_types, "Returns the PointType of all points as an array")
+        .def("set_array", &bezier_set_array,
+            "Replaces all points from a (N, 6) array as returned by to_array()",
+            py::arg("points"), py::arg("types") = py::none()
+        )
+        .def_static("from_array", [](const FloatArray& points, const std::optional<TypeArray>& types, bool closed){
+                math::bezier::Bezier bez;
+                bezier_set_array(bez, points, types);
+                bez.set_closed(closed);
+                return bez;
+            },
+            "Creates a bezier from a (N, 6) array as returned by to_array()",
+            py::arg("points"), py::arg("types") = py::none(), py::arg("closed") = false
+        )
     ;
 
     pybind11::detail::type_caster<QVariant>::add_custom_type<math::bezier::Bezier>();
@@ -139,7 +219,7 @@ static void define_trace(py::module& m)
             tracer.set_target_index(i);
             math::bezier::MultiBezier mb;
             tracer.trace(mb);
-            out.emplace_back(std::move(mb.beziers()));
+            out.emplace_back(mb.beziers().begin(), mb.beziers().end());
         }
 
         return out;
@@ -4,7 +4,10 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  */
 
+#include <algorithm>
+
 #include <pybind11/operators.h>
+#include <pybind11/numpy.h>
 
 #include "model/document.hpp"
 #include "model/visitor.hpp"
@@ -52,6 +55,128 @@ using namespace glaxnimate;
 
 namespace {
 
+/**
+ * Conversion between keyframe values and rows of a float array,
+ * specialized for types that can be represented as a fixed number of floats
+ */
+template<class T>
+struct KeyframeArray
+{
+    static constexpr int components = 0;
+};
+
+template<>
+struct KeyframeArray<float>
+{
+    static constexpr int components = 1;
+    static void to_array(float v, double* out) { out[0] = v; }
+    static float from_array(const double* in) { return in[0]; }
+};
+
+template<>
+struct KeyframeArray<QPointF>
+{
+    static constexpr int components = 2;
+    static void to_array(const QPointF& v, double* out) { out[0] = v.x(); out[1] = v.y(); }
+    static QPointF from_array(const double* in) { return {in[0], in[1]}; }
+};
+
+template<>
+struct KeyframeArray<QSizeF>
+{
+    static constexpr int components = 2;
+    static void to_array(const QSizeF& v, double* out) { out[0] = v.width(); out[1] = v.height(); }
+    static QSizeF from_array(const double* in) { return {in[0], in[1]}; }
+};
+
+template<>
+struct KeyframeArray<QVector2D>
+{
+    static constexpr int components = 2;
+    static void to_array(const QVector2D& v, double* out) { out[0] = v.x(); out[1] = v.y(); }
+    static QVector2D from_array(const double* in) { return QVector2D(in[0], in[1]); }
+};
+
+template<>
+struct KeyframeArray<QColor>
+{
+    static constexpr int components = 4;
+    static void to_array(const QColor& v, double* out)
+    {
+        out[0] = v.redF();
+        out[1] = v.greenF();
+        out[2] = v.blueF();
+        out[3] = v.alphaF();
+    }
+    static QColor from_array(const double* in) { return QColor::fromRgbF(in[0], in[1], in[2], in[3]); }
+};
+
+using FloatArray = py::array_t<double, py::array::c_style | py::array::forcecast>;
+
+template<class T, class PyClass>
+void define_keyframe_arrays(PyClass& cls)
+{
+    using Prop = model::AnimatedProperty<T>;
+    using Traits = KeyframeArray<T>;
+
+    cls.def("keyframe_times", [](const Prop& prop){
+            int count = prop.keyframe_count();
+            FloatArray out(count);
+            double* data = out.mutable_data();
+            for ( int i = 0; i < count; i++ )
+                data[i] = prop.keyframe(i)->time();
+            return out;
+        },
+        "Returns the times of all keyframes as an array"
+    )
+    .def("keyframe_values", [](const Prop& prop){
+            int count = prop.keyframe_count();
+            std::vector<py::ssize_t> shape{py::ssize_t(count)};
+            if ( Traits::components > 1 )
+                shape.push_back(Traits::components);
+            FloatArray out(shape);
+            double* data = out.mutable_data();
+            for ( int i = 0; i < count; i++ )
+                Traits::to_array(prop.keyframe(i)->get(), data + i * Traits::components);
+            return out;
+        },
+        "Returns the values of all keyframes as an array with one row per keyframe"
+    )
+    .def("set_keyframes", [](Prop& prop, const FloatArray& times, const FloatArray& values){
+            py::ssize_t count = times.size();
+            if ( times.ndim() != 1 )
+                throw py::value_error("times must be a 1D array");
+            if ( values.size() != count * Traits::components )
+                throw py::value_error("values must have one row per keyframe");
+
+            const double* time_data = times.data();
+            const double* value_data = values.data();
+            std::vector<command::ReplaceKeyframes::Keyframe> keyframes;
+            keyframes.reserve(count);
+            for ( py::ssize_t i = 0; i < count; i++ )
+                keyframes.push_back({
+                    time_data[i],
+                    QVariant::fromValue(Traits::from_array(value_data + i * Traits::components))
+                });
+
+            std::stable_sort(keyframes.begin(), keyframes.end(), [](const auto& a, const auto& b){
+                return a.time < b.time;
+            });
+
+            // ReplaceKeyframes would insert all of them, leaving keyframes with the same time
+            auto duplicate = std::adjacent_find(keyframes.begin(), keyframes.end(), [](const auto& a, const auto& b){
+                return a.time == b.time;
+            });
+            if ( duplicate != keyframes.end() )
+                throw py::value_error("times must not contain duplicates");
+
+            prop.object()->push_command(new command::ReplaceKeyframes(&prop, std::move(keyframes)));
+        },
+        "Replaces all keyframes with the given times and values (one row per keyframe) in a single undoable step, times must be unique",
+        py::arg("times"), py::arg("values")
+    );
+}
+
 template<class T, class Base=model::AnimatableBase>
 void register_animatable(py::module& m)
 {
@@ -62,7 +187,33 @@ void register_animatable(py::module& m)
     name += QMetaType::fromType<T>().name();
 #endif
     name += ">";
-    py::class_<model::AnimatedProperty<T>, Base>(m, name.c_str());
+    py::class_<model::AnimatedProperty<T>, Base> cls(m, name.c_str());
+
+    if constexpr ( KeyframeArray<T>::components > 0 )
+        define_keyframe_arrays<T>(cls);
+}
+
+/**
+ * Rendered frame, its pixels are exposed through the buffer protocol without copies
+ */
+struct FrameBuffer
+{
+    QImage image;
+};
+
+static FrameBuffer render_frame_buffer(model::Composition* comp, model::FrameTime time, const QSize& size, const QColor& background)
+{
+    return {comp->render_image(time, size, background)};
+}
+
+static void render_frame_into(model::Composition* comp, model::FrameTime time, const py::buffer& buffer, const QColor& background)
+{
+    py::buffer_info info = buffer.request(true);
+    if ( info.ndim != 3 || info.shape[2] != 4 || info.itemsize != 1 || info.strides[2] != 1 || info.strides[1] != 4 )
+        throw py::value_error("buffer must be a (height, width, 4) array of bytes with contiguous rows");
+
+    QImage image(static_cast<uchar*>(info.ptr), info.shape[1], info.shape[0], info.strides[0], QImage::Format_RGBA8888);
+    comp->render_into(image, time, background);
 }
 
 static QImage doc_to_image(model::Composition* comp)
@@ -76,9 +227,9 @@ static QByteArray frame_to_svg(model::Composition* comp)
     QBuffer file(&data);
     file.open(QIODevice::WriteOnly);
 
-    io::svg::SvgRenderer rend(io::svg::NotAnimated, io::svg::CssFontType::FontFace);
+    io::svg::SvgRenderer rend(&file, io::svg::NotAnimated, io::svg::CssFontType::FontFace, true);
     rend.write_main(comp);
-    rend.write(&file, true);
+    rend.close();
 
     return data;
 }
@@ -103,6 +254,24 @@ void define_io(py::module& m)
                     py::arg("node"), py::arg("frame"))
     ;
 
+    py::class_<FrameBuffer>(io, "FrameBuffer", py::buffer_protocol())
+        .def_buffer([](FrameBuffer& frame) {
+            return py::buffer_info(
+                const_cast<uchar*>(frame.image.constBits()),
+                1,
+                py::format_descriptor<uint8_t>::format(),
+                3,
+                {py::ssize_t(frame.image.height()), py::ssize_t(frame.image.width()), py::ssize_t(4)},
+                {py::ssize_t(frame.image.bytesPerLine()), py::ssize_t(4), py::ssize_t(1)},
+                true
+            );
+        })
+        .def_property_readonly("width", [](const FrameBuffer& frame){ return frame.image.width(); })
+        .def_property_readonly("height", [](const FrameBuffer& frame){ return frame.image.height(); })
+        .def("to_image", [](const FrameBuffer& frame){ return frame.image; })
+        .attr("__doc__") = "RGBA pixels of a rendered frame, supports the buffer protocol so numpy.asarray() doesn't copy the data"
+    ;
+
     using Fac = io::IoRegistry;
     py::class_<Fac, std::unique_ptr<Fac, py::nodelete>>(io, "IoRegistry")
         .def("importers", &Fac::importers, no_own)
@@ -147,6 +316,43 @@ void define_io(py::module& m)
 }
 
 
+/**
+ * Keyframe exposed to Python, looked up by time on every access
+ * so it doesn't dangle when keyframes are added or removed
+ */
+struct KeyframeRef
+{
+    model::AnimatableBase* prop;
+    model::FrameTime time;
+
+    int index() const
+    {
+        int index = prop->keyframe_index(time);
+        auto kf = prop->keyframe(index);
+        if ( !kf || kf->time() != time )
+            throw py::value_error("the keyframe has been removed");
+        return index;
+    }
+
+    const model::KeyframeBase* keyframe() const
+    {
+        return prop->keyframe(index());
+    }
+
+    void set_transition(const model::KeyframeTransition& transition) const
+    {
+        prop->object()->push_command(new command::SetKeyframeTransition(prop, index(), transition));
+    }
+};
+
+py::object keyframe_ref(model::AnimatableBase& prop, int index)
+{
+    auto kf = prop.keyframe(index);
+    if ( !kf )
+        return py::none();
+    return py::cast(KeyframeRef{&prop, kf->time()});
+}
+
 void define_animatable(py::module& m)
 {
     py::class_<model::KeyframeTransition> kt(m, "KeyframeTransition");
@@ -169,29 +375,35 @@ void define_animatable(py::module& m)
         .def("bezier_parameter", &model::KeyframeTransition::bezier_parameter)
     ;
 
-    py::class_<model::KeyframeBase>(m, "Keyframe")
-        .def_property_readonly("time", &model::KeyframeBase::time)
-        .def_property_readonly("value", &model::KeyframeBase::value)
+    py::class_<KeyframeRef>(m, "Keyframe")
+        .def_readonly("time", &KeyframeRef::time)
+        .def_property_readonly("value", [](const KeyframeRef& kf){ return kf.keyframe()->value(); })
         .def_property("transition",
-            &model::KeyframeBase::transition,
-            &model::KeyframeBase::set_transition,
-            no_own
+            [](const KeyframeRef& kf){ return kf.keyframe()->transition(); },
+            &KeyframeRef::set_transition,
+            "Transition to the next keyframe, setting it is undoable"
         )
     ;
     register_from_meta<model::AnimatableBase, QObject>(m)
-        .def("keyframe", [](const model::AnimatableBase& a, model::FrameTime t){ return a.keyframe(t); }, no_own, py::arg("time"))
+        .def("keyframe", &keyframe_ref, py::arg("index"), "Returns the keyframe at the given index, or None")
         .def("set_keyframe", [](model::AnimatableBase& a, model::FrameTime time, const QVariant& value){
-            a.object()->document()->undo_stack().push(
-                new command::SetKeyframe(&a, time, value, true)
-            );
-            return a.keyframe(a.keyframe_index(time));
-        }, no_own, py::arg("time"), py::arg("value"))
+            a.object()->push_command(new command::SetKeyframe(&a, time, value, true));
+            return KeyframeRef{&a, time};
+        }, py::arg("time"), py::arg("value"))
         .def("remove_keyframe_at_time", [](model::AnimatableBase& a, model::FrameTime time){
             a.object()->document()->undo_stack().push(
                 new command::RemoveKeyframeTime(&a, time)
             );
         }, py::arg("time"))
         .def("clear_keyframes", &model::AnimatableBase::clear_keyframes_undoable, py::arg("value") = py::none())
+        .def("set_keyframe_transition", [](model::AnimatableBase& a, int index, const model::KeyframeTransition& transition){
+            if ( !a.keyframe(index) )
+                return false;
+            a.object()->document()->undo_stack().push(
+                new command::SetKeyframeTransition(&a, index, transition)
+            );
+            return true;
+        }, py::arg("index"), py::arg("transition"))
     ;
 }
 
@@ -457,6 +669,16 @@ void register_py_module(py::module& glaxnimate_module)
     py::class_<model::AssetBase>(defs, "AssetBase");
     auto cls_comp = register_from_meta<model::Composition, model::VisualNode, model::AssetBase>(model);
     define_add_shape(cls_comp);
+    cls_comp
+        .def("render_frame_buffer", &render_frame_buffer,
+            "Renders a frame, the result can be used as a numpy array without copying",
+            py::arg("time"), py::arg("size") = QSize(), py::arg("background") = QColor()
+        )
+        .def("render_frame_into", &render_frame_into,
+            "Renders a frame into an existing writable (height, width, 4) RGBA buffer",
+            py::arg("time"), py::arg("buffer"), py::arg("background") = QColor()
+        )
+    ;
 
     define_io(glaxnimate_module);
 
@@ -0,0 +1,154 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QTextStream>
+
+QJsonObject glaxnimate::bench::Result::to_json() const
+{
+    QJsonObject object;
+    object["name"] = name;
+
+    if ( !skipped.isEmpty() )
+    {
+        object["skipped"] = skipped;
+        return object;
+    }
+
+    std::vector<qint64> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+
+    double mean = std::accumulate(sorted.begin(), sorted.end(), 0.0) / sorted.size();
+    double variance = 0;
+    for ( auto sample : sorted )
+        variance += (sample - mean) * (sample - mean);
+    variance /= sorted.size();
+
+    std::size_t mid = sorted.size() / 2;
+    double median = sorted.size() % 2 ? sorted[mid] : (sorted[mid - 1] + sorted[mid]) / 2.0;
+
+    object["iterations"] = int(sorted.size());
+    object["items_per_iteration"] = items;
+    object["min_ns"] = double(sorted.front());
+    object["max_ns"] = double(sorted.back());
+    object["mean_ns"] = mean;
+    object["median_ns"] = median;
+    object["stddev_ns"] = std::sqrt(variance);
+    object["items_per_second"] = median > 0 ? items * 1e9 / median : 0.;
+    if ( !metrics.isEmpty() )
+        object["metrics"] = metrics;
+    return object;
+}
+
+void glaxnimate::bench::Runner::add(const QString& name, const Setup& setup)
+{
+    entries.push_back({name, setup});
+}
+
+void glaxnimate::bench::Runner::set_filter(const QRegularExpression& filter)
+{
+    this->filter = filter;
+}
+
+void glaxnimate::bench::Runner::set_min_iterations(int count)
+{
+    min_iterations = qMax(1, count);
+}
+
+void glaxnimate::bench::Runner::set_max_iterations(int count)
+{
+    max_iterations = qMax(1, count);
+}
+
+void glaxnimate::bench::Runner::set_min_time(int milliseconds)
+{
+    min_time = milliseconds;
+}
+
+QStringList glaxnimate::bench::Runner::names() const
+{
+    QStringList names;
+    for ( const auto& entry : entries )
+        if ( entry.name.contains(filter) )
+            names.push_back(entry.name);
+    return names;
+}
+
+std::vector<glaxnimate::bench::Result> glaxnimate::bench::Runner::run() const
+{
+    QTextStream err(stderr);
+    std::vector<Result> results;
+
+    for ( const auto& entry : entries )
+    {
+        if ( !entry.name.contains(filter) )
+            continue;
+
+        err << entry.name << "... ";
+        err.flush();
+        results.push_back(run(entry));
+
+        const Result& result = results.back();
+        if ( !result.skipped.isEmpty() )
+            err << "skipped: " << result.skipped << "\n";
+        else
+            err << result.to_json()["median_ns"].toDouble() / 1e6 << " ms (" << int(result.samples.size()) << " iterations)\n";
+        err.flush();
+    }
+
+    return results;
+}
+
+glaxnimate::bench::Result glaxnimate::bench::Runner::run(const Entry& entry) const
+{
+    Result result;
+    result.name = entry.name;
+
+    Case bench = entry.setup();
+    result.items = bench.items;
+    result.skipped = bench.skipped;
+    result.metrics = bench.metrics;
+    if ( !result.skipped.isEmpty() )
+        return result;
+
+    // Warm up caches and lazy initialization
+    bench.run();
+
+    QElapsedTimer total;
+    total.start();
+    QElapsedTimer timer;
+    while ( int(result.samples.size()) < max_iterations )
+    {
+        timer.start();
+        bench.run();
+        result.samples.push_back(timer.nsecsElapsed());
+
+        if ( int(result.samples.size()) >= min_iterations && total.elapsed() >= min_time )
+            break;
+    }
+
+    return result;
+}
+
+QByteArray glaxnimate::bench::Runner::to_json(const std::vector<Result>& results, const QJsonObject& context)
+{
+    QJsonArray benchmarks;
+    for ( const auto& result : results )
+        benchmarks.push_back(result.to_json());
+
+    QJsonObject root;
+    root["context"] = context;
+    root["benchmarks"] = benchmarks;
+    return QJsonDocument(root).toJson(QJsonDocument::Indented);
+}
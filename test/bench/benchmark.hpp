@@ -0,0 +1,97 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QString>
+
+namespace glaxnimate::bench {
+
+/**
+ * \brief Prepared benchmark, returned by the setup function of each entry
+ */
+struct Case
+{
+    /// Called once per measured iteration
+    std::function<void()> run;
+    /// Number of items (frames, files, shapes...) processed by each call to run
+    qint64 items = 1;
+    /// If not empty, the benchmark isn't run and this is reported as the reason
+    QString skipped = {};
+    /// Extra measurements (eg: memory usage) reported along with the timings
+    QJsonObject metrics = {};
+};
+
+/**
+ * \brief Timing statistics for a single benchmark
+ */
+struct Result
+{
+    QString name;
+    QString skipped;
+    qint64 items = 1;
+    /// Duration of each iteration, in nanoseconds
+    std::vector<qint64> samples;
+    QJsonObject metrics;
+
+    QJsonObject to_json() const;
+};
+
+/**
+ * \brief Collects, runs and reports benchmarks
+ *
+ * Each iteration is timed individually after a warm-up run,
+ * iterations continue until both the minimum time and count are reached.
+ */
+class Runner
+{
+public:
+    using Setup = std::function<Case()>;
+
+    void add(const QString& name, const Setup& setup);
+
+    void set_filter(const QRegularExpression& filter);
+    void set_min_iterations(int count);
+    void set_max_iterations(int count);
+    void set_min_time(int milliseconds);
+
+    /**
+     * \brief Runs all the benchmarks matching the filter, printing progress to stderr
+     */
+    std::vector<Result> run() const;
+
+    /**
+     * \brief Names of all the benchmarks matching the filter
+     */
+    QStringList names() const;
+
+    /**
+     * \brief Results as a JSON document, \p context is stored along with the results
+     */
+    static QByteArray to_json(const std::vector<Result>& results, const QJsonObject& context);
+
+private:
+    struct Entry
+    {
+        QString name;
+        Setup setup;
+    };
+
+    Result run(const Entry& entry) const;
+
+    std::vector<Entry> entries;
+    QRegularExpression filter;
+    int min_iterations = 5;
+    int max_iterations = 1000;
+    int min_time = 500;
+};
+
+} // namespace glaxnimate::bench
@@ -0,0 +1,664 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <optional>
+#include <random>
+
+#ifdef __GLIBC__
+#   include <malloc.h>
+#endif
+
+#include <QBuffer>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QFile>
+#include <QJsonObject>
+#include <QSysInfo>
+#include <QTextStream>
+#include <QThread>
+
+#include "benchmark.hpp"
+
+#include "math/bezier/frame_arena.hpp"
+#include "model/document.hpp"
+#include "model/render_program.hpp"
+#include "model/assets/assets.hpp"
+#include "model/shapes/ellipse.hpp"
+#include "model/shapes/fill.hpp"
+#include "model/shapes/layer.hpp"
+#include "model/shapes/offset_path.hpp"
+#include "model/shapes/path.hpp"
+#include "model/shapes/polystar.hpp"
+#include "model/shapes/rect.hpp"
+#include "model/shapes/round_corners.hpp"
+#include "model/shapes/stroke.hpp"
+#include "model/shapes/trim.hpp"
+#include "model/property/sub_object_property.hpp"
+#include "io/aep/aep_format.hpp"
+#include "io/lottie/lottie_format.hpp"
+#include "io/rive/rive_format.hpp"
+#include "io/svg/svg_format.hpp"
+#include "io/svg/svg_parser.hpp"
+#include "utils/quantize.hpp"
+#include "utils/trace_wrapper.hpp"
+
+using namespace glaxnimate;
+
+namespace {
+
+/**
+ * \brief Number of calls to operator new, used to report allocations per frame
+ */
+std::atomic<qint64> allocation_count = 0;
+
+} // namespace
+
+void* operator new(std::size_t size)
+{
+    ++allocation_count;
+    if ( void* ptr = std::malloc(size ? size : 1) )
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace {
+
+/**
+ * \brief Parameters for the generated documents
+ *
+ * The same parameters always result in the same document
+ */
+struct DocumentOptions
+{
+    int layers = 20;
+    int shapes_per_layer = 25;
+    int frames = 120;
+    int size = 512;
+    unsigned seed = 1;
+
+    QJsonObject to_json() const
+    {
+        return {
+            {"layers", layers},
+            {"shapes_per_layer", shapes_per_layer},
+            {"frames", frames},
+            {"size", size},
+            {"seed", int(seed)},
+        };
+    }
+};
+
+class Generator
+{
+public:
+    explicit Generator(const DocumentOptions& options)
+        : options(options), random(options.seed)
+    {}
+
+    std::unique_ptr<model::Document> document()
+    {
+        auto document = std::make_unique<model::Document>("bench.rawr");
+        auto comp = document->assets()->compositions->values.insert(std::make_unique<model::Composition>(document.get()));
+        comp->width.set(options.size);
+        comp->height.set(options.size);
+        comp->animation->last_frame.set(options.frames);
+
+        for ( int i = 0; i < options.layers; i++ )
+        {
+            auto layer = static_cast<model::Layer*>(comp->shapes.insert(std::make_unique<model::Layer>(document.get())));
+            layer->name.set(QString("Layer %1").arg(i));
+            QPointF from = point();
+            animate(layer->transform->position, from, point());
+            float angle = real(-45, 45);
+            animate(layer->transform->rotation, angle, float(real(-45, 45)));
+
+            for ( int j = 0; j < options.shapes_per_layer; j++ )
+                add_group(document.get(), layer->shapes);
+        }
+
+        return document;
+    }
+
+    /**
+     * \brief Star outlines with a mix of smooth and corner points
+     */
+    math::bezier::MultiBezier shapes(int count)
+    {
+        math::bezier::MultiBezier bez;
+        for ( int i = 0; i < count; i++ )
+        {
+            QPointF center = point();
+            qreal outer = real(10, 60);
+            int points = std::uniform_int_distribution<int>(3, 12)(random);
+            bez.beziers().push_back(math::bezier::Bezier());
+            auto& shape = bez.back();
+            for ( int p = 0; p < points * 2; p++ )
+            {
+                qreal angle = M_PI * p / points;
+                qreal radius = p % 2 ? outer / 2 : outer;
+                QPointF pos = center + QPointF(std::cos(angle), std::sin(angle)) * radius;
+                if ( p % 4 == 0 )
+                    shape.add_smooth_point(pos, QPointF(-std::sin(angle), std::cos(angle)) * radius / 4);
+                else
+                    shape.add_point(pos);
+            }
+            shape.close();
+        }
+        return bez;
+    }
+
+    /**
+     * \brief Single path with the points of \p count star outlines, like large traced images
+     */
+    math::bezier::Bezier large_path(int count)
+    {
+        math::bezier::Bezier path;
+        for ( const auto& bez : shapes(count).beziers() )
+            path.points().insert(path.points().end(), bez.begin(), bez.end());
+        path.close();
+        return path;
+    }
+
+private:
+    qreal real(qreal min, qreal max)
+    {
+        return std::uniform_real_distribution<qreal>(min, max)(random);
+    }
+
+    // Random values are drawn in separate statements, argument evaluation order is unspecified
+
+    QPointF point()
+    {
+        qreal x = real(0, options.size);
+        qreal y = real(0, options.size);
+        return QPointF(x, y);
+    }
+
+    QSizeF size(qreal min, qreal max)
+    {
+        qreal width = real(min, max);
+        qreal height = real(min, max);
+        return QSizeF(width, height);
+    }
+
+    QColor color()
+    {
+        qreal hue = real(0, 1);
+        qreal saturation = real(0.5, 1);
+        qreal value = real(0.5, 1);
+        return QColor::fromHsvF(hue, saturation, value);
+    }
+
+    template<class Prop, class Value>
+    void animate(Prop& property, const Value& from, const Value& to)
+    {
+        property.set_keyframe(0, from)->set_transition(model::KeyframeTransition(model::KeyframeTransition::Ease));
+        property.set_keyframe(options.frames / 2, to)->set_transition(model::KeyframeTransition(model::KeyframeTransition::Fast));
+        property.set_keyframe(options.frames, from);
+    }
+
+    void add_group(model::Document* document, model::ShapeListProperty& parent)
+    {
+        auto group = static_cast<model::Group*>(parent.insert(std::make_unique<model::Group>(document)));
+        group->transform->position.set(point());
+        QSizeF scale = size(0.5, 1.5);
+        animate(group->transform->scale, QVector2D(1, 1), QVector2D(scale.width(), scale.height()));
+
+        auto fill = static_cast<model::Fill*>(group->shapes.insert(std::make_unique<model::Fill>(document)));
+        QColor from = color();
+        animate(fill->color, from, color());
+
+        auto stroke = static_cast<model::Stroke*>(group->shapes.insert(std::make_unique<model::Stroke>(document)));
+        stroke->color.set(color());
+        stroke->width.set(real(1, 6));
+
+        switch ( std::uniform_int_distribution<int>(0, 3)(random) )
+        {
+            case 0:
+            {
+                auto rect = static_cast<model::Rect*>(group->shapes.insert(std::make_unique<model::Rect>(document)));
+                rect->size.set(size(10, 80));
+                animate(rect->rounded, 0.f, float(real(0, 20)));
+                break;
+            }
+            case 1:
+            {
+                auto ellipse = static_cast<model::Ellipse*>(group->shapes.insert(std::make_unique<model::Ellipse>(document)));
+                QSizeF from = size(10, 80);
+                animate(ellipse->size, from, size(10, 80));
+                break;
+            }
+            case 2:
+            {
+                auto star = static_cast<model::PolyStar*>(group->shapes.insert(std::make_unique<model::PolyStar>(document)));
+                star->points.set(std::uniform_int_distribution<int>(3, 9)(random));
+                star->outer_radius.set(real(20, 50));
+                star->inner_radius.set(real(5, 20));
+                animate(star->angle, 0.f, 180.f);
+                break;
+            }
+            case 3:
+            {
+                auto path = static_cast<model::Path*>(group->shapes.insert(std::make_unique<model::Path>(document)));
+                auto from = shapes(1).back();
+                animate(path->shape, from, shapes(1).back());
+                break;
+            }
+        }
+    }
+
+    DocumentOptions options;
+    std::mt19937 random;
+};
+
+void collect_animated(model::Object* object, std::vector<model::AnimatableBase*>& output)
+{
+    for ( auto prop : object->properties() )
+    {
+        const auto& traits = prop->traits();
+        if ( traits.flags & model::PropertyTraits::Animated )
+            output.push_back(static_cast<model::AnimatableBase*>(prop));
+        else if ( traits.type == model::PropertyTraits::Object && !(traits.flags & model::PropertyTraits::List) )
+            collect_animated(static_cast<model::SubObjectPropertyBase*>(prop)->sub_object(), output);
+    }
+
+    if ( auto node = qobject_cast<model::DocumentNode*>(object) )
+    {
+        for ( auto child : node->docnode_children() )
+            collect_animated(child, output);
+    }
+}
+
+void collect_stylers(model::DocumentNode* node, std::vector<model::Styler*>& output)
+{
+    if ( auto styler = qobject_cast<model::Styler*>(node) )
+        output.push_back(styler);
+
+    for ( auto child : node->docnode_children() )
+        collect_stylers(child, output);
+}
+
+model::Composition* main_comp(model::Document* document)
+{
+    return document->assets()->compositions->values[0];
+}
+
+/**
+ * \brief Benchmarks loading data saved from the generated document
+ */
+bench::Case load_case(const DocumentOptions& options, io::ImportExport& format, const QVariantMap& settings = {})
+{
+    auto document = Generator(options).document();
+    QByteArray data = format.save(main_comp(document.get()), settings);
+    return {[&format, data]{
+        model::Document loaded("bench");
+        format.load(&loaded, data);
+    }};
+}
+
+bench::Case save_case(const DocumentOptions& options, io::ImportExport& format, const QVariantMap& settings = {})
+{
+    std::shared_ptr<model::Document> document = Generator(options).document();
+    return {[&format, document, settings]{
+        format.save(main_comp(document.get()), settings);
+    }};
+}
+
+/**
+ * \brief Bytes currently allocated on the heap, -1 if it can't be measured
+ */
+qint64 heap_usage()
+{
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+    return mallinfo2().uordblks;
+#elif defined(__GLIBC__)
+    return mallinfo().uordblks;
+#else
+    return -1;
+#endif
+}
+
+/**
+ * \brief Benchmarks evaluating the geometry drawn by all the stylers for a frame
+ */
+bench::Case geometry_case(const DocumentOptions& options, bool arena)
+{
+    std::shared_ptr<model::Document> document = Generator(options).document();
+    auto stylers = std::make_shared<std::vector<model::Styler*>>();
+    collect_stylers(main_comp(document.get()), *stylers);
+
+    auto evaluate = [stylers, arena](int frame){
+        std::optional<math::bezier::FrameArena::Scope> scope;
+        if ( arena )
+            scope.emplace();
+        for ( auto styler : *stylers )
+            styler->collect_shapes(frame, {});
+    };
+
+    // The first frame grows the arena and the path caches to their steady state
+    evaluate(0);
+    qint64 allocations_before = allocation_count;
+    evaluate(1);
+    qint64 allocations = allocation_count - allocations_before;
+
+    auto frame = std::make_shared<int>(0);
+    bench::Case bench{[document, evaluate, frame, options]{
+        evaluate(*frame);
+        *frame = (*frame + 1) % options.frames;
+    }};
+    bench.metrics["allocations_per_frame"] = double(allocations);
+    if ( arena )
+        bench.metrics["arena_bytes"] = double(math::bezier::FrameArena::capacity());
+    return bench;
+}
+
+template<class Modifier>
+bench::Case modifier_case(const DocumentOptions& options, const std::function<void(Modifier*)>& setup)
+{
+    auto document = std::make_shared<model::Document>("bench");
+    auto modifier = std::make_shared<Modifier>(document.get());
+    setup(modifier.get());
+    auto bez = Generator(options).shapes(options.shapes_per_layer);
+    return {[document, modifier, bez]{
+        modifier->process(0, bez);
+    }, qint64(bez.size())};
+}
+
+void add_benchmarks(bench::Runner& runner, const DocumentOptions& options, const QString& aep_file)
+{
+    static io::lottie::LottieFormat lottie;
+    static io::svg::SvgFormat svg;
+    static io::rive::RiveFormat rive;
+    static io::aep::AepFormat aep;
+
+    runner.add("render/render_image", [options]{
+        std::shared_ptr<model::Document> document = Generator(options).document();
+        auto comp = main_comp(document.get());
+        auto frame = std::make_shared<int>(0);
+        return bench::Case{[document, comp, frame, options]{
+            comp->render_image(*frame);
+            *frame = (*frame + 1) % options.frames;
+        }};
+    });
+
+    runner.add("render/render_image_direct", [options]{
+        std::shared_ptr<model::Document> document = Generator(options).document();
+        document->set_direct_rasterization(true);
+        auto comp = main_comp(document.get());
+        auto frame = std::make_shared<int>(0);
+        return bench::Case{[document, comp, frame, options]{
+            comp->render_image(*frame);
+            *frame = (*frame + 1) % options.frames;
+        }};
+    });
+
+    for ( bool parallel : {false, true} )
+    {
+        runner.add(parallel ? "render/program_parallel" : "render/program", [options, parallel]{
+            std::shared_ptr<model::Document> document = Generator(options).document();
+            auto program = std::make_shared<model::RenderProgram>(main_comp(document.get()));
+            program->set_parallel(parallel);
+            auto frame = std::make_shared<int>(0);
+            return bench::Case{[document, program, frame, options]{
+                program->render_image(*frame);
+                *frame = (*frame + 1) % options.frames;
+            }};
+        });
+    }
+
+    runner.add("geometry/collect_shapes", [options]{ return geometry_case(options, false); });
+    runner.add("geometry/collect_shapes_arena", [options]{ return geometry_case(options, true); });
+
+    runner.add("bezier/transform", [options]{
+        auto path = std::make_shared<math::bezier::Bezier>(Generator(options).large_path(options.layers * options.shapes_per_layer * 10));
+        QTransform transform;
+        transform.rotate(1).scale(1.001, 0.999);
+        return bench::Case{[path, transform]{
+            path->transform(transform);
+        }, qint64(path->size())};
+    });
+
+    runner.add("bezier/bounding_box", [options]{
+        auto path = std::make_shared<math::bezier::Bezier>(Generator(options).large_path(options.layers * options.shapes_per_layer * 10));
+        return bench::Case{[path]{
+            path->bounding_box();
+        }, qint64(path->size())};
+    });
+
+    runner.add("bezier/lerp", [options]{
+        auto path = std::make_shared<math::bezier::Bezier>(Generator(options).large_path(options.layers * options.shapes_per_layer * 10));
+        QTransform transform;
+        transform.rotate(45);
+        auto other = std::make_shared<math::bezier::Bezier>(path->transformed(transform));
+        return bench::Case{[path, other]{
+            path->lerp(*other, 0.5);
+        }, qint64(path->size())};
+    });
+
+    runner.add("keyframes/value_at", [options]{
+        std::shared_ptr<model::Document> document = Generator(options).document();
+        std::vector<model::AnimatableBase*> properties;
+        collect_animated(main_comp(document.get()), properties);
+        return bench::Case{[document, properties, options]{
+            for ( int frame = 0; frame < options.frames; frame++ )
+                for ( auto prop : properties )
+                    prop->value(frame);
+        }, qint64(properties.size()) * options.frames};
+    });
+
+    runner.add("keyframes/set_current_time", [options]{
+        std::shared_ptr<model::Document> document = Generator(options).document();
+        return bench::Case{[document, options]{
+            for ( int frame = 0; frame < options.frames; frame++ )
+                document->set_current_time(frame);
+        }, options.frames};
+    });
+
+    runner.add("keyframes/memory", [options]{
+        // One keyframe per frame on every shape of the generated document, on a single property
+        int count = options.layers * options.shapes_per_layer * options.frames;
+        auto document = std::make_shared<model::Document>("bench");
+        auto layer = std::make_shared<model::Layer>(document.get());
+
+        qint64 heap_before = heap_usage();
+        for ( int i = 0; i < count; i++ )
+        {
+            layer->opacity.set_keyframe(i, float(i % 2));
+            layer->transform->position.set_keyframe(i, QPointF(i % 100, i % 50));
+        }
+        qint64 heap_after = heap_usage();
+
+        bench::Case bench{[document, layer, count]{
+            for ( int i = 0; i < count; i++ )
+            {
+                layer->opacity.get_at(i + 0.5);
+                layer->transform->position.get_at(i + 0.5);
+            }
+        }, qint64(count) * 2};
+
+        bench.metrics["keyframes"] = count * 2;
+        bench.metrics["sizeof_keyframe_float"] = int(sizeof(model::Keyframe<float>));
+        bench.metrics["sizeof_keyframe_point"] = int(sizeof(model::Keyframe<QPointF>));
+        if ( heap_before != -1 )
+        {
+            bench.metrics["heap_bytes"] = double(heap_after - heap_before);
+            bench.metrics["heap_bytes_per_keyframe"] = double(heap_after - heap_before) / (count * 2);
+        }
+        return bench;
+    });
+
+    runner.add("modifiers/trim", [options]{
+        return modifier_case<model::Trim>(options, [](model::Trim* trim){
+            trim->start.set(0.2);
+            trim->end.set(0.7);
+            trim->offset.set(0.1);
+        });
+    });
+
+    runner.add("modifiers/offset_path", [options]{
+        return modifier_case<model::OffsetPath>(options, [](model::OffsetPath* offset){
+            offset->amount.set(5);
+            offset->join.set(model::Stroke::MiterJoin);
+        });
+    });
+
+    runner.add("modifiers/round_corners", [options]{
+        return modifier_case<model::RoundCorners>(options, [](model::RoundCorners* round){
+            round->radius.set(8);
+        });
+    });
+
+    runner.add("io/lottie/save", [options]{ return save_case(options, lottie); });
+    runner.add("io/lottie/load", [options]{ return load_case(options, lottie); });
+    runner.add("io/svg/save", [options]{ return save_case(options, svg); });
+    runner.add("io/svg/load", [options]{
+        auto document = Generator(options).document();
+        QByteArray data = svg.save(main_comp(document.get()));
+        return bench::Case{[data]{
+            QBuffer buffer;
+            buffer.setData(data);
+            buffer.open(QIODevice::ReadOnly);
+            model::Document loaded("bench");
+            io::svg::SvgParser(&buffer, io::svg::SvgParser::Inkscape, &loaded).parse_to_document();
+        }};
+    });
+    runner.add("io/rive/save", [options]{ return save_case(options, rive); });
+    runner.add("io/rive/load", [options]{ return load_case(options, rive); });
+    runner.add("io/aep/load", [aep_file]{
+        // There is no AEP exporter, so this needs an existing file
+        if ( aep_file.isEmpty() )
+            return bench::Case{{}, 1, "use --aep to specify a file"};
+
+        QFile file(aep_file);
+        if ( !file.open(QIODevice::ReadOnly) )
+            return bench::Case{{}, 1, "could not open " + aep_file};
+
+        QByteArray data = file.readAll();
+        return bench::Case{[data, aep_file]{
+            model::Document loaded("bench");
+            aep.load(&loaded, data, {}, aep_file);
+        }};
+    });
+
+    runner.add("trace/closest", [options]{
+        auto document = Generator(options).document();
+        QImage image = main_comp(document.get())->render_image(0);
+        auto colors = utils::quantize::octree(image, 16);
+        std::shared_ptr<model::Document> target = std::make_unique<model::Document>("bench");
+        auto comp = target->assets()->compositions->values.insert(std::make_unique<model::Composition>(target.get()));
+        return bench::Case{[target, comp, image, colors]{
+            utils::trace::TraceWrapper tracer(comp, image, "bench");
+            std::vector<utils::trace::TraceWrapper::TraceResult> result;
+            tracer.trace_closest(colors, result);
+        }};
+    });
+
+    runner.add("trace/mono", [options]{
+        auto document = Generator(options).document();
+        QImage image = main_comp(document.get())->render_image(0);
+        std::shared_ptr<model::Document> target = std::make_unique<model::Document>("bench");
+        auto comp = target->assets()->compositions->values.insert(std::make_unique<model::Composition>(target.get()));
+        return bench::Case{[target, comp, image]{
+            utils::trace::TraceWrapper tracer(comp, image, "bench");
+            std::vector<utils::trace::TraceWrapper::TraceResult> result;
+            tracer.trace_mono(Qt::black, false, 128, result);
+        }};
+    });
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Glaxnimate benchmarks");
+    parser.addHelpOption();
+    parser.addOptions({
+        {{"o", "output"}, "Write the JSON results to <file> instead of stdout", "file"},
+        {{"f", "filter"}, "Only run benchmarks whose name matches <regex>", "regex"},
+        {"list", "List benchmark names and exit"},
+        {"min-iterations", "Minimum number of iterations per benchmark", "count", "5"},
+        {"max-iterations", "Maximum number of iterations per benchmark", "count", "1000"},
+        {"min-time", "Minimum time to spend on each benchmark", "ms", "500"},
+        {"layers", "Number of layers in the generated document", "count", "20"},
+        {"shapes", "Number of shapes per layer in the generated document", "count", "25"},
+        {"frames", "Number of frames in the generated document", "count", "120"},
+        {"size", "Width and height of the generated document", "px", "512"},
+        {"seed", "Random seed for the generated document", "seed", "1"},
+        {"aep", "After Effects project used for the AEP benchmarks", "file"},
+    });
+    parser.process(app);
+
+    DocumentOptions options;
+    options.layers = parser.value("layers").toInt();
+    options.shapes_per_layer = parser.value("shapes").toInt();
+    options.frames = qMax(1, parser.value("frames").toInt());
+    options.size = parser.value("size").toInt();
+    options.seed = parser.value("seed").toUInt();
+
+    bench::Runner runner;
+    runner.set_filter(QRegularExpression(parser.value("filter")));
+    runner.set_min_iterations(parser.value("min-iterations").toInt());
+    runner.set_max_iterations(parser.value("max-iterations").toInt());
+    runner.set_min_time(parser.value("min-time").toInt());
+    add_benchmarks(runner, options, parser.value("aep"));
+
+    if ( parser.isSet("list") )
+    {
+        QTextStream out(stdout);
+        for ( const auto& name : runner.names() )
+            out << name << "\n";
+        return 0;
+    }
+
+    QJsonObject context{
+        {"version", GLAXNIMATE_BENCH_VERSION},
+        {"qt_version", qVersion()},
+        {"date", QDateTime::currentDateTimeUtc().toString(Qt::ISODate)},
+        {"cpu_architecture", QSysInfo::currentCpuArchitecture()},
+        {"kernel", QSysInfo::kernelType() + " " + QSysInfo::kernelVersion()},
+        {"threads", QThread::idealThreadCount()},
+        {"document", options.to_json()},
+    };
+
+    QByteArray json = bench::Runner::to_json(runner.run(), context);
+
+    if ( parser.isSet("output") )
+    {
+        QFile file(parser.value("output"));
+        if ( !file.open(QIODevice::WriteOnly) )
+        {
+            QTextStream(stderr) << "Could not write " << file.fileName() << "\n";
+            return 1;
+        }
+        file.write(json);
+    }
+    else
+    {
+        QFile out;
+        out.open(stdout, QIODevice::WriteOnly);
+        out.write(json);
+    }
+
+    return 0;
+}
@@ -0,0 +1,68 @@
+# SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+# SPDX-License-Identifier: GPL-3.0-or-later
+
+import unittest
+
+import numpy
+
+import glaxnimate
+
+
+class TestKeyframeArrays(unittest.TestCase):
+    def setUp(self):
+        self.document = glaxnimate.model.Document("")
+        self.layer = glaxnimate.model.shapes.Layer(self.document)
+
+    def test_round_trip_float(self):
+        prop = self.layer.opacity
+        times = numpy.array([0, 10, 20], dtype=float)
+        values = numpy.array([1, 0.5, 0.25])
+        prop.set_keyframes(times, values)
+
+        numpy.testing.assert_array_equal(prop.keyframe_times(), times)
+        numpy.testing.assert_allclose(prop.keyframe_values(), values)
+
+    def test_round_trip_point(self):
+        prop = self.layer.transform.position
+        times = numpy.array([20, 0, 10], dtype=float)
+        values = numpy.array([[5, 6], [1, 2], [3, 4]], dtype=float)
+        prop.set_keyframes(times, values)
+
+        # Keyframes are sorted by time along with their values
+        numpy.testing.assert_array_equal(prop.keyframe_times(), [0, 10, 20])
+        numpy.testing.assert_allclose(prop.keyframe_values(), [[1, 2], [3, 4], [5, 6]])
+        self.assertEqual(prop.keyframe_values().shape, (3, 2))
+
+    def test_undo(self):
+        prop = self.layer.opacity
+        prop.set_keyframes(numpy.array([0, 10.]), numpy.array([1, 0.]))
+        prop.set_keyframes(numpy.array([5, 15, 25.]), numpy.array([0.1, 0.2, 0.3]))
+        numpy.testing.assert_array_equal(prop.keyframe_times(), [5, 15, 25])
+
+        # Each call is a single undo step
+        self.assertTrue(self.document.undo())
+        numpy.testing.assert_array_equal(prop.keyframe_times(), [0, 10])
+        numpy.testing.assert_allclose(prop.keyframe_values(), [1, 0])
+
+        self.assertTrue(self.document.undo())
+        self.assertEqual(len(prop.keyframe_times()), 0)
+
+        self.assertTrue(self.document.redo())
+        numpy.testing.assert_array_equal(prop.keyframe_times(), [0, 10])
+
+    def test_invalid(self):
+        prop = self.layer.opacity
+        with self.assertRaises(ValueError):
+            prop.set_keyframes(numpy.array([0, 10, 0.]), numpy.array([1, 0.5, 0.]))
+        with self.assertRaises(ValueError):
+            prop.set_keyframes(numpy.array([0, 10.]), numpy.array([1.]))
+        with self.assertRaises(ValueError):
+            prop.set_keyframes(numpy.array([[0, 10.]]), numpy.array([1, 0.]))
+
+        # Rejected calls don't touch the property
+        self.assertEqual(len(prop.keyframe_times()), 0)
+        self.assertFalse(self.document.undo())
+
+
+if __name__ == "__main__":
+    unittest.main()
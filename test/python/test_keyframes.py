@@ -0,0 +1,54 @@
+# SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+# SPDX-License-Identifier: GPL-3.0-or-later
+
+import unittest
+
+import glaxnimate
+
+
+class TestKeyframes(unittest.TestCase):
+    def setUp(self):
+        self.document = glaxnimate.model.Document("")
+        self.layer = glaxnimate.model.shapes.Layer(self.document)
+        self.prop = self.layer.opacity
+
+    def test_survives_insertion(self):
+        kf = self.prop.set_keyframe(10, 0.5)
+        # Inserting before it moves the keyframe in the underlying storage
+        for time in range(10):
+            self.prop.set_keyframe(time, time / 10)
+
+        self.assertEqual(kf.time, 10)
+        self.assertAlmostEqual(kf.value, 0.5)
+        self.assertEqual(self.prop.keyframe(10).time, 10)
+        self.assertIsNone(self.prop.keyframe(11))
+
+    def test_removed(self):
+        kf = self.prop.set_keyframe(10, 0.5)
+        self.prop.set_keyframe(20, 1)
+        self.prop.remove_keyframe_at_time(10)
+        with self.assertRaises(ValueError):
+            kf.value
+
+        # Undoing the removal makes it reachable again
+        self.assertTrue(self.document.undo())
+        self.assertAlmostEqual(kf.value, 0.5)
+
+    def test_transition_undo(self):
+        kf = self.prop.set_keyframe(0, 0)
+        self.prop.set_keyframe(10, 1)
+        self.assertFalse(kf.transition.hold)
+
+        transition = kf.transition
+        transition.hold = True
+        kf.transition = transition
+        self.assertTrue(kf.transition.hold)
+
+        self.assertTrue(self.document.undo())
+        self.assertFalse(kf.transition.hold)
+        self.assertTrue(self.document.redo())
+        self.assertTrue(kf.transition.hold)
+
+
+if __name__ == "__main__":
+    unittest.main()
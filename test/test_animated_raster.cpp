@@ -0,0 +1,123 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <QtTest/QtTest>
+#include <QBuffer>
+#include <QImageReader>
+#include <QtEndian>
+
+#include "io/raster/animated_raster_format.hpp"
+#include "model/document.hpp"
+#include "model/assets/assets.hpp"
+#include "model/shapes/fill.hpp"
+#include "model/shapes/layer.hpp"
+#include "model/shapes/rect.hpp"
+
+using namespace glaxnimate;
+
+
+class TestCase: public QObject
+{
+    Q_OBJECT
+
+private:
+    struct Scene
+    {
+        model::Document doc{"foo"};
+        model::Composition* comp;
+
+        Scene()
+        {
+            comp = doc.assets()->compositions->values.insert(std::make_unique<model::Composition>(&doc));
+            comp->width.set(32);
+            comp->height.set(32);
+            comp->fps.set(10);
+            comp->animation->last_frame.set(10);
+
+            auto layer = static_cast<model::Layer*>(comp->shapes.insert(std::make_unique<model::Layer>(&doc)));
+            auto fill = static_cast<model::Fill*>(layer->shapes.insert(std::make_unique<model::Fill>(&doc)));
+            fill->color.set(QColor(255, 0, 0));
+            auto rect = static_cast<model::Rect*>(layer->shapes.insert(std::make_unique<model::Rect>(&doc)));
+            rect->size.set(QSizeF(8, 8));
+            rect->position.set_keyframe(0, QPointF(8, 8));
+            rect->position.set_keyframe(9, QPointF(24, 24));
+        }
+    };
+
+    static QByteArray save(model::Composition* comp, const QString& filename, const QVariantMap& settings = {})
+    {
+        io::raster::AnimatedRasterFormat format;
+        QByteArray data;
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::WriteOnly);
+        if ( !format.save(buffer, filename, comp, settings) )
+            return {};
+        return data;
+    }
+
+private slots:
+    void test_gif_frames()
+    {
+        Scene scene;
+        QByteArray data = save(scene.comp, "test.gif");
+        QVERIFY(data.startsWith("GIF89a"));
+
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::ReadOnly);
+        QImageReader reader(&buffer, "gif");
+        QCOMPARE(reader.imageCount(), 10);
+
+        QImage first = reader.read().convertToFormat(QImage::Format_ARGB32);
+        QCOMPARE(first.pixel(8, 8), qRgb(255, 0, 0));
+        QCOMPARE(qAlpha(first.pixel(24, 24)), 0);
+
+        QImage last;
+        while ( reader.canRead() )
+            last = reader.read().convertToFormat(QImage::Format_ARGB32);
+        QCOMPARE(last.pixel(24, 24), qRgb(255, 0, 0));
+        // The area covered by the first frame has been cleared
+        QCOMPARE(qAlpha(last.pixel(8, 8)), 0);
+    }
+
+    void test_gif_frame_palette()
+    {
+        Scene scene;
+        QByteArray data = save(scene.comp, "test.gif", {{"palette", int(io::raster::AnimatedRasterFormat::FramePalette)}});
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::ReadOnly);
+        QImageReader reader(&buffer, "gif");
+        QImage first = reader.read().convertToFormat(QImage::Format_ARGB32);
+        QCOMPARE(first.pixel(8, 8), qRgb(255, 0, 0));
+    }
+
+    void test_apng_default_image()
+    {
+        Scene scene;
+        QByteArray data = save(scene.comp, "test.apng");
+        QVERIFY(data.contains("acTL"));
+
+        // Viewers without APNG support show the first frame
+        QImage image = QImage::fromData(data, "png").convertToFormat(QImage::Format_ARGB32);
+        QCOMPARE(image.size(), QSize(32, 32));
+        QCOMPARE(image.pixel(8, 8), qRgb(255, 0, 0));
+        QCOMPARE(qAlpha(image.pixel(24, 24)), 0);
+    }
+
+    void test_apng_frame_count()
+    {
+        Scene scene;
+        // Frames after the last keyframe are merged into the one at the keyframe
+        scene.comp->animation->last_frame.set(20);
+        QByteArray data = save(scene.comp, "test.apng");
+        QCOMPARE(data.count("fcTL"), 10);
+        int animation_control = data.indexOf("acTL");
+        QVERIFY(animation_control != -1);
+        QCOMPARE(qFromBigEndian<quint32>(data.constData() + animation_control + 4), quint32(10));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestCase)
+#include "test_animated_raster.moc"
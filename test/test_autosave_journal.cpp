@@ -0,0 +1,218 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+#include <QBuffer>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "io/glaxnimate/glaxnimate_journal.hpp"
+#include "io/glaxnimate/glaxnimate_format.hpp"
+#include "model/document.hpp"
+#include "model/assets/assets.hpp"
+#include "model/shapes/group.hpp"
+#include "model/shapes/layer.hpp"
+#include "model/shapes/rect.hpp"
+
+using namespace glaxnimate;
+
+
+class TestCase: public QObject
+{
+    Q_OBJECT
+
+private:
+    static std::unique_ptr<model::Document> recover(const QString& filename)
+    {
+        QByteArray data = io::glaxnimate::AutosaveJournal::recover(filename);
+        if ( data.isEmpty() )
+            return {};
+
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::ReadOnly);
+        auto document = std::make_unique<model::Document>("");
+        if ( !io::glaxnimate::GlaxnimateFormat().open(buffer, filename, document.get(), {}) )
+            return {};
+        return document;
+    }
+
+    static QList<QJsonObject> journal_records(const QString& filename)
+    {
+        QFile file(io::glaxnimate::AutosaveJournal::journal_filename(filename));
+        if ( !file.open(QIODevice::ReadOnly) )
+            return {};
+
+        QList<QJsonObject> records;
+        for ( const QByteArray& line : file.readAll().split('\n') )
+        {
+            if ( !line.isEmpty() )
+                records.push_back(QJsonDocument::fromJson(line).object());
+        }
+        return records;
+    }
+
+private slots:
+    void test_recover()
+    {
+        QTemporaryDir dir;
+        QString filename = dir.filePath("test.bak.rawr");
+
+        model::Document document("foo");
+        auto comp = document.assets()->add_comp_no_undo();
+        auto layer = static_cast<model::Layer*>(comp->shapes.insert(std::make_unique<model::Layer>(&document)));
+        auto rect = static_cast<model::Rect*>(layer->shapes.insert(std::make_unique<model::Rect>(&document)));
+        rect->size.set(QSizeF(10, 20));
+
+        io::glaxnimate::AutosaveJournal journal(&document, filename);
+        journal.flush();
+        journal.wait();
+        QVERIFY(QFile::exists(filename));
+
+        // Property of a nested shape
+        rect->size.set(QSizeF(30, 40));
+        // Sub-object of a composition
+        comp->animation->last_frame.set(123);
+        // New top-level shape
+        auto layer2 = static_cast<model::Layer*>(comp->shapes.insert(std::make_unique<model::Layer>(&document)));
+        layer2->name.set("Layer 2");
+        journal.flush();
+
+        // Changes to removed shapes are ignored
+        auto removed = comp->shapes.remove(1);
+        journal.flush();
+        QVERIFY(QFileInfo(io::glaxnimate::AutosaveJournal::journal_filename(filename)).size() > 0);
+        removed->name.set("Removed");
+        journal.flush();
+        comp->shapes.insert(std::move(removed));
+        journal.flush();
+
+        auto recovered = recover(filename);
+        QVERIFY(recovered);
+        QCOMPARE(recovered->assets()->compositions->values.size(), 1);
+        auto recovered_comp = recovered->assets()->compositions->values[0];
+        QCOMPARE(recovered_comp->animation->last_frame.get(), 123.f);
+        QCOMPARE(recovered_comp->shapes.size(), 2);
+        QCOMPARE(recovered_comp->shapes[1]->name.get(), QString("Removed"));
+        auto recovered_rect = static_cast<model::Rect*>(static_cast<model::Layer*>(recovered_comp->shapes[0])->shapes[0]);
+        QCOMPARE(recovered_rect->size.get(), QSizeF(30, 40));
+
+        // The snapshot removes the journal entries
+        journal.snapshot();
+        journal.wait();
+        QCOMPARE(QFileInfo(io::glaxnimate::AutosaveJournal::journal_filename(filename)).size(), 0);
+        recovered = recover(filename);
+        QVERIFY(recovered);
+        QCOMPARE(recovered->assets()->compositions->values[0]->shapes.size(), 2);
+
+        journal.remove_files();
+        QVERIFY(!QFile::exists(filename));
+    }
+
+    void test_nested_chunks()
+    {
+        QTemporaryDir dir;
+        QString filename = dir.filePath("test.bak.rawr");
+
+        model::Document document("foo");
+        auto comp = document.assets()->add_comp_no_undo();
+        auto layer = static_cast<model::Layer*>(comp->shapes.insert(std::make_unique<model::Layer>(&document)));
+        auto rect = static_cast<model::Rect*>(layer->shapes.insert(std::make_unique<model::Rect>(&document)));
+        auto other = static_cast<model::Rect*>(layer->shapes.insert(std::make_unique<model::Rect>(&document)));
+
+        io::glaxnimate::AutosaveJournal journal(&document, filename);
+        journal.flush();
+        journal.wait();
+
+        // Only the edited shape is written, not the layer containing it
+        rect->size.set(QSizeF(30, 40));
+        journal.flush();
+        auto records = journal_records(filename);
+        QCOMPARE(records.size(), 1);
+        QCOMPARE(records[0]["type"].toString(), QString("node"));
+        QCOMPARE(QUuid(records[0]["uuid"].toString()), rect->uuid.get());
+
+        // New shapes in a nested group are written along with the group
+        auto group = static_cast<model::Group*>(layer->shapes.insert(std::make_unique<model::Group>(&document), 0));
+        auto nested = static_cast<model::Rect*>(group->shapes.insert(std::make_unique<model::Rect>(&document)));
+        nested->size.set(QSizeF(5, 6));
+        other->name.set("Other");
+        journal.flush();
+        // Nested rect, group, layer shape order and the other rect
+        QCOMPARE(journal_records(filename).size(), 4);
+
+        auto recovered = recover(filename);
+        QVERIFY(recovered);
+        auto recovered_layer = static_cast<model::Layer*>(recovered->assets()->compositions->values[0]->shapes[0]);
+        QCOMPARE(recovered_layer->shapes.size(), 3);
+        auto recovered_group = static_cast<model::Group*>(recovered_layer->shapes[0]);
+        QCOMPARE(static_cast<model::Rect*>(recovered_group->shapes[0])->size.get(), QSizeF(5, 6));
+        QCOMPARE(static_cast<model::Rect*>(recovered_layer->shapes[1])->size.get(), QSizeF(30, 40));
+        QCOMPARE(recovered_layer->shapes[2]->name.get(), QString("Other"));
+    }
+
+    void test_schedule_flush()
+    {
+        QTemporaryDir dir;
+        QString filename = dir.filePath("test.bak.rawr");
+
+        model::Document document("foo");
+        auto comp = document.assets()->add_comp_no_undo();
+        auto rect = static_cast<model::Rect*>(comp->shapes.insert(std::make_unique<model::Rect>(&document)));
+
+        io::glaxnimate::AutosaveJournal journal(&document, filename);
+        journal.flush();
+        journal.wait();
+        journal.set_flush_delay(50);
+
+        // Edits within the delay are coalesced into a single record
+        for ( int i = 1; i <= 10; i++ )
+        {
+            rect->size.set(QSizeF(i, i));
+            journal.schedule_flush();
+        }
+        QCOMPARE(journal_records(filename).size(), 0);
+        QTRY_COMPARE(journal_records(filename).size(), 1);
+
+        auto recovered = recover(filename);
+        QVERIFY(recovered);
+        QCOMPARE(static_cast<model::Rect*>(recovered->assets()->compositions->values[0]->shapes[0])->size.get(), QSizeF(10, 10));
+    }
+    void test_keyframe_edits()
+    {
+        QTemporaryDir dir;
+        QString filename = dir.filePath("test.bak.rawr");
+
+        model::Document document("foo");
+        auto comp = document.assets()->add_comp_no_undo();
+        auto rect = static_cast<model::Rect*>(comp->shapes.insert(std::make_unique<model::Rect>(&document)));
+        rect->size.set_keyframe(0, QSizeF(10, 10));
+        rect->size.set_keyframe(10, QSizeF(20, 20));
+
+        io::glaxnimate::AutosaveJournal journal(&document, filename);
+        journal.flush();
+        journal.wait();
+
+        // None of these change the value at the current time
+        rect->size.set_keyframe(10, QSizeF(30, 30));
+        rect->size.set_keyframe(20, QSizeF(40, 40));
+        rect->size.set_keyframe_transition(1, model::KeyframeTransition(model::KeyframeTransition::Hold));
+        QCOMPARE(rect->size.get(), QSizeF(10, 10));
+        journal.flush();
+        QCOMPARE(journal_records(filename).size(), 1);
+
+        auto recovered = recover(filename);
+        QVERIFY(recovered);
+        auto recovered_rect = static_cast<model::Rect*>(recovered->assets()->compositions->values[0]->shapes[0]);
+        QCOMPARE(recovered_rect->size.keyframe_count(), 3);
+        QCOMPARE(recovered_rect->size.keyframe(1)->get(), QSizeF(30, 30));
+        QCOMPARE(recovered_rect->size.keyframe(1)->transition().hold(), true);
+        QCOMPARE(recovered_rect->size.keyframe(2)->get(), QSizeF(40, 40));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestCase)
+#include "test_autosave_journal.moc"
@@ -6,6 +6,7 @@
 
 #include <QtTest/QtTest>
 
+#include <memory>
 #include <vector>
 #include "math/bezier/bezier_length.hpp"
 
@@ -174,6 +175,56 @@ private slots:
             CLOSE_ENOUGH(seg.solve(child_split.descend().ratio).y(), 100, false);
         }
     }
+
+    void test_frame_arena()
+    {
+        QCOMPARE(FrameArena::resource(), std::pmr::get_default_resource());
+
+        std::unique_ptr<MultiBezier> kept;
+        {
+            FrameArena::Scope scope;
+            QVERIFY(FrameArena::resource() != std::pmr::get_default_resource());
+
+            // Only objects that are explicitly given the arena use it
+            MultiBezier heap;
+            heap.move_to(QPointF(0, 0));
+            QCOMPARE(heap.beziers().get_allocator().resource(), std::pmr::get_default_resource());
+            QCOMPARE(heap[0].points().get_allocator().resource(), std::pmr::get_default_resource());
+
+            MultiBezier mbez(FrameArena::resource());
+            mbez.move_to(QPointF(0, 0));
+            mbez.line_to(QPointF(100, 0));
+            mbez.line_to(QPointF(100, 100));
+            QCOMPARE(mbez.beziers().get_allocator().resource(), FrameArena::resource());
+            QCOMPARE(mbez[0].points().get_allocator().resource(), FrameArena::resource());
+
+            LengthData data(mbez, 10, FrameArena::resource());
+            QCOMPARE(data.length(), 200);
+
+            // Copies and moves allocate from the default resource
+            MultiBezier copy(mbez);
+            QCOMPARE(copy.beziers().get_allocator().resource(), std::pmr::get_default_resource());
+            QCOMPARE(copy[0].points().get_allocator().resource(), std::pmr::get_default_resource());
+            Bezier bez_copy(mbez[0]);
+            QCOMPARE(bez_copy.points().get_allocator().resource(), std::pmr::get_default_resource());
+
+            kept = std::make_unique<MultiBezier>(std::move(mbez));
+            QCOMPARE(kept->beziers().get_allocator().resource(), std::pmr::get_default_resource());
+            QCOMPARE((*kept)[0].points().get_allocator().resource(), std::pmr::get_default_resource());
+
+            // Nested scopes share the outer arena
+            auto outer = FrameArena::resource();
+            {
+                FrameArena::Scope nested;
+                QCOMPARE(FrameArena::resource(), outer);
+            }
+            QCOMPARE(FrameArena::resource(), outer);
+        }
+
+        QCOMPARE(FrameArena::resource(), std::pmr::get_default_resource());
+        QCOMPARE((*kept)[0].size(), 3);
+        QCOMPARE((*kept)[0][2].pos, QPointF(100, 100));
+    }
 };
 
 QTEST_GUILESS_MAIN(TestCase)
@@ -6,8 +6,10 @@
 
 #include <QtTest/QtTest>
 
+#include <cmath>
 #include <vector>
 #include "math/bezier/solver.hpp"
+#include "math/bezier/bezier.hpp"
 
 using namespace glaxnimate;
 
@@ -15,6 +17,12 @@ class TestCase: public QObject
 {
     Q_OBJECT
 
+private:
+    static bool same_point(const QPointF& a, const QPointF& b)
+    {
+        return QLineF(a, b).length() < 1e-6;
+    }
+
 private slots:
 #if 0
     void test_order()
@@ -535,6 +543,56 @@ private slots:
         QCOMPARE(float(bs.solve_component(minmax.second, 0)), 1-x);
         QCOMPARE(float(bs.solve_component(minmax.second, 1)), 1+y);
     }
+    void test_bulk_operations()
+    {
+        using namespace math::bezier;
+
+        Bezier bez;
+        for ( int i = 0; i < 50; i++ )
+        {
+            qreal angle = M_PI * i / 25;
+            QPointF pos(std::cos(angle) * (i % 2 ? 50 : 100), std::sin(angle) * (i % 2 ? 50 : 100));
+            bez.push_back(Point(pos, pos * 1.2, pos * 0.8, i % 3 ? Corner : Smooth));
+        }
+        bez.close();
+
+        // Transform
+        QTransform transform;
+        transform.translate(10, 20).rotate(30).scale(2, 0.5);
+        Bezier transformed = bez.transformed(transform);
+        QCOMPARE(transformed.size(), bez.size());
+        for ( int i = 0; i < bez.size(); i++ )
+        {
+            QVERIFY(same_point(transformed[i].pos, transform.map(bez[i].pos)));
+            QVERIFY(same_point(transformed[i].tan_in, transform.map(bez[i].tan_in)));
+            QVERIFY(same_point(transformed[i].tan_out, transform.map(bez[i].tan_out)));
+            QCOMPARE(transformed[i].type, bez[i].type);
+        }
+
+        // Bounding box, same as the union of the bounds of all segments
+        QRectF expected;
+        for ( int i = 0; i < bez.segment_count(); i++ )
+        {
+            auto bounds = Solver(bez.segment(i)).bounds();
+            expected |= QRectF(bounds.first, bounds.second);
+        }
+        QRectF box = bez.bounding_box();
+        QVERIFY(qAbs(box.left() - expected.left()) < 0.5);
+        QVERIFY(qAbs(box.top() - expected.top()) < 0.5);
+        QVERIFY(qAbs(box.right() - expected.right()) < 0.5);
+        QVERIFY(qAbs(box.bottom() - expected.bottom()) < 0.5);
+
+        // Lerp
+        Bezier lerped = bez.lerp(transformed, 0.25);
+        QCOMPARE(lerped.size(), bez.size());
+        QCOMPARE(lerped.closed(), true);
+        for ( int i = 0; i < bez.size(); i++ )
+        {
+            QVERIFY(same_point(lerped[i].pos, math::lerp(bez[i].pos, transformed[i].pos, 0.25)));
+            QVERIFY(same_point(lerped[i].tan_in, math::lerp(bez[i].tan_in, transformed[i].tan_in, 0.25)));
+            QVERIFY(same_point(lerped[i].tan_out, math::lerp(bez[i].tan_out, transformed[i].tan_out, 0.25)));
+        }
+    }
 };
 
 QTEST_GUILESS_MAIN(TestCase)
@@ -0,0 +1,101 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <QtTest/QtTest>
+#include <QBuffer>
+
+#include "model/document.hpp"
+#include "model/assets/assets.hpp"
+
+using namespace glaxnimate;
+
+
+class TestCase: public QObject
+{
+    Q_OBJECT
+
+private:
+    QByteArray png(const QSize& size, const QColor& color)
+    {
+        QImage image(size, QImage::Format_ARGB32);
+        image.fill(color);
+        QByteArray data;
+        QBuffer buf(&data);
+        buf.open(QIODevice::WriteOnly);
+        image.save(&buf, "png");
+        return data;
+    }
+
+private slots:
+    void test_dedup()
+    {
+        model::Document doc("foo");
+        auto& store = doc.assets()->bitmap_store;
+
+        model::Bitmap bmp1(&doc);
+        bmp1.data.set(png({16, 8}, Qt::red));
+        model::Bitmap bmp2(&doc);
+        bmp2.data.set(png({16, 8}, Qt::red));
+        model::Bitmap bmp3(&doc);
+        bmp3.data.set(png({16, 8}, Qt::blue));
+
+        QCOMPARE(store.size(), 2);
+        QCOMPARE(bmp1.store_entry().get(), bmp2.store_entry().get());
+        QVERIFY(bmp1.store_entry().get() != bmp3.store_entry().get());
+    }
+
+    void test_lazy_decode()
+    {
+        model::Document doc("foo");
+        model::Bitmap bmp(&doc);
+        bmp.data.set(png({16, 8}, Qt::red));
+
+        QCOMPARE(bmp.width.get(), 16);
+        QCOMPARE(bmp.height.get(), 8);
+        QCOMPARE(bmp.format.get(), QString("png"));
+        QVERIFY(!bmp.store_entry()->decoded());
+
+        QCOMPARE(bmp.get_image().size(), QSize(16, 8));
+        QVERIFY(bmp.store_entry()->decoded());
+        QCOMPARE(bmp.get_image().pixelColor(3, 3), QColor(Qt::red));
+    }
+
+    void test_mip()
+    {
+        model::Document doc("foo");
+        model::Bitmap bmp(&doc);
+        bmp.data.set(png({16, 8}, Qt::red));
+        auto entry = bmp.store_entry();
+
+        QCOMPARE(entry->mip_level(1), 0);
+        QCOMPARE(entry->mip_level(2), 0);
+        QCOMPARE(entry->mip_level(0.5), 1);
+        QCOMPARE(entry->mip_level(0.3), 1);
+        QCOMPARE(entry->mip_level(0.25), 2);
+        QCOMPARE(entry->mip_level(0.001), 4);
+
+        QCOMPARE(entry->mip(0).size(), QSize(16, 8));
+        QCOMPARE(entry->mip(1).size(), QSize(8, 4));
+        QCOMPARE(entry->mip(3).size(), QSize(2, 1));
+        QCOMPARE(entry->mip(4).size(), QSize(1, 1));
+        QCOMPARE(entry->mip(10).size(), QSize(1, 1));
+    }
+
+    void test_release()
+    {
+        model::Document doc("foo");
+        auto& store = doc.assets()->bitmap_store;
+        {
+            model::Bitmap bmp(&doc);
+            bmp.data.set(png({16, 8}, Qt::red));
+            QCOMPARE(store.size(), 1);
+        }
+        QCOMPARE(store.size(), 0);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestCase)
+#include "test_bitmap_store.moc"
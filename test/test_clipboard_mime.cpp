@@ -0,0 +1,138 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <QtTest/QtTest>
+#include <QMimeData>
+
+#include "io/glaxnimate/glaxnimate_mime.hpp"
+#include "model/document.hpp"
+#include "model/assets/assets.hpp"
+#include "model/shapes/fill.hpp"
+#include "model/shapes/layer.hpp"
+#include "model/shapes/rect.hpp"
+
+using namespace glaxnimate;
+
+
+class TestCase: public QObject
+{
+    Q_OBJECT
+
+private:
+    struct Source
+    {
+        model::Document document{""};
+        model::Layer* layer = nullptr;
+        model::Rect* rect = nullptr;
+        model::NamedColor* color = nullptr;
+
+        Source()
+        {
+            auto comp = document.assets()->compositions->values.insert(std::make_unique<model::Composition>(&document));
+            layer = static_cast<model::Layer*>(comp->shapes.insert(std::make_unique<model::Layer>(&document)));
+            layer->name.set("Layer");
+            color = document.assets()->add_color(QColor(255, 0, 0), "Red");
+            auto fill = static_cast<model::Fill*>(layer->shapes.insert(std::make_unique<model::Fill>(&document)));
+            fill->use.set(color);
+            rect = static_cast<model::Rect*>(layer->shapes.insert(std::make_unique<model::Rect>(&document)));
+            rect->size.set_keyframe(0, QSizeF(10, 10));
+            rect->size.set_keyframe(10, QSizeF(20, 20));
+        }
+    };
+
+    static void check_pasted(const io::mime::DeserializedData& pasted, const Source& source)
+    {
+        QVERIFY(!pasted.empty());
+        QCOMPARE(pasted.main->shapes.size(), 1);
+        auto layer = qobject_cast<model::Layer*>(pasted.main->shapes[0]);
+        QVERIFY(layer);
+        QVERIFY(layer != source.layer);
+        QCOMPARE(layer->document(), pasted.document.get());
+        QCOMPARE(layer->name.get(), QString("Layer"));
+        QCOMPARE(layer->shapes.size(), 2);
+
+        auto fill = qobject_cast<model::Fill*>(layer->shapes[0]);
+        QVERIFY(fill);
+        auto color = qobject_cast<model::NamedColor*>(fill->use.get());
+        QVERIFY(color);
+        QVERIFY(color != source.color);
+        QCOMPARE(color->document(), pasted.document.get());
+        QCOMPARE(color->color.get(), QColor(255, 0, 0));
+        QCOMPARE(pasted.document->assets()->colors->values.size(), 1);
+
+        auto rect = qobject_cast<model::Rect*>(layer->shapes[1]);
+        QVERIFY(rect);
+        QCOMPARE(rect->size.keyframe_count(), 2);
+        QCOMPARE(rect->size.keyframe(1)->get(), QSizeF(20, 20));
+    }
+
+private slots:
+    void test_same_process()
+    {
+        Source source;
+        io::glaxnimate::GlaxnimateBinaryMime mime;
+        QMimeData data;
+        mime.to_mime_data(data, {source.layer});
+        QVERIFY(data.hasFormat("application/x-glaxnimate-binary"));
+
+        // Changes after copying don't affect the clipboard
+        source.rect->size.set_keyframe(10, QSizeF(30, 30));
+
+        check_pasted(mime.from_mime_data(data), source);
+        // Pasting multiple times gives independent copies
+        auto first = mime.from_mime_data(data);
+        auto second = mime.from_mime_data(data);
+        QVERIFY(first.main->shapes[0] != second.main->shapes[0]);
+        QCOMPARE(static_cast<model::Rect*>(static_cast<model::Layer*>(second.main->shapes[0])->shapes[1])->size.keyframe(1)->get(), QSizeF(20, 20));
+    }
+
+    void test_lazy_payload()
+    {
+        Source source;
+        io::glaxnimate::GlaxnimateBinaryMime mime;
+        io::mime::MimeData data;
+        mime.to_mime_data(data, {source.layer});
+        QString format = "application/x-glaxnimate-binary";
+        QVERIFY(data.hasFormat(format));
+        QVERIFY(data.formats().contains(format));
+        QVERIFY(!data.lazy_header(format).isEmpty());
+
+        // Pasting in the same process doesn't produce the payload
+        check_pasted(mime.from_mime_data(data), source);
+        QVERIFY(!data.lazy_header(format).isEmpty());
+
+        // The payload is encoded from the snapshot, not the current state of the source
+        source.rect->size.set_keyframe(10, QSizeF(30, 30));
+        source.layer->name.set("Changed");
+        QByteArray payload = data.data(format);
+        QVERIFY(data.lazy_header(format).isEmpty());
+
+        // A newer copy replaces the snapshot so the payload has to be decoded
+        QMimeData other;
+        mime.to_mime_data(other, {source.rect});
+        check_pasted(mime.deserialize(payload), source);
+    }
+
+    void test_serialized()
+    {
+        Source source;
+        io::glaxnimate::GlaxnimateBinaryMime mime;
+        QByteArray data = mime.serialize({source.layer});
+        QVERIFY(data.startsWith("GLXB"));
+        QVERIFY(data.size() < io::glaxnimate::GlaxnimateMime().serialize({source.layer}).size());
+        check_pasted(mime.deserialize(data), source);
+    }
+
+    void test_invalid()
+    {
+        io::glaxnimate::GlaxnimateBinaryMime mime;
+        QVERIFY(mime.deserialize("not glaxnimate").empty());
+        QVERIFY(mime.deserialize(QByteArray("GLXB\x00\x01", 6)).empty());
+    }
+};
+
+QTEST_GUILESS_MAIN(TestCase)
+#include "test_clipboard_mime.moc"
@@ -0,0 +1,206 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <QtTest/QtTest>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QSharedMemory>
+
+#include "io/frame_server.hpp"
+#include "model/document.hpp"
+#include "model/assets/assets.hpp"
+#include "model/shapes/fill.hpp"
+#include "model/shapes/layer.hpp"
+#include "model/shapes/rect.hpp"
+
+using namespace glaxnimate;
+
+
+class TestCase: public QObject
+{
+    Q_OBJECT
+
+private:
+    /**
+     * \brief Host side of the connection
+     */
+    struct Host
+    {
+        QLocalServer server;
+        QLocalSocket* socket = nullptr;
+        std::unique_ptr<QDataStream> stream;
+
+        bool listen(io::FrameServer& frame_server)
+        {
+            QString name = QString("glaxnimate-test-%1").arg(QCoreApplication::applicationPid());
+            QLocalServer::removeServer(name);
+            if ( !server.listen(name) )
+                return false;
+
+            frame_server.connect_to_host(name);
+            if ( !server.waitForNewConnection(5000) )
+                return false;
+
+            socket = server.nextPendingConnection();
+            stream = std::make_unique<QDataStream>(socket);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+            stream->setVersion(QDataStream::Qt_5_15);
+#endif
+            return true;
+        }
+
+        void send(const QString& message)
+        {
+            *stream << message;
+            socket->flush();
+        }
+
+        QString receive()
+        {
+            QElapsedTimer timer;
+            timer.start();
+            while ( timer.elapsed() < 5000 )
+            {
+                stream->startTransaction();
+                QString message;
+                *stream >> message;
+                if ( stream->commitTransaction() )
+                    return message;
+                QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+            }
+            return {};
+        }
+    };
+
+    static std::unique_ptr<model::Document> document()
+    {
+        auto doc = std::make_unique<model::Document>("foo");
+        auto comp = doc->assets()->compositions->values.insert(std::make_unique<model::Composition>(doc.get()));
+        comp->width.set(32);
+        comp->height.set(32);
+        comp->animation->last_frame.set(10);
+
+        auto layer = static_cast<model::Layer*>(comp->shapes.insert(std::make_unique<model::Layer>(doc.get())));
+        auto fill = static_cast<model::Fill*>(layer->shapes.insert(std::make_unique<model::Fill>(doc.get())));
+        fill->color.set(QColor(255, 0, 0));
+        auto rect = static_cast<model::Rect*>(layer->shapes.insert(std::make_unique<model::Rect>(doc.get())));
+        rect->size.set(QSizeF(8, 8));
+        rect->position.set_keyframe(0, QPointF(8, 8));
+        rect->position.set_keyframe(9, QPointF(24, 24));
+        return doc;
+    }
+
+    static QRgb slot_pixel(QSharedMemory& memory, int stride, int slot, QPoint pos)
+    {
+        const uchar* data = static_cast<const uchar*>(memory.constData()) + io::FrameServer::header_size + slot * stride;
+        const qint32* header = reinterpret_cast<const qint32*>(data);
+        QImage image(data + io::FrameServer::slot_header_size, header[0], header[1], header[3], QImage::Format(header[2]));
+        return image.pixel(pos);
+    }
+
+private slots:
+    void test_render_and_prefetch()
+    {
+        io::FrameServer server;
+        server.set_document(document());
+        server.set_prefetch(2);
+
+        Host host;
+        QVERIFY(host.listen(server));
+
+        host.send("hello");
+        QCOMPARE(host.receive(), QString("version 1 frame-server"));
+        QCOMPARE(host.receive(), QString("document 32 32 0 10 60"));
+
+        host.send("configure 16 16 4");
+        QString memory_message = host.receive();
+        if ( memory_message.startsWith("error") )
+            QSKIP("Shared memory not available");
+        QStringList memory_info = memory_message.split(' ');
+        QCOMPARE(memory_info.size(), 5);
+        QCOMPARE(memory_info[0], QString("memory"));
+        QCOMPARE(memory_info[2], QString("4"));
+        int stride = memory_info[3].toInt();
+        QCOMPARE(stride % 64, 0);
+
+        QSharedMemory memory(memory_info[1]);
+        QVERIFY(memory.attach(QSharedMemory::ReadOnly));
+
+        host.send("frame 0");
+        QCOMPARE(host.receive(), QString("ready 0 0"));
+        QCOMPARE(slot_pixel(memory, stride, 0, {4, 4}), qRgba(255, 0, 0, 255));
+        QCOMPARE(slot_pixel(memory, stride, 0, {12, 12}), qRgba(0, 0, 0, 0));
+
+        // Frames 1 and 2 are prefetched in the other slots
+        host.send("frame 1");
+        QCOMPARE(host.receive(), QString("ready 1 1"));
+
+        // Requesting the same frame again pins it twice
+        host.send("frame 0");
+        QCOMPARE(host.receive(), QString("ready 0 0"));
+        host.send("release 0");
+        host.send("release 0");
+        host.send("release 1");
+        host.send("release 1");
+        QCOMPARE(host.receive(), QString("error invalid slot 1"));
+
+        host.send("frame 9");
+        QString ready = host.receive();
+        QVERIFY(ready.startsWith("ready 9 "));
+        int slot = ready.section(' ', 2).toInt();
+        QCOMPARE(slot_pixel(memory, stride, slot, {12, 12}), qRgba(255, 0, 0, 255));
+        QCOMPARE(slot_pixel(memory, stride, slot, {4, 4}), qRgba(0, 0, 0, 0));
+
+        host.send("bye");
+        QSignalSpy finished(&server, &io::FrameServer::finished);
+        QVERIFY(finished.wait(5000));
+        QCOMPARE(finished[0][0].toBool(), true);
+    }
+
+    void test_composition()
+    {
+        auto doc = document();
+        auto second = doc->assets()->compositions->values.insert(std::make_unique<model::Composition>(doc.get()));
+        second->width.set(64);
+        second->height.set(48);
+        second->animation->last_frame.set(30);
+
+        io::FrameServer server;
+        server.set_document(std::move(doc));
+
+        Host host;
+        QVERIFY(host.listen(server));
+
+        host.send("hello");
+        QCOMPARE(host.receive(), QString("version 1 frame-server"));
+        QCOMPARE(host.receive(), QString("document 32 32 0 10 60"));
+
+        host.send("composition 1");
+        QCOMPARE(host.receive(), QString("document 64 48 0 30 60"));
+
+        host.send("composition 2");
+        QCOMPARE(host.receive(), QString("error no composition 2"));
+
+        host.send("composition 0");
+        QCOMPARE(host.receive(), QString("document 32 32 0 10 60"));
+    }
+
+    void test_connection_error()
+    {
+        QString name = QString("glaxnimate-test-missing-%1").arg(QCoreApplication::applicationPid());
+        QLocalServer::removeServer(name);
+
+        io::FrameServer server;
+        QSignalSpy finished(&server, &io::FrameServer::finished);
+        server.connect_to_host(name);
+        QVERIFY(finished.count() || finished.wait(5000));
+        QCOMPARE(finished.count(), 1);
+        QCOMPARE(finished[0][0].toBool(), false);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestCase)
+#include "test_frame_server.moc"
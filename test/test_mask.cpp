@@ -0,0 +1,70 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <QtTest/QtTest>
+
+#include "model/document.hpp"
+#include "model/render_program.hpp"
+#include "model/assets/assets.hpp"
+#include "model/shapes/fill.hpp"
+#include "model/shapes/layer.hpp"
+#include "model/shapes/rect.hpp"
+
+using namespace glaxnimate;
+
+
+class TestCase: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void test_matte()
+    {
+        model::Document doc("foo");
+        auto comp = doc.assets()->add_comp_no_undo();
+        comp->width.set(32);
+        comp->height.set(32);
+        comp->animation->last_frame.set(10);
+
+        auto layer = static_cast<model::Layer*>(comp->shapes.insert(std::make_unique<model::Layer>(&doc)));
+        layer->animation->last_frame.set(10);
+        layer->mask->mask.set(model::MaskSettings::Luma);
+
+        // Matte covering the left half
+        auto matte = static_cast<model::Group*>(layer->shapes.insert(std::make_unique<model::Group>(&doc)));
+        auto matte_fill = static_cast<model::Fill*>(matte->shapes.insert(std::make_unique<model::Fill>(&doc)));
+        matte_fill->color.set(QColor(255, 255, 255));
+        auto matte_rect = static_cast<model::Rect*>(matte->shapes.insert(std::make_unique<model::Rect>(&doc)));
+        matte_rect->position.set(QPointF(8, 16));
+        matte_rect->size.set(QSizeF(16, 32));
+
+        auto fill = static_cast<model::Fill*>(layer->shapes.insert(std::make_unique<model::Fill>(&doc)));
+        fill->color.set(QColor(255, 0, 0));
+        auto rect = static_cast<model::Rect*>(layer->shapes.insert(std::make_unique<model::Rect>(&doc)));
+        rect->position.set(QPointF(16, 16));
+        rect->size.set(QSizeF(32, 32));
+
+        QImage image = comp->render_image(0);
+        QCOMPARE(image.pixel(4, 16), qRgba(255, 0, 0, 255));
+        QCOMPARE(qAlpha(image.pixel(28, 16)), 0);
+
+        // Black has no luminance but it's opaque
+        matte_fill->color.set(QColor(0, 0, 0));
+        QCOMPARE(qAlpha(comp->render_image(0).pixel(4, 16)), 0);
+        layer->mask->mask.set(model::MaskSettings::AlphaMatte);
+        QCOMPARE(comp->render_image(0).pixel(4, 16), qRgba(255, 0, 0, 255));
+
+        layer->mask->inverted.set(true);
+        image = comp->render_image(0);
+        QCOMPARE(qAlpha(image.pixel(4, 16)), 0);
+        QCOMPARE(image.pixel(28, 16), qRgba(255, 0, 0, 255));
+
+        QCOMPARE(model::RenderProgram(comp).render_image(0), image);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestCase)
+#include "test_mask.moc"
@@ -0,0 +1,109 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <QtTest/QtTest>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "utils/profiler.hpp"
+
+using namespace glaxnimate::utils;
+
+
+class TestCase: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void cleanup()
+    {
+        profiler::set_enabled(false);
+        profiler::clear();
+    }
+
+    void test_disabled()
+    {
+        profiler::clear();
+        {
+            profiler::Scope scope("paint", "foo");
+        }
+        QCOMPARE(int(profiler::take().size()), 0);
+    }
+
+    void test_nested()
+    {
+        profiler::clear();
+        profiler::set_enabled(true);
+        {
+            profiler::Scope outer("paint", "outer");
+            {
+                profiler::Scope inner("process", "inner");
+                QThread::msleep(2);
+            }
+        }
+        profiler::set_enabled(false);
+
+        auto spans = profiler::take();
+        QCOMPARE(int(spans.size()), 2);
+        QVERIFY(profiler::take().empty());
+
+        auto stats = profiler::summarize(spans);
+        QCOMPARE(int(stats.size()), 2);
+        // Inner has the most self time
+        QCOMPARE(stats[0].name, "inner");
+        QCOMPARE(stats[1].name, "outer");
+        QVERIFY(stats[1].total >= stats[0].total);
+        QCOMPARE(stats[1].self, stats[1].total - stats[0].total);
+    }
+
+    void test_threads()
+    {
+        profiler::clear();
+        profiler::set_enabled(true);
+        // Enough spans to need more than one chunk per thread
+        auto record = []{
+            for ( int i = 0; i < 3000; i++ )
+                profiler::Scope scope("paint", "thread");
+        };
+        QThread* thread = QThread::create(record);
+        thread->start();
+        record();
+        thread->wait();
+        delete thread;
+        profiler::set_enabled(false);
+
+        auto spans = profiler::take();
+        QCOMPARE(int(spans.size()), 6000);
+        auto stats = profiler::summarize(spans);
+        QCOMPARE(int(stats.size()), 1);
+        QCOMPARE(stats[0].count, 6000);
+    }
+
+    void test_chrome_trace()
+    {
+        profiler::clear();
+        profiler::set_enabled(true);
+        {
+            profiler::Scope scope("save", "lottie");
+        }
+        profiler::set_enabled(false);
+
+        auto json = QJsonDocument::fromJson(profiler::chrome_trace(profiler::take())).object();
+        QJsonObject event;
+        for ( const auto& val : json["traceEvents"].toArray() )
+            if ( val.toObject()["ph"].toString() == "X" )
+                event = val.toObject();
+
+        QCOMPARE(event["name"].toString(), "lottie");
+        QCOMPARE(event["cat"].toString(), "save");
+        QVERIFY(event.contains("ts"));
+        QVERIFY(event.contains("dur"));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestCase)
+#include "test_profiler.moc"
@@ -11,6 +11,8 @@
 #include "model/property/object_list_property.hpp"
 #include "model/property/reference_property.hpp"
 #include "model/document.hpp"
+#include "model/shapes/group.hpp"
+#include "model/shapes/rect.hpp"
 
 using namespace glaxnimate::model;
 using namespace glaxnimate;
@@ -195,6 +197,48 @@ private slots:
         QCOMPARE(prop_2.read(&test_subject).toList()[0].value<MetaTestSubject*>(), test_subject.prop_list[0]);
     }
 
+    void test_property_id()
+    {
+        PropertyId foo("foo");
+        QVERIFY(foo.valid());
+        QCOMPARE(foo.name(), QString("foo"));
+        QVERIFY(PropertyId("foo") == foo);
+        QVERIFY(PropertyId::find("foo") == foo);
+        QVERIFY(PropertyId("bar") != foo);
+        QVERIFY(!PropertyId::find("property_id_not_registered").valid());
+        QVERIFY(!PropertyId().valid());
+        QCOMPARE(PropertyId().index(), -1);
+    }
+
+    void test_get_property()
+    {
+        Document doc("foo");
+        MetaTestSubject test_subject(&doc);
+        MetaTestSubject other(&doc);
+
+        QVERIFY(test_subject.get_property("prop_scalar") == &test_subject.prop_scalar);
+        QVERIFY(other.get_property(PropertyId("prop_scalar")) == &other.prop_scalar);
+        QVERIFY(other.get_property(test_subject.prop_list.id()) == &other.prop_list);
+        QVERIFY(test_subject.get_property("not_a_property") == nullptr);
+
+        const MetaTestSubject& const_subject = test_subject;
+        static_assert(std::is_same_v<decltype(const_subject.get_property(PropertyId())), const BaseProperty*>);
+        QVERIFY(const_subject.get_property(PropertyId("prop_scalar")) == &test_subject.prop_scalar);
+        QVERIFY(const_subject.get_property("prop_list") == &test_subject.prop_list);
+
+        QVERIFY(test_subject.has("prop_ref"));
+        QVERIFY(!test_subject.has("not_a_property"));
+
+        // Objects of the same type with different properties
+        Object obj1(nullptr);
+        Property<int> foo(&obj1, "foo");
+        Object obj2(nullptr);
+        Property<int> bar(&obj2, "bar");
+        QVERIFY(obj1.get_property("foo") == &foo);
+        QVERIFY(obj2.get_property("bar") == &bar);
+        QVERIFY(obj2.get_property("foo") == nullptr);
+    }
+
     void test_callback_val()
     {
         Document doc("foo");
@@ -246,6 +290,48 @@ private slots:
         pc = nullptr;
         QVERIFY(!pc);
     }
+
+    void test_object_list_range()
+    {
+        Document doc("foo");
+        Group group(&doc);
+        auto existing = group.shapes.insert(std::make_unique<Rect>(&doc));
+
+        QSignalSpy add_begin(&group, &DocumentNode::docnode_child_add_span_begin);
+        QSignalSpy add_end(&group, &DocumentNode::docnode_child_add_span_end);
+        QSignalSpy added(&group, &DocumentNode::docnode_child_add_end);
+        bool active_in_span = false;
+        QObject::connect(&group, &DocumentNode::docnode_child_add_end, &group, [&group, &active_in_span]{
+            active_in_span = group.docnode_child_span_active();
+        });
+
+        std::vector<std::unique_ptr<ShapeElement>> items;
+        for ( int i = 0; i < 3; i++ )
+            items.push_back(std::make_unique<Rect>(&doc));
+        auto inserted = group.shapes.insert_range(std::move(items), 0);
+
+        QCOMPARE(int(inserted.size()), 3);
+        QCOMPARE(group.shapes.size(), 4);
+        QCOMPARE(group.shapes[0], inserted[0]);
+        QCOMPARE(group.shapes[2], inserted[2]);
+        QCOMPARE(group.shapes[3], existing);
+        QCOMPARE(add_begin.size(), 1);
+        QCOMPARE(add_begin[0][0].toInt(), 0);
+        QCOMPARE(add_begin[0][1].toInt(), 3);
+        QCOMPARE(add_end.size(), 1);
+        QCOMPARE(added.size(), 3);
+        QVERIFY(active_in_span);
+        QVERIFY(!group.docnode_child_span_active());
+
+        QSignalSpy remove_begin(&group, &DocumentNode::docnode_child_remove_span_begin);
+        auto removed = group.shapes.remove_range(1, 5);
+        QCOMPARE(int(removed.size()), 3);
+        QCOMPARE(removed[0].get(), inserted[1]);
+        QCOMPARE(removed[2].get(), existing);
+        QCOMPARE(group.shapes.size(), 1);
+        QCOMPARE(remove_begin.size(), 1);
+        QCOMPARE(remove_begin[0][1].toInt(), 3);
+    }
 };
 
 QTEST_GUILESS_MAIN(TestProperty)
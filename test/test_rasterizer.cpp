@@ -0,0 +1,240 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <QtTest/QtTest>
+#include <QPainter>
+
+#include "math/bezier/rasterizer.hpp"
+#include "model/document.hpp"
+#include "model/assets/assets.hpp"
+#include "model/shapes/ellipse.hpp"
+#include "model/shapes/fill.hpp"
+#include "model/shapes/layer.hpp"
+#include "model/shapes/stroke.hpp"
+
+using namespace glaxnimate;
+using math::bezier::MultiBezier;
+using math::bezier::Rasterizer;
+
+
+class TestCase: public QObject
+{
+    Q_OBJECT
+
+private:
+    static constexpr int size = 64;
+
+    static QImage blank(QImage::Format format = QImage::Format_ARGB32_Premultiplied)
+    {
+        QImage image(size, size, format);
+        image.fill(Qt::transparent);
+        return image;
+    }
+
+    static MultiBezier circle(const QPointF& center, qreal radius)
+    {
+        // Handle length for a quarter circle
+        qreal k = radius * 0.5519150244935105707435627;
+        qreal x = center.x();
+        qreal y = center.y();
+        MultiBezier bez;
+        bez.move_to({x + radius, y});
+        bez.cubic_to({x + radius, y + k}, {x + k, y + radius}, {x, y + radius});
+        bez.cubic_to({x - k, y + radius}, {x - radius, y + k}, {x - radius, y});
+        bez.cubic_to({x - radius, y - k}, {x - k, y - radius}, {x, y - radius});
+        bez.cubic_to({x + k, y - radius}, {x + radius, y - k}, {x + radius, y});
+        bez.close();
+        return bez;
+    }
+
+    static MultiBezier star()
+    {
+        // Self-intersecting, the center has a winding number of 2
+        MultiBezier bez;
+        bez.move_to({32, 4});
+        bez.line_to({48.5, 54.5});
+        bez.line_to({5.5, 23.5});
+        bez.line_to({58.5, 23.5});
+        bez.line_to({15.5, 54.5});
+        bez.close();
+        return bez;
+    }
+
+    static MultiBezier zigzag()
+    {
+        MultiBezier bez;
+        bez.move_to({8, 48});
+        bez.line_to({20, 12});
+        bez.line_to({32, 48});
+        bez.cubic_to({40, 20}, {50, 60}, {56, 16});
+        return bez;
+    }
+
+    /**
+     * Golden image check: the rasterizer is allowed to differ from QPainter
+     * in the anti-aliasing of edge pixels, not in the covered area
+     */
+    static void compare(const QImage& actual, const QImage& expected)
+    {
+        QImage a = actual.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+        QImage b = expected.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+        QCOMPARE(a.size(), b.size());
+
+        int max_difference = 0;
+        qint64 total_difference = 0;
+        for ( int y = 0; y < a.height(); y++ )
+        {
+            auto line_a = reinterpret_cast<const QRgb*>(a.constScanLine(y));
+            auto line_b = reinterpret_cast<const QRgb*>(b.constScanLine(y));
+            for ( int x = 0; x < a.width(); x++ )
+            {
+                for ( int shift : {0, 8, 16, 24} )
+                {
+                    int difference = std::abs(int((line_a[x] >> shift) & 0xff) - int((line_b[x] >> shift) & 0xff));
+                    max_difference = std::max(max_difference, difference);
+                    total_difference += difference;
+                }
+            }
+        }
+
+        double mean_difference = double(total_difference) / (a.width() * a.height() * 4);
+        QVERIFY2(max_difference <= 64, qPrintable(QString("Max difference %1").arg(max_difference)));
+        QVERIFY2(mean_difference <= 1, qPrintable(QString("Mean difference %1").arg(mean_difference)));
+    }
+
+    static void check_fill(const MultiBezier& shape, Qt::FillRule rule, const QColor& color, const QTransform& transform = {}, QImage::Format format = QImage::Format_ARGB32_Premultiplied)
+    {
+        QImage expected = blank(format);
+        {
+            QPainter painter(&expected);
+            painter.setRenderHint(QPainter::Antialiasing);
+            painter.setTransform(transform);
+            painter.setPen(Qt::NoPen);
+            painter.setBrush(color);
+            QPainterPath path = shape.painter_path();
+            path.setFillRule(rule);
+            painter.drawPath(path);
+        }
+
+        QImage actual = blank(format);
+        Rasterizer(actual, transform).fill(shape, rule, color);
+        compare(actual, expected);
+    }
+
+    static void check_stroke(const MultiBezier& shape, const QPen& pen, const QTransform& transform = {})
+    {
+        QImage expected = blank();
+        {
+            QPainter painter(&expected);
+            painter.setRenderHint(QPainter::Antialiasing);
+            painter.setTransform(transform);
+            painter.setPen(pen);
+            painter.setBrush(Qt::NoBrush);
+            painter.drawPath(shape.painter_path());
+        }
+
+        QImage actual = blank();
+        Rasterizer(actual, transform).stroke(shape, pen);
+        compare(actual, expected);
+    }
+
+private slots:
+    void test_fill()
+    {
+        MultiBezier rect;
+        rect.move_to({8.5, 10.25});
+        rect.line_to({40.75, 10.25});
+        rect.line_to({40.75, 50.5});
+        rect.line_to({8.5, 50.5});
+        rect.close();
+        check_fill(rect, Qt::WindingFill, QColor(255, 0, 0));
+        check_fill(circle({32, 32}, 20), Qt::WindingFill, QColor(0, 128, 255));
+        check_fill(circle({32, 32}, 20), Qt::WindingFill, QColor(0, 128, 255, 100));
+    }
+
+    void test_fill_rule()
+    {
+        check_fill(star(), Qt::WindingFill, QColor(0, 0, 0));
+        check_fill(star(), Qt::OddEvenFill, QColor(0, 0, 0));
+
+        MultiBezier rings = circle({32, 32}, 24);
+        rings.append(circle({32, 32}, 12));
+        check_fill(rings, Qt::OddEvenFill, QColor(0, 255, 0));
+    }
+
+    void test_fill_transform()
+    {
+        QTransform transform;
+        transform.translate(32, 32).rotate(30).scale(1.5, 0.75).translate(-32, -32);
+        check_fill(star(), Qt::WindingFill, QColor(255, 0, 255), transform);
+        check_fill(circle({32, 32}, 40), Qt::WindingFill, QColor(255, 0, 255), QTransform::fromTranslate(10, -6));
+    }
+
+    void test_fill_formats()
+    {
+        for ( auto format : {QImage::Format_ARGB32, QImage::Format_RGBA8888, QImage::Format_RGBA8888_Premultiplied, QImage::Format_RGB32} )
+            check_fill(circle({32, 32}, 20), Qt::WindingFill, QColor(255, 128, 0, 200), {}, format);
+        QVERIFY(!Rasterizer::supported(blank(QImage::Format_RGB16)));
+    }
+
+    void test_stroke()
+    {
+        for ( auto cap : {Qt::FlatCap, Qt::SquareCap, Qt::RoundCap} )
+        {
+            for ( auto join : {Qt::MiterJoin, Qt::BevelJoin, Qt::RoundJoin} )
+            {
+                QPen pen(QColor(0, 0, 255), 5, Qt::SolidLine, cap, join);
+                // High enough to keep all the sharp corners mitered
+                pen.setMiterLimit(10);
+                check_stroke(zigzag(), pen);
+                check_stroke(star(), pen);
+            }
+        }
+
+        check_stroke(circle({32, 32}, 20), QPen(QColor(0, 0, 0, 128), 8));
+        QTransform transform;
+        transform.translate(32, 32).rotate(-20).scale(0.75, 1.25).translate(-32, -32);
+        check_stroke(zigzag(), QPen(QColor(255, 0, 0), 4, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin), transform);
+    }
+
+    void test_painter_fallback()
+    {
+        QImage image = blank();
+        QPainter painter(&image);
+        painter.setRenderHint(QPainter::Antialiasing);
+        QVERIFY(Rasterizer::fill(&painter, star(), Qt::WindingFill, QColor(255, 0, 0)));
+        QVERIFY(!Rasterizer::fill(&painter, star(), Qt::WindingFill, QLinearGradient(0, 0, 64, 64)));
+        QVERIFY(!Rasterizer::stroke(&painter, star(), QPen(QColor(255, 0, 0), 2, Qt::DashLine)));
+
+        painter.setClipRect(0, 0, 32, 32);
+        QVERIFY(!Rasterizer::fill(&painter, star(), Qt::WindingFill, QColor(255, 0, 0)));
+    }
+
+    void test_document()
+    {
+        model::Document doc("foo");
+        auto comp = doc.assets()->compositions->values.insert(std::make_unique<model::Composition>(&doc));
+        comp->width.set(64);
+        comp->height.set(64);
+        auto layer = static_cast<model::Layer*>(comp->shapes.insert(std::make_unique<model::Layer>(&doc)));
+        layer->opacity.set(0.75);
+        auto fill = static_cast<model::Fill*>(layer->shapes.insert(std::make_unique<model::Fill>(&doc)));
+        fill->color.set(QColor(255, 0, 0));
+        auto stroke = static_cast<model::Stroke*>(layer->shapes.insert(std::make_unique<model::Stroke>(&doc)));
+        stroke->color.set(QColor(0, 0, 255));
+        stroke->width.set(4);
+        auto ellipse = static_cast<model::Ellipse*>(layer->shapes.insert(std::make_unique<model::Ellipse>(&doc)));
+        ellipse->position.set(QPointF(30, 34));
+        ellipse->size.set(QSizeF(40, 24));
+
+        QImage expected = comp->render_image(0, QSize(128, 128));
+        doc.set_direct_rasterization(true);
+        compare(comp->render_image(0, QSize(128, 128)), expected);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestCase)
+#include "test_rasterizer.moc"
@@ -0,0 +1,284 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <QtTest/QtTest>
+
+#include "model/document.hpp"
+#include "model/precomp_render_cache.hpp"
+#include "model/static_render_cache.hpp"
+#include "model/assets/assets.hpp"
+#include "model/assets/named_color.hpp"
+#include "model/shapes/fill.hpp"
+#include "model/shapes/layer.hpp"
+#include "model/shapes/precomp_layer.hpp"
+#include "model/shapes/rect.hpp"
+
+using namespace glaxnimate;
+
+
+class TestCase: public QObject
+{
+    Q_OBJECT
+
+private:
+    static model::Composition* add_comp(model::Document& doc)
+    {
+        auto comp = doc.assets()->compositions->values.insert(std::make_unique<model::Composition>(&doc));
+        comp->width.set(64);
+        comp->height.set(64);
+        return comp;
+    }
+
+    static model::PreCompLayer* add_precomp(model::Composition* parent, model::Composition* child)
+    {
+        auto layer = static_cast<model::PreCompLayer*>(parent->shapes.insert(std::make_unique<model::PreCompLayer>(parent->document())));
+        layer->composition.set(child);
+        layer->size.set(QSizeF(64, 64));
+        return layer;
+    }
+
+    /**
+     * \brief Adds a group with a square of \p size centered on \p pos
+     */
+    static model::Group* add_group(model::Composition* comp, const QPointF& pos, qreal size, model::Fill** fill = nullptr, model::Rect** rect = nullptr)
+    {
+        auto doc = comp->document();
+        auto group = static_cast<model::Group*>(comp->shapes.insert(std::make_unique<model::Group>(doc)));
+        auto group_fill = static_cast<model::Fill*>(group->shapes.insert(std::make_unique<model::Fill>(doc)));
+        group_fill->color.set(QColor(255, 0, 0));
+        auto group_rect = static_cast<model::Rect*>(group->shapes.insert(std::make_unique<model::Rect>(doc)));
+        group_rect->position.set(pos);
+        group_rect->size.set(QSizeF(size, size));
+        if ( fill )
+            *fill = group_fill;
+        if ( rect )
+            *rect = group_rect;
+        return group;
+    }
+
+private slots:
+    void test_precomp_hit()
+    {
+        model::Document doc("foo");
+        auto inner = add_comp(doc);
+        auto layer = static_cast<model::Layer*>(inner->shapes.insert(std::make_unique<model::Layer>(&doc)));
+        static_cast<model::Fill*>(layer->shapes.insert(std::make_unique<model::Fill>(&doc)))->color.set(QColor(255, 0, 0));
+        auto rect = static_cast<model::Rect*>(layer->shapes.insert(std::make_unique<model::Rect>(&doc)));
+        rect->position.set(QPointF(32, 32));
+        rect->size.set(QSizeF(32, 32));
+
+        auto& cache = doc.precomp_cache();
+        cache.set_enabled(true);
+        QImage first = cache.image(inner, 0, QSizeF(64, 64), 1, 1, model::VisualNode::Render);
+        QCOMPARE(cache.size(), 1);
+        QImage second = cache.image(inner, 0, QSizeF(64, 64), 1, 1, model::VisualNode::Render);
+        QCOMPARE(cache.size(), 1);
+        QCOMPARE(second.cacheKey(), first.cacheKey());
+
+        cache.image(inner, 0, QSizeF(64, 64), 2, 2, model::VisualNode::Render);
+        QCOMPARE(cache.size(), 2);
+
+        rect->size.set(QSizeF(16, 16));
+        QCOMPARE(cache.size(), 0);
+        QImage edited = cache.image(inner, 0, QSizeF(64, 64), 1, 1, model::VisualNode::Render);
+        QVERIFY(edited.cacheKey() != first.cacheKey());
+        QVERIFY(edited != first);
+    }
+
+    void test_precomp_nested_invalidation()
+    {
+        model::Document doc("foo");
+        auto main = add_comp(doc);
+        auto middle = add_comp(doc);
+        auto inner = add_comp(doc);
+        add_precomp(main, middle);
+        add_precomp(middle, inner);
+        auto layer = static_cast<model::Layer*>(inner->shapes.insert(std::make_unique<model::Layer>(&doc)));
+        static_cast<model::Fill*>(layer->shapes.insert(std::make_unique<model::Fill>(&doc)))->color.set(QColor(255, 0, 0));
+        auto rect = static_cast<model::Rect*>(layer->shapes.insert(std::make_unique<model::Rect>(&doc)));
+        rect->position.set(QPointF(32, 32));
+        rect->size.set(QSizeF(32, 32));
+
+        doc.precomp_cache().set_enabled(true);
+        QImage before = main->render_image(0);
+        QVERIFY(doc.precomp_cache().size() > 0);
+        QCOMPARE(main->render_image(0), before);
+
+        // Deep edit inside the innermost composition
+        rect->position.set(QPointF(16, 16));
+        QCOMPARE(doc.precomp_cache().size(), 0);
+        QImage after = main->render_image(0);
+        QVERIFY(after != before);
+
+        doc.precomp_cache().set_enabled(false);
+        QCOMPARE(main->render_image(0), after);
+    }
+
+    void test_precomp_asset_invalidation()
+    {
+        model::Document doc("foo");
+        auto main = add_comp(doc);
+        auto inner = add_comp(doc);
+        add_precomp(main, inner);
+        auto color = doc.assets()->colors->values.insert(std::make_unique<model::NamedColor>(&doc));
+        color->color.set(QColor(255, 0, 0));
+        auto layer = static_cast<model::Layer*>(inner->shapes.insert(std::make_unique<model::Layer>(&doc)));
+        static_cast<model::Fill*>(layer->shapes.insert(std::make_unique<model::Fill>(&doc)))->use.set(color);
+        auto rect = static_cast<model::Rect*>(layer->shapes.insert(std::make_unique<model::Rect>(&doc)));
+        rect->position.set(QPointF(32, 32));
+        rect->size.set(QSizeF(32, 32));
+
+        doc.precomp_cache().set_enabled(true);
+        QImage before = main->render_image(0);
+        QVERIFY(doc.precomp_cache().size() > 0);
+
+        color->color.set(QColor(0, 0, 255));
+        QCOMPARE(doc.precomp_cache().size(), 0);
+        QImage after = main->render_image(0);
+        QCOMPARE(after.pixelColor(32, 32), QColor(0, 0, 255));
+
+        doc.precomp_cache().set_enabled(false);
+        QCOMPARE(main->render_image(0), after);
+    }
+
+    void test_precomp_keyframe_invalidation()
+    {
+        model::Document doc("foo");
+        auto main = add_comp(doc);
+        auto inner = add_comp(doc);
+        add_precomp(main, inner);
+        auto layer = static_cast<model::Layer*>(inner->shapes.insert(std::make_unique<model::Layer>(&doc)));
+        static_cast<model::Fill*>(layer->shapes.insert(std::make_unique<model::Fill>(&doc)))->color.set(QColor(255, 0, 0));
+        auto rect = static_cast<model::Rect*>(layer->shapes.insert(std::make_unique<model::Rect>(&doc)));
+        rect->size.set(QSizeF(16, 16));
+        rect->position.set_keyframe(0, QPointF(16, 16));
+        rect->position.set_keyframe(10, QPointF(48, 16));
+
+        doc.precomp_cache().set_enabled(true);
+        main->render_image(0);
+        QImage before = main->render_image(10);
+        QCOMPARE(before.pixelColor(48, 16), QColor(255, 0, 0));
+        QVERIFY(doc.precomp_cache().size() > 0);
+
+        // Keyframe away from the current time, the current value doesn't change
+        rect->position.set_keyframe(10, QPointF(48, 48));
+        QCOMPARE(rect->position.get(), QPointF(16, 16));
+        QCOMPARE(doc.precomp_cache().size(), 0);
+        QImage after = main->render_image(10);
+        QCOMPARE(after.pixelColor(48, 16).alpha(), 0);
+        QCOMPARE(after.pixelColor(48, 48), QColor(255, 0, 0));
+
+        // Transition changes
+        main->render_image(5);
+        QVERIFY(doc.precomp_cache().size() > 0);
+        rect->position.set_keyframe_transition(0, model::KeyframeTransition(model::KeyframeTransition::Hold));
+        QCOMPARE(doc.precomp_cache().size(), 0);
+        QCOMPARE(main->render_image(5).pixelColor(16, 16), QColor(255, 0, 0));
+
+        doc.precomp_cache().set_enabled(false);
+        QCOMPARE(main->render_image(10), after);
+    }
+
+    void test_static_classification()
+    {
+        model::Document doc("foo");
+        auto comp = add_comp(doc);
+        auto still = add_group(comp, QPointF(16, 16), 16);
+        model::Rect* moving_rect;
+        auto moving = add_group(comp, QPointF(48, 16), 16, nullptr, &moving_rect);
+        moving_rect->position.set_keyframe(0, QPointF(48, 16));
+        moving_rect->position.set_keyframe(10, QPointF(48, 48));
+
+        QVERIFY(still->docnode_time_invariant());
+        QVERIFY(!moving->docnode_time_invariant());
+
+        auto& cache = doc.static_render_cache();
+        cache.set_enabled(true);
+        QImage image = comp->render_image(10);
+        // Only the static group is cached
+        QCOMPARE(cache.size(), 1);
+        QCOMPARE(image.pixelColor(16, 16), QColor(255, 0, 0));
+        QCOMPARE(image.pixelColor(48, 48), QColor(255, 0, 0));
+
+        // Same image for every frame
+        comp->render_image(0);
+        QCOMPARE(cache.size(), 1);
+
+        // Animating the static group turns it dynamic
+        still->opacity.set_keyframe(0, 1);
+        still->opacity.set_keyframe(10, 0);
+        QVERIFY(!still->docnode_time_invariant());
+        QCOMPARE(cache.size(), 0);
+        image = comp->render_image(10);
+        QCOMPARE(cache.size(), 0);
+        QCOMPARE(image.pixelColor(16, 16).alpha(), 0);
+    }
+
+    void test_static_invalidation()
+    {
+        model::Document doc("foo");
+        auto comp = add_comp(doc);
+        model::Fill* fill;
+        model::Rect* rect;
+        add_group(comp, QPointF(32, 32), 32, &fill, &rect);
+
+        auto& cache = doc.static_render_cache();
+        cache.set_enabled(true);
+        comp->render_image(0);
+        QCOMPARE(cache.size(), 1);
+
+        // Changes that don't affect the bounding box
+        fill->color.set(QColor(0, 255, 0));
+        QCOMPARE(cache.size(), 0);
+        QCOMPARE(comp->render_image(0).pixelColor(32, 32), QColor(0, 255, 0));
+        QCOMPARE(cache.size(), 1);
+
+        fill->opacity.set(0);
+        QCOMPARE(cache.size(), 0);
+        QCOMPARE(comp->render_image(0).pixelColor(32, 32).alpha(), 0);
+        fill->opacity.set(1);
+
+        rect->size.set(QSizeF(16, 16));
+        QCOMPARE(cache.size(), 0);
+        QCOMPARE(comp->render_image(0).pixelColor(20, 20).alpha(), 0);
+
+        // Referenced assets
+        auto color = doc.assets()->colors->values.insert(std::make_unique<model::NamedColor>(&doc));
+        color->color.set(QColor(0, 0, 255));
+        fill->use.set(color);
+        QCOMPARE(comp->render_image(0).pixelColor(32, 32), QColor(0, 0, 255));
+        QCOMPARE(cache.size(), 1);
+        color->color.set(QColor(255, 255, 0));
+        QCOMPARE(cache.size(), 0);
+        QCOMPARE(comp->render_image(0).pixelColor(32, 32), QColor(255, 255, 0));
+    }
+
+    void test_static_precomp_invalidation()
+    {
+        model::Document doc("foo");
+        auto main = add_comp(doc);
+        auto inner = add_comp(doc);
+        model::Fill* fill;
+        add_group(inner, QPointF(32, 32), 32, &fill);
+        auto group = static_cast<model::Group*>(main->shapes.insert(std::make_unique<model::Group>(&doc)));
+        auto layer = static_cast<model::PreCompLayer*>(group->shapes.insert(std::make_unique<model::PreCompLayer>(&doc)));
+        layer->composition.set(inner);
+        layer->size.set(QSizeF(64, 64));
+
+        auto& cache = doc.static_render_cache();
+        cache.set_enabled(true);
+        QCOMPARE(main->render_image(0).pixelColor(32, 32), QColor(255, 0, 0));
+        QCOMPARE(cache.size(), 1);
+
+        // The group in main shows inner through the precomp layer
+        fill->color.set(QColor(0, 255, 0));
+        QCOMPARE(cache.size(), 0);
+        QCOMPARE(main->render_image(0).pixelColor(32, 32), QColor(0, 255, 0));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestCase)
+#include "test_render_cache.moc"
@@ -0,0 +1,131 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <QtTest/QtTest>
+
+#include "model/document.hpp"
+#include "model/render_program.hpp"
+#include "model/assets/assets.hpp"
+#include "model/shapes/ellipse.hpp"
+#include "model/shapes/fill.hpp"
+#include "model/shapes/layer.hpp"
+#include "model/shapes/rect.hpp"
+#include "model/shapes/stroke.hpp"
+
+using namespace glaxnimate;
+
+
+class TestCase: public QObject
+{
+    Q_OBJECT
+
+private:
+    struct Scene
+    {
+        model::Document doc{"foo"};
+        model::Composition* comp;
+        model::Layer* layer;
+        model::Rect* rect;
+        model::Group* group;
+
+        Scene()
+        {
+            comp = doc.assets()->compositions->values.insert(std::make_unique<model::Composition>(&doc));
+            comp->width.set(64);
+            comp->height.set(64);
+            comp->animation->last_frame.set(20);
+
+            layer = static_cast<model::Layer*>(comp->shapes.insert(std::make_unique<model::Layer>(&doc)));
+            layer->animation->last_frame.set(15);
+            auto fill = static_cast<model::Fill*>(layer->shapes.insert(std::make_unique<model::Fill>(&doc)));
+            fill->color.set(QColor(255, 0, 0));
+            rect = static_cast<model::Rect*>(layer->shapes.insert(std::make_unique<model::Rect>(&doc)));
+            rect->position.set(QPointF(16, 16));
+            rect->size.set(QSizeF(16, 16));
+
+            group = static_cast<model::Group*>(comp->shapes.insert(std::make_unique<model::Group>(&doc)));
+            group->opacity.set(0.5);
+            auto stroke = static_cast<model::Stroke*>(group->shapes.insert(std::make_unique<model::Stroke>(&doc)));
+            stroke->color.set(QColor(0, 0, 255));
+            stroke->width.set(4);
+            auto ellipse = static_cast<model::Ellipse*>(group->shapes.insert(std::make_unique<model::Ellipse>(&doc)));
+            ellipse->position.set(QPointF(10, 10));
+            ellipse->size.set(QSizeF(12, 12));
+            group->transform->position.set_keyframe(0, QPointF(0, 0));
+            group->transform->position.set_keyframe(10, QPointF(40, 40));
+        }
+    };
+
+private slots:
+    void test_matches_paint()
+    {
+        Scene scene;
+        model::RenderProgram program(scene.comp);
+
+        for ( model::FrameTime t : {0., 5., 10., 17.} )
+            QCOMPARE(program.render_image(t), scene.comp->render_image(t));
+    }
+
+    void test_parallel()
+    {
+        Scene scene;
+        // More top-level nodes with animated paths
+        for ( int i = 0; i < 4; i++ )
+        {
+            auto layer = static_cast<model::Layer*>(scene.comp->shapes.insert(std::make_unique<model::Layer>(&scene.doc)));
+            auto fill = static_cast<model::Fill*>(layer->shapes.insert(std::make_unique<model::Fill>(&scene.doc)));
+            fill->color.set(QColor(0, 255, 0));
+            auto rect = static_cast<model::Rect*>(layer->shapes.insert(std::make_unique<model::Rect>(&scene.doc)));
+            rect->position.set_keyframe(0, QPointF(8 + i * 12, 8));
+            rect->position.set_keyframe(20, QPointF(8 + i * 12, 56));
+            rect->size.set(QSizeF(8, 8));
+        }
+
+        model::RenderProgram serial(scene.comp);
+        model::RenderProgram parallel(scene.comp);
+        parallel.set_parallel(true);
+        QVERIFY(parallel.parallel());
+
+        for ( model::FrameTime t : {0., 5., 10., 17.} )
+        {
+            QImage expected = scene.comp->render_image(t);
+            QCOMPARE(serial.render_image(t), expected);
+            QCOMPARE(parallel.render_image(t), expected);
+        }
+    }
+
+    void test_dynamic_slots()
+    {
+        Scene scene;
+        model::RenderProgram program(scene.comp);
+        // Layer time and group transform
+        QCOMPARE(program.dynamic_slots(), 2);
+
+        scene.rect->size.set_keyframe(0, QSizeF(16, 16));
+        scene.rect->size.set_keyframe(10, QSizeF(8, 8));
+        program.compile();
+        // Plus the fill path
+        QCOMPARE(program.dynamic_slots(), 3);
+        QCOMPARE(program.render_image(5), scene.comp->render_image(5));
+    }
+
+    void test_outdated()
+    {
+        Scene scene;
+        model::RenderProgram program(scene.comp);
+        QVERIFY(!program.outdated());
+
+        scene.rect->size.set_undoable(QSizeF(20, 20));
+        QVERIFY(program.outdated());
+
+        program.compile();
+        QVERIFY(!program.outdated());
+        QCOMPARE(program.render_image(0), scene.comp->render_image(0));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestCase)
+#include "test_render_program.moc"
@@ -0,0 +1,94 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <QtTest/QtTest>
+
+#include "model/document.hpp"
+#include "model/assets/assets.hpp"
+#include "model/shapes/fill.hpp"
+#include "model/shapes/layer.hpp"
+#include "model/shapes/rect.hpp"
+#include "model/shapes/repeater.hpp"
+#include "model/shapes/stroke.hpp"
+
+using namespace glaxnimate;
+
+
+class TestCase: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void test_render()
+    {
+        model::Document doc("foo");
+        auto comp = doc.assets()->compositions->values.insert(std::make_unique<model::Composition>(&doc));
+        comp->width.set(64);
+        comp->height.set(64);
+
+        auto layer = static_cast<model::Layer*>(comp->shapes.insert(std::make_unique<model::Layer>(&doc)));
+        auto repeater = static_cast<model::Repeater*>(layer->shapes.insert(std::make_unique<model::Repeater>(&doc)));
+        repeater->copies.set(4);
+        repeater->end_opacity.set(0.5);
+        repeater->transform->position.set(QPointF(16, 0));
+        auto fill = static_cast<model::Fill*>(layer->shapes.insert(std::make_unique<model::Fill>(&doc)));
+        fill->color.set(QColor(255, 0, 0));
+        auto rect = static_cast<model::Rect*>(layer->shapes.insert(std::make_unique<model::Rect>(&doc)));
+        rect->position.set(QPointF(4, 4));
+        rect->size.set(QSizeF(8, 8));
+
+        QImage image = comp->render_image(0);
+        QCOMPARE(image.pixelColor(4, 4), QColor(255, 0, 0));
+        QVERIFY(qAbs(image.pixelColor(52, 4).alpha() - 128) <= 1);
+        QCOMPARE(image.pixelColor(7, 7), QColor(255, 0, 0));
+
+        // The cached instances are updated when the shapes change
+        rect->size.set(QSizeF(4, 4));
+        image = comp->render_image(0);
+        QCOMPARE(image.pixelColor(4, 4), QColor(255, 0, 0));
+        QCOMPARE(image.pixelColor(7, 7).alpha(), 0);
+    }
+
+    void test_direct_rasterization()
+    {
+        model::Document doc("foo");
+        auto comp = doc.assets()->compositions->values.insert(std::make_unique<model::Composition>(&doc));
+        comp->width.set(64);
+        comp->height.set(64);
+
+        auto layer = static_cast<model::Layer*>(comp->shapes.insert(std::make_unique<model::Layer>(&doc)));
+        auto repeater = static_cast<model::Repeater*>(layer->shapes.insert(std::make_unique<model::Repeater>(&doc)));
+        repeater->copies.set(3);
+        repeater->end_opacity.set(0.5);
+        repeater->transform->position.set(QPointF(20, 0));
+        auto fill = static_cast<model::Fill*>(layer->shapes.insert(std::make_unique<model::Fill>(&doc)));
+        fill->color.set(QColor(255, 0, 0));
+        auto stroke = static_cast<model::Stroke*>(layer->shapes.insert(std::make_unique<model::Stroke>(&doc)));
+        stroke->color.set(QColor(0, 0, 255));
+        stroke->width.set(2);
+        auto rect = static_cast<model::Rect*>(layer->shapes.insert(std::make_unique<model::Rect>(&doc)));
+        rect->position.set(QPointF(10, 32));
+        rect->size.set(QSizeF(12, 12));
+
+        QImage expected = comp->render_image(0);
+        doc.set_direct_rasterization(true);
+        QImage actual = comp->render_image(0);
+
+        // Same coverage as QPainter, anti-aliasing of the edges can differ slightly
+        for ( QPoint pos : {QPoint(10, 32), QPoint(30, 32), QPoint(50, 32), QPoint(10, 26), QPoint(30, 26), QPoint(60, 10)} )
+        {
+            QColor a = actual.pixelColor(pos);
+            QColor b = expected.pixelColor(pos);
+            QVERIFY2(
+                qAbs(a.red() - b.red()) <= 2 && qAbs(a.blue() - b.blue()) <= 2 && qAbs(a.alpha() - b.alpha()) <= 2,
+                qPrintable(QString("%1,%2: %3 != %4").arg(pos.x()).arg(pos.y()).arg(a.name(QColor::HexArgb)).arg(b.name(QColor::HexArgb)))
+            );
+        }
+    }
+};
+
+QTEST_GUILESS_MAIN(TestCase)
+#include "test_repeater.moc"
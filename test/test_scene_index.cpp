@@ -0,0 +1,213 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>
+#include <numeric>
+
+#include <QtTest/QtTest>
+#include <QRandomGenerator>
+
+#include "graphics/document_node_graphics_item.hpp"
+#include "graphics/scene_index.hpp"
+#include "model/document.hpp"
+#include "model/assets/assets.hpp"
+#include "model/shapes/rect.hpp"
+
+using namespace glaxnimate;
+using gui::graphics::DocumentNodeGraphicsItem;
+
+
+class TestCase: public QObject
+{
+    Q_OBJECT
+
+private:
+    struct Item
+    {
+        model::Rect* rect;
+        std::unique_ptr<DocumentNodeGraphicsItem> item;
+    };
+
+    static QRectF random_rect(QRandomGenerator& random, qreal max_size)
+    {
+        return QRectF(
+            random.bounded(512.0),
+            random.bounded(512.0),
+            random.bounded(max_size),
+            random.bounded(max_size)
+        );
+    }
+
+    static void set_rect(model::Rect* rect, const QRectF& bounds)
+    {
+        rect->position.set(bounds.center());
+        rect->size.set(bounds.size());
+    }
+
+    static Item add_item(model::Composition* comp, const QRectF& bounds, qreal z)
+    {
+        auto rect = static_cast<model::Rect*>(comp->shapes.insert(std::make_unique<model::Rect>(comp->document())));
+        set_rect(rect, bounds);
+        auto item = std::make_unique<DocumentNodeGraphicsItem>(rect);
+        item->setZValue(z);
+        return {rect, std::move(item)};
+    }
+
+    /**
+     * \brief Items intersecting \p query found by going through all of them, topmost first
+     */
+    static std::vector<DocumentNodeGraphicsItem*> brute_force(const std::vector<Item>& items, const QRectF& query)
+    {
+        std::vector<DocumentNodeGraphicsItem*> found;
+        for ( const auto& item : items )
+        {
+            QRectF rect = item.item->sceneBoundingRect();
+            if ( rect.left() <= query.right() && query.left() <= rect.right() &&
+                 rect.top() <= query.bottom() && query.top() <= rect.bottom() )
+                found.push_back(item.item.get());
+        }
+
+        std::stable_sort(found.begin(), found.end(), [](DocumentNodeGraphicsItem* a, DocumentNodeGraphicsItem* b){
+            return a->zValue() > b->zValue();
+        });
+        return found;
+    }
+
+    static void compare_queries(gui::graphics::SceneIndex& index, const std::vector<Item>& items, QRandomGenerator& random)
+    {
+        for ( int i = 0; i < 50; i++ )
+        {
+            QRectF point(QPointF(random.bounded(512.0), random.bounded(512.0)), QSizeF(0, 0));
+            QCOMPARE(index.candidates(point), brute_force(items, point));
+
+            QRectF rect = random_rect(random, 128);
+            QCOMPARE(index.candidates(rect), brute_force(items, rect));
+        }
+    }
+
+private slots:
+    void test_insert()
+    {
+        model::Document doc("foo");
+        auto comp = doc.assets()->compositions->values.insert(std::make_unique<model::Composition>(&doc));
+        QRandomGenerator random(1);
+        gui::graphics::SceneIndex index;
+        std::vector<Item> items;
+
+        QVERIFY(index.candidates(QRectF(0, 0, 512, 512)).empty());
+
+        for ( int i = 0; i < 200; i++ )
+        {
+            items.push_back(add_item(comp, random_rect(random, 64), i));
+            index.add(items.back().item.get());
+        }
+        compare_queries(index, items, random);
+
+        // Adding after the tree has been built
+        for ( int i = 200; i < 250; i++ )
+        {
+            items.push_back(add_item(comp, random_rect(random, 64), i));
+            index.add(items.back().item.get());
+        }
+        compare_queries(index, items, random);
+    }
+
+    void test_remove()
+    {
+        model::Document doc("foo");
+        auto comp = doc.assets()->compositions->values.insert(std::make_unique<model::Composition>(&doc));
+        QRandomGenerator random(2);
+        gui::graphics::SceneIndex index;
+        std::vector<Item> items;
+
+        for ( int i = 0; i < 200; i++ )
+        {
+            items.push_back(add_item(comp, random_rect(random, 64), i));
+            index.add(items.back().item.get());
+        }
+        compare_queries(index, items, random);
+
+        for ( int i = 0; i < 100; i++ )
+        {
+            int removed = random.bounded(int(items.size()));
+            index.remove(items[removed].item.get());
+            items.erase(items.begin() + removed);
+        }
+        compare_queries(index, items, random);
+
+        index.clear();
+        items.clear();
+        QVERIFY(index.candidates(QRectF(0, 0, 512, 512)).empty());
+    }
+
+    void test_update()
+    {
+        model::Document doc("foo");
+        auto comp = doc.assets()->compositions->values.insert(std::make_unique<model::Composition>(&doc));
+        QRandomGenerator random(3);
+        gui::graphics::SceneIndex index;
+        std::vector<Item> items;
+
+        for ( int i = 0; i < 200; i++ )
+        {
+            items.push_back(add_item(comp, random_rect(random, 64), i));
+            index.add(items.back().item.get());
+        }
+        compare_queries(index, items, random);
+
+        // Moving items only refits the tree
+        for ( int i = 0; i < 50; i++ )
+        {
+            auto& item = items[random.bounded(int(items.size()))];
+            set_rect(item.rect, random_rect(random, 128));
+            index.invalidate(item.item.get());
+        }
+        compare_queries(index, items, random);
+
+        // Same for changes in the item transform
+        for ( int i = 0; i < 20; i++ )
+        {
+            auto& item = items[random.bounded(int(items.size()))];
+            item.item->setPos(random.bounded(64.0), random.bounded(64.0));
+            index.invalidate(item.item.get());
+        }
+        compare_queries(index, items, random);
+
+        // Stacking order
+        std::vector<int> z_values(items.size());
+        std::iota(z_values.begin(), z_values.end(), 0);
+        std::shuffle(z_values.begin(), z_values.end(), random);
+        for ( int i = 0; i < int(items.size()); i++ )
+            items[i].item->setZValue(z_values[i]);
+        index.invalidate_order();
+        compare_queries(index, items, random);
+    }
+
+    void test_degenerate()
+    {
+        model::Document doc("foo");
+        auto comp = doc.assets()->compositions->values.insert(std::make_unique<model::Composition>(&doc));
+        gui::graphics::SceneIndex index;
+        std::vector<Item> items;
+
+        // Horizontal and vertical lines
+        items.push_back(add_item(comp, QRectF(10, 20, 100, 0), 0));
+        items.push_back(add_item(comp, QRectF(50, 0, 0, 100), 1));
+        for ( const auto& item : items )
+            index.add(item.item.get());
+
+        auto found = index.candidates(QRectF(QPointF(50, 20), QSizeF(0, 0)));
+        QCOMPARE(int(found.size()), 2);
+        QCOMPARE(found[0], items[1].item.get());
+        QCOMPARE(found[1], items[0].item.get());
+
+        QCOMPARE(int(index.candidates(QRectF(QPointF(30, 20), QSizeF(0, 0))).size()), 1);
+        QVERIFY(index.candidates(QRectF(QPointF(30, 30), QSizeF(0, 0))).empty());
+    }
+};
+
+QTEST_GUILESS_MAIN(TestCase)
+#include "test_scene_index.moc"
@@ -0,0 +1,187 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <QtTest/QtTest>
+
+#include "command/animation_commands.hpp"
+#include "command/property_commands.hpp"
+#include "command/spill_store.hpp"
+#include "model/document.hpp"
+#include "model/assets/assets.hpp"
+#include "model/shapes/layer.hpp"
+#include "model/shapes/path.hpp"
+
+using namespace glaxnimate;
+
+
+class TestCase: public QObject
+{
+    Q_OBJECT
+
+private:
+    static QString value(int i)
+    {
+        return QString(1000, QChar('a' + i));
+    }
+
+    static math::bezier::Bezier bezier(int i)
+    {
+        math::bezier::Bezier bez;
+        for ( int j = 0; j < 100; j++ )
+            bez.add_point(QPointF(i, j));
+        return bez;
+    }
+
+private slots:
+    void test_spill_restore()
+    {
+        model::Document document("");
+        auto comp = document.assets()->compositions->values.insert(std::make_unique<model::Composition>(&document));
+        auto layer = static_cast<model::Layer*>(comp->shapes.insert(std::make_unique<model::Layer>(&document)));
+        layer->name.set(value(0));
+
+        auto& stack = document.undo_stack();
+        auto& store = document.undo_spill_store();
+        store.set_budget(5000);
+
+        for ( int i = 1; i <= 4; i++ )
+            stack.push(new command::SetPropertyValue(&layer->name, value(i)));
+
+        QCOMPARE(layer->name.get(), value(4));
+        QVERIFY(store.memory_usage() <= store.budget());
+        QVERIFY(command::SpillStore::spilled_size(stack.command(0)) > 0);
+        QCOMPARE(command::SpillStore::memory_usage(stack.command(0)), qint64(0));
+        // The next command to undo is kept in memory
+        QVERIFY(command::SpillStore::spilled_size(stack.command(3)) == 0);
+        QVERIFY(command::SpillStore::memory_usage(stack.command(3)) > 0);
+
+        for ( int i = 3; i >= 0; i-- )
+        {
+            stack.undo();
+            QCOMPARE(layer->name.get(), value(i));
+        }
+
+        for ( int i = 1; i <= 4; i++ )
+        {
+            stack.redo();
+            QCOMPARE(layer->name.get(), value(i));
+        }
+    }
+
+    void test_spill_animated()
+    {
+        model::Document document("");
+        auto comp = document.assets()->compositions->values.insert(std::make_unique<model::Composition>(&document));
+        auto path = static_cast<model::Path*>(comp->shapes.insert(std::make_unique<model::Path>(&document)));
+        path->shape.set(bezier(0));
+
+        auto& stack = document.undo_stack();
+        auto& store = document.undo_spill_store();
+        store.set_budget(qint64(sizeof(math::bezier::Point)) * 100 * 5);
+
+        for ( int i = 1; i <= 4; i++ )
+            stack.push(new command::SetMultipleAnimated(&path->shape, QVariant::fromValue(bezier(i)), true));
+
+        QCOMPARE(path->shape.get().size(), 100);
+        QCOMPARE(path->shape.get()[0].pos, QPointF(4, 0));
+        QVERIFY(store.memory_usage() <= store.budget());
+        QVERIFY(command::SpillStore::spilled_size(stack.command(0)) > 0);
+
+        for ( int i = 3; i >= 0; i-- )
+        {
+            stack.undo();
+            QCOMPARE(path->shape.get()[0].pos, QPointF(i, 0));
+        }
+
+        for ( int i = 1; i <= 4; i++ )
+        {
+            stack.redo();
+            QCOMPARE(path->shape.get()[0].pos, QPointF(i, 0));
+        }
+    }
+
+    void test_reuse_file()
+    {
+        model::Document document("");
+        auto comp = document.assets()->compositions->values.insert(std::make_unique<model::Composition>(&document));
+        auto layer = static_cast<model::Layer*>(comp->shapes.insert(std::make_unique<model::Layer>(&document)));
+        layer->name.set(value(0));
+
+        auto& stack = document.undo_stack();
+        auto& store = document.undo_spill_store();
+        store.set_budget(5000);
+
+        for ( int i = 1; i <= 4; i++ )
+            stack.push(new command::SetPropertyValue(&layer->name, value(i)));
+
+        qint64 file_size = QFileInfo(store.file_name()).size();
+        QVERIFY(file_size > 0);
+
+        // Each step restores a command and spills another one
+        for ( int cycle = 0; cycle < 10; cycle++ )
+        {
+            while ( stack.canUndo() )
+                stack.undo();
+            while ( stack.canRedo() )
+                stack.redo();
+        }
+
+        QCOMPARE(layer->name.get(), value(4));
+        QVERIFY(QFileInfo(store.file_name()).size() <= 2 * file_size);
+    }
+
+    void test_read_failure()
+    {
+        model::Document document("");
+        auto comp = document.assets()->compositions->values.insert(std::make_unique<model::Composition>(&document));
+        auto layer = static_cast<model::Layer*>(comp->shapes.insert(std::make_unique<model::Layer>(&document)));
+        layer->name.set(value(0));
+
+        auto& stack = document.undo_stack();
+        auto& store = document.undo_spill_store();
+        QStringList errors;
+        store.set_error_handler([&errors](const QString& message){ errors.push_back(message); });
+        store.set_budget(5000);
+
+        for ( int i = 1; i <= 4; i++ )
+            stack.push(new command::SetPropertyValue(&layer->name, value(i)));
+
+        stack.undo();
+        QCOMPARE(layer->name.get(), value(3));
+        QVERIFY(errors.empty());
+
+        QVERIFY(command::SpillStore::spilled_size(stack.command(2)) > 0);
+        QVERIFY(QFile::resize(store.file_name(), 0));
+
+        // The data is lost, undo does nothing and the history is discarded
+        stack.undo();
+        QCOMPARE(layer->name.get(), value(3));
+        QCOMPARE(errors.size(), 1);
+        QTRY_COMPARE(stack.count(), 0);
+        QCOMPARE(store.memory_usage(), qint64(0));
+
+        // New commands work as usual
+        stack.push(new command::SetPropertyValue(&layer->name, value(5)));
+        stack.undo();
+        QCOMPARE(layer->name.get(), value(3));
+    }
+
+    void test_no_budget()
+    {
+        model::Document document("");
+        auto comp = document.assets()->compositions->values.insert(std::make_unique<model::Composition>(&document));
+        auto layer = static_cast<model::Layer*>(comp->shapes.insert(std::make_unique<model::Layer>(&document)));
+
+        for ( int i = 1; i <= 4; i++ )
+            document.undo_stack().push(new command::SetPropertyValue(&layer->name, value(i)));
+
+        for ( int i = 0; i < 4; i++ )
+            QCOMPARE(command::SpillStore::spilled_size(document.undo_stack().command(i)), qint64(0));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestCase)
+#include "test_spill_store.moc"
@@ -0,0 +1,206 @@
+/*
+ * SPDX-FileCopyrightText: 2019-2023 Mattia Basaglia <dev@dragon.best>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <QtTest/QtTest>
+#include <QBuffer>
+
+#include "io/svg/svg_renderer.hpp"
+#include "model/document.hpp"
+#include "model/assets/assets.hpp"
+#include "model/shapes/ellipse.hpp"
+#include "model/shapes/fill.hpp"
+#include "model/shapes/layer.hpp"
+#include "model/shapes/rect.hpp"
+#include "model/shapes/stroke.hpp"
+
+using namespace glaxnimate;
+
+
+class TestCase: public QObject
+{
+    Q_OBJECT
+
+private:
+    struct Scene
+    {
+        model::Document doc{"foo"};
+        model::Composition* comp;
+        model::Layer* layer;
+        model::Layer* masked;
+        model::Group* group;
+
+        Scene()
+        {
+            comp = doc.assets()->compositions->values.insert(std::make_unique<model::Composition>(&doc));
+            comp->width.set(64);
+            comp->height.set(64);
+            comp->animation->last_frame.set(20);
+
+            layer = static_cast<model::Layer*>(comp->shapes.insert(std::make_unique<model::Layer>(&doc)));
+            layer->animation->last_frame.set(15);
+            auto fill = static_cast<model::Fill*>(layer->shapes.insert(std::make_unique<model::Fill>(&doc)));
+            fill->color.set_keyframe(0, QColor(255, 0, 0));
+            fill->color.set_keyframe(10, QColor(0, 255, 0));
+            auto rect = static_cast<model::Rect*>(layer->shapes.insert(std::make_unique<model::Rect>(&doc)));
+            rect->size.set(QSizeF(16, 16));
+            auto ellipse = static_cast<model::Ellipse*>(layer->shapes.insert(std::make_unique<model::Ellipse>(&doc)));
+            ellipse->size.set(QSizeF(8, 8));
+
+            // Single shape styled, the stroke attributes go on the group
+            group = static_cast<model::Group*>(comp->shapes.insert(std::make_unique<model::Group>(&doc)));
+            group->visible.set(false);
+            auto stroke = static_cast<model::Stroke*>(group->shapes.insert(std::make_unique<model::Stroke>(&doc)));
+            stroke->color.set(QColor(0, 0, 255));
+            stroke->width.set_keyframe(0, 1);
+            stroke->width.set_keyframe(10, 4);
+            group->shapes.insert(std::make_unique<model::Ellipse>(&doc));
+            group->transform->position.set_keyframe(0, QPointF(0, 0));
+            group->transform->position.set_keyframe(10, QPointF(40, 40));
+            group->transform->anchor_point.set(QPointF(4, 4));
+
+            masked = static_cast<model::Layer*>(comp->shapes.insert(std::make_unique<model::Layer>(&doc)));
+            masked->mask->mask.set(model::MaskSettings::Alpha);
+            masked->shapes.insert(std::make_unique<model::Rect>(&doc));
+            auto mask_fill = static_cast<model::Fill*>(masked->shapes.insert(std::make_unique<model::Fill>(&doc)));
+            mask_fill->color.set(QColor(0, 0, 0));
+            masked->shapes.insert(std::make_unique<model::Rect>(&doc));
+        }
+
+        /**
+         * \brief Gives fixed names and ids to the nodes that show up in the output
+         */
+        void set_ids()
+        {
+            set_id(comp, 1);
+            set_id(layer, 2);
+            set_id(layer->shapes[0], 3);
+            set_id(group, 6);
+            set_id(group->shapes[0], 7);
+            set_id(masked, 9);
+            set_id(masked->shapes[1], 11);
+        }
+
+        static void set_id(model::DocumentNode* node, uint index)
+        {
+            node->uuid.set_value(QUuid(index, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0));
+            node->name.set(QString("%1 %2").arg(node->type_name()).arg(index));
+        }
+    };
+
+    static QDomDocument streamed(model::Composition* comp, bool indent)
+    {
+        QByteArray data;
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::WriteOnly);
+        io::svg::SvgRenderer rend(&buffer, io::svg::SMIL, io::svg::CssFontType::FontFace, indent);
+        rend.write_main(comp);
+        rend.close();
+
+        QDomDocument dom;
+        dom.setContent(data);
+        return dom;
+    }
+
+    static QMap<QString, QString> attributes(const QDomElement& element)
+    {
+        QMap<QString, QString> attrs;
+        auto map = element.attributes();
+        for ( int i = 0; i < map.count(); i++ )
+        {
+            auto attr = map.item(i).toAttr();
+            attrs[attr.name()] = attr.value();
+        }
+        return attrs;
+    }
+
+    // Attribute order isn't preserved by QDomDocument so we compare element by element
+    static void compare_elements(const QDomElement& actual, const QDomElement& expected)
+    {
+        QCOMPARE(actual.tagName(), expected.tagName());
+        QCOMPARE(attributes(actual), attributes(expected));
+
+        auto actual_children = actual.childNodes();
+        auto expected_children = expected.childNodes();
+        QCOMPARE(actual_children.count(), expected_children.count());
+        for ( int i = 0; i < expected_children.count(); i++ )
+        {
+            auto expected_child = expected_children.at(i);
+            auto actual_child = actual_children.at(i);
+            QCOMPARE(actual_child.nodeType(), expected_child.nodeType());
+            if ( expected_child.isElement() )
+                compare_elements(actual_child.toElement(), expected_child.toElement());
+            else
+                QCOMPARE(actual_child.nodeValue(), expected_child.nodeValue());
+        }
+    }
+
+private slots:
+    void test_stream_matches_dom()
+    {
+        Scene scene;
+        io::svg::SvgRenderer rend(io::svg::SMIL, io::svg::CssFontType::FontFace);
+        rend.write_main(scene.comp);
+
+        // Round trip the DOM so both sides have been parsed the same way
+        QDomDocument expected;
+        expected.setContent(rend.dom().toByteArray(-1));
+
+        compare_elements(streamed(scene.comp, false).documentElement(), expected.documentElement());
+    }
+
+    void test_golden()
+    {
+        // Output of the DOM based renderer, before streaming was introduced
+        QFile file(QFINDTESTDATA("data/svg_renderer_scene.svg"));
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QDomDocument expected;
+        QVERIFY(expected.setContent(&file));
+
+        Scene scene;
+        scene.set_ids();
+        compare_elements(streamed(scene.comp, true).documentElement(), expected.documentElement());
+
+        io::svg::SvgRenderer rend(io::svg::SMIL, io::svg::CssFontType::FontFace);
+        rend.write_main(scene.comp);
+        QDomDocument dom;
+        dom.setContent(rend.dom().toByteArray(-1));
+        compare_elements(dom.documentElement(), expected.documentElement());
+    }
+
+    void test_stream_structure()
+    {
+        Scene scene;
+        QDomElement svg = streamed(scene.comp, true).documentElement();
+        QCOMPARE(svg.attribute("width"), QString("64"));
+
+        // Masks are written in <defs> before the layers using them
+        QDomElement defs = svg.firstChildElement("defs");
+        QDomElement mask = defs.firstChildElement("mask");
+        QVERIFY(!mask.isNull());
+        QCOMPARE(mask.attribute("id"), "clip_Layer_" + scene.masked->uuid.get().toString(QUuid::Id128));
+
+        // Stroke properties and visibility are on the group containing the shape
+        QString stroke_id = "Stroke_" + scene.group->shapes[0]->uuid.get().toString(QUuid::Id128);
+        bool found = false;
+        auto groups = svg.elementsByTagName("g");
+        for ( int i = 0; i < groups.count(); i++ )
+        {
+            auto g = groups.at(i).toElement();
+            if ( g.attribute("id") == stroke_id )
+            {
+                found = true;
+                QCOMPARE(g.attribute("display"), QString("none"));
+                QCOMPARE(g.attribute("stroke-width"), QString("1"));
+                QVERIFY(!g.firstChildElement("ellipse").isNull());
+                QCOMPARE(g.lastChildElement("animate").attribute("attributeName"), QString("stroke-width"));
+            }
+        }
+        QVERIFY(found);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestCase)
+#include "test_svg_renderer.moc"